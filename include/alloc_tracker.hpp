@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// counts every global operator new/delete, the hooks live in alloc_tracker.cpp
+namespace AllocTracker {
+	struct Counters {
+		uint64_t allocations = 0;
+		uint64_t frees = 0;
+		uint64_t bytes = 0;
+	};
+
+	struct CallSite {
+		void* address = nullptr;
+		uint64_t count = 0;
+	};
+
+	// counters since the last endFrame()
+	Counters frame();
+	// moves the current counters to lastFrame() and starts counting a new frame
+	void endFrame();
+	Counters lastFrame();
+	// highest allocation count of a single frame since resetPeak()
+	uint64_t peakFrameAllocations();
+	// also forgets the call sites, so they only cover the frames after the reset
+	void resetPeak();
+
+	// return addresses of the allocating callers, empty unless built without NDEBUG.
+	// symbolize them with addr2line or the debugger. returns the number written, most frequent first
+	size_t getCallSites(CallSite* callSites, size_t maxCount);
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ktx2.hpp"
+#include "mesh_file.hpp"
+#include "vulkan_vertex.hpp"
+
+// decodes models and their textures into CPU memory on worker threads. the GPU resources are
+// created from the decoded data on the render thread
+class AssetLoader {
+public:
+	struct Request {
+		uint32_t ticket = 0;
+		std::string modelPath;
+		// indexed by texture type, empty when the model has no texture of that type
+		std::array<std::string, 3> texturePaths;
+		// try the cooked .ktx2 next to each texture before the source image
+		bool preferCooked = false;
+	};
+
+	struct DecodedTexture {
+		// source image, a cooked texture was read from the .ktx2 next to it
+		std::string path;
+		bool cooked = false;
+		Ktx2::Texture compressed;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<uint8_t> rgba;
+	};
+
+	struct DecodedModel {
+		uint32_t ticket = 0;
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		// empty means one LOD over all indices
+		std::vector<MeshFile::Lod> lods;
+		// ranges of LOD 0, empty when the model wasn't split into meshlets
+		std::vector<MeshFile::Meshlet> meshlets;
+		std::array<DecodedTexture, 3> textures;
+		// empty on success
+		std::string error;
+	};
+
+	AssetLoader() = default;
+	~AssetLoader() = default;
+
+	void init(uint32_t workerCount);
+	// drops queued requests and joins the workers
+	void cleanup();
+	void request(Request request);
+	// drops a request that is queued or decoded but not polled yet. false once a worker is decoding it
+	bool cancel(uint32_t ticket);
+	// moves one decoded model out, false when none is ready
+	bool poll(DecodedModel& decoded);
+	// requests queued, being decoded or decoded but not polled yet
+	size_t getPendingCount();
+
+	// decodes on the calling thread, throws when a file is missing or malformed
+	static void decode(const Request& request, DecodedModel& decoded);
+	static void decodeImage(const std::string& path, DecodedTexture& texture);
+
+private:
+	void workerLoop();
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<Request> requests;
+	std::deque<DecodedModel> results;
+	size_t decoding = 0;
+	bool stopping = false;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// packed archive: a header, the files as aligned blobs, a directory sorted by path hash and a
+// string table of the paths. the runtime maps it once and reads the blobs in place through Vfs
+namespace AssetPack {
+	const uint32_t VERSION = 1;
+	const char IDENTIFIER[8] = {'R', 'T', 'G', 'P', 'A', 'C', 'K', 0};
+	const char EXTENSION[] = ".rtgpack";
+	// blobs start on this boundary so SPIR-V words and vertex data can be read in place
+	const uint64_t BLOB_ALIGNMENT = 64;
+
+	enum Kind : uint32_t {
+		KIND_DATA = 0,
+		// validated SPIR-V, a whole number of words starting with the magic number
+		KIND_SPIRV = 1
+	};
+
+	struct Header {
+		char identifier[8];
+		uint32_t version;
+		uint32_t entryCount;
+		uint64_t fileSize;
+		uint64_t directoryOffset;
+		uint64_t stringsOffset;
+		uint64_t stringsSize;
+	};
+
+	struct Entry {
+		uint64_t hash;
+		uint64_t offset;
+		uint64_t size;
+		// offset into the string table
+		uint32_t path;
+		uint32_t kind;
+	};
+
+	struct Source {
+		// forward slashes, relative to the directory the pack is mounted from
+		std::string path;
+		std::string filePath;
+	};
+
+	// FNV-1a of the path inside the pack
+	uint64_t hashPath(std::string_view path);
+	bool isSpirv(const uint8_t* bytes, size_t size);
+	// checks that the directory, the strings and every blob lie inside the file
+	bool validate(const uint8_t* bytes, size_t size);
+	// reads every source and writes the pack, false with a message when a source can't be read
+	bool write(const std::string& path, const std::vector<Source>& sources, std::string& error);
+}
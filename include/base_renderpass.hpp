@@ -9,6 +9,9 @@
 #include "vulkan_types.hpp"
 #include "camera.hpp"
 #include "buffer_types.hpp"
+#include "render_graph.hpp"
+
+class DeletionQueue;
 
 class BaseRenderPass {
 public:
@@ -29,7 +32,11 @@ public:
 	virtual void init() = 0;
 	virtual void cleanup() = 0;
 	virtual void createImageResources() = 0;
+	// retires the images and framebuffers to the DeletionQueue
 	virtual void cleanupImageResources() = 0;
+	// call after the swapchain was recreated. the attachments are kept while they still cover the
+	// new extent, only the framebuffers are replaced then
+	void resize();
 	virtual void render(
 		std::vector<VkCommandBuffer>& commandBuffer,
 		uint32_t imageIndex,
@@ -39,11 +46,54 @@ public:
 		const Camera& camera,
 		const std::vector<DirectionalLightBuffer>& directionalLights,
 		GLFWwindow* window
-	) = 0;
+	);
 	void inline setSwapchain(Swapchain& swapchain) {
 		this->swapchain = swapchain;
 	}
+	void inline setProfiler(GpuProfiler* profiler) {
+		this->profiler = profiler;
+	}
+	void inline setFrameArena(FrameArena* arena) {
+		this->arena = arena;
+	}
+	void inline setMeshletCuller(const MeshletCuller* meshletCuller) {
+		this->meshletCuller = meshletCuller;
+	}
+	void inline setGeometryArena(const GeometryArena* geometryArena) {
+		this->geometryArena = geometryArena;
+	}
+	void inline setInstanceBuffer(const InstanceBuffer* instanceBuffer) {
+		this->instanceBuffer = instanceBuffer;
+	}
+	void inline setRenderQueue(const RenderQueue* renderQueue) {
+		this->renderQueue = renderQueue;
+	}
+	void inline setDepthPrepass(bool depthPrepass) {
+		this->depthPrepass = depthPrepass;
+	}
+	// the pool of the secondary command buffers, set before init
+	void inline setCommandPool(VkCommandPool commandPool) {
+		this->commandPool = commandPool;
+	}
+	// destroys what frames in flight may still use, set before init
+	void inline setDeletionQueue(DeletionQueue* deletionQueue) {
+		this->deletionQueue = deletionQueue;
+	}
+	void inline setCommandCaching(bool enabled, uint64_t sceneGeneration) {
+		cacheCommands = enabled;
+		this->sceneGeneration = sceneGeneration;
+	}
 protected:
+	// declares the passes of this render mode, called with the swapchain image already imported
+	virtual void buildGraph(RenderGraph& graph) = 0;
+	// replaces the framebuffers for the current swapchain, keeping the graph's images
+	virtual void resizeFramebuffers() = 0;
+	void createGraph();
+	void cleanupGraph();
+
+	// the swapchain extent rounded up to Config::ATTACHMENT_EXTENT_GRANULARITY
+	static VkExtent2D getAttachmentExtent(VkExtent2D extent);
+
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 	VkDevice device = VK_NULL_HANDLE;
 	CommonDescriptor& commonDescriptor;
@@ -52,4 +102,20 @@ protected:
 	std::vector<VkFramebuffer> framebuffers;
 	Swapchain& swapchain;
 	VkFormat depthFormat;
+
+	std::unique_ptr<RenderGraph> graph;
+	RenderGraphResource swapchainImage = 0;
+	// what the graph's images were created with, at least the swapchain extent
+	VkExtent2D attachmentExtent{};
+	DeletionQueue* deletionQueue = nullptr;
+	GpuProfiler* profiler = nullptr;
+	FrameArena* arena = nullptr;
+	const MeshletCuller* meshletCuller = nullptr;
+	const GeometryArena* geometryArena = nullptr;
+	const InstanceBuffer* instanceBuffer = nullptr;
+	const RenderQueue* renderQueue = nullptr;
+	bool depthPrepass = false;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	bool cacheCommands = false;
+	uint64_t sceneGeneration = 0;
 };
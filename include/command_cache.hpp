@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+
+#include "constants.hpp"
+#include "render_stats.hpp"
+
+struct FrameContext;
+
+// the draws of one subpass in a secondary command buffer per frame slot. a slot is recorded again
+// only when the scene generation moved on since it was last recorded, otherwise the frame replays
+// it with vkCmdExecuteCommands and the CPU records nothing
+class CommandCache {
+public:
+	CommandCache() = default;
+	~CommandCache() = default;
+
+	// the secondary buffers come from commandPool, which has to allow resetting single buffers
+	void init(VkDevice device, VkCommandPool commandPool);
+	void cleanup();
+	// records the subpass through draw, into the slot's secondary buffer when the context caches
+	// commands and inline into the frame's command buffer otherwise. begin the subpass with
+	// getSubpassContents
+	void record(const FrameContext& context, VkRenderPass renderPass, uint32_t subpass, const std::function<void(VkCommandBuffer)>& draw);
+
+	static VkSubpassContents getSubpassContents(const FrameContext& context);
+
+private:
+	struct Slot {
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		// 0 until recorded
+		uint64_t generation = 0;
+		// what recording counted, counted again by every replay
+		RenderCounters counters;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	std::array<Slot, Config::MAX_FRAMES_IN_FLIGHT> slots{};
+};
@@ -1,5 +1,55 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+
 namespace Config{
 	const int MAX_FRAMES_IN_FLIGHT = 2;
+	const int DEFAULT_PIXEL_BLOCK_SIZE = 8;
+	const size_t FRAME_ARENA_SIZE = 64 * 1024;
+	// frames rendered before the benchmark expects zero heap allocations per frame, once streaming has settled
+	const uint32_t ALLOCATION_WARMUP_FRAMES = 300;
+	// default VRAM budget of streamed textures, adjustable from the GUI
+	const size_t TEXTURE_STREAMING_BUDGET = 256 * 1024 * 1024;
+	// levels up to this size stay resident from load on
+	const uint32_t TEXTURE_STREAMING_TAIL_SIZE = 64;
+	// mip upgrades started per frame
+	const uint32_t TEXTURE_STREAMING_MAX_UPLOADS = 2;
+	// threads decoding models and textures requested at runtime
+	const uint32_t ASSET_LOADER_WORKERS = 2;
+	// decoded models turned into GPU resources per frame
+	const uint32_t ASSET_STREAMING_MAX_UPLOADS = 2;
+	// models a descriptor pool added at runtime has room for
+	const uint32_t MODEL_DESCRIPTOR_POOL_GROWTH = 64;
+	// vertices and indices of a geometry arena block, larger meshes get a block of their own
+	const uint32_t GEOMETRY_BLOCK_VERTICES = 1 << 20;
+	const uint32_t GEOMETRY_BLOCK_INDICES = 1 << 22;
+	// transforms of all instance groups together, 64 bytes each
+	const uint32_t MAX_INSTANCES = 1 << 18;
+	// resident bytes of world cells, adjustable from the GUI
+	const size_t WORLD_STREAMING_BUDGET = 512 * 1024 * 1024;
+	// used when the scene doesn't set a load radius
+	const float WORLD_STREAMING_LOAD_RADIUS = 64.0f;
+	// cells unload only past this multiple of the load radius so they don't flicker at the edge
+	const float WORLD_STREAMING_UNLOAD_FACTOR = 1.25f;
+	// cell loads started per frame
+	const uint32_t WORLD_STREAMING_MAX_CELL_LOADS = 1;
+	// 16-bit positions across the mesh bounds instead of floats
+	const bool QUANTIZE_VERTEX_POSITIONS = true;
+	// screen-space error in pixels a LOD may have, adjustable from the GUI
+	const float LOD_ERROR_PIXELS = 1.0f;
+	// a coarser LOD is only taken once its error is this fraction under the threshold
+	const float LOD_HYSTERESIS = 0.25f;
+	// multiple of the error threshold the shadow pass accepts
+	const float SHADOW_LOD_BIAS = 2.0f;
+	// cull the meshlets of LOD 0 draws on the GPU, adjustable from the GUI
+	const bool MESHLET_CULLING = true;
+	// record draws in RenderQueue order instead of scene order, adjustable from the GUI
+	const bool SORT_DRAWS = true;
+	// lay down depth before forward shading when the scene doesn't ask for it, adjustable from the GUI
+	const bool DEPTH_PREPASS = false;
+	// replay each pass's recorded draws while the scene is unchanged, adjustable from the GUI
+	const bool CACHE_COMMANDS = true;
+	// render targets are allocated in multiples of this many pixels, resizes within them keep the images
+	const uint32_t ATTACHMENT_EXTENT_GRANULARITY = 256;
 }
\ No newline at end of file
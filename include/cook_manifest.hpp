@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// record of the outputs rtg-cook produced. the cooker skips outputs whose input hash is unchanged,
+// the runtime only uses cooked outputs the manifest lists with their format and size
+namespace CookManifest {
+	const uint32_t VERSION = 1;
+	const char FILENAME[] = "cook_manifest.json";
+
+	struct Entry {
+		// relative to the manifest directory
+		std::string source;
+		std::string format;
+		// the source bytes together with the cook settings
+		uint64_t inputHash = 0;
+		uint64_t size = 0;
+	};
+
+	// keyed by output path relative to the manifest directory, forward slashes
+	using Entries = std::unordered_map<std::string, Entry>;
+
+	bool read(const std::string& path, Entries& entries);
+	bool write(const std::string& path, const Entries& entries);
+
+	// loads the manifest the runtime validates cooked outputs against, through Vfs. call before
+	// any loader thread starts
+	bool load(const std::string& path);
+	// whether the cooked file was produced by the cooker in this format and is complete
+	bool isCurrent(const std::string& outputPath, size_t size, const char* format);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class GpuProfiler;
+
+// scoped CPU zones recorded into a ring buffer per thread
+class CpuProfiler {
+public:
+	static constexpr size_t EVENTS_PER_THREAD = 1 << 16;
+
+	struct Event {
+		// must outlive the profiler, use string literals or intern()
+		const char* name = nullptr;
+		int64_t beginNs = 0;
+		int64_t endNs = 0;
+	};
+
+	static inline int64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()
+		).count();
+	}
+
+	// returns a pointer that stays valid until the program exits
+	static const char* intern(const std::string& name);
+	static void record(const char* name, int64_t beginNs, int64_t endNs);
+	// CPU zones of every thread and the GPU scopes on one timeline
+	static bool writeChromeTrace(const std::string& path, const GpuProfiler* gpuProfiler);
+
+private:
+	struct ThreadBuffer {
+		std::vector<Event> events;
+		std::atomic<uint64_t> written{0};
+		uint32_t threadIndex = 0;
+	};
+
+	static ThreadBuffer& threadBuffer();
+	// buffers are never freed so that zones of exited threads can still be exported
+	static std::vector<std::unique_ptr<ThreadBuffer>>& threadBuffers();
+};
+
+class CpuProfileScope {
+public:
+	explicit CpuProfileScope(const char* name) : name(name), beginNs(CpuProfiler::now()) {}
+	~CpuProfileScope() {
+		CpuProfiler::record(name, beginNs, CpuProfiler::now());
+	}
+	CpuProfileScope(const CpuProfileScope&) = delete;
+	CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+private:
+	const char* name;
+	int64_t beginNs;
+};
+
+#define RTG_PROFILE_CONCAT_INNER(a, b) a##b
+#define RTG_PROFILE_CONCAT(a, b) RTG_PROFILE_CONCAT_INNER(a, b)
+
+// zones compile out unless RTG_CPU_PROFILER is defined
+#ifdef RTG_CPU_PROFILER
+#define PROFILE_ZONE(name) CpuProfileScope RTG_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
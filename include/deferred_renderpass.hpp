@@ -8,6 +8,7 @@
 #include "base_renderpass.hpp"
 #include "vulkan_types.hpp"
 #include "shadowmapping_renderpass.hpp"
+#include "command_cache.hpp"
 
 class DeferredRenderPass : public BaseRenderPass {
 public:
@@ -31,31 +32,27 @@ public:
 	void cleanup() override;
 	void createImageResources() override;
 	void cleanupImageResources() override;
-	void render(
-		std::vector<VkCommandBuffer>& commandBuffer,
-		uint32_t imageIndex,
-		uint32_t currentFrame,
-		std::vector<void*>& modelMatrixBuffersMapped,
-		const std::vector<AssetData>& assets,
-		const Camera& camera,
-		const std::vector<DirectionalLightBuffer>& directionalLights,
-		GLFWwindow* window
-	) override;
+protected:
+	void buildGraph(RenderGraph& graph) override;
+	void resizeFramebuffers() override;
 private:
 	void createRenderPass();
 	void createDescriptorSetLayout();
 	void createDescriptorPool();
 	void createDescriptorSets();
-	void createGBuffers();
 	void createFramebuffers();
 	void createGraphicsPipeline();
+	void draw(const FrameContext& context);
+	// the G-buffer subpass, into the frame's command buffer or a cached secondary one
+	void drawGBuffer(VkCommandBuffer commandBuffer, const FrameContext& context);
 
-	ImageResource albedo;
-	ImageResource position;
-	ImageResource normal;
-	ImageResource material;
-	ImageResource depth;
-	ImageResource ssao;
+	RenderGraphResource albedo = 0;
+	RenderGraphResource position = 0;
+	RenderGraphResource normal = 0;
+	RenderGraphResource material = 0;
+	RenderGraphResource depth = 0;
+	RenderGraphResource ssao = 0;
+	RenderGraphResource shadowMap = 0;
 
 	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
 	Descriptor ssaoDescriptor;
@@ -70,4 +67,5 @@ private:
 	VkPipelineLayout lightingPipelineLayout = VK_NULL_HANDLE;
 
 	std::unique_ptr<BaseShadowRenderPass> shadowPass = nullptr;
+	CommandCache gBufferCache;
 };
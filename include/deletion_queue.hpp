@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "constants.hpp"
+
+// Vulkan objects that frames in flight may still use, destroyed once every frame submitted before
+// they were retired has completed. the frame slots' fences tell how far the GPU got, nothing has
+// to wait for the device to go idle
+class DeletionQueue {
+public:
+	DeletionQueue() = default;
+	~DeletionQueue() = default;
+
+	// destroy runs after every frame submitted so far, it may retire more objects itself
+	void push(std::function<void()> destroy);
+	// destroys the framebuffers and empties the vector
+	void retireFramebuffers(VkDevice device, std::vector<VkFramebuffer>& framebuffers);
+	// call after submitting the command buffer of the frame slot
+	void submit(uint32_t frame);
+	// call after the fence wait of the frame slot, destroys what its last submission outlived
+	void collect(uint32_t frame);
+	// destroys everything, once the device is idle
+	void flush();
+
+	inline size_t getPendingCount() const {
+		return entries.size();
+	}
+
+private:
+	struct Entry {
+		// submissions made when it was retired
+		uint64_t submission;
+		std::function<void()> destroy;
+	};
+
+	void run(uint64_t completed);
+
+	// in submission order
+	std::vector<Entry> entries;
+	// reused by run, the entries it destroys
+	std::vector<Entry> ready;
+	uint64_t submissions = 0;
+	std::array<uint64_t, Config::MAX_FRAMES_IN_FLIGHT> frameSubmissions{};
+};
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "base_renderpass.hpp"
+#include "command_cache.hpp"
 
 class ForwardRenderPass : public BaseRenderPass {
 public:
@@ -31,32 +32,34 @@ public:
 	void cleanup() override;
 	void createImageResources() override;
 	void cleanupImageResources() override;
-	void render(
-		std::vector<VkCommandBuffer>& commandBuffer,
-		uint32_t imageIndex,
-		uint32_t currentFrame,
-		std::vector<void*>& modelMatrixBuffersMapped,
-		const std::vector<AssetData>& assets,
-		const Camera& camera,
-		const std::vector<DirectionalLightBuffer>& directionalLights,
-		GLFWwindow* window
-	) override;
+protected:
+	void buildGraph(RenderGraph& graph) override;
+	void resizeFramebuffers() override;
 private:
 	void createRenderPass();
-	void createColorResources();
-	void createDepthResources();
 	void createFramebuffers();
 	void createGraphicsPipeline();
+	void draw(const FrameContext& context);
+	// the subpasses, into the frame's command buffer or a cached secondary one
+	void drawDepth(VkCommandBuffer commandBuffer, const FrameContext& context);
+	void drawShaded(VkCommandBuffer commandBuffer, const FrameContext& context);
+	void bindCommonState(VkCommandBuffer commandBuffer, const FrameContext& context);
+	void bindModelMatrix(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t index);
+	// the object's culled meshlets or its whole LOD
+	void drawModel(VkCommandBuffer commandBuffer, const FrameContext& context, uint32_t index);
 
-	VkImage colorImage = VK_NULL_HANDLE;
-	VkDeviceMemory colorImageMemory = VK_NULL_HANDLE;
-	VkImageView colorImageView = VK_NULL_HANDLE;
-
-	VkImage depthImage = VK_NULL_HANDLE;
-	VkDeviceMemory depthImageMemory = VK_NULL_HANDLE;
-	VkImageView depthImageView = VK_NULL_HANDLE;
+	RenderGraphResource colorImage = 0;
+	RenderGraphResource depthImage = 0;
 
+	// shading without a pre-pass, depth test LESS with writes
 	VkPipeline pipeline = VK_NULL_HANDLE;
+	// shading after the pre-pass, depth test EQUAL without writes
+	VkPipeline shadingPipeline = VK_NULL_HANDLE;
+	// subpass 0, positions only and no fragment shader
+	VkPipeline depthPrepassPipeline = VK_NULL_HANDLE;
+
+	CommandCache prepassCache;
+	CommandCache shadingCache;
 	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
 
 	VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
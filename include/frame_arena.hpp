@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// linear allocator for data that lives for one frame of recording.
+// an overflowing frame falls back to the heap and the arena grows on the next reset
+class FrameArena {
+public:
+	explicit FrameArena(size_t capacity);
+	~FrameArena() = default;
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// memory is uninitialized and never destructed
+	template <typename T>
+	T* allocate(size_t count) {
+		static_assert(std::is_trivially_destructible<T>::value, "frame arena memory is never destructed");
+		return static_cast<T*>(allocateBytes(sizeof(T) * count, alignof(T)));
+	}
+	void reset();
+
+	inline size_t getCapacity() const {
+		return capacity;
+	}
+	inline size_t getUsed() const {
+		return used + overflowBytes;
+	}
+	inline size_t getPeak() const {
+		return peak;
+	}
+
+private:
+	void* allocateBytes(size_t size, size_t alignment);
+
+	std::unique_ptr<std::byte[]> memory;
+	size_t capacity = 0;
+	size_t used = 0;
+	size_t peak = 0;
+	std::vector<std::unique_ptr<std::byte[]>> overflow;
+	size_t overflowBytes = 0;
+};
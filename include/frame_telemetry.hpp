@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// CPU frame-to-frame times with rolling percentiles and stutter detection
+class FrameTelemetry {
+public:
+	static constexpr size_t WINDOW_FRAMES = 1024;
+	static constexpr size_t MAX_STUTTERS = 64;
+	// fixed buckets keep the run-long histogram bounded on soak runs, the last one collects the overflow
+	static constexpr float BUCKET_MS = 0.5f;
+	static constexpr size_t BUCKET_COUNT = 100;
+
+	// work that may cause a hitch, tagged onto the frame it overlapped
+	enum Subsystem : uint32_t {
+		SWAPCHAIN_RECREATE = 1 << 0,
+		PASS_REBUILD = 1 << 1,
+		ASSET_UPLOAD = 1 << 2
+	};
+
+	struct Stats {
+		float p50Ms = 0.0f;
+		float p95Ms = 0.0f;
+		float p99Ms = 0.0f;
+		float maxMs = 0.0f;
+	};
+
+	struct Stutter {
+		uint64_t frame = 0;
+		float frameMs = 0.0f;
+		float medianMs = 0.0f;
+		uint32_t subsystems = 0;
+	};
+
+	// a frame is a stutter when it is longer than both thresholds
+	struct StutterConfig {
+		float medianFactor = 2.0f;
+		float minMs = 4.0f;
+	};
+
+	FrameTelemetry() = default;
+	~FrameTelemetry() = default;
+
+	// call once per frame, the interval since the previous call is the frame time
+	void beginFrame(int64_t nowNs);
+	inline void markSubsystem(Subsystem subsystem) {
+		pendingSubsystems |= subsystem;
+	}
+
+	bool writeCsv(const std::string& path) const;
+	bool writeJson(const std::string& path) const;
+	static std::string subsystemNames(uint32_t subsystems);
+
+	// percentiles over the last WINDOW_FRAMES frames
+	inline const Stats& getStats() const {
+		return stats;
+	}
+	// percentiles over the whole run, accurate to BUCKET_MS
+	Stats getRunStats() const;
+	inline StutterConfig& getStutterConfig() {
+		return stutterConfig;
+	}
+	// ring buffer, the oldest sample is at getSampleOffset()
+	inline const std::array<float, WINDOW_FRAMES>& getFrameTimes() const {
+		return frameTimes;
+	}
+	inline size_t getSampleOffset() const {
+		return sampleCount < WINDOW_FRAMES ? 0 : sampleHead;
+	}
+	inline size_t getSampleCount() const {
+		return sampleCount < WINDOW_FRAMES ? static_cast<size_t>(sampleCount) : WINDOW_FRAMES;
+	}
+	inline const std::array<uint64_t, BUCKET_COUNT>& getHistogram() const {
+		return histogram;
+	}
+	// ring buffer of the most recent stutters
+	inline const std::array<Stutter, MAX_STUTTERS>& getStutters() const {
+		return stutters;
+	}
+	inline uint64_t getStutterCount() const {
+		return stutterCount;
+	}
+	inline uint64_t getFrameCount() const {
+		return sampleCount;
+	}
+
+private:
+	void updateStats();
+
+	int64_t lastFrameNs = 0;
+	uint32_t pendingSubsystems = 0;
+	uint32_t previousSubsystems = 0;
+
+	std::array<float, WINDOW_FRAMES> frameTimes{};
+	std::array<uint32_t, WINDOW_FRAMES> sampleSubsystems{};
+	std::array<bool, WINDOW_FRAMES> sampleStutters{};
+	size_t sampleHead = 0;
+	uint64_t sampleCount = 0;
+	// reused by updateStats() to avoid per-frame allocations
+	std::array<float, WINDOW_FRAMES> sortScratch{};
+	Stats stats;
+
+	std::array<uint64_t, BUCKET_COUNT> histogram{};
+	float runMaxMs = 0.0f;
+
+	StutterConfig stutterConfig;
+	std::array<Stutter, MAX_STUTTERS> stutters{};
+	uint64_t stutterCount = 0;
+};
@@ -7,9 +7,12 @@
 #include <memory>
 
 #include "vulkan_types.hpp"
+#include "render_graph.hpp"
+#include "command_cache.hpp"
 
 class GLFWwindow;
 class Camera;
+class DeletionQueue;
 
 class GBufferRenderPass {
 public:
@@ -19,44 +22,49 @@ public:
 		CommonDescriptor& commonDescriptor,
 		VkDescriptorSetLayout modelTextureDescriptorSetLayout,
 		Swapchain& swapchain,
-		VkFormat depthFormat
+		VkFormat depthFormat,
+		uint32_t resolutionDivisor = 1
 	) : physicalDevice(physicalDevice),
 		device(device),
 		commonDescriptor(commonDescriptor),
 		modelTextureDescriptorSetLayout(modelTextureDescriptorSetLayout),
 		swapchain(swapchain),
-		depthFormat(depthFormat) {};
+		depthFormat(depthFormat),
+		resolutionDivisor(resolutionDivisor) {};
 	~GBufferRenderPass() = default;
 
-	void init();
-	void createImageResources();
+	// the cached G-buffer draws come from commandPool
+	void init(VkCommandPool commandPool);
 	void cleanup();
-	void cleanupImageResources();
-	void generateGBuffer(
-		std::vector<VkCommandBuffer>& commandBuffers,
-		uint32_t imageIndex,
-		uint32_t currentFrame,
-		std::vector<void*>& modelMatrixBuffersMapped,
-		const std::vector<AssetData>& models
-	);
+	// declares the G-buffer images for attachmentExtent and the pass filling them
+	void declareResources(RenderGraph& graph, VkExtent2D attachmentExtent);
+	// samples the G-buffer from a later pass
+	void readGBuffer(RenderGraph::PassBuilder& pass) const;
+	void createImageResources(const RenderGraph& graph);
+	void cleanupImageResources(DeletionQueue& deletionQueue);
+	// the swapchain was resized within the extent the images were declared with
+	void resizeFramebuffers(DeletionQueue& deletionQueue, const RenderGraph& graph);
+	void generateGBuffer(const FrameContext& context);
 	inline VkDescriptorSetLayout getGBufferLayout() {
 		return descriptor.layout;
 	}
-	inline std::vector<VkDescriptorSet> getGBuffer() {
+	inline const std::vector<VkDescriptorSet>& getGBuffer() const {
 		return descriptor.sets;
 	}
+	inline VkExtent2D getExtent() const {
+		return extent;
+	}
 
 private:
 	void createRenderPass();
-	void createGBufferResources();
-	void createFramebuffers();
+	void updateExtent();
+	void createFramebuffers(const RenderGraph& graph);
 	void createGraphicsPipeline();
 	void createDescriptorSetLayout();
 	void createDescriptorPool();
-	void createDescriptorSets();
+	void createDescriptorSets(const RenderGraph& graph);
 	void createSampler();
-	void transitionGBufferToSampler(VkCommandBuffer commandBuffer);
-	void transitionGBufferToAttachment(VkCommandBuffer commandBuffer);
+	void drawGBuffer(VkCommandBuffer commandBuffer, const FrameContext& context);
 
     VkPhysicalDevice physicalDevice;
 	VkDevice device;
@@ -66,11 +74,8 @@ private:
 	VkPipeline pipeline = VK_NULL_HANDLE;
 	VkSampler sampler;
 
-	ImageResource albedo;
-	ImageResource position;
-	ImageResource normal;
-	ImageResource material;
-	ImageResource depth;
+	// indexed by binding: albedo, position, normal, material, depth
+	std::array<RenderGraphResource, 5> gBufferImages{};
 
 	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
 	Descriptor descriptor;
@@ -80,5 +85,9 @@ private:
 	VkFormat depthFormat;
 	Swapchain& swapchain;
 
-	bool isTransitioned = false;
+	// the G-buffer covers swapchain.extent / resolutionDivisor, rounded up. the images may be larger
+	uint32_t resolutionDivisor;
+	VkExtent2D extent{};
+
+	CommandCache commandCache;
 };
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// first fit over the free ranges of [0, capacity), freed ranges merge with their neighbors
+class RangeAllocator {
+public:
+	static const uint32_t INVALID = UINT32_MAX;
+
+	RangeAllocator() = default;
+	explicit RangeAllocator(uint32_t capacity);
+
+	// INVALID when no free range is large enough
+	uint32_t allocate(uint32_t size);
+	void free(uint32_t offset, uint32_t size);
+
+	inline uint32_t getCapacity() const {
+		return capacity;
+	}
+	inline uint32_t getUsed() const {
+		return used;
+	}
+
+private:
+	struct Range {
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	// sorted by offset
+	std::vector<Range> freeRanges;
+	uint32_t capacity = 0;
+	uint32_t used = 0;
+};
+
+// the vertices and indices of every model live in a few large device-local blocks, sub-allocated
+// per model. draws of models in the same block share one vertex and index buffer binding and
+// address their mesh with firstIndex and vertexOffset. blocks are shared by the graphics and
+// transfer queue families, uploads need no ownership transfer
+class GeometryArena {
+public:
+	static const uint32_t NO_BLOCK = UINT32_MAX;
+
+	struct Allocation {
+		uint32_t block = NO_BLOCK;
+		uint32_t firstVertex = 0;
+		uint32_t vertexCount = 0;
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+	};
+
+	struct Stats {
+		uint32_t blocks = 0;
+		uint32_t allocations = 0;
+		uint64_t usedVertices = 0;
+		uint64_t vertexCapacity = 0;
+		uint64_t usedIndices = 0;
+		uint64_t indexCapacity = 0;
+	};
+
+	GeometryArena() = default;
+	~GeometryArena() = default;
+
+	// queueFamilies share the blocks, one family uses them exclusively
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, const std::vector<uint32_t>& queueFamilies);
+	void cleanup();
+	// adds a block when none has room, one larger than the default for oversized meshes
+	Allocation allocate(uint32_t vertexCount, uint32_t indexCount);
+	// once no frame in flight draws the mesh anymore
+	void free(const Allocation& allocation);
+
+	// copies what PackedVertex::pack wrote for the allocation's vertices, and its indices
+	void copyVertices(VkCommandBuffer commandBuffer, const Allocation& allocation, VkBuffer stagingBuffer) const;
+	void copyIndices(VkCommandBuffer commandBuffer, const Allocation& allocation, VkBuffer stagingBuffer) const;
+
+	// binds both PackedVertex streams and the indices of a block
+	void bind(VkCommandBuffer commandBuffer, uint32_t block) const;
+	// binds only the position stream, for depth-only passes
+	void bindPositions(VkCommandBuffer commandBuffer, uint32_t block) const;
+
+	Stats getStats() const;
+
+private:
+	struct Block {
+		// positions from 0, attributes from attributeOffset
+		VkBuffer vertexBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
+		VkDeviceSize attributeOffset = 0;
+		VkBuffer indexBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory indexMemory = VK_NULL_HANDLE;
+		RangeAllocator vertices;
+		RangeAllocator indices;
+		uint32_t allocations = 0;
+	};
+
+	void createBlock(uint32_t vertexCapacity, uint32_t indexCapacity);
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory);
+
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	std::vector<uint32_t> queueFamilies;
+	std::vector<Block> blocks;
+};
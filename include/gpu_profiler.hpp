@@ -0,0 +1,138 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "constants.hpp"
+
+// timestamp queries around each pass, read back MAX_FRAMES_IN_FLIGHT frames later
+class GpuProfiler {
+public:
+	static constexpr uint32_t MAX_SCOPES = 64;
+	static constexpr size_t HISTORY_FRAMES = 240;
+
+	// results are written in the bit order of these flags
+	static constexpr VkQueryPipelineStatisticFlags PIPELINE_STATISTICS =
+		VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+		VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+	static constexpr uint32_t PIPELINE_STATISTIC_COUNT = 5;
+
+	struct PipelineStatistics {
+		uint64_t vertexInvocations = 0;
+		uint64_t clippingInvocations = 0;
+		uint64_t clippingPrimitives = 0;
+		uint64_t fragmentInvocations = 0;
+		uint64_t computeInvocations = 0;
+	};
+
+	struct ScopeTiming {
+		std::string name;
+		uint32_t depth = 0;
+		// relative to the calibration timestamp
+		double beginMs = 0.0;
+		double durationMs = 0.0;
+		// queries of one type can't nest, so only top-level scopes collect statistics
+		bool hasStatistics = false;
+		PipelineStatistics statistics;
+	};
+
+	GpuProfiler() = default;
+	~GpuProfiler() = default;
+
+	// pipelineStatistics requires the pipelineStatisticsQuery device feature to be enabled
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, bool pipelineStatistics);
+	void cleanup();
+	// maps GPU timestamps onto the CPU steady_clock, waits for the queue to go idle
+	void calibrate(VkCommandPool commandPool, VkQueue queue);
+	// call right after the frame's fence wait, before any scope is recorded
+	void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+	uint32_t beginScope(VkCommandBuffer commandBuffer, const std::string& name);
+	void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+	// chrome trace events of the history, timestamps in CPU steady_clock microseconds
+	void appendTraceEvents(nlohmann::json& events) const;
+
+	inline bool isEnabled() const {
+		return queryPool != VK_NULL_HANDLE;
+	}
+	inline bool hasPipelineStatistics() const {
+		return statisticsQueryPool != VK_NULL_HANDLE;
+	}
+	// scopes of the most recently resolved frame, in recording order
+	inline const std::vector<ScopeTiming>& getTimings() const {
+		return timings;
+	}
+	inline double getFrameTimeMs() const {
+		return frameTimeMs;
+	}
+
+private:
+	struct PendingScope {
+		std::string name;
+		uint32_t depth = 0;
+		// index into the frame's statistics queries, packed so the range can be read in one call
+		uint32_t statisticsQuery = UINT32_MAX;
+	};
+
+	struct FrameQueries {
+		std::array<PendingScope, MAX_SCOPES> scopes;
+		uint32_t scopeCount = 0;
+		uint32_t statisticsCount = 0;
+		bool recorded = false;
+	};
+
+	void resolveFrame(uint32_t frameIndex);
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueryPool queryPool = VK_NULL_HANDLE;
+	VkQueryPool statisticsQueryPool = VK_NULL_HANDLE;
+	double timestampPeriod = 1.0;
+	uint64_t timestampMask = ~0ull;
+
+	std::array<FrameQueries, Config::MAX_FRAMES_IN_FLIGHT> frames;
+	uint32_t currentFrame = 0;
+	uint32_t currentDepth = 0;
+
+	std::vector<uint64_t> queryResults;
+	std::vector<uint64_t> statisticsResults;
+	std::vector<ScopeTiming> timings;
+	double frameTimeMs = 0.0;
+	uint64_t baseTimestamp = 0;
+	int64_t baseCpuNs = 0;
+	bool hasBaseTimestamp = false;
+
+	// ring buffer for the trace export
+	std::vector<std::vector<ScopeTiming>> history;
+	size_t historyHead = 0;
+};
+
+// records a begin/end timestamp pair for its lifetime, no-op without a profiler
+class GpuProfileScope {
+public:
+	GpuProfileScope(GpuProfiler* profiler, VkCommandBuffer commandBuffer, const std::string& name)
+		: profiler(profiler), commandBuffer(commandBuffer) {
+		if (profiler != nullptr) {
+			scope = profiler->beginScope(commandBuffer, name);
+		}
+	}
+	~GpuProfileScope() {
+		if (profiler != nullptr) {
+			profiler->endScope(commandBuffer, scope);
+		}
+	}
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+	GpuProfiler* profiler;
+	VkCommandBuffer commandBuffer;
+	uint32_t scope = 0;
+};
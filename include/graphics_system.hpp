@@ -3,14 +3,13 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
-#include <nlohmann/json.hpp>
-
 #include <string>
 #include <vector>
 #include <cstddef>
 
 #include "vulkan_state.hpp"
 #include "gui_renderpass.hpp"
+#include "scene_file.hpp"
 
 class WindowState;
 class PointLightBuffer;
@@ -18,6 +17,7 @@ class DirectionalLightBuffer;
 class AssetData;
 class Camera;
 class DirectionalLightBuffer;
+class WorldStreamer;
 
 class GraphicsSystem {
 public:
@@ -25,8 +25,31 @@ public:
 	~GraphicsSystem() = default;
 	void init();
 	void createLevelResource(size_t assetCount, size_t pointLightCount, size_t dirLightCount);
-	ModelResource createModelResource(std::string textureDir, std::string modelDir, nlohmann::json data);
+	ModelResource createModelResource(const std::string& textureDir, const std::string& modelDir, const SceneFile::ModelRef& model);
+	ModelResource requestModelResource(const std::string& textureDir, const std::string& modelDir, const SceneFile::ModelRef& model);
+	void updateAssetStreaming();
+	bool applyResidentModels(std::vector<AssetData>& assets, int64_t* uploadBeginNs = nullptr);
+	void releaseModelResource(const ModelResource& model);
+	AssetData requestInstanceGroup(
+		const std::string& textureDir,
+		const std::string& modelDir,
+		const SceneFile::Scene& scene,
+		const SceneFile::InstanceGroup& group
+	);
+	void releaseInstances(const AssetData& asset);
+	bool isStreamingIdle() {
+		return vulkanState.isStreamingIdle();
+	}
+	void setWorldStreamer(WorldStreamer* streamer) {
+		vulkanState.setWorldStreamer(streamer);
+	}
+	void setDepthPrepass(bool enabled) {
+		vulkanState.setDepthPrepass(enabled);
+	}
 	void updateLights(std::vector<PointLightBuffer>& pointLights, std::vector<DirectionalLightBuffer>& directionalLights);
+	void inline selectLods(std::vector<AssetData>& assets, const Camera& camera) {
+		vulkanState.selectLods(assets, camera);
+	}
 	void inline render(const std::vector<AssetData>& assets, const Camera& camera, const std::vector<DirectionalLightBuffer>& directionalLights) {
 		vulkanState.updateCamera(camera);
 		vulkanState.cleanupRenderModeResource();
@@ -36,6 +59,9 @@ public:
 	void changeRenderPass() {
 		vulkanState.changeRenderPass();
 	}
+	void printBenchmarkReport(std::ostream& out) const {
+		vulkanState.printBenchmarkReport(out);
+	}
 private:
 	VulkanState vulkanState;
 };
\ No newline at end of file
@@ -11,8 +11,18 @@
 #include <vector>
 
 #include "vulkan_types.hpp"
+#include "constants.hpp"
 
 class GLFWwindow;
+class GpuProfiler;
+class FrameTelemetry;
+class TextureStreamer;
+class LodSelector;
+class MeshletCuller;
+class GeometryArena;
+class RenderQueue;
+class WorldStreamer;
+class DeletionQueue;
 
 class VulkanGUI {
 public:
@@ -30,7 +40,8 @@ public:
 	);
 	void cleanup(VkDevice device);
 	void createFramebuffer(VkDevice device, Swapchain& swapchain);
-	void recreateFramebuffer(VkDevice device, Swapchain& swapchain);
+	// the old framebuffers go to the DeletionQueue
+	void recreateFramebuffer(VkDevice device, Swapchain& swapchain, DeletionQueue& deletionQueue);
 	void render(VkCommandBuffer commandBuffer, VkExtent2D swapchainExtent, uint32_t imageIndex);
 
 	int inline getMode() const {
@@ -39,12 +50,54 @@ public:
 	float inline getIntensity() const {
 		return intensity;
 	}
+	uint32_t inline getPixelBlockSize() const {
+		return static_cast<uint32_t>(pixelBlockSize);
+	}
+	bool inline isPixelMode() const {
+		return mode == 2;
+	}
+	bool inline isForwardMode() const {
+		return mode == 0;
+	}
+	bool inline isDepthPrepass() const {
+		return depthPrepass;
+	}
+	void inline setDepthPrepass(bool enabled) {
+		depthPrepass = enabled;
+	}
+	bool inline isCacheCommands() const {
+		return cacheCommands;
+	}
 	void inline proceedRenderModeIndex() {
 		mode = (mode + 1) % std::size(renderModes);
 	}
 	void inline setRenderModeChangedCallback(std::function<void()> callback) {
 		renderModeChangedCallback = callback;
 	}
+	void inline setGpuProfiler(const GpuProfiler* profiler) {
+		gpuProfiler = profiler;
+	}
+	void inline setFrameTelemetry(FrameTelemetry* telemetry) {
+		frameTelemetry = telemetry;
+	}
+	void inline setTextureStreamer(TextureStreamer* streamer) {
+		textureStreamer = streamer;
+	}
+	void inline setLodSelector(LodSelector* selector) {
+		lodSelector = selector;
+	}
+	void inline setMeshletCuller(MeshletCuller* culler) {
+		meshletCuller = culler;
+	}
+	void inline setGeometryArena(const GeometryArena* arena) {
+		geometryArena = arena;
+	}
+	void inline setRenderQueue(RenderQueue* queue) {
+		renderQueue = queue;
+	}
+	void inline setWorldStreamer(WorldStreamer* streamer) {
+		worldStreamer = streamer;
+	}
 	void inline setRayTracingAvailable(bool rayTracingAvailable) {
 		m_isRayTracingAvailable = rayTracingAvailable;
 		renderModes = std::vector<const char*>(DEFALT_MODES.begin(), DEFALT_MODES.end());
@@ -62,6 +115,15 @@ public:
 private:
 	void createDescriptorPool(VkDevice device);
 	void createRenderPass(VkDevice device, VkFormat imageFormat);
+	void renderGpuTimings();
+	void renderFrameTelemetry();
+	void renderRenderCounters();
+	void renderDepthPrepass(VkExtent2D swapchainExtent);
+	void renderTextureStreaming();
+	void renderLevelOfDetail();
+	void renderMeshletCulling();
+	void renderGeometryArena();
+	void renderWorldStreaming();
 
 	VkDescriptorPool descriptorPool;
 	VkRenderPass renderPass;
@@ -72,10 +134,21 @@ private:
 	std::vector<const char*> renderModes;
 
 	std::function<void()> renderModeChangedCallback;
+	const GpuProfiler* gpuProfiler = nullptr;
+	FrameTelemetry* frameTelemetry = nullptr;
+	TextureStreamer* textureStreamer = nullptr;
+	LodSelector* lodSelector = nullptr;
+	MeshletCuller* meshletCuller = nullptr;
+	const GeometryArena* geometryArena = nullptr;
+	RenderQueue* renderQueue = nullptr;
+	WorldStreamer* worldStreamer = nullptr;
 
 	// TODO separate state from GUI (adopt MV pattern)
 	// manage states collectively for now
 	int mode = 0;
 	float intensity = 1.0f;
+	int pixelBlockSize = Config::DEFAULT_PIXEL_BLOCK_SIZE;
+	bool depthPrepass = Config::DEPTH_PREPASS;
+	bool cacheCommands = Config::CACHE_COMMANDS;
 	bool m_isRayTracingAvailable = false;
 };
\ No newline at end of file
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "geometry_arena.hpp"
+
+// the transforms of every instance group, a per-instance vertex stream at PackedVertex::INSTANCE_BINDING.
+// groups get a range of it when they are created, written once through a persistent mapping. objects
+// outside of a group draw the single identity transform in slot IDENTITY
+class InstanceBuffer {
+public:
+	static const uint32_t IDENTITY = 0;
+
+	InstanceBuffer() = default;
+	~InstanceBuffer() = default;
+
+	void init(VkPhysicalDevice physicalDevice, VkDevice device);
+	void cleanup();
+	// the first instance of the range holding the transforms, throws when the buffer is full
+	uint32_t allocate(const std::vector<glm::mat4>& transforms);
+	// once no frame in flight draws the group anymore
+	void free(uint32_t firstInstance, uint32_t instanceCount);
+	void bind(VkCommandBuffer commandBuffer) const;
+
+	inline uint32_t getUsed() const {
+		return ranges.getUsed();
+	}
+	inline uint32_t getCapacity() const {
+		return ranges.getCapacity();
+	}
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	glm::mat4* mapped = nullptr;
+	RangeAllocator ranges;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// minimal KTX2 container: one 2D image with a full mip chain, no supercompression
+namespace Ktx2 {
+	// format name recorded in the cook manifest
+	const char FORMAT[] = "ktx2";
+	// the VkFormat values the container supports
+	const uint32_t FORMAT_R8G8B8A8_UNORM = 37;
+	const uint32_t FORMAT_R8G8B8A8_SRGB = 43;
+	const uint32_t FORMAT_BC1_RGB_UNORM = 131;
+	const uint32_t FORMAT_BC1_RGB_SRGB = 132;
+	const uint32_t FORMAT_BC5_UNORM = 141;
+	const uint32_t FORMAT_BC7_UNORM = 145;
+	const uint32_t FORMAT_BC7_SRGB = 146;
+
+	struct Level {
+		// offset into Texture::data
+		size_t offset = 0;
+		size_t size = 0;
+	};
+
+	struct Texture {
+		// a VkFormat value, kept as an integer so offline tools don't need a Vulkan loader
+		uint32_t vkFormat = 0;
+		uint32_t width = 0;
+		uint32_t height = 0;
+		// level 0 is the full resolution image
+		std::vector<Level> levels;
+		std::vector<uint8_t> data;
+	};
+
+	// bytes per 4x4 block, or per texel for uncompressed formats. 0 for unsupported formats
+	uint32_t blockSize(uint32_t vkFormat);
+	bool isBlockCompressed(uint32_t vkFormat);
+	size_t levelSize(uint32_t vkFormat, uint32_t width, uint32_t height);
+
+	// reads the whole file, level data is copied out of the buffer as is
+	bool read(const std::string& path, Texture& texture);
+	bool parse(const uint8_t* bytes, size_t byteCount, Texture& texture);
+	bool write(const std::string& path, const Texture& texture);
+}
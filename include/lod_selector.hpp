@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "constants.hpp"
+#include "mesh_file.hpp"
+#include "vulkan_types.hpp"
+
+class Camera;
+
+// picks the coarsest LOD of each object whose simplification error stays under a pixel threshold
+// at the nearest point of its bounding sphere. switching to a coarser LOD needs the error a margin
+// under the threshold, so objects near a boundary don't alternate between two LODs every frame
+class LodSelector {
+public:
+	struct Stats {
+		// of the camera passes, what LOD 0 everywhere would draw against what is drawn
+		uint64_t fullTriangles = 0;
+		uint64_t selectedTriangles = 0;
+		uint64_t shadowTriangles = 0;
+		std::array<uint32_t, MeshFile::MAX_LODS> objectsPerLod{};
+	};
+
+	LodSelector() = default;
+	~LodSelector() = default;
+
+	void update(std::vector<AssetData>& objects, const Camera& camera, VkExtent2D extent);
+
+	inline const Stats& getStats() const {
+		return stats;
+	}
+	inline float getErrorPixels() const {
+		return errorPixels;
+	}
+	inline void setErrorPixels(float pixels) {
+		errorPixels = pixels;
+	}
+	inline float getHysteresis() const {
+		return hysteresis;
+	}
+	inline void setHysteresis(float fraction) {
+		hysteresis = fraction;
+	}
+	inline float getShadowBias() const {
+		return shadowBias;
+	}
+	inline void setShadowBias(float bias) {
+		shadowBias = bias;
+	}
+
+private:
+	uint32_t select(const ModelResource& model, uint32_t current, float pixelsPerUnit, float threshold) const;
+
+	float errorPixels = Config::LOD_ERROR_PIXELS;
+	float hysteresis = Config::LOD_HYSTERESIS;
+	// multiplies the threshold of the shadow pass, shadow maps hide coarser silhouettes
+	float shadowBias = Config::SHADOW_LOD_BIAS;
+	Stats stats;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// read-only memory mapping of a whole file, unmapped on destruction
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	// false when the file can't be opened or is empty
+	bool open(const std::string& path);
+	void close();
+
+	inline const uint8_t* getData() const {
+		return data;
+	}
+	inline size_t getSize() const {
+		return size;
+	}
+	inline bool isOpen() const {
+		return data != nullptr;
+	}
+
+private:
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// cooked mesh: a header followed by the LOD and meshlet tables and the vertex and index arrays,
+// ready to copy into GPU buffers. every LOD is a range of the one index array over the same
+// vertices, the meshlets split LOD 0 into consecutive ranges
+namespace MeshFile {
+	const uint32_t VERSION = 3;
+	const char EXTENSION[] = ".rtgmesh";
+	// format name recorded in the cook manifest
+	const char FORMAT[] = "rtgmesh";
+	const uint32_t MAX_LODS = 5;
+
+	struct Header {
+		char identifier[8];
+		uint32_t version;
+		uint32_t fileSize;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t lodCount;
+		uint32_t meshletCount;
+		// offsets in bytes from the start of the file
+		uint32_t lodOffset;
+		uint32_t meshletOffset;
+		uint32_t vertexOffset;
+		uint32_t indexOffset;
+	};
+
+	struct Lod {
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		// object space distance the surface moved by at most, against the full resolution mesh
+		float error;
+	};
+
+	// a few dozen triangles of LOD 0 with the bounds to cull them by. laid out like the std430
+	// struct the culling shader reads, so the table is uploaded as is
+	struct Meshlet {
+		// object space bounding sphere
+		float center[3];
+		float radius;
+		// the meshlet faces away from a camera at p when
+		// dot(center - p, coneAxis) >= coneCutoff * length(center - p) + radius
+		float coneAxis[3];
+		float coneCutoff;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t vertexCount;
+		uint32_t padding;
+	};
+
+	// same layout as the runtime Vertex, kept free of GLM so offline tools can write it
+	struct Vertex {
+		float position[3];
+		float normal[3];
+		float color[3];
+		float texCoord[2];
+	};
+
+	struct Mesh {
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		// finest first, empty means one LOD over all indices
+		std::vector<Lod> lods;
+		std::vector<Meshlet> meshlets;
+	};
+
+	// the arrays of a cooked mesh, read in place
+	struct View {
+		const Vertex* vertices = nullptr;
+		uint32_t vertexCount = 0;
+		const uint32_t* indices = nullptr;
+		uint32_t indexCount = 0;
+		const Lod* lods = nullptr;
+		uint32_t lodCount = 0;
+		const Meshlet* meshlets = nullptr;
+		uint32_t meshletCount = 0;
+	};
+
+	// triangulates the OBJ into one vertex per corner, MeshOptimizer welds and orders them.
+	// false with a message when it can't be parsed
+	bool loadObj(const uint8_t* bytes, size_t size, Mesh& mesh, std::string& error);
+	// false when the bytes aren't a mesh of this version
+	bool parse(const uint8_t* bytes, size_t size, View& view);
+	bool write(const std::string& path, const Mesh& mesh);
+}
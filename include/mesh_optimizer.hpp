@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mesh_file.hpp"
+
+// reorders an indexed triangle mesh for the GPU: identical vertices are welded, triangles are
+// ordered for the post-transform vertex cache and then in clusters front to back for less
+// overdraw, coarser LODs are simplified from it, the full mesh is regrouped into meshlets that
+// can be culled on their own, and vertices are ordered by first use so vertex fetch walks
+// memory linearly
+namespace MeshOptimizer {
+	// FIFO cache the statistics and cluster boundaries assume, about the reuse window of current GPUs
+	const uint32_t FIFO_CACHE_SIZE = 16;
+	// LRU cache the triangle ordering optimizes for
+	const uint32_t LRU_CACHE_SIZE = 32;
+	// how much worse than its cluster's ACMR a smaller overdraw cluster may be
+	const float OVERDRAW_THRESHOLD = 1.05f;
+	// each LOD aims for this fraction of the previous one's triangles
+	const float LOD_REDUCTION = 0.25f;
+	// the chain ends at a LOD that keeps more than this fraction, or would go below LOD_MIN_TRIANGLES
+	const float LOD_MIN_REDUCTION = 0.75f;
+	const uint32_t LOD_MIN_TRIANGLES = 16;
+	// meshlet limits of the common mesh shader sizes, so the same clusters would suit them
+	const uint32_t MESHLET_MAX_VERTICES = 64;
+	const uint32_t MESHLET_MAX_TRIANGLES = 124;
+	// triangles closer than this cosine to the average normal leave a meshlet without a cone
+	const float MESHLET_MIN_CONE_COSINE = 0.1f;
+
+	struct Stats {
+		// transformed vertices per triangle, 0.5 is the limit for regular meshes and 3 is no reuse
+		float acmrBefore = 0.0f;
+		float acmrAfter = 0.0f;
+		// transformed vertices per unique vertex, 1 is the limit
+		float atvrBefore = 0.0f;
+		float atvrAfter = 0.0f;
+		uint32_t weldedVertices = 0;
+		uint32_t clusters = 0;
+		uint32_t lodCount = 0;
+		// of the coarsest LOD
+		uint32_t lodTriangles = 0;
+		float lodError = 0.0f;
+		uint32_t meshlets = 0;
+	};
+
+	// merges bitwise identical vertices, every attribute takes part
+	uint32_t weld(MeshFile::Mesh& mesh);
+	void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+	// expects indices already optimized for the vertex cache, returns the number of clusters
+	uint32_t optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshFile::Vertex>& vertices, float threshold = OVERDRAW_THRESHOLD);
+	// drops unused vertices
+	void optimizeVertexFetch(MeshFile::Mesh& mesh);
+
+	// collapses edges by their quadric error until targetIndexCount or no collapse is left. vertices
+	// only collapse onto other vertices, the result indexes the same vertex array. returns the
+	// object space distance the surface moved by
+	float simplify(std::vector<uint32_t>& indices, const std::vector<MeshFile::Vertex>& vertices, size_t targetIndexCount);
+	// the indices become LOD 0, coarser LODs simplified from it are appended behind them
+	void generateLods(MeshFile::Mesh& mesh);
+	// regroups LOD 0 into meshlets of neighboring triangles, each a range of the indices. they
+	// replace its overdraw clusters and are ordered for the vertex cache one by one
+	void buildMeshlets(MeshFile::Mesh& mesh);
+
+	float computeAcmr(const std::vector<uint32_t>& indices, uint32_t cacheSize = FIFO_CACHE_SIZE);
+	float computeAtvr(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = FIFO_CACHE_SIZE);
+
+	// the whole pipeline in order
+	Stats optimize(MeshFile::Mesh& mesh);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "constants.hpp"
+#include "vulkan_types.hpp"
+
+// culls the meshlets of every object drawn at LOD 0 against the camera frustum and their normal
+// cones in a compute pass. visible meshlets are compacted into indirect draws of their index
+// ranges, so it works without mesh shaders. passes draw an object through drawCulled and fall
+// back to its whole LOD when the object wasn't culled this frame
+class MeshletCuller {
+public:
+	struct Stats {
+		// read back from the last frame that used the same frame slot
+		uint32_t culledObjects = 0;
+		uint32_t testedMeshlets = 0;
+		uint32_t visibleMeshlets = 0;
+		uint64_t visibleTriangles = 0;
+	};
+
+	MeshletCuller() = default;
+	~MeshletCuller() = default;
+
+	// stays disabled when the device can't draw more than one indirect command per call
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, bool multiDrawIndirect, bool drawIndirectCount);
+	void cleanup();
+	// the set reading the model's meshlet buffer, freed again by freeModelSet
+	void createModelSet(ModelResource& model);
+	void freeModelSet(ModelResource& model);
+	// call after the frame's fence wait and outside of any render pass, before the passes draw
+	void record(
+		VkCommandBuffer commandBuffer,
+		uint32_t currentFrame,
+		const std::vector<AssetData>& objects,
+		const glm::mat4& viewProjection,
+		const glm::vec3& cameraPosition
+	);
+	// false when the object wasn't culled this frame. either way the arena block of its model has to be bound.
+	// commandBuffer may be a secondary buffer executed by the frame's, the draws only read this frame slot's buffers
+	bool drawCulled(VkCommandBuffer commandBuffer, uint32_t currentFrame, size_t objectIndex) const;
+
+	inline bool isSupported() const {
+		return pipeline != VK_NULL_HANDLE;
+	}
+	inline bool isEnabled() const {
+		return enabled;
+	}
+	inline void setEnabled(bool enabled) {
+		this->enabled = enabled;
+	}
+	inline const Stats& getStats() const {
+		return stats;
+	}
+	// moves on whenever a frame slot's buffers are replaced, draws recorded before reference the old ones
+	inline uint64_t getReallocations() const {
+		return reallocations;
+	}
+
+private:
+	struct FrameBuffers {
+		// VkDrawIndexedIndirectCommand per meshlet, visible ones first in each object's range
+		VkBuffer draws = VK_NULL_HANDLE;
+		VkDeviceMemory drawsMemory = VK_NULL_HANDLE;
+		size_t drawCapacity = 0;
+		// visible triangle indices, then a draw count per object. mapped for the statistics
+		VkBuffer counts = VK_NULL_HANDLE;
+		VkDeviceMemory countsMemory = VK_NULL_HANDLE;
+		void* countsMapped = nullptr;
+		size_t countCapacity = 0;
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		// what the counts were recorded for
+		uint32_t culledObjects = 0;
+		uint32_t objectCount = 0;
+		uint32_t testedMeshlets = 0;
+	};
+
+	// an object's range of the draw buffer, count 0 when it isn't culled
+	struct Draw {
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	struct PushConstants {
+		glm::vec4 planes[6];
+		glm::vec3 cameraPosition;
+		uint32_t meshletCount;
+		uint32_t drawOffset;
+		uint32_t objectIndex;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+	};
+
+	void createPipeline();
+	void readStats(const FrameBuffers& frame);
+	void reserve(FrameBuffers& frame, size_t drawCount, size_t countCount);
+	void growModelPool();
+
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	bool drawIndirectCount = false;
+	// meshlets one indirect call may draw, larger models aren't culled
+	uint32_t maxDrawCount = 0;
+	bool enabled = Config::MESHLET_CULLING;
+
+	VkDescriptorSetLayout frameSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout modelSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkDescriptorPool framePool = VK_NULL_HANDLE;
+	// the last pool takes new models
+	std::vector<VkDescriptorPool> modelPools;
+
+	std::array<FrameBuffers, Config::MAX_FRAMES_IN_FLIGHT> frames{};
+	bool recorded = false;
+	uint32_t recordedFrame = 0;
+	// reused every frame
+	std::vector<Draw> draws;
+	Stats stats;
+	uint64_t reallocations = 0;
+};
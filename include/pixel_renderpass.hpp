@@ -16,7 +16,8 @@ public:
 		CommonDescriptor& commonDescriptor,
 		VkDescriptorSetLayout modelTextureDescriptorSetLayout,
 		Swapchain& swapchain,
-		VkFormat depthFormat
+		VkFormat depthFormat,
+		uint32_t blockSize
 	) : BaseRenderPass(
 		physicalDevice,
 		device,
@@ -30,30 +31,27 @@ public:
 		commonDescriptor,
 		modelTextureDescriptorSetLayout,
 		swapchain,
-		depthFormat
-	)) {};
+		depthFormat,
+		blockSize
+	)), blockSize(blockSize) {};
 	~PixelRenderPass() override = default;
 	void init() override;
 	void cleanup() override;
 	void createImageResources() override;
 	void cleanupImageResources() override;
-	void render(
-		std::vector<VkCommandBuffer>& commandBuffer,
-		uint32_t imageIndex,
-		uint32_t currentFrame,
-		std::vector<void*>& modelMatrixBuffersMapped,
-		const std::vector<AssetData>& assets,
-		const Camera& camera,
-		const std::vector<DirectionalLightBuffer>& directionalLights,
-		GLFWwindow* window
-	) override;
+protected:
+	void buildGraph(RenderGraph& graph) override;
+	void resizeFramebuffers() override;
 private:
 	void createRenderPass();
 	void createFramebuffers();
 	void createGraphicsPipeline();
+	void draw(const FrameContext& context);
 
 	VkPipeline pipeline = VK_NULL_HANDLE;
 	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
 
 	std::unique_ptr<GBufferRenderPass> gBuffer;
+	// one G-buffer texel per blockSize x blockSize screen pixels
+	uint32_t blockSize;
 };
\ No newline at end of file
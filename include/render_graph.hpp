@@ -0,0 +1,198 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "vulkan_types.hpp"
+#include "buffer_types.hpp"
+
+class Camera;
+class GpuProfiler;
+class FrameArena;
+class MeshletCuller;
+class GeometryArena;
+class InstanceBuffer;
+class RenderQueue;
+
+// everything a pass may need while recording a frame
+struct FrameContext {
+	std::vector<VkCommandBuffer>* commandBuffers = nullptr;
+	uint32_t imageIndex = 0;
+	uint32_t currentFrame = 0;
+	std::vector<void*>* modelMatrixBuffersMapped = nullptr;
+	const std::vector<AssetData>* assets = nullptr;
+	const Camera* camera = nullptr;
+	const std::vector<DirectionalLightBuffer>* directionalLights = nullptr;
+	GLFWwindow* window = nullptr;
+	GpuProfiler* profiler = nullptr;
+	// transient data of this frame, reset before the next frame is recorded
+	FrameArena* arena = nullptr;
+	// draws the culled meshlets of objects, null in modes that don't use it
+	const MeshletCuller* meshletCuller = nullptr;
+	// holds the vertices and indices of every model, bound per block
+	const GeometryArena* geometryArena = nullptr;
+	// transforms of the instance groups, bound once per pass
+	const InstanceBuffer* instanceBuffer = nullptr;
+	// the order to draw assets in
+	const RenderQueue* renderQueue = nullptr;
+	// forward only, shade after a depth-only pass so that each sample runs the fragment shader once
+	bool depthPrepass = false;
+	// passes replay their CommandCache while sceneGeneration is the one they recorded it for
+	bool cacheCommands = false;
+	uint64_t sceneGeneration = 0;
+
+	inline VkCommandBuffer commandBuffer() const {
+		return (*commandBuffers)[currentFrame];
+	}
+};
+
+using RenderGraphResource = uint32_t;
+
+struct RenderGraphImageDesc {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+	VkImageUsageFlags usage = 0;
+	VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+};
+
+class RenderGraph {
+public:
+	using RecordFunc = std::function<void(const FrameContext&)>;
+
+	class PassBuilder {
+	public:
+		PassBuilder(RenderGraph& graph, size_t index) : graph(graph), index(index) {};
+		// layout is the layout the pass expects on entry.
+		// VK_IMAGE_LAYOUT_UNDEFINED leaves the transition to the pass's own VkRenderPass
+		PassBuilder& read(
+			RenderGraphResource resource,
+			VkImageLayout layout,
+			VkPipelineStageFlags stage,
+			VkAccessFlags access
+		);
+		// writes discard the previous contents. finalLayout is the layout the pass leaves behind
+		PassBuilder& write(
+			RenderGraphResource resource,
+			VkImageLayout layout,
+			VkImageLayout finalLayout,
+			VkPipelineStageFlags stage,
+			VkAccessFlags access
+		);
+	private:
+		RenderGraph& graph;
+		size_t index;
+	};
+
+	RenderGraph(VkPhysicalDevice physicalDevice, VkDevice device) : physicalDevice(physicalDevice), device(device) {};
+	~RenderGraph() = default;
+
+	RenderGraphResource createImage(const std::string& name, const RenderGraphImageDesc& desc);
+	// persistent images keep their state between frames, the others restart from initialLayout
+	RenderGraphResource importImage(
+		const std::string& name,
+		VkImage image,
+		VkImageAspectFlags aspect,
+		VkImageLayout initialLayout,
+		bool persistent
+	);
+	void setImportedImage(RenderGraphResource resource, VkImage image);
+	void setOutput(RenderGraphResource resource);
+	PassBuilder addPass(const std::string& name, RecordFunc record);
+
+	void compile();
+	void execute(const FrameContext& context);
+	void cleanup();
+
+	const ImageResource& getImage(RenderGraphResource resource) const;
+	bool isPassCulled(const std::string& name) const;
+	inline VkDeviceSize getAllocatedMemorySize() const {
+		return allocatedMemorySize;
+	}
+	inline VkDeviceSize getRequestedMemorySize() const {
+		return requestedMemorySize;
+	}
+
+private:
+	struct Access {
+		RenderGraphResource resource;
+		VkImageLayout layout;
+		VkImageLayout finalLayout;
+		VkPipelineStageFlags stage;
+		VkAccessFlags access;
+		bool write;
+	};
+
+	struct Pass {
+		std::string name;
+		// interned copy of name for the CPU profiler
+		const char* profileName = nullptr;
+		RecordFunc record;
+		std::vector<Access> accesses;
+		uint32_t refCount = 0;
+		bool culled = false;
+	};
+
+	struct ResourceState {
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags stage = 0;
+		VkAccessFlags access = 0;
+	};
+
+	struct Resource {
+		std::string name;
+		RenderGraphImageDesc desc;
+		ImageResource image{};
+		bool imported = false;
+		bool persistent = false;
+		bool output = false;
+		VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkMemoryRequirements memoryRequirements{};
+		int firstPass = -1;
+		int lastPass = -1;
+		int memoryBlock = -1;
+		// true until the first access of the frame
+		bool pendingFirstUse = false;
+		ResourceState state;
+	};
+
+	struct MemoryBlock {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		uint32_t memoryTypeIndex = 0;
+		std::vector<RenderGraphResource> resources;
+		// last access by any image living in this block
+		ResourceState state;
+	};
+
+	void cullPasses();
+	void computeLifetimes();
+	void allocateTransientImages();
+	void syncAccess(const Access& access, Resource& resource);
+
+	VkPhysicalDevice physicalDevice;
+	VkDevice device;
+
+	std::vector<Resource> resources;
+	std::vector<Pass> passes;
+	std::vector<MemoryBlock> memoryBlocks;
+
+	// barrier batch of the pass being executed, allocated from the frame arena
+	VkImageMemoryBarrier* imageBarriers = nullptr;
+	uint32_t imageBarrierCount = 0;
+	VkPipelineStageFlags srcStageMask = 0;
+	VkPipelineStageFlags dstStageMask = 0;
+	VkAccessFlags srcAccessMask = 0;
+	VkAccessFlags dstAccessMask = 0;
+
+	VkDeviceSize allocatedMemorySize = 0;
+	VkDeviceSize requestedMemorySize = 0;
+	bool compiled = false;
+};
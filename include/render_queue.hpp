@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+#include "constants.hpp"
+#include "vulkan_types.hpp"
+
+// the order every pass records the objects of a frame in, by 64-bit sort keys radix sorted each
+// frame. from the most significant bits: the GeometryArena block, the model, whose textures and
+// mesh are bound together, and the depth along the camera's view direction, so that draws sharing
+// state are adjacent and each model's copies go front to back
+class RenderQueue {
+public:
+	RenderQueue() = default;
+	~RenderQueue() = default;
+
+	// call after the LODs were selected, the order holds until the next build
+	void build(const std::vector<AssetData>& objects, const glm::vec3& cameraPosition, const glm::vec3& cameraFront);
+
+	// indices into the objects of the last build
+	inline const std::vector<uint32_t>& getOrder() const {
+		return order;
+	}
+	inline bool isEnabled() const {
+		return enabled;
+	}
+	// disabled, objects are drawn in the order they are passed
+	inline void setEnabled(bool enabled) {
+		this->enabled = enabled;
+	}
+	// hash of the order and of what the passes record per object in it: models, LODs, instance
+	// ranges and bound sets. equal signatures record the same draws
+	inline uint64_t getSignature() const {
+		return signature;
+	}
+
+	static uint64_t makeKey(uint32_t block, uint32_t model, float depth);
+
+private:
+	struct Entry {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	// least significant digit first, 8 bits per pass. passes where every key has the same digit are skipped
+	void sort();
+	void sign(const std::vector<AssetData>& objects);
+
+	bool enabled = Config::SORT_DRAWS;
+	// reused every frame
+	std::vector<Entry> entries;
+	std::vector<Entry> scratch;
+	std::vector<uint32_t> order;
+	uint64_t signature = 0;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+
+// CPU-side work of a frame, counted where the Vulkan calls are made
+struct RenderCounters {
+	uint64_t drawCalls = 0;
+	// of indexed mesh draws, every pass counts its own
+	uint64_t triangles = 0;
+	// copies those draws put on screen, an instanced draw counts each
+	uint64_t instances = 0;
+	uint64_t descriptorBinds = 0;
+	// vertex and index buffer bindings
+	uint64_t bufferBinds = 0;
+	uint64_t pipelineBinds = 0;
+	uint64_t barriers = 0;
+	uint64_t bytesUploaded = 0;
+	uint64_t allocations = 0;
+	// cached secondary command buffers executed instead of being recorded, their draws are counted above
+	uint64_t replays = 0;
+
+	RenderCounters& operator+=(const RenderCounters& other);
+	RenderCounters& operator-=(const RenderCounters& other);
+};
+
+namespace RenderStats {
+	// counters of the frame being recorded
+	RenderCounters& frame();
+	// moves the current counters to lastFrame() and starts counting a new frame
+	void endFrame();
+	const RenderCounters& lastFrame();
+	// sum over every finished frame, divide by frameCount() for averages
+	const RenderCounters& total();
+	uint64_t frameCount();
+}
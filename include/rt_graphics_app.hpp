@@ -4,6 +4,7 @@
 
 #include <chrono>
 #include <iostream>
+#include <string>
 #include <vector>
 #include <optional>
 
@@ -11,6 +12,9 @@
 #include "input_manager.hpp"
 #include "update_system.hpp"
 #include "graphics_system.hpp"
+#include "world_streamer.hpp"
+#include "scene_file.hpp"
+#include "game_object.hpp"
 #include "camera.hpp"
 
 class RTGraphicsApp {
@@ -18,9 +22,16 @@ public:
 	RTGraphicsApp() : windowState(800, 600, "Real-Time Graphics Playground"), graphicsSystem(windowState) {}
 	~RTGraphicsApp() = default;
 	void run();
+	// renders the given number of frames, prints a report to stdout and exits
+	inline void setBenchmarkFrames(uint32_t frames) {
+		benchmarkFrames = frames;
+	}
+	// adds a prop while the app runs, it is drawn as a placeholder until its model is resident
+	void requestProp(const std::string& textureDir, const std::string& modelDir, const SceneFile::ModelRef& model, const GameObject& object);
 private:
 	void setCallback();
 	void loadAssets(std::string filepath);
+	void rebuildDrawList();
 	static void mouseButtonCallback(GLFWwindow *window, int button, int action, int mods);
 	static void cursorPosCallback(GLFWwindow *window, double xpos, double ypos);
 	static void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods);
@@ -30,13 +41,17 @@ private:
 	InputManager inputManager;
 	UpdateSystem updateSystem;
 	GraphicsSystem graphicsSystem;
+	WorldStreamer worldStreamer;
 
 	// TODO move to state management class
 	std::optional<AssetData> player;
 	std::vector<AssetData> props;
+	// props, then the props of the streamed world cells, then the player. passed to the renderer every frame
+	std::vector<AssetData> assets;
 	Camera camera;
 	std::vector<PointLightBuffer> pointLights;
 	std::vector<DirectionalLightBuffer> directionalLights;
 
 	float delta = 0.0f;
+	uint32_t benchmarkFrames = 0;
 };
\ No newline at end of file
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.hpp"
+
+// compiled scene: a header followed by flat arrays of fixed-size records and a string table.
+// the file is mapped and read in place, the JSON manifest compiles into the same layout
+namespace SceneFile {
+	const uint32_t VERSION = 3;
+	const char EXTENSION[] = ".rtgscene";
+	// string offset of an unused texture slot
+	const uint32_t NO_STRING = UINT32_MAX;
+	// Header::flags, "depthPrepass" in the JSON
+	const uint32_t FLAG_DEPTH_PREPASS = 1 << 0;
+	// JSON texture keys by slot, the slots match the model texture descriptor bindings
+	const std::array<const char*, 3> TEXTURE_SLOTS = {"albedo", "normal", "material"};
+
+	// a section of the file, offset in bytes from its start
+	struct Range {
+		uint32_t offset;
+		uint32_t count;
+	};
+
+	struct Header {
+		char identifier[8];
+		uint32_t version;
+		uint32_t fileSize;
+		// string offsets
+		uint32_t textureDir;
+		uint32_t modelDir;
+		// 0 when the scene has no world partition or doesn't set a radius
+		float cellSize;
+		float loadRadius;
+		// render settings the scene asks for
+		uint32_t flags;
+		// count is in bytes, every string is null-terminated
+		Range strings;
+		Range models;
+		Range characters;
+		Range props;
+		Range pointLights;
+		Range directionalLights;
+		Range cells;
+		Range instanceGroups;
+		Range instances;
+	};
+
+	// a model and its textures, shared by every object using the same combination
+	struct Model {
+		uint32_t path;
+		uint32_t textures[3];
+	};
+
+	struct Object {
+		float position[3];
+		float direction[3];
+		uint32_t model;
+	};
+
+	// one model drawn at every transform of its range of instances
+	struct InstanceGroup {
+		uint32_t model;
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+	};
+
+	struct Instance {
+		float position[3];
+		float direction[3];
+		float scale;
+	};
+
+	struct PointLight {
+		float position[3];
+		float intensity;
+		float color[3];
+	};
+
+	struct DirectionalLight {
+		float direction[3];
+		float intensity;
+		float color[3];
+	};
+
+	struct Cell {
+		int32_t x;
+		int32_t z;
+		// manifest path relative to the scene directory
+		uint32_t manifest;
+	};
+
+	// a model with its strings resolved, texture slots without a texture are empty
+	struct ModelRef {
+		std::string_view path;
+		std::array<std::string_view, 3> textures;
+	};
+
+	template <typename T>
+	struct Array {
+		const T* data = nullptr;
+		size_t count = 0;
+
+		inline const T* begin() const {
+			return data;
+		}
+		inline const T* end() const {
+			return data + count;
+		}
+		inline size_t size() const {
+			return count;
+		}
+		inline const T& operator[](size_t index) const {
+			return data[index];
+		}
+	};
+
+	// throws when a required field of the manifest is missing
+	std::vector<uint8_t> compile(const nlohmann::json& json);
+	bool write(const std::string& path, const std::vector<uint8_t>& bytes);
+	// the compiled scene next to a JSON manifest
+	std::string compiledPath(const std::string& manifestPath);
+
+	class Scene {
+	public:
+		Scene() = default;
+		~Scene() = default;
+
+		// reads the compiled scene in place from the mounted pack, or maps the one next to the manifest
+		// when it is up to date. otherwise parses the JSON manifest and compiles it in memory. throws
+		// when neither can be read
+		void open(const std::string& manifestPath);
+		// false when the file is missing or isn't a valid scene of this version
+		bool openCompiled(const std::string& path);
+		void openJson(const nlohmann::json& json);
+
+		// false when the scene was compiled from JSON
+		inline bool isMapped() const {
+			return data != nullptr && bytes.empty();
+		}
+		inline const Header& getHeader() const {
+			return *reinterpret_cast<const Header*>(data);
+		}
+		inline std::string_view getString(uint32_t offset) const {
+			if (offset == NO_STRING) {
+				return {};
+			}
+			return std::string_view(reinterpret_cast<const char*>(data + getHeader().strings.offset + offset));
+		}
+		ModelRef getModel(uint32_t index) const;
+
+		inline Array<Object> getCharacters() const {
+			return getArray<Object>(getHeader().characters);
+		}
+		inline Array<Object> getProps() const {
+			return getArray<Object>(getHeader().props);
+		}
+		inline Array<PointLight> getPointLights() const {
+			return getArray<PointLight>(getHeader().pointLights);
+		}
+		inline Array<DirectionalLight> getDirectionalLights() const {
+			return getArray<DirectionalLight>(getHeader().directionalLights);
+		}
+		inline Array<Cell> getCells() const {
+			return getArray<Cell>(getHeader().cells);
+		}
+		inline Array<InstanceGroup> getInstanceGroups() const {
+			return getArray<InstanceGroup>(getHeader().instanceGroups);
+		}
+		inline Array<Instance> getInstances(const InstanceGroup& group) const {
+			return {getArray<Instance>(getHeader().instances).data + group.firstInstance, group.instanceCount};
+		}
+
+	private:
+		template <typename T>
+		inline Array<T> getArray(const Range& range) const {
+			return {reinterpret_cast<const T*>(data + range.offset), range.count};
+		}
+		bool openMemory(const uint8_t* memory, size_t memorySize);
+		bool validate() const;
+
+		MappedFile file;
+		// the in-memory compilation of a JSON manifest
+		std::vector<uint8_t> bytes;
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+	};
+}
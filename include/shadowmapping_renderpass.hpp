@@ -7,8 +7,10 @@
 #include <vector>
 
 #include "vulkan_types.hpp"
+#include "command_cache.hpp"
 
 class Camera;
+struct FrameContext;
 
 // TODO create subclass based on the shadowing technique
 class BaseShadowRenderPass {
@@ -20,19 +22,10 @@ public:
 		CommonDescriptor& commonDescriptor
 	): physicalDevice(physicalDevice), device(device), commonDescriptor(commonDescriptor) {};
 	~BaseShadowRenderPass() = default;
-	void init();
+	// the cached shadow draws come from commandPool
+	void init(VkCommandPool commandPool);
 	void cleanup();
-	void generateShadowMap(
-		std::vector<VkCommandBuffer>& commandBuffers,
-		uint32_t imageIndex,
-		uint32_t currentFrame,
-		std::vector<void*>& modelMatrixBuffersMapped,
-		const std::vector<AssetData>& models,
-		const Camera& camera,
-		const std::vector<DirectionalLightBuffer>& directionalLights,
-		GLFWwindow* window
-	);
-	void resetLayout(VkCommandBuffer commandBuffer);
+	void generateShadowMap(const FrameContext& context);
 
 	inline VkDescriptorSetLayout getShadowMapLayout() {
 		return shadowMapDescriptor.layout;
@@ -42,16 +35,21 @@ public:
 		return lightDescriptor.layout;
 	}
 
-	inline std::vector<VkDescriptorSet> getShadowMap() {
+	inline VkImage getShadowMapImage() const {
+		return shadowMap.image;
+	}
+
+	inline const std::vector<VkDescriptorSet>& getShadowMap() const {
 		return shadowMapDescriptor.sets;
 	}
 
-	inline std::vector<VkDescriptorSet> getLightMatrix() {
+	inline const std::vector<VkDescriptorSet>& getLightMatrix() const {
 		return lightDescriptor.sets;
 	}
 
 private:
-    void updateLightMatrix(const Camera& camera, const std::vector<DirectionalLightBuffer> directionalLights, float aspect);
+    void updateLightMatrix(const Camera& camera, const std::vector<DirectionalLightBuffer>& directionalLights, float aspect);
+	void drawShadowCasters(VkCommandBuffer commandBuffer, const FrameContext& context);
     VkPhysicalDevice physicalDevice;
 	VkDevice device;
 	VkRenderPass renderPass = VK_NULL_HANDLE;
@@ -70,5 +68,5 @@ private:
 
 	VkSampler sampler = VK_NULL_HANDLE;
 
-	VkImageLayout currentLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	CommandCache commandCache;
 };
\ No newline at end of file
@@ -11,19 +11,27 @@
 #include "constants.hpp"
 #include "vulkan_utils.hpp"
 
+class DeletionQueue;
+
 class SwapchainRenderPass {
 public:
-    SwapchainRenderPass(VkPhysicalDevice physicalDevice, VkDevice device, Swapchain& swapchain, VkQueue graphicsQueue, VkCommandPool commandPool)
-		: physicalDevice(physicalDevice), device(device), swapchain(swapchain), graphicsQueue(graphicsQueue), commandPool(commandPool) {}
+    SwapchainRenderPass(VkPhysicalDevice physicalDevice, VkDevice device, Swapchain& swapchain, DeletionQueue& deletionQueue)
+		: physicalDevice(physicalDevice), device(device), swapchain(swapchain), deletionQueue(deletionQueue) {}
     ~SwapchainRenderPass() = default;
     void init();
 	void cleanup();
+	// retires the rendered image, its descriptors and the framebuffers to the DeletionQueue
     void cleanupImageResources();
 	void createImageResources();
+	// call first in the frame's command buffer, moves a new rendered image into the general layout
+	void prepare(VkCommandBuffer commandBuffer);
 	void render(VkCommandBuffer commandBuffer, uint32_t imageIndex, uint32_t currentFrame);
 	inline const Descriptor& getRenderTargetResource() const {
 		return renderedImageDescriptor;
 	}
+	inline VkImage getRenderedImage() const {
+		return renderedImageResource.image;
+	}
 	void inline setSwapchain(Swapchain& swapchain) {
 		this->swapchain = swapchain;
 	}
@@ -39,8 +47,7 @@ private:
 	VkPhysicalDevice physicalDevice;
 	VkDevice device;
     Swapchain& swapchain;
-	VkQueue graphicsQueue;
-	VkCommandPool commandPool;
+	DeletionQueue& deletionQueue;
 
     VkRenderPass renderPass;
     VkPipeline pipeline;
@@ -52,5 +59,7 @@ private:
 	Descriptor samplerDescriptor;
 
 	ImageResource renderedImageResource;
+	// still in the undefined layout, no frame recorded its transition yet
+	bool renderedImageUndefined = false;
 	VkSampler sampler = VK_NULL_HANDLE;
 };
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "constants.hpp"
+#include "ktx2.hpp"
+#include "transfer_queue.hpp"
+#include "vulkan_types.hpp"
+
+class Camera;
+
+// keeps only the mips a texture needs on screen resident. a texture owns one image holding
+// its levels [residentMip, levelCount), changing residency uploads a new image from the cooked
+// KTX2 data on the transfer queue and swaps it into the descriptor sets once the upload completed
+class TextureStreamer {
+public:
+	struct StreamedTexture {
+		std::string path;
+		Ktx2::Texture source;
+		// bytes of the chain starting at each level
+		std::vector<size_t> chainSizes;
+		ImageResource image{};
+		uint32_t residentMip = 0;
+		uint32_t wantedMip = 0;
+		// smallest levels, always resident
+		uint32_t tailMip = 0;
+		uint64_t lastUsedFrame = 0;
+		bool uploading = false;
+		uint32_t uploadMip = 0;
+		// image replaced by the last upload, destroyed once no frame in flight can reference it
+		ImageResource retiredImage{};
+		// bit per frame in flight whose descriptor sets still point at the retired image
+		uint32_t staleDescriptorMask = 0;
+
+		inline uint32_t getLevelCount() const {
+			return static_cast<uint32_t>(source.levels.size());
+		}
+	};
+
+	TextureStreamer() = default;
+	~TextureStreamer() = default;
+
+	void init(VkPhysicalDevice physicalDevice, VkDevice device, TransferQueue* transferQueue, VkSampler sampler);
+	void cleanup();
+	// takes over the decoded KTX2 data, uploads the mip tail and waits for it. false when the
+	// format can't be sampled
+	bool load(const std::string& path, Ktx2::Texture&& source, int32_t& textureId);
+	void addUser(int32_t textureId, const std::vector<VkDescriptorSet>& descriptorSets, uint32_t binding);
+	// stops writing into the descriptor sets, the textures stay loaded
+	void removeUser(const std::vector<VkDescriptorSet>& descriptorSets);
+	// call right after the frame's fence wait, descriptor sets of currentFrame are idle then
+	void update(uint32_t currentFrame, const std::vector<AssetData>& objects, const Camera& camera, VkExtent2D extent);
+
+	inline VkImageView getImageView(int32_t textureId) const {
+		return textures[textureId].image.imageView;
+	}
+	inline const std::vector<StreamedTexture>& getTextures() const {
+		return textures;
+	}
+	inline size_t getBudget() const {
+		return budget;
+	}
+	inline void setBudget(size_t bytes) {
+		budget = bytes;
+	}
+	// bytes of the chains that are resident or being uploaded
+	size_t getCommittedBytes() const;
+	inline size_t getPendingUploadCount() const {
+		return uploads.size();
+	}
+	// command buffers that bound a rewritten set have to be recorded again
+	inline uint64_t getDescriptorWrites() const {
+		return descriptorWrites;
+	}
+
+private:
+	struct User {
+		int32_t texture;
+		std::vector<VkDescriptorSet> descriptorSets;
+		uint32_t binding;
+	};
+
+	struct Upload {
+		int32_t texture;
+		uint32_t firstMip;
+		ImageResource image;
+		VkBuffer stagingBuffer;
+		VkDeviceMemory stagingBufferMemory;
+		// transfer timeline value
+		uint64_t value;
+	};
+
+	void beginUpload(int32_t textureId, uint32_t firstMip);
+	void finishUpload(const Upload& upload);
+	void writeDescriptors(int32_t textureId, uint32_t frame);
+	void estimateWantedMips(const std::vector<AssetData>& objects, const Camera& camera, VkExtent2D extent);
+	void scheduleUploads();
+	int32_t findEvictionVictim(int32_t exclude) const;
+	bool isBusy(int32_t textureId) const;
+
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	TransferQueue* transferQueue = nullptr;
+	VkSampler sampler = VK_NULL_HANDLE;
+
+	std::vector<StreamedTexture> textures;
+	std::vector<User> users;
+	std::vector<Upload> uploads;
+	// reserved on load so update() doesn't allocate
+	std::vector<int32_t> candidates;
+
+	size_t budget = Config::TEXTURE_STREAMING_BUDGET;
+	uint64_t frameIndex = 0;
+	uint64_t descriptorWrites = 0;
+};
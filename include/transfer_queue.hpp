@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// uploads on a dedicated transfer queue family when the device has one, otherwise on the
+// graphics queue. every submission signals the next value of one timeline semaphore
+class TransferQueue {
+public:
+	TransferQueue() = default;
+	~TransferQueue() = default;
+
+	// transferFamily == graphicsFamily shares the graphics queue and skips ownership transfers
+	void init(VkDevice device, uint32_t graphicsFamily, uint32_t transferFamily, VkQueue transferQueue);
+	void cleanup();
+
+	VkCommandBuffer begin();
+	// returns the timeline value signalled once the commands completed
+	uint64_t submit(VkCommandBuffer commandBuffer);
+	bool isComplete(uint64_t value) const;
+	void wait(uint64_t value) const;
+
+	// release half of the ownership transfer to the graphics family, recorded after the copy.
+	// images end up in SHADER_READ_ONLY_OPTIMAL, buffers are read as vertex and index data or by compute
+	void releaseImage(VkCommandBuffer commandBuffer, VkImage image, uint32_t levelCount);
+	void releaseBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer);
+	// queue the acquire half for the next frame, only once the submission with value completed
+	void acquireImage(VkImage image, uint32_t levelCount, uint64_t value);
+	void acquireBuffer(VkBuffer buffer, uint64_t value);
+	// for buffers shared by both families: makes the copies visible to vertex input and compute
+	// when they ran on the graphics queue, otherwise the frame only waits for value
+	void releaseShared(VkCommandBuffer commandBuffer);
+	void acquireShared(uint64_t value);
+	// records the queued acquires at the start of a frame. returns the timeline value the
+	// frame's submission has to wait for, already reached on the CPU so the wait never stalls
+	uint64_t recordAcquires(VkCommandBuffer commandBuffer);
+
+	inline bool isDedicated() const {
+		return graphicsFamily != transferFamily;
+	}
+	inline VkSemaphore getTimelineSemaphore() const {
+		return timelineSemaphore;
+	}
+
+private:
+	struct Submission {
+		VkCommandBuffer commandBuffer;
+		uint64_t value;
+	};
+
+	void freeCompletedCommandBuffers();
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueue queue = VK_NULL_HANDLE;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	VkSemaphore timelineSemaphore = VK_NULL_HANDLE;
+	uint32_t graphicsFamily = 0;
+	uint32_t transferFamily = 0;
+	uint64_t nextValue = 1;
+
+	std::vector<Submission> submissions;
+	std::vector<VkImageMemoryBarrier> imageAcquires;
+	std::vector<VkBufferMemoryBarrier> bufferAcquires;
+	uint64_t acquireValue = 0;
+};
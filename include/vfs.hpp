@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// virtual file system: paths resolve into the mounted pack first and fall back to loose files.
+// mount before any reader starts, lookups are read-only afterwards and safe from any thread
+namespace Vfs {
+	struct File {
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+		// loose files are read into this, files in the pack are used in place while it stays mounted
+		std::vector<uint8_t> bytes;
+		bool packed = false;
+	};
+
+	// maps the pack, the paths inside it are relative to its directory. false when it is missing or invalid
+	bool mount(const std::string& packPath);
+	void unmount();
+	bool isMounted();
+	size_t getMountedFileCount();
+
+	// false when neither the pack nor the disk has the file
+	bool open(const std::string& path, File& file);
+	// the pack only, null data when it doesn't have the file
+	File find(const std::string& path);
+}
@@ -8,7 +8,6 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/hash.hpp>
 
-#include <nlohmann/json.hpp>
 
 #include <optional>
 #include <fstream>
@@ -21,8 +20,22 @@
 #include "constants.hpp"
 #include "swapchain_renderpass.hpp"
 #include "raytracing_pipeline.hpp"
+#include "render_graph.hpp"
+#include "gpu_profiler.hpp"
+#include "frame_telemetry.hpp"
+#include "frame_arena.hpp"
+#include "texture_streamer.hpp"
+#include "lod_selector.hpp"
+#include "meshlet_culler.hpp"
+#include "geometry_arena.hpp"
+#include "render_queue.hpp"
+#include "transfer_queue.hpp"
+#include "asset_loader.hpp"
+#include "scene_file.hpp"
+#include "deletion_queue.hpp"
 
 class Camera;
+class WorldStreamer;
 class WindowState;
 class PointLightBuffer;
 class DirectionalLightBuffer;
@@ -36,23 +49,80 @@ public:
 	void createRenderModeResource();
 	void cleanupRenderModeResource();
 	void createLevelResource(size_t modelCount, size_t pointLightCount, size_t dirLightCount);
-	ModelResource createModelResource(std::string textureDir, std::string modelDir, nlohmann::json data);
+	ModelResource createModelResource(const std::string& textureDir, const std::string& modelDir, const SceneFile::ModelRef& model);
+	// queues the model for decoding on the loader threads and returns the shared placeholder,
+	// applyResidentModels swaps in the real model once it is resident
+	ModelResource requestModelResource(const std::string& textureDir, const std::string& modelDir, const SceneFile::ModelRef& model);
+	// uploads decoded models and collects the ones that became resident this frame
+	void updateAssetStreaming();
+	// replaces the placeholders of models that became resident this frame. returns whether any
+	// asset changed, uploadBeginNs is lowered to the earliest upload start of the swapped models
+	bool applyResidentModels(std::vector<AssetData>& assets, int64_t* uploadBeginNs = nullptr);
+	// destroys the model once no frame in flight draws it anymore, or drops it while still streaming
+	void releaseModelResource(const ModelResource& model);
+	// the group drawn as one instanced call, its object at the origin and its model streaming in
+	AssetData requestInstanceGroup(
+		const std::string& textureDir,
+		const std::string& modelDir,
+		const SceneFile::Scene& scene,
+		const SceneFile::InstanceGroup& group
+	);
+	// frees the transforms of an instance group once no frame in flight draws it anymore
+	void releaseInstances(const AssetData& asset);
+	// no model is decoding or uploading and no texture mips are being uploaded
+	bool isStreamingIdle();
+	inline void setWorldStreamer(WorldStreamer* streamer) {
+		gui.setWorldStreamer(streamer);
+	}
+	// the scene's default, the GUI can still change it
+	inline void setDepthPrepass(bool enabled) {
+		gui.setDepthPrepass(enabled);
+	}
 	void updateLightSSBO(std::vector<PointLightBuffer>& pointLights, std::vector<DirectionalLightBuffer>& directionalLights);
 	void createModelDescriptorPool(size_t modelCount, size_t lightCount);
 	void updateCamera(const Camera& camera);
+	// picks the LOD every pass draws each object with, before render
+	void selectLods(std::vector<AssetData>& objects, const Camera& camera);
 	void render(
 		const std::vector<AssetData>& objects,
 		const Camera& camera,
-		const std::vector<DirectionalLightBuffer> directionalLights
+		const std::vector<DirectionalLightBuffer>& directionalLights
 	);
 	void cleanup(AssetData& player, std::vector<AssetData>& props);
 	void deviceWaitIdle() {
 		vkDeviceWaitIdle(device);
 	}
 	void changeRenderPass();
-	static const std::unordered_map<std::string, int> textureTypeMap;
+	void printBenchmarkReport(std::ostream& out) const;
 
 private:
+	struct PendingModel {
+		uint32_t ticket;
+		ModelResource resource;
+		// the vertex, index and meshlet copies signal this transfer timeline value
+		uint64_t value;
+		std::array<VkBuffer, 3> stagingBuffers;
+		std::array<VkDeviceMemory, 3> stagingBuffersMemory;
+		int64_t uploadBeginNs;
+	};
+
+	// what the frame's passes record, besides the resources that bump sceneGeneration directly
+	struct DrawState {
+		uint64_t renderQueue = 0;
+		uint64_t textureWrites = 0;
+		uint64_t meshletReallocations = 0;
+		bool meshletCulling = false;
+		bool depthPrepass = false;
+
+		inline bool operator!=(const DrawState& other) const {
+			return renderQueue != other.renderQueue
+				|| textureWrites != other.textureWrites
+				|| meshletReallocations != other.meshletReallocations
+				|| meshletCulling != other.meshletCulling
+				|| depthPrepass != other.depthPrepass;
+		}
+	};
+
 	VkInstance instance = VK_NULL_HANDLE;
 	VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
 	VkSurfaceKHR surface = VK_NULL_HANDLE;
@@ -62,16 +132,23 @@ private:
 
 	VkQueue graphicsQueue = VK_NULL_HANDLE;
 	VkQueue presentQueue = VK_NULL_HANDLE;
+	VkQueue transferQueueHandle = VK_NULL_HANDLE;
 
 	Swapchain swapchain;
 	std::unique_ptr<SwapchainRenderPass> swapchainRenderPass;
 	std::unique_ptr<RayTracingPipeline> rayTracingPipeline;
+	std::unique_ptr<RenderGraph> rayTracingGraph;
+	RenderGraphResource rayTracingSwapchainImage = 0;
 
 	VkDescriptorPool modelDescriptorPool = VK_NULL_HANDLE;
+	// pools added once modelDescriptorPool ran out, the last one takes new models
+	std::vector<VkDescriptorPool> grownModelDescriptorPools;
 	VkDescriptorSetLayout modelTextureDescriptorSetLayout = VK_NULL_HANDLE;
 	CommonDescriptor commonDescriptor;
 
 	BufferResource modelMatrixUBOResource;
+	// matrices each frame's buffer has room for, a frame's buffer only grows after its fence wait
+	std::array<size_t, Config::MAX_FRAMES_IN_FLIGHT> modelMatrixCapacity{};
 	BufferResource cameraMatrixUBOResource;
 	BufferResource cameraUBOResource;
 	BufferResource pointLightSSBOResource;
@@ -80,7 +157,8 @@ private:
 	VkSampler textureSampler = VK_NULL_HANDLE;
 
 	std::unique_ptr<BaseRenderPass> renderModeManager;
-	std::vector<std::unique_ptr<BaseRenderPass>> oldRenderPassQueue[Config::MAX_FRAMES_IN_FLIGHT];
+	// replaced passes, swapchains and attachments wait here for the frames that still use them
+	DeletionQueue deletionQueue;
 
 	VkCommandPool commandPool = VK_NULL_HANDLE;
 	std::vector<VkCommandBuffer> commandBuffers;
@@ -91,7 +169,41 @@ private:
 
 	WindowState& windowState;
 	VulkanGUI gui;
+	GpuProfiler gpuProfiler;
+	TransferQueue transferQueue;
+	TextureStreamer textureStreamer;
+	LodSelector lodSelector;
+	MeshletCuller meshletCuller;
+	GeometryArena geometryArena;
+	InstanceBuffer instanceBuffer;
+	RenderQueue renderQueue;
+	AssetLoader assetLoader;
+	// reused by updateAssetStreaming
+	AssetLoader::DecodedModel decodedModel;
+	ModelResource placeholderModel;
+	std::vector<PendingModel> pendingModels;
+	// models of this frame's updateAssetStreaming, with the ticket their placeholders hold
+	std::vector<PendingModel> residentModels;
+	// released while decoding or uploading, destroyed as soon as they arrive
+	std::vector<uint32_t> cancelledTickets;
+	std::vector<ModelResource> retiredModels[Config::MAX_FRAMES_IN_FLIGHT];
+	// first instance and count of the released instance groups
+	std::vector<std::pair<uint32_t, uint32_t>> retiredInstances[Config::MAX_FRAMES_IN_FLIGHT];
+	uint32_t nextAssetTicket = 1;
+	uint32_t nextSortId = 1;
+	FrameTelemetry frameTelemetry;
+	FrameArena frameArena{Config::FRAME_ARENA_SIZE};
 	bool shouldSwitchRenderPass = false;
+	bool pipelineStatisticsEnabled = false;
+	bool textureCompressionEnabled = false;
+	bool multiDrawIndirectEnabled = false;
+	bool drawIndirectCountEnabled = false;
+	bool commandCachingSupported = false;
+	// cached command buffers recorded for an older generation are recorded again
+	uint64_t sceneGeneration = 1;
+	DrawState lastDrawState;
+	// of the last updateCamera, the meshlet culling frustum
+	glm::mat4 viewProjection{1.0f};
 
 	uint32_t mipLevels = 1;
 	uint32_t currentFrame = 0;
@@ -115,11 +227,43 @@ private:
 	void createTextureSampler();
 	void createSyncObjects();
 
-	void createTextureImage(std::string path,  VkImage& image, VkDeviceMemory& memory);
-	void createVertexBuffer(std::vector<Vertex>& vertices, VkBuffer& vertexBuffer, VkDeviceMemory& vertexBufferMemory);
-	void createIndexBuffer(std::vector<uint32_t>& indices, VkBuffer& indexBuffer, VkDeviceMemory& indexBufferMemory);
+	void createTextureImage(const AssetLoader::DecodedTexture& texture, int textureType, VkImage& image, VkDeviceMemory& memory, VkFormat& format);
+	// packs the vertices into the PackedVertex streams of the model's arena allocation
+	void createVertexBuffer(
+		const std::vector<Vertex>& vertices,
+		ModelResource& model,
+		VkCommandBuffer commandBuffer,
+		VkBuffer& stagingBuffer,
+		VkDeviceMemory& stagingBufferMemory
+	);
+	void createIndexBuffer(
+		const std::vector<uint32_t>& indices,
+		const GeometryArena::Allocation& geometry,
+		VkCommandBuffer commandBuffer,
+		VkBuffer& stagingBuffer,
+		VkDeviceMemory& stagingBufferMemory
+	);
+	void createMeshletBuffer(
+		const std::vector<MeshFile::Meshlet>& meshlets,
+		VkBuffer& meshletBuffer,
+		VkDeviceMemory& meshletBufferMemory,
+		VkCommandBuffer commandBuffer,
+		VkBuffer& stagingBuffer,
+		VkDeviceMemory& stagingBufferMemory
+	);
 	void createBufferResource(VkDeviceSize bufferSize, BufferResource& bufferResource, VkBufferUsageFlags usage);
-	void createModelTextureDescriptorSets(std::vector<VkDescriptorSet>& descriptorSets, std::array<VkImageView, 3>& textureImageViews);
+	void createModelTextureDescriptorSets(
+		std::vector<VkDescriptorSet>& descriptorSets,
+		VkDescriptorPool& descriptorPool,
+		std::array<VkImageView, 3>& textureImageViews
+	);
+	void destroyModelResource(ModelResource& model);
+	void growModelDescriptorPool();
+	void reserveModelMatrices(size_t modelCount);
+	AssetLoader::Request createAssetRequest(const std::string& textureDir, const std::string& modelDir, const SceneFile::ModelRef& model);
+	void uploadModelResource(AssetLoader::DecodedModel& decoded, PendingModel& pending);
+	void finishModelUpload(PendingModel& pending);
+	void createPlaceholderModelResource();
 
 	bool checkValidationLayerSupport();
 	std::vector<const char*> getRequiredExtensions();
@@ -134,9 +278,11 @@ private:
     void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
     void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
 	void generateMipmaps(VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels);
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+	void copyBuffer(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
 	void recreateSwapchain();
 	void cleanupSwapchain();
+	void createRayTracingGraph();
+	void cleanupRayTracingGraph();
 	VkSampleCountFlagBits getMaxUsableSampleCount();
 	void switchRenderPassCallback();
 
@@ -2,6 +2,7 @@
 
 #include <vulkan/vulkan.h>
 
+#include <algorithm>
 #include <optional>
 #include <cstddef>
 #include <cstring>
@@ -10,6 +11,9 @@
 
 #include "game_object.hpp"
 #include "buffer_types.hpp"
+#include "mesh_file.hpp"
+#include "geometry_arena.hpp"
+#include "instance_buffer.hpp"
 
 struct VertexBufferResource {
 	VkBuffer buffer;
@@ -29,22 +33,44 @@ struct ImageResource {
 };
 
 struct ModelResource {
-	VertexBufferResource vertexBufferResource;
-	VertexBufferResource indexBufferResource;
+	// PackedVertex streams and indices in the GeometryArena, freed with the model by VulkanState
+	GeometryArena::Allocation geometry;
+	// from the stored positions to object space, precedes the object's model matrix
+	glm::mat4 positionDequantize{1.0f};
+	// unused slots of textures owned by the TextureStreamer keep null handles
 	std::array<ImageResource, 3> textureResources;
+	std::array<int32_t, 3> streamedTextures = {-1, -1, -1};
 	std::vector<VkDescriptorSet> descriptorSets;
-	size_t indexCount;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	// ranges of the model's indices from geometry.firstIndex on, finest first
+	std::array<MeshFile::Lod, MeshFile::MAX_LODS> lods{};
+	uint32_t lodCount = 0;
+	// MeshFile::Meshlet ranges of LOD 0, read by the MeshletCuller through its own set
+	VertexBufferResource meshletBufferResource{};
+	uint32_t meshletCount = 0;
+	VkDescriptorSet meshletDescriptorSet = VK_NULL_HANDLE;
+	VkDescriptorPool meshletDescriptorPool = VK_NULL_HANDLE;
+	// UV units per world unit, and the object space bounding sphere around the origin
+	float uvDensity = 0.0f;
+	float boundingRadius = 0.0f;
+	// non-zero while this is a copy of the shared placeholder standing in for a streamed model
+	uint32_t streamTicket = 0;
+	// unique per uploaded model, groups its draws in the RenderQueue
+	uint32_t sortId = 0;
+	// geometry and fully resident textures, streamed textures are accounted by the TextureStreamer
+	size_t residentBytes = 0;
+
+	inline const MeshFile::Lod& getLod(uint32_t lod) const {
+		return lods[std::min(lod, lodCount - 1)];
+	}
 
 	void cleanup(VkDevice device) {
 		for (auto textureResource : textureResources) {
 			textureResource.cleanup(device);
 		}
 
-		vkDestroyBuffer(device, indexBufferResource.buffer, nullptr);
-		vkFreeMemory(device, indexBufferResource.bufferMemory, nullptr);
-
-		vkDestroyBuffer(device, vertexBufferResource.buffer, nullptr);
-		vkFreeMemory(device, vertexBufferResource.bufferMemory, nullptr);
+		vkDestroyBuffer(device, meshletBufferResource.buffer, nullptr);
+		vkFreeMemory(device, meshletBufferResource.bufferMemory, nullptr);
 	}
 };
 
@@ -99,11 +125,39 @@ struct BufferResource {
 struct AssetData {
 	GameObject object;
 	ModelResource resource;
+	// chosen by the LodSelector each frame, kept for its hysteresis
+	uint32_t lod = 0;
+	uint32_t shadowLod = 0;
+	// the range of the InstanceBuffer drawn in one call. an instance group keeps its object at the
+	// origin, the instance transforms place the copies
+	uint32_t firstInstance = 0;
+	uint32_t instanceCount = 1;
+	// of an instance group: a sphere around the instance positions and the largest instance scale
+	glm::vec3 instanceCenter{0.0f};
+	float instanceRadius = 0.0f;
+	float instanceScale = 1.0f;
+
+	inline bool isInstanceGroup() const {
+		return firstInstance != InstanceBuffer::IDENTITY;
+	}
+
+	// what the vertex shaders multiply the stored positions with, after the instance transform
+	inline glm::mat4 getModelMatrix() const {
+		return object.getModelMatrix() * resource.positionDequantize;
+	}
+
+	// center and radius around everything drawn, for the distance based LOD and mip selection
+	inline glm::vec4 getBoundingSphere() const {
+		if (isInstanceGroup()) {
+			return glm::vec4(instanceCenter, instanceRadius + resource.boundingRadius * instanceScale);
+		}
+		return glm::vec4(object.getPosition(), resource.boundingRadius);
+	}
 
 	uint32_t updateModelTransformMatrix(uint32_t index, void* modelMatrixBufferMapped) const {
 		uint32_t offset = static_cast<uint32_t>(index * sizeof(TransformMatrixBuffer));
 		TransformMatrixBuffer matrixUBO{};
-		matrixUBO.model = object.getModelMatrix();
+		matrixUBO.model = getModelMatrix();
 		void* target = static_cast<char*>(modelMatrixBufferMapped) + offset;
 		memcpy(target, &matrixUBO, sizeof(matrixUBO));
 		return offset;
@@ -113,6 +167,8 @@ struct AssetData {
 struct QueueFamilyIndices {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	// transfer-only family when the device has one, uploads fall back to graphics otherwise
+	std::optional<uint32_t> transferFamily;
 
 	inline bool isComplete() {
 		return graphicsFamily.has_value() && presentFamily.has_value();
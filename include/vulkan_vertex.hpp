@@ -6,10 +6,19 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glm/gtx/hash.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "constants.hpp"
 
 struct Vertex {
 	glm::vec3 pos;
@@ -58,11 +67,170 @@ struct Vertex {
 	}
 };
 
-namespace std {
-	template<>
-	struct hash<Vertex> {
-		size_t operator()(const Vertex& vertex) const {
-			return ((hash<glm::vec3>()(vertex.pos) ^ (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^ (hash<glm::vec2>()(vertex.texCoord) << 1);
-		}
+// the layout vertex buffers hold, Vertex stays the decoded one. positions are a stream of their own so that
+// depth-only passes fetch nothing else: 16-bit UNORM across the mesh bounds, or floats without
+// Config::QUANTIZE_VERTEX_POSITIONS. the second stream has octahedral 2x16-bit SNORM normals and
+// half float UVs, the constant color is dropped. 16 bytes per vertex against the 44 of Vertex
+struct PackedVertex {
+	struct Attributes {
+		uint32_t normal;
+		uint32_t texCoord;
 	};
-}
+
+	static constexpr VkFormat POSITION_FORMAT = Config::QUANTIZE_VERTEX_POSITIONS ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R32G32B32_SFLOAT;
+	static constexpr uint32_t POSITION_STRIDE = Config::QUANTIZE_VERTEX_POSITIONS ? 4 * sizeof(uint16_t) : 3 * sizeof(float);
+
+	// per-instance transforms, a mat4 taking four locations
+	static constexpr uint32_t INSTANCE_BINDING = 2;
+
+	// binding 0 is the position stream, binding 1 the attributes, INSTANCE_BINDING the instance transforms
+	static std::array<VkVertexInputBindingDescription, 3> getBindingDescriptions() {
+		std::array<VkVertexInputBindingDescription, 3> bindingDescriptions{};
+		bindingDescriptions[0] = getPositionBindingDescription();
+
+		bindingDescriptions[1].binding = 1;
+		bindingDescriptions[1].stride = sizeof(Attributes);
+		bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		bindingDescriptions[2] = getInstanceBindingDescription();
+
+		return bindingDescriptions;
+	}
+
+	// the instance transform at locations 3 to 6
+	static std::array<VkVertexInputAttributeDescription, 7> getAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 7> attributeDescriptions{};
+		attributeDescriptions[0] = getPositionAttributeDescription();
+
+		attributeDescriptions[1].binding = 1;
+		attributeDescriptions[1].location = 1;
+		attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+		attributeDescriptions[1].offset = offsetof(Attributes, normal);
+
+		attributeDescriptions[2].binding = 1;
+		attributeDescriptions[2].location = 2;
+		attributeDescriptions[2].format = VK_FORMAT_R16G16_SFLOAT;
+		attributeDescriptions[2].offset = offsetof(Attributes, texCoord);
+
+		auto instanceAttributes = getInstanceAttributeDescriptions(3);
+		std::copy(instanceAttributes.begin(), instanceAttributes.end(), attributeDescriptions.begin() + 3);
+
+		return attributeDescriptions;
+	}
+
+	// depth-only passes bind the position stream and the instance transforms, at locations 1 to 4
+	static std::array<VkVertexInputBindingDescription, 2> getPositionBindingDescriptions() {
+		return {getPositionBindingDescription(), getInstanceBindingDescription()};
+	}
+
+	static std::array<VkVertexInputAttributeDescription, 5> getPositionAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions{};
+		attributeDescriptions[0] = getPositionAttributeDescription();
+		auto instanceAttributes = getInstanceAttributeDescriptions(1);
+		std::copy(instanceAttributes.begin(), instanceAttributes.end(), attributeDescriptions.begin() + 1);
+
+		return attributeDescriptions;
+	}
+
+	static VkVertexInputBindingDescription getPositionBindingDescription() {
+		VkVertexInputBindingDescription bindingDescription{};
+		bindingDescription.binding = 0;
+		bindingDescription.stride = POSITION_STRIDE;
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return bindingDescription;
+	}
+
+	static VkVertexInputAttributeDescription getPositionAttributeDescription() {
+		VkVertexInputAttributeDescription attributeDescription{};
+		attributeDescription.binding = 0;
+		attributeDescription.location = 0;
+		attributeDescription.format = POSITION_FORMAT;
+		attributeDescription.offset = 0;
+
+		return attributeDescription;
+	}
+
+	static VkVertexInputBindingDescription getInstanceBindingDescription() {
+		VkVertexInputBindingDescription bindingDescription{};
+		bindingDescription.binding = INSTANCE_BINDING;
+		bindingDescription.stride = sizeof(glm::mat4);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+		return bindingDescription;
+	}
+
+	// one column of the transform per location
+	static std::array<VkVertexInputAttributeDescription, 4> getInstanceAttributeDescriptions(uint32_t firstLocation) {
+		std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+		for (uint32_t column = 0; column < attributeDescriptions.size(); ++column) {
+			attributeDescriptions[column].binding = INSTANCE_BINDING;
+			attributeDescriptions[column].location = firstLocation + column;
+			attributeDescriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			attributeDescriptions[column].offset = column * sizeof(glm::vec4);
+		}
+
+		return attributeDescriptions;
+	}
+
+	// where the attribute stream starts in a buffer holding both
+	static size_t getAttributeOffset(size_t vertexCount) {
+		return (static_cast<size_t>(POSITION_STRIDE) * vertexCount + alignof(Attributes) - 1) / alignof(Attributes) * alignof(Attributes);
+	}
+
+	static size_t getSize(size_t vertexCount) {
+		return getAttributeOffset(vertexCount) + sizeof(Attributes) * vertexCount;
+	}
+
+	static glm::vec2 encodeOctahedral(const glm::vec3& normal) {
+		float sum = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		if (sum == 0.0f) {
+			return glm::vec2(0.0f);
+		}
+		glm::vec3 n = normal / sum;
+		if (n.z >= 0.0f) {
+			return glm::vec2(n.x, n.y);
+		}
+		// the lower hemisphere folds over the diagonals
+		return glm::vec2(
+			(1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)
+		);
+	}
+
+	// writes getSize(vertices.size()) bytes. returns the matrix from the stored positions back to
+	// object space, the scale is uniform so normals transformed by the model matrix only need normalizing
+	static glm::mat4 pack(const std::vector<Vertex>& vertices, uint8_t* destination) {
+		glm::vec3 minimum(0.0f);
+		float extent = 1.0f;
+		if (Config::QUANTIZE_VERTEX_POSITIONS && !vertices.empty()) {
+			minimum = vertices[0].pos;
+			glm::vec3 maximum = vertices[0].pos;
+			for (const auto& vertex : vertices) {
+				minimum = glm::min(minimum, vertex.pos);
+				maximum = glm::max(maximum, vertex.pos);
+			}
+			glm::vec3 size = maximum - minimum;
+			extent = std::max({size.x, size.y, size.z});
+			if (extent <= 0.0f) {
+				extent = 1.0f;
+			}
+		}
+
+		uint8_t* positions = destination;
+		Attributes* attributes = reinterpret_cast<Attributes*>(destination + getAttributeOffset(vertices.size()));
+		for (size_t i = 0; i < vertices.size(); ++i) {
+			const Vertex& vertex = vertices[i];
+			if (Config::QUANTIZE_VERTEX_POSITIONS) {
+				glm::vec4 unit(glm::clamp((vertex.pos - minimum) / extent, 0.0f, 1.0f), 0.0f);
+				uint64_t packed = glm::packUnorm4x16(unit);
+				std::memcpy(positions + i * POSITION_STRIDE, &packed, POSITION_STRIDE);
+			} else {
+				std::memcpy(positions + i * POSITION_STRIDE, &vertex.pos, POSITION_STRIDE);
+			}
+			attributes[i].normal = glm::packSnorm2x16(encodeOctahedral(vertex.normal));
+			attributes[i].texCoord = glm::packHalf2x16(vertex.texCoord);
+		}
+		return glm::scale(glm::translate(glm::mat4(1.0f), minimum), glm::vec3(extent));
+	}
+};
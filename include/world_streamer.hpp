@@ -0,0 +1,127 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "constants.hpp"
+#include "scene_file.hpp"
+#include "vulkan_types.hpp"
+
+class GraphicsSystem;
+
+// streams the props of a world partitioned into square cells around the camera. cells inside
+// the load radius are requested nearest first while their last known size fits the budget,
+// cells past the unload radius are released, and the farthest cells go first over budget
+class WorldStreamer {
+public:
+	enum class CellState {
+		UNLOADED,
+		// props are placeholders until their models are resident
+		LOADING,
+		RESIDENT
+	};
+
+	struct Cell {
+		int32_t x = 0;
+		int32_t z = 0;
+		std::string manifestPath;
+		CellState state = CellState::UNLOADED;
+		std::vector<AssetData> props;
+		// measured on the last load, the estimate for loading it again
+		size_t residentBytes = 0;
+		// from the camera to the cell's square on the ground plane
+		float distance = 0.0f;
+		int64_t requestNs = 0;
+		int64_t uploadBeginNs = 0;
+	};
+
+	struct Latency {
+		float lastMs = 0.0f;
+		float meanMs = 0.0f;
+		float maxMs = 0.0f;
+		uint64_t count = 0;
+
+		inline void add(float ms) {
+			lastMs = ms;
+			maxMs = std::max(maxMs, ms);
+			++count;
+			meanMs += (ms - meanMs) / static_cast<float>(count);
+		}
+	};
+
+	WorldStreamer() = default;
+	~WorldStreamer() = default;
+
+	// takes the world partition of the scene, manifest paths are relative to sceneDir
+	void load(const SceneFile::Scene& scene, const std::string& sceneDir);
+	// call after GraphicsSystem::updateAssetStreaming. returns whether the props of any cell changed
+	bool update(const glm::vec3& cameraPosition, GraphicsSystem& graphicsSystem);
+	void cleanup(GraphicsSystem& graphicsSystem);
+	// whether any cell still waits for its models
+	bool isLoading() const;
+	// props of the loading and resident cells
+	void appendProps(std::vector<AssetData>& assets) const;
+
+	inline const std::vector<Cell>& getCells() const {
+		return cells;
+	}
+	inline float getCellSize() const {
+		return cellSize;
+	}
+	inline float getLoadRadius() const {
+		return loadRadius;
+	}
+	inline void setLoadRadius(float radius) {
+		loadRadius = radius;
+	}
+	inline float getUnloadRadius() const {
+		return loadRadius * Config::WORLD_STREAMING_UNLOAD_FACTOR;
+	}
+	inline size_t getBudget() const {
+		return budget;
+	}
+	inline void setBudget(size_t bytes) {
+		budget = bytes;
+	}
+	inline size_t getCommittedBytes() const {
+		return committedBytes;
+	}
+	// request until every prop of the cell is resident
+	inline const Latency& getLoadLatency() const {
+		return loadLatency;
+	}
+	// first model upload of the cell until every prop is resident
+	inline const Latency& getUploadLatency() const {
+		return uploadLatency;
+	}
+	// CPU time of releasing a cell, the GPU memory follows once the frames in flight completed
+	inline const Latency& getUnloadLatency() const {
+		return unloadLatency;
+	}
+
+private:
+	void loadCell(Cell& cell, GraphicsSystem& graphicsSystem);
+	void unloadCell(Cell& cell, GraphicsSystem& graphicsSystem);
+
+	std::vector<Cell> cells;
+	// reserved on load so update() doesn't allocate
+	std::vector<size_t> candidates;
+	std::string textureDir;
+	std::string modelDir;
+	float cellSize = 1.0f;
+	float loadRadius = Config::WORLD_STREAMING_LOAD_RADIUS;
+	size_t budget = Config::WORLD_STREAMING_BUDGET;
+	size_t committedBytes = 0;
+
+	Latency loadLatency;
+	Latency uploadLatency;
+	Latency unloadLatency;
+};
@@ -10,7 +10,6 @@ layout(set = 3, binding = 0) uniform sampler2D albedoSampler;
 layout(set = 3, binding = 1) uniform sampler2D normalSampler;
 layout(set = 3, binding = 2) uniform sampler2D materialSampler;
 
-layout(location = 0) in vec3 inColor;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoord;
 layout(location = 3) in vec3 inPosition;
@@ -9,20 +9,30 @@ layout(set= 1, binding = 0) uniform CameraMatrix {
     mat4 proj;
 } cameraMat;
 
+// PackedVertex: positions as stored, the model matrix maps them to object space.
+// octahedral normal and half float UV
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in vec3 inNormal;
-layout(location = 2) in vec3 inColor;
-layout(location = 3) in vec2 inTexCoord;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+// InstanceBuffer, the identity outside of instance groups
+layout(location = 3) in mat4 inInstance;
 
-layout(location = 0) out vec3 outColor;
 layout(location = 1) out vec3 outNormal;
 layout(location = 2) out vec2 outTexCoord;
 layout(location = 3) out vec3 outPosition;
 
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 void main() {
-    gl_Position = cameraMat.proj * cameraMat.view * modelMat.model * vec4(inPosition, 1.0);
-    outNormal = normalize(mat3(modelMat.model) * inNormal);
-    outColor = inColor;
+    mat4 model = inInstance * modelMat.model;
+    gl_Position = cameraMat.proj * cameraMat.view * model * vec4(inPosition, 1.0);
+    outNormal = normalize(mat3(model) * decodeOctahedral(inNormal));
     outTexCoord = inTexCoord;
-    outPosition = vec3(modelMat.model * vec4(inPosition, 1.0));
+    outPosition = vec3(model * vec4(inPosition, 1.0));
 }
\ No newline at end of file
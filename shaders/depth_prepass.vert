@@ -0,0 +1,22 @@
+#version 460
+
+layout(set= 0, binding = 0) uniform ModelMatrix {
+    mat4 model;
+} modelMat;
+
+layout(set= 1, binding = 0) uniform CameraMatrix {
+    mat4 view;
+    mat4 proj;
+} cameraMat;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in mat4 inInstance;
+
+// the forward color pass tests against this depth with EQUAL, both compute it the same way
+invariant gl_Position;
+
+void main() {
+    mat4 model = inInstance * modelMat.model;
+    vec4 worldPos = model * vec4(inPosition, 1.0);
+    gl_Position = cameraMat.proj * cameraMat.view * worldPos;
+}
@@ -33,7 +33,6 @@ layout(set = 4, binding = 2) uniform sampler2D materialSampler;
 
 layout(set = 5, binding = 0, rgba32f) uniform writeonly image2D outputImage;
 
-layout(location = 0) in vec3 inColor;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoord;
 layout(location = 3) in vec3 inPosition;
@@ -40,16 +40,12 @@ layout(set = 3, binding = 4) uniform sampler2D gDepth;
 layout(location = 0) in vec2 inTexCoord;
 layout(location = 0) out vec4 outColor;
 
-int BLOCK_SIZE = 8;
+// the G-buffer is rendered at swapchain extent / blockSize
 layout(push_constant) uniform PushConstant {
-    vec2 resolution;
+    int blockSize;
 };
 
 void main() {
-    vec2 pixelCoord = inTexCoord * resolution;
-	pixelCoord = clamp(pixelCoord, vec2(0.0), resolution - BLOCK_SIZE);
-    vec2 blockCoord = floor(pixelCoord / BLOCK_SIZE) * BLOCK_SIZE;
-	blockCoord = blockCoord + BLOCK_SIZE * 0.5;
-    vec2 mosaicUV = blockCoord / resolution;
-    outColor = texture(gAlbedo, mosaicUV);
+    ivec2 texel = ivec2(gl_FragCoord.xy) / blockSize;
+    outColor = texelFetch(gAlbedo, texel, 0);
 }
\ No newline at end of file
@@ -11,7 +11,8 @@ layout(set = 1, binding = 0) uniform LightUBO {
 } light;
 
 layout(location = 0) in vec3 inPosition;
+layout(location = 1) in mat4 inInstance;
 
 void main() {
-    gl_Position = light.proj * light.view * model.model * vec4(inPosition, 1.0);
+    gl_Position = light.proj * light.view * inInstance * model.model * vec4(inPosition, 1.0);
 }
\ No newline at end of file
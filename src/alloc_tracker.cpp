@@ -0,0 +1,240 @@
+#include "alloc_tracker.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define RTG_RETURN_ADDRESS() _ReturnAddress()
+#else
+#define RTG_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
+namespace {
+	std::atomic<uint64_t> frameAllocations{0};
+	std::atomic<uint64_t> frameFrees{0};
+	std::atomic<uint64_t> frameBytes{0};
+	std::atomic<uint64_t> peakAllocations{0};
+
+	// written by endFrame() only, which runs on the main thread
+	AllocTracker::Counters lastCounters;
+
+#ifndef NDEBUG
+	// fixed size open addressing, the hooks must not allocate themselves
+	constexpr size_t CALL_SITE_SLOTS = 1024;
+	std::array<AllocTracker::CallSite, CALL_SITE_SLOTS> callSites{};
+	std::atomic_flag callSiteLock = ATOMIC_FLAG_INIT;
+
+	void recordCallSite(void* address) {
+		while (callSiteLock.test_and_set(std::memory_order_acquire)) {
+		}
+		size_t slot = (reinterpret_cast<uintptr_t>(address) >> 4) % CALL_SITE_SLOTS;
+		for (size_t probe = 0; probe < CALL_SITE_SLOTS; ++probe) {
+			AllocTracker::CallSite& site = callSites[(slot + probe) % CALL_SITE_SLOTS];
+			if (site.address == address || site.address == nullptr) {
+				site.address = address;
+				++site.count;
+				break;
+			}
+		}
+		callSiteLock.clear(std::memory_order_release);
+	}
+#endif
+
+	void* allocate(size_t size, void* caller) {
+		void* pointer = std::malloc(size == 0 ? 1 : size);
+		if (pointer == nullptr) {
+			throw std::bad_alloc();
+		}
+		frameAllocations.fetch_add(1, std::memory_order_relaxed);
+		frameBytes.fetch_add(size, std::memory_order_relaxed);
+#ifndef NDEBUG
+		recordCallSite(caller);
+#else
+		(void)caller;
+#endif
+		return pointer;
+	}
+
+	void* allocateAligned(size_t size, size_t alignment, void* caller) {
+#ifdef _WIN32
+		void* pointer = _aligned_malloc(size == 0 ? 1 : size, alignment);
+#else
+		// aligned_alloc wants the size to be a multiple of the alignment
+		void* pointer = std::aligned_alloc(alignment, (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment);
+#endif
+		if (pointer == nullptr) {
+			throw std::bad_alloc();
+		}
+		frameAllocations.fetch_add(1, std::memory_order_relaxed);
+		frameBytes.fetch_add(size, std::memory_order_relaxed);
+#ifndef NDEBUG
+		recordCallSite(caller);
+#else
+		(void)caller;
+#endif
+		return pointer;
+	}
+
+	void deallocate(void* pointer) {
+		if (pointer == nullptr) {
+			return;
+		}
+		frameFrees.fetch_add(1, std::memory_order_relaxed);
+		std::free(pointer);
+	}
+
+	void deallocateAligned(void* pointer) {
+		if (pointer == nullptr) {
+			return;
+		}
+		frameFrees.fetch_add(1, std::memory_order_relaxed);
+#ifdef _WIN32
+		_aligned_free(pointer);
+#else
+		std::free(pointer);
+#endif
+	}
+}
+
+namespace AllocTracker {
+	Counters frame() {
+		Counters counters;
+		counters.allocations = frameAllocations.load(std::memory_order_relaxed);
+		counters.frees = frameFrees.load(std::memory_order_relaxed);
+		counters.bytes = frameBytes.load(std::memory_order_relaxed);
+		return counters;
+	}
+
+	void endFrame() {
+		lastCounters.allocations = frameAllocations.exchange(0, std::memory_order_relaxed);
+		lastCounters.frees = frameFrees.exchange(0, std::memory_order_relaxed);
+		lastCounters.bytes = frameBytes.exchange(0, std::memory_order_relaxed);
+		if (lastCounters.allocations > peakAllocations.load(std::memory_order_relaxed)) {
+			peakAllocations.store(lastCounters.allocations, std::memory_order_relaxed);
+		}
+	}
+
+	Counters lastFrame() {
+		return lastCounters;
+	}
+
+	uint64_t peakFrameAllocations() {
+		return peakAllocations.load(std::memory_order_relaxed);
+	}
+
+	void resetPeak() {
+		peakAllocations.store(0, std::memory_order_relaxed);
+#ifndef NDEBUG
+		while (callSiteLock.test_and_set(std::memory_order_acquire)) {
+		}
+		callSites.fill(CallSite{});
+		callSiteLock.clear(std::memory_order_release);
+#endif
+	}
+
+	size_t getCallSites(CallSite* result, size_t maxCount) {
+#ifndef NDEBUG
+		size_t count = 0;
+		while (callSiteLock.test_and_set(std::memory_order_acquire)) {
+		}
+		for (const auto& site : callSites) {
+			if (site.address == nullptr) {
+				continue;
+			}
+			// insertion into the caller's array keeps the most frequent sites
+			size_t position = count < maxCount ? count++ : maxCount;
+			while (position > 0 && result[position - 1].count < site.count) {
+				if (position < maxCount) {
+					result[position] = result[position - 1];
+				}
+				--position;
+			}
+			if (position < maxCount) {
+				result[position] = site;
+			}
+		}
+		callSiteLock.clear(std::memory_order_release);
+		return count;
+#else
+		(void)result;
+		(void)maxCount;
+		return 0;
+#endif
+	}
+}
+
+void* operator new(size_t size) {
+	return allocate(size, RTG_RETURN_ADDRESS());
+}
+
+void* operator new[](size_t size) {
+	return allocate(size, RTG_RETURN_ADDRESS());
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return allocate(size, RTG_RETURN_ADDRESS());
+	} catch (const std::bad_alloc&) {
+		return nullptr;
+	}
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return allocate(size, RTG_RETURN_ADDRESS());
+	} catch (const std::bad_alloc&) {
+		return nullptr;
+	}
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+	return allocateAligned(size, static_cast<size_t>(alignment), RTG_RETURN_ADDRESS());
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+	return allocateAligned(size, static_cast<size_t>(alignment), RTG_RETURN_ADDRESS());
+}
+
+void operator delete(void* pointer) noexcept {
+	deallocate(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+	deallocate(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+	deallocate(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+	deallocate(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+	deallocate(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+	deallocate(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+	deallocateAligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+	deallocateAligned(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+	deallocateAligned(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept {
+	deallocateAligned(pointer);
+}
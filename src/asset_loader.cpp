@@ -0,0 +1,188 @@
+#include "asset_loader.hpp"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+#include "cook_manifest.hpp"
+#include "cpu_profiler.hpp"
+#include "mesh_file.hpp"
+#include "mesh_optimizer.hpp"
+#include "vfs.hpp"
+
+static_assert(sizeof(Vertex) == sizeof(MeshFile::Vertex), "cooked meshes are copied into Vertex as is");
+
+void AssetLoader::init(uint32_t workerCount) {
+	stopping = false;
+	workers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; ++i) {
+		workers.emplace_back(&AssetLoader::workerLoop, this);
+	}
+}
+
+void AssetLoader::cleanup() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		requests.clear();
+	}
+	condition.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+	results.clear();
+}
+
+void AssetLoader::request(Request request) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		requests.push_back(std::move(request));
+	}
+	condition.notify_one();
+}
+
+bool AssetLoader::cancel(uint32_t ticket) {
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto it = requests.begin(); it != requests.end(); ++it) {
+		if (it->ticket == ticket) {
+			requests.erase(it);
+			return true;
+		}
+	}
+	for (auto it = results.begin(); it != results.end(); ++it) {
+		if (it->ticket == ticket) {
+			results.erase(it);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool AssetLoader::poll(DecodedModel& decoded) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (results.empty()) {
+		return false;
+	}
+	decoded = std::move(results.front());
+	results.pop_front();
+	return true;
+}
+
+size_t AssetLoader::getPendingCount() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return requests.size() + decoding + results.size();
+}
+
+void AssetLoader::workerLoop() {
+	while (true) {
+		Request request;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this] { return stopping || !requests.empty(); });
+			if (stopping) {
+				return;
+			}
+			request = std::move(requests.front());
+			requests.pop_front();
+			++decoding;
+		}
+
+		DecodedModel decoded;
+		decoded.ticket = request.ticket;
+		try {
+			PROFILE_ZONE("decode asset");
+			decode(request, decoded);
+		} catch (const std::exception& e) {
+			decoded.error = e.what();
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		--decoding;
+		results.push_back(std::move(decoded));
+	}
+}
+
+void AssetLoader::decode(const Request& request, DecodedModel& decoded) {
+	for (size_t i = 0; i < request.texturePaths.size(); ++i) {
+		const std::string& path = request.texturePaths[i];
+		if (path.empty()) {
+			continue;
+		}
+		DecodedTexture& texture = decoded.textures[i];
+		if (request.preferCooked) {
+			std::string cookedPath = path.substr(0, path.find_last_of('.')) + ".ktx2";
+			Vfs::File cooked;
+			if (Vfs::open(cookedPath, cooked)
+				&& CookManifest::isCurrent(cookedPath, cooked.size, Ktx2::FORMAT)
+				&& Ktx2::parse(cooked.data, cooked.size, texture.compressed)) {
+				texture.path = path;
+				texture.cooked = true;
+				continue;
+			}
+		}
+		decodeImage(path, texture);
+	}
+
+	// the mesh cooked by rtg-cook is copied as is, the OBJ is parsed otherwise
+	std::string cookedMeshPath = request.modelPath.substr(0, request.modelPath.find_last_of('.')) + MeshFile::EXTENSION;
+	Vfs::File cookedMesh;
+	MeshFile::View view;
+	if (Vfs::open(cookedMeshPath, cookedMesh)
+		&& CookManifest::isCurrent(cookedMeshPath, cookedMesh.size, MeshFile::FORMAT)
+		&& MeshFile::parse(cookedMesh.data, cookedMesh.size, view)) {
+		decoded.vertices.resize(view.vertexCount);
+		std::memcpy(decoded.vertices.data(), view.vertices, view.vertexCount * sizeof(Vertex));
+		decoded.indices.assign(view.indices, view.indices + view.indexCount);
+		decoded.lods.assign(view.lods, view.lods + view.lodCount);
+		decoded.meshlets.assign(view.meshlets, view.meshlets + view.meshletCount);
+		return;
+	}
+
+	Vfs::File model;
+	if (!Vfs::open(request.modelPath, model)) {
+		throw std::runtime_error("failed to open model " + request.modelPath);
+	}
+	MeshFile::Mesh mesh;
+	std::string error;
+	if (!MeshFile::loadObj(model.data, model.size, mesh, error)) {
+		throw std::runtime_error(error);
+	}
+	// what rtg-cook does offline, so uncooked models draw with the same vertex reuse
+	MeshOptimizer::optimize(mesh);
+	decoded.vertices.resize(mesh.vertices.size());
+	std::memcpy(decoded.vertices.data(), mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+	decoded.indices = std::move(mesh.indices);
+	decoded.lods = std::move(mesh.lods);
+	decoded.meshlets = std::move(mesh.meshlets);
+}
+
+void AssetLoader::decodeImage(const std::string& path, DecodedTexture& texture) {
+	Vfs::File image;
+	if (!Vfs::open(path, image)) {
+		throw std::runtime_error("failed to load texture image");
+	}
+	int textureWidth, textureHeight, textureChannels;
+	stbi_uc* pixels = stbi_load_from_memory(
+		image.data,
+		static_cast<int>(image.size),
+		&textureWidth,
+		&textureHeight,
+		&textureChannels,
+		STBI_rgb_alpha
+	);
+	if (!pixels) {
+		throw std::runtime_error("failed to load texture image");
+	}
+
+	texture.path = path;
+	texture.cooked = false;
+	texture.width = static_cast<uint32_t>(textureWidth);
+	texture.height = static_cast<uint32_t>(textureHeight);
+	texture.rgba.assign(pixels, pixels + static_cast<size_t>(textureWidth) * textureHeight * 4);
+	stbi_image_free(pixels);
+}
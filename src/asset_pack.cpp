@@ -0,0 +1,131 @@
+#include "asset_pack.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace AssetPack {
+	namespace {
+		const uint32_t SPIRV_MAGIC = 0x07230203;
+
+		static_assert(sizeof(Header) == 48, "pack header layout changed, bump VERSION");
+		static_assert(sizeof(Entry) == 32, "pack entry layout changed, bump VERSION");
+
+		void padTo(std::vector<uint8_t>& bytes, uint64_t alignment) {
+			bytes.resize((bytes.size() + alignment - 1) / alignment * alignment, 0);
+		}
+	}
+
+	uint64_t hashPath(std::string_view path) {
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : path) {
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool isSpirv(const uint8_t* bytes, size_t size) {
+		if (size < sizeof(uint32_t) || size % sizeof(uint32_t) != 0) {
+			return false;
+		}
+		uint32_t magic;
+		std::memcpy(&magic, bytes, sizeof(magic));
+		return magic == SPIRV_MAGIC;
+	}
+
+	bool validate(const uint8_t* bytes, size_t size) {
+		if (size < sizeof(Header)) {
+			return false;
+		}
+		Header header;
+		std::memcpy(&header, bytes, sizeof(header));
+		if (std::memcmp(header.identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0 || header.version != VERSION || header.fileSize != size) {
+			return false;
+		}
+		// offset + size could wrap around, every bound is checked against what's left after the offset
+		if (header.directoryOffset % alignof(Entry) != 0
+			|| header.directoryOffset > size
+			|| header.entryCount > (size - header.directoryOffset) / sizeof(Entry)
+			|| header.stringsOffset > size
+			|| header.stringsSize > size - header.stringsOffset
+			|| (header.stringsSize > 0 && bytes[header.stringsOffset + header.stringsSize - 1] != 0)) {
+			return false;
+		}
+		const Entry* directory = reinterpret_cast<const Entry*>(bytes + header.directoryOffset);
+		for (uint32_t i = 0; i < header.entryCount; ++i) {
+			if (directory[i].offset > size || directory[i].size > size - directory[i].offset || directory[i].path >= header.stringsSize) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool write(const std::string& path, const std::vector<Source>& sources, std::string& error) {
+		std::vector<uint8_t> bytes(sizeof(Header), 0);
+		std::vector<Entry> entries;
+		std::vector<uint8_t> strings;
+		entries.reserve(sources.size());
+
+		for (const auto& source : sources) {
+			std::ifstream file(source.filePath, std::ios::binary);
+			if (!file.is_open()) {
+				error = "failed to open " + source.filePath;
+				return false;
+			}
+			std::vector<uint8_t> blob((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+			Entry entry{};
+			entry.hash = hashPath(source.path);
+			entry.size = blob.size();
+			entry.path = static_cast<uint32_t>(strings.size());
+			entry.kind = KIND_DATA;
+			bool isShader = source.path.size() > 4 && source.path.compare(source.path.size() - 4, 4, ".spv") == 0;
+			if (isShader) {
+				if (!isSpirv(blob.data(), blob.size())) {
+					error = source.filePath + " is not SPIR-V";
+					return false;
+				}
+				entry.kind = KIND_SPIRV;
+			}
+			padTo(bytes, BLOB_ALIGNMENT);
+			entry.offset = bytes.size();
+			bytes.insert(bytes.end(), blob.begin(), blob.end());
+			strings.insert(strings.end(), source.path.begin(), source.path.end());
+			strings.push_back(0);
+			entries.push_back(entry);
+		}
+
+		// equal hashes end up adjacent, lookups compare the paths within the run
+		std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+			return a.hash < b.hash;
+		});
+
+		Header header{};
+		std::memcpy(header.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+		header.version = VERSION;
+		header.entryCount = static_cast<uint32_t>(entries.size());
+		padTo(bytes, alignof(Entry));
+		header.directoryOffset = bytes.size();
+		const uint8_t* directory = reinterpret_cast<const uint8_t*>(entries.data());
+		bytes.insert(bytes.end(), directory, directory + entries.size() * sizeof(Entry));
+		header.stringsOffset = bytes.size();
+		header.stringsSize = strings.size();
+		bytes.insert(bytes.end(), strings.begin(), strings.end());
+		header.fileSize = bytes.size();
+		std::memcpy(bytes.data(), &header, sizeof(Header));
+
+		std::ofstream output(path, std::ios::binary);
+		if (!output.is_open()) {
+			error = "failed to open " + path;
+			return false;
+		}
+		output.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		if (!output.good()) {
+			error = "failed to write " + path;
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,87 @@
+#include "base_renderpass.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <memory>
+#include <vector>
+
+#include "render_graph.hpp"
+#include "deletion_queue.hpp"
+#include "constants.hpp"
+
+void BaseRenderPass::resize() {
+	VkExtent2D needed = getAttachmentExtent(swapchain.extent);
+	// shrinking by more than a granule gives the memory back
+	bool covered = graph != nullptr
+		&& needed.width <= attachmentExtent.width
+		&& needed.height <= attachmentExtent.height
+		&& attachmentExtent.width - needed.width <= Config::ATTACHMENT_EXTENT_GRANULARITY
+		&& attachmentExtent.height - needed.height <= Config::ATTACHMENT_EXTENT_GRANULARITY;
+	if (covered) {
+		resizeFramebuffers();
+		return;
+	}
+	cleanupImageResources();
+	createImageResources();
+}
+
+VkExtent2D BaseRenderPass::getAttachmentExtent(VkExtent2D extent) {
+	const uint32_t granularity = Config::ATTACHMENT_EXTENT_GRANULARITY;
+	return VkExtent2D{
+		(extent.width + granularity - 1) / granularity * granularity,
+		(extent.height + granularity - 1) / granularity * granularity
+	};
+}
+
+void BaseRenderPass::createGraph() {
+	attachmentExtent = getAttachmentExtent(swapchain.extent);
+	graph = std::make_unique<RenderGraph>(physicalDevice, device);
+	swapchainImage = graph->importImage("swapchain", VK_NULL_HANDLE, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false);
+	graph->setOutput(swapchainImage);
+	buildGraph(*graph);
+	graph->compile();
+}
+
+void BaseRenderPass::cleanupGraph() {
+	if (graph != nullptr) {
+		// frames in flight may still render into its images
+		std::shared_ptr<RenderGraph> retired = std::move(graph);
+		deletionQueue->push([retired]() {
+			retired->cleanup();
+		});
+	}
+}
+
+void BaseRenderPass::render(
+	std::vector<VkCommandBuffer>& commandBuffers,
+	uint32_t imageIndex,
+	uint32_t currentFrame,
+	std::vector<void*>& modelMatrixBuffersMapped,
+	const std::vector<AssetData>& assets,
+	const Camera& camera,
+	const std::vector<DirectionalLightBuffer>& directionalLights,
+	GLFWwindow* window
+) {
+	FrameContext context{};
+	context.commandBuffers = &commandBuffers;
+	context.imageIndex = imageIndex;
+	context.currentFrame = currentFrame;
+	context.modelMatrixBuffersMapped = &modelMatrixBuffersMapped;
+	context.assets = &assets;
+	context.camera = &camera;
+	context.directionalLights = &directionalLights;
+	context.window = window;
+	context.profiler = profiler;
+	context.arena = arena;
+	context.meshletCuller = meshletCuller;
+	context.geometryArena = geometryArena;
+	context.instanceBuffer = instanceBuffer;
+	context.renderQueue = renderQueue;
+	context.depthPrepass = depthPrepass;
+	context.cacheCommands = cacheCommands;
+	context.sceneGeneration = sceneGeneration;
+
+	graph->setImportedImage(swapchainImage, swapchain.images[imageIndex]);
+	graph->execute(context);
+}
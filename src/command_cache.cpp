@@ -0,0 +1,82 @@
+#include "command_cache.hpp"
+
+#include <stdexcept>
+
+#include "gpu_profiler.hpp"
+#include "render_graph.hpp"
+
+void CommandCache::init(VkDevice device, VkCommandPool commandPool) {
+	this->device = device;
+	this->commandPool = commandPool;
+
+	std::array<VkCommandBuffer, Config::MAX_FRAMES_IN_FLIGHT> commandBuffers{};
+	VkCommandBufferAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool = commandPool;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+	allocateInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+	if (vkAllocateCommandBuffers(device, &allocateInfo, commandBuffers.data()) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate secondary command buffers");
+	}
+	for (size_t i = 0; i < slots.size(); ++i) {
+		slots[i] = Slot{};
+		slots[i].commandBuffer = commandBuffers[i];
+	}
+}
+
+void CommandCache::cleanup() {
+	for (auto& slot : slots) {
+		if (slot.commandBuffer != VK_NULL_HANDLE) {
+			vkFreeCommandBuffers(device, commandPool, 1, &slot.commandBuffer);
+		}
+		slot = Slot{};
+	}
+}
+
+void CommandCache::record(const FrameContext& context, VkRenderPass renderPass, uint32_t subpass, const std::function<void(VkCommandBuffer)>& draw) {
+	if (!context.cacheCommands) {
+		draw(context.commandBuffer());
+		return;
+	}
+
+	Slot& slot = slots[context.currentFrame];
+	if (slot.generation == context.sceneGeneration) {
+		vkCmdExecuteCommands(context.commandBuffer(), 1, &slot.commandBuffer);
+		RenderStats::frame() += slot.counters;
+		++RenderStats::frame().replays;
+		return;
+	}
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = renderPass;
+	inheritanceInfo.subpass = subpass;
+	// any framebuffer of the render pass, the buffer is replayed with every swapchain image
+	inheritanceInfo.framebuffer = VK_NULL_HANDLE;
+	// the pass scope of the profiler has its statistics query active around the replay
+	if (context.profiler != nullptr && context.profiler->hasPipelineStatistics()) {
+		inheritanceInfo.pipelineStatistics = GpuProfiler::PIPELINE_STATISTICS;
+	}
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+	if (vkBeginCommandBuffer(slot.commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("failed to begin recording secondary command buffer");
+	}
+	RenderCounters before = RenderStats::frame();
+	draw(slot.commandBuffer);
+	if (vkEndCommandBuffer(slot.commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record secondary command buffer");
+	}
+	slot.counters = RenderStats::frame();
+	slot.counters -= before;
+	slot.generation = context.sceneGeneration;
+
+	vkCmdExecuteCommands(context.commandBuffer(), 1, &slot.commandBuffer);
+}
+
+VkSubpassContents CommandCache::getSubpassContents(const FrameContext& context) {
+	return context.cacheCommands ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+}
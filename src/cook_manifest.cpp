@@ -0,0 +1,97 @@
+#include "cook_manifest.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "vfs.hpp"
+
+namespace CookManifest {
+	namespace {
+		Entries loaded;
+		std::filesystem::path root;
+
+		bool parse(const nlohmann::json& json, Entries& entries) {
+			if (json.value("version", 0u) != VERSION || !json.contains("outputs")) {
+				return false;
+			}
+			try {
+				for (const auto& [output, data] : json["outputs"].items()) {
+					Entry entry;
+					entry.source = data.value("source", "");
+					entry.format = data.value("format", "");
+					entry.inputHash = std::stoull(data.value("inputHash", "0"), nullptr, 16);
+					entry.size = data.value("size", 0ull);
+					entries.emplace(output, std::move(entry));
+				}
+			} catch (const std::exception&) {
+				entries.clear();
+				return false;
+			}
+			return true;
+		}
+	}
+
+	bool read(const std::string& path, Entries& entries) {
+		std::ifstream file(path);
+		if (!file.is_open()) {
+			return false;
+		}
+		nlohmann::json json = nlohmann::json::parse(file, nullptr, false);
+		return !json.is_discarded() && parse(json, entries);
+	}
+
+	bool write(const std::string& path, const Entries& entries) {
+		nlohmann::json outputs = nlohmann::json::object();
+		for (const auto& [output, entry] : entries) {
+			char hash[17];
+			std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(entry.inputHash));
+			outputs[output] = {
+				{"source", entry.source},
+				{"format", entry.format},
+				// hex string, JSON numbers lose precision past 53 bits in most readers
+				{"inputHash", hash},
+				{"size", entry.size}
+			};
+		}
+		nlohmann::json json;
+		json["version"] = VERSION;
+		json["outputs"] = outputs;
+
+		std::ofstream file(path);
+		if (!file.is_open()) {
+			return false;
+		}
+		file << json.dump(4);
+		return file.good();
+	}
+
+	bool load(const std::string& path) {
+		loaded.clear();
+		Vfs::File file;
+		if (!Vfs::open(path, file)) {
+			return false;
+		}
+		nlohmann::json json = nlohmann::json::parse(file.data, file.data + file.size, nullptr, false);
+		if (json.is_discarded() || !parse(json, loaded)) {
+			std::cerr << path << " is not a cook manifest of version " << VERSION << ", cooked assets are ignored" << std::endl;
+			loaded.clear();
+			return false;
+		}
+		root = std::filesystem::path(path).parent_path().lexically_normal();
+		return true;
+	}
+
+	bool isCurrent(const std::string& outputPath, size_t size, const char* format) {
+		std::filesystem::path normal = std::filesystem::path(outputPath).lexically_normal();
+		if (!root.empty()) {
+			normal = normal.lexically_relative(root);
+		}
+		auto found = loaded.find(normal.generic_string());
+		return found != loaded.end() && found->second.size == size && found->second.format == format;
+	}
+}
@@ -0,0 +1,104 @@
+#include "cpu_profiler.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "gpu_profiler.hpp"
+
+namespace {
+	std::mutex registryMutex;
+	std::unordered_set<std::string>& internedNames() {
+		static std::unordered_set<std::string> names;
+		return names;
+	}
+}
+
+const char* CpuProfiler::intern(const std::string& name) {
+	std::lock_guard<std::mutex> lock(registryMutex);
+	// set nodes don't move on rehash, so the pointer stays valid
+	return internedNames().insert(name).first->c_str();
+}
+
+std::vector<std::unique_ptr<CpuProfiler::ThreadBuffer>>& CpuProfiler::threadBuffers() {
+	static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	return buffers;
+}
+
+CpuProfiler::ThreadBuffer& CpuProfiler::threadBuffer() {
+	thread_local ThreadBuffer* buffer = nullptr;
+	if (buffer == nullptr) {
+		auto newBuffer = std::make_unique<ThreadBuffer>();
+		newBuffer->events.resize(EVENTS_PER_THREAD);
+
+		std::lock_guard<std::mutex> lock(registryMutex);
+		newBuffer->threadIndex = static_cast<uint32_t>(threadBuffers().size());
+		buffer = newBuffer.get();
+		threadBuffers().push_back(std::move(newBuffer));
+	}
+	return *buffer;
+}
+
+void CpuProfiler::record(const char* name, int64_t beginNs, int64_t endNs) {
+	ThreadBuffer& buffer = threadBuffer();
+	// only the owning thread writes, the atomic publishes the event to the exporter
+	uint64_t index = buffer.written.load(std::memory_order_relaxed);
+	Event& event = buffer.events[index % EVENTS_PER_THREAD];
+	event.name = name;
+	event.beginNs = beginNs;
+	event.endNs = endNs;
+	buffer.written.store(index + 1, std::memory_order_release);
+}
+
+bool CpuProfiler::writeChromeTrace(const std::string& path, const GpuProfiler* gpuProfiler) {
+	nlohmann::json events = nlohmann::json::array();
+
+	{
+		std::lock_guard<std::mutex> lock(registryMutex);
+		for (const auto& buffer : threadBuffers()) {
+			// tid 0 belongs to the GPU
+			uint32_t tid = buffer->threadIndex + 1;
+			events.push_back({
+				{"name", "thread_name"},
+				{"ph", "M"},
+				{"pid", 0},
+				{"tid", tid},
+				{"args", {{"name", tid == 1 ? std::string("CPU main") : "CPU " + std::to_string(tid - 1)}}}
+			});
+
+			uint64_t written = buffer->written.load(std::memory_order_acquire);
+			uint64_t first = written > EVENTS_PER_THREAD ? written - EVENTS_PER_THREAD : 0;
+			for (uint64_t i = first; i < written; ++i) {
+				const Event& event = buffer->events[i % EVENTS_PER_THREAD];
+				events.push_back({
+					{"name", event.name},
+					{"cat", "cpu"},
+					{"ph", "X"},
+					{"pid", 0},
+					{"tid", tid},
+					{"ts", static_cast<double>(event.beginNs) * 1e-3},
+					{"dur", static_cast<double>(event.endNs - event.beginNs) * 1e-3}
+				});
+			}
+		}
+	}
+
+	if (gpuProfiler != nullptr) {
+		gpuProfiler->appendTraceEvents(events);
+	}
+
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		return false;
+	}
+	nlohmann::json trace;
+	trace["traceEvents"] = events;
+	trace["displayTimeUnit"] = "ms";
+	file << trace.dump();
+	return true;
+}
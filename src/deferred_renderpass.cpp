@@ -16,6 +16,12 @@
 #include "buffer_types.hpp"
 #include "constants.hpp"
 #include "shadowmapping_renderpass.hpp"
+#include "gpu_profiler.hpp"
+#include "render_stats.hpp"
+#include "meshlet_culler.hpp"
+#include "render_queue.hpp"
+#include "command_cache.hpp"
+#include "deletion_queue.hpp"
 
 enum BINDING {
 	ALBEDO = 0,
@@ -31,15 +37,17 @@ struct SSAOPushConstant{
 };
 
 void DeferredRenderPass::init() {
-	shadowPass->init();
+	shadowPass->init(commandPool);
 	createRenderPass();
 	createImageResources();
 	createGraphicsPipeline();
+	gBufferCache.init(device, commandPool);
 }
 
 void DeferredRenderPass::cleanup() {
-	shadowPass->cleanup();
+	gBufferCache.cleanup();
 	cleanupImageResources();
+	shadowPass->cleanup();
 	vkDestroyPipeline(device, gBufferPipeline, nullptr);
 	vkDestroyPipeline(device, ssaoPipeline, nullptr);
 	vkDestroyPipeline(device, lightingPipeline, nullptr);
@@ -50,7 +58,7 @@ void DeferredRenderPass::cleanup() {
 }
 
 void DeferredRenderPass::createImageResources(){
-	createGBuffers();
+	createGraph();
 	createFramebuffers();
 	createDescriptorSetLayout();
 	createDescriptorPool();
@@ -58,21 +66,23 @@ void DeferredRenderPass::createImageResources(){
 }
 
 void DeferredRenderPass::cleanupImageResources() {
-	albedo.cleanup(device);
-	position.cleanup(device);
-	normal.cleanup(device);
-	material.cleanup(device);
-	depth.cleanup(device);
-	ssao.cleanup(device);
-
-	for (auto framebuffer : framebuffers) {
-		vkDestroyFramebuffer(device, framebuffer, nullptr);
-	}
+	deletionQueue->retireFramebuffers(device, framebuffers);
 
-	ssaoDescriptor.cleanup(device);
-	lightingDescriptor.cleanup(device);
+	// the sets are bound by frames still in flight
+	deletionQueue->push([device = device, ssaoLayout = ssaoDescriptor.layout, lightingLayout = lightingDescriptor.layout, pool = descriptorPool]() {
+		vkDestroyDescriptorSetLayout(device, ssaoLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device, lightingLayout, nullptr);
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	});
+	descriptorPool = VK_NULL_HANDLE;
 
-	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	cleanupGraph();
+}
+
+void DeferredRenderPass::resizeFramebuffers() {
+	// the input attachment sets keep pointing at the same images
+	deletionQueue->retireFramebuffers(device, framebuffers);
+	createFramebuffers();
 }
 
 
@@ -81,7 +91,7 @@ void DeferredRenderPass::createRenderPass() {
 	albedoAttachment.format = VK_FORMAT_R8G8B8A8_UNORM;
 	albedoAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	albedoAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	albedoAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	albedoAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	albedoAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	albedoAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
@@ -89,7 +99,7 @@ void DeferredRenderPass::createRenderPass() {
 	positionAttachment.format = VK_FORMAT_R32G32B32A32_SFLOAT;
 	positionAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	positionAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	positionAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	positionAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	positionAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	positionAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
@@ -97,7 +107,7 @@ void DeferredRenderPass::createRenderPass() {
 	normalAttachment.format = VK_FORMAT_R32G32B32A32_SFLOAT;
 	normalAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	normalAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	normalAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	normalAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	normalAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	normalAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
@@ -105,7 +115,7 @@ void DeferredRenderPass::createRenderPass() {
 	materialAttachment.format = VK_FORMAT_R8G8_UNORM;
 	materialAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	materialAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	materialAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	materialAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	materialAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	materialAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
@@ -113,7 +123,7 @@ void DeferredRenderPass::createRenderPass() {
 	depthAttachment.format = depthFormat;
 	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -123,7 +133,7 @@ void DeferredRenderPass::createRenderPass() {
 	ssaoAttachment.format = VK_FORMAT_R8_UNORM;
 	ssaoAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	ssaoAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	ssaoAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	ssaoAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	ssaoAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	ssaoAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
@@ -197,10 +207,11 @@ void DeferredRenderPass::createRenderPass() {
 	VkSubpassDependency gBufferDependency{};
 	gBufferDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
 	gBufferDependency.dstSubpass = 0;
-	gBufferDependency.srcStageMask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	// chains with the render graph barrier so the layout transitions wait for the previous frame
+	gBufferDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
 	gBufferDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
 	gBufferDependency.srcAccessMask = VK_ACCESS_NONE;
-	gBufferDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	gBufferDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 	gBufferDependency.dependencyFlags = 0;
 
 	VkSubpassDependency ssaoDependency{};
@@ -246,102 +257,99 @@ void DeferredRenderPass::createRenderPass() {
 	}
 }
 
-void DeferredRenderPass::createGBuffers() {
-	VulkanUtils::createImage(
-		physicalDevice,
-		device,
-		swapchain.extent.width,
-		swapchain.extent.height,
-		1,
-		VK_SAMPLE_COUNT_1_BIT,
-		VK_FORMAT_R8G8B8A8_UNORM,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		albedo.image,
-		albedo.imageMemory
-	);
-	albedo.imageView = VulkanUtils::createImageView(device, albedo.image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-
-	VulkanUtils::createImage(
-		physicalDevice,
-		device,
-		swapchain.extent.width,
-		swapchain.extent.height,
-		1,
-		VK_SAMPLE_COUNT_1_BIT,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		position.image,
-		position.imageMemory
-	);
-	position.imageView = VulkanUtils::createImageView(device, position.image, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-
-	VulkanUtils::createImage(
-		physicalDevice,
-		device,
-		swapchain.extent.width,
-		swapchain.extent.height,
-		1,
-		VK_SAMPLE_COUNT_1_BIT,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		normal.image,
-		normal.imageMemory
-	);
-	normal.imageView = VulkanUtils::createImageView(device, normal.image, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-
-	VulkanUtils::createImage(
-		physicalDevice,
-		device,
-		swapchain.extent.width,
-		swapchain.extent.height,
-		1,
-		VK_SAMPLE_COUNT_1_BIT,
-		VK_FORMAT_R8G8_UNORM,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		material.image,
-		material.imageMemory
-	);
-	material.imageView = VulkanUtils::createImageView(device, material.image, VK_FORMAT_R8G8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-
-	VulkanUtils::createImage(
-		physicalDevice,
-		device,
-		swapchain.extent.width,
-		swapchain.extent.height,
-		1,
-		VK_SAMPLE_COUNT_1_BIT,
-		depthFormat,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		depth.image,
-		depth.imageMemory
-	);
-	depth.imageView = VulkanUtils::createImageView(device, depth.image, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+void DeferredRenderPass::buildGraph(RenderGraph& graph) {
+	RenderGraphImageDesc desc{};
+	desc.width = attachmentExtent.width;
+	desc.height = attachmentExtent.height;
+	desc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+	desc.format = VK_FORMAT_R8G8B8A8_UNORM;
+	albedo = graph.createImage("deferred albedo", desc);
+	desc.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+	position = graph.createImage("deferred position", desc);
+	normal = graph.createImage("deferred normal", desc);
+	desc.format = VK_FORMAT_R8G8_UNORM;
+	material = graph.createImage("deferred material", desc);
+	desc.format = VK_FORMAT_R8_UNORM;
+	ssao = graph.createImage("deferred ssao", desc);
+
+	desc.format = depthFormat;
+	desc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+	desc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+	depth = graph.createImage("deferred depth", desc);
+
+	shadowMap = graph.importImage("shadow map", shadowPass->getShadowMapImage(), VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_UNDEFINED, true);
+
+	VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+	graph.addPass("shadow", [this](const FrameContext& context) {
+		shadowPass->generateShadowMap(context);
+	})
+		.write(
+			shadowMap,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			depthStages,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		);
 
-	VulkanUtils::createImage(
-		physicalDevice,
-		device,
-		swapchain.extent.width,
-		swapchain.extent.height,
-		1,
-		VK_SAMPLE_COUNT_1_BIT,
-		VK_FORMAT_R8_UNORM,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		ssao.image,
-		ssao.imageMemory
-	);
-	ssao.imageView = VulkanUtils::createImageView(device, ssao.image, VK_FORMAT_R8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+	// G-Buffer, SSAO and lighting share one render pass, so their images never leave it
+	graph.addPass("deferred", [this](const FrameContext& context) { draw(context); })
+		.read(
+			shadowMap,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_SHADER_READ_BIT
+		)
+		.write(
+			albedo,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		)
+		.write(
+			position,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		)
+		.write(
+			normal,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		)
+		.write(
+			material,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		)
+		.write(
+			ssao,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		)
+		.write(
+			depth,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			depthStages,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		)
+		.write(
+			swapchainImage,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		);
 }
 
 void DeferredRenderPass::createFramebuffers() {
@@ -349,12 +357,12 @@ void DeferredRenderPass::createFramebuffers() {
 
 	for (size_t i = 0; i < swapchain.imageViews.size(); ++i) {
 		std::array<VkImageView, 7> attachments = {
-			albedo.imageView,
-			position.imageView,
-			normal.imageView,
-			material.imageView,
-			depth.imageView,
-			ssao.imageView,
+			graph->getImage(albedo).imageView,
+			graph->getImage(position).imageView,
+			graph->getImage(normal).imageView,
+			graph->getImage(material).imageView,
+			graph->getImage(depth).imageView,
+			graph->getImage(ssao).imageView,
 			swapchain.imageViews[i],
 		};
 
@@ -485,12 +493,12 @@ void DeferredRenderPass::createGraphicsPipeline() {
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	auto bindingDescriptions = PackedVertex::getBindingDescriptions();
+	auto attributeDescriptions = PackedVertex::getAttributeDescriptions();
 
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
 	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -759,27 +767,27 @@ void DeferredRenderPass::createDescriptorSets() {
 
 	for (size_t i = 0; i < Config::MAX_FRAMES_IN_FLIGHT; ++i) {
 		VkDescriptorImageInfo albedoImageInfo{};
-		albedoImageInfo.imageView = albedo.imageView;
+		albedoImageInfo.imageView = graph->getImage(albedo).imageView;
 		albedoImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
 		VkDescriptorImageInfo positionImageInfo{};
-		positionImageInfo.imageView = position.imageView;
+		positionImageInfo.imageView = graph->getImage(position).imageView;
 		positionImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
 		VkDescriptorImageInfo normalImageInfo{};
-		normalImageInfo.imageView = normal.imageView;
+		normalImageInfo.imageView = graph->getImage(normal).imageView;
 		normalImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
 		VkDescriptorImageInfo materialImageInfo{};
-		materialImageInfo.imageView = material.imageView;
+		materialImageInfo.imageView = graph->getImage(material).imageView;
 		materialImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
 		VkDescriptorImageInfo depthImageInfo{};
-		depthImageInfo.imageView = depth.imageView;
+		depthImageInfo.imageView = graph->getImage(depth).imageView;
 		depthImageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
 		VkDescriptorImageInfo ssaoImageInfo{};
-		ssaoImageInfo.imageView = ssao.imageView;
+		ssaoImageInfo.imageView = graph->getImage(ssao).imageView;
 		ssaoImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
 		std::array<VkWriteDescriptorSet, 2> ssaoDescriptorWrites{};
@@ -854,26 +862,10 @@ void DeferredRenderPass::createDescriptorSets() {
 	}
 }
 
-void DeferredRenderPass::render(
-	std::vector<VkCommandBuffer>& commandBuffers,
-	uint32_t imageIndex,
-	uint32_t currentFrame,
-	std::vector<void*>& modelMatrixBuffersMapped,
-	const std::vector<AssetData>& models,
-	const Camera& camera,
-	const std::vector<DirectionalLightBuffer>& directionalLights,
-	GLFWwindow* window
-) {
-	shadowPass->generateShadowMap(
-		commandBuffers,
-		imageIndex,
-		currentFrame,
-		modelMatrixBuffersMapped,
-		models,
-		camera,
-		directionalLights,
-		window
-	);
+void DeferredRenderPass::draw(const FrameContext& context) {
+	std::vector<VkCommandBuffer>& commandBuffers = *context.commandBuffers;
+	uint32_t imageIndex = context.imageIndex;
+	uint32_t currentFrame = context.currentFrame;
 
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -894,8 +886,18 @@ void DeferredRenderPass::render(
 	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 	renderPassInfo.pClearValues = clearValues.data();
 
-	vkCmdBeginRenderPass(commandBuffers[currentFrame], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(commandBuffers[currentFrame], &renderPassInfo, CommandCache::getSubpassContents(context));
 	{
+		// G-Buffer subpass
+		gBufferCache.record(context, renderPass, 0, [&](VkCommandBuffer commandBuffer) {
+			// timestamps can't go into cached buffers
+			GpuProfileScope scope(context.cacheCommands ? nullptr : context.profiler, commandBuffer, "gbuffer");
+			drawGBuffer(commandBuffer, context);
+		});
+
+		vkCmdNextSubpass(commandBuffers[currentFrame], VK_SUBPASS_CONTENTS_INLINE);
+
+		// executing a secondary command buffer leaves the dynamic state undefined
 		VkViewport viewport{};
 		viewport.x = 0.0f;
 		viewport.y = 0.0f;
@@ -910,174 +912,235 @@ void DeferredRenderPass::render(
 		scissor.extent = swapchain.extent;
 		vkCmdSetScissor(commandBuffers[currentFrame], 0, 1, &scissor);
 
-		vkCmdBindPipeline(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, gBufferPipeline);
-
-		// G-Buffer subpass
-		for(size_t i = 0; i < models.size(); ++i) {
-			uint32_t offset = static_cast<uint32_t>(i * sizeof(TransformMatrixBuffer));
-			TransformMatrixBuffer matrixUBO{};
-			matrixUBO.model = models[i].object.getModelMatrix();
-			void* target = static_cast<char*>(modelMatrixBuffersMapped[currentFrame]) + offset;
-			memcpy(target, &matrixUBO, sizeof(matrixUBO));
-			VkBuffer vertexBuffers[] = {models[i].resource.vertexBufferResource.buffer};
-			VkDeviceSize offsets[] = {0};
-			vkCmdBindVertexBuffers(commandBuffers[currentFrame], 0, 1, vertexBuffers, offsets);
-			vkCmdBindIndexBuffer(commandBuffers[currentFrame], models[i].resource.indexBufferResource.buffer, 0, VK_INDEX_TYPE_UINT32);
+		// SSAO subpass
+		{
+			GpuProfileScope scope(context.profiler, commandBuffers[currentFrame], "ssao");
+			vkCmdBindPipeline(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoPipeline);
+			++RenderStats::frame().pipelineBinds;
 			vkCmdBindDescriptorSets(
 				commandBuffers[currentFrame],
 				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				gBufferPipelineLayout,
+				ssaoPipelineLayout,
+				0,
+				1,
+				&commonDescriptor.cameraMatrix.sets[currentFrame],
 				0,
+				nullptr
+			);
+			++RenderStats::frame().descriptorBinds;
+			vkCmdBindDescriptorSets(
+				commandBuffers[currentFrame],
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				ssaoPipelineLayout,
 				1,
-				&commonDescriptor.modelMatrix.sets[currentFrame],
 				1,
-				&offset
+				&commonDescriptor.camera.sets[currentFrame],
+				0,
+				nullptr
 			);
+			++RenderStats::frame().descriptorBinds;
 			vkCmdBindDescriptorSets(
 				commandBuffers[currentFrame],
 				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				gBufferPipelineLayout,
+				ssaoPipelineLayout,
+				2,
 				1,
+				&ssaoDescriptor.sets[currentFrame],
+				0,
+				nullptr
+			);
+			++RenderStats::frame().descriptorBinds;
+			SSAOPushConstant pushConstant;
+			pushConstant.screenSize = glm::vec2(swapchain.extent.width, swapchain.extent.height);
+			vkCmdPushConstants(
+				commandBuffers[currentFrame],
+				ssaoPipelineLayout,
+				VK_SHADER_STAGE_FRAGMENT_BIT,
+				0,
+				sizeof(SSAOPushConstant),
+				&pushConstant
+			);
+
+			vkCmdDraw(commandBuffers[currentFrame], 4, 1, 0, 0);
+			++RenderStats::frame().drawCalls;
+		}
+
+		vkCmdNextSubpass(commandBuffers[currentFrame], VK_SUBPASS_CONTENTS_INLINE);
+
+		// Lighting subpass
+		{
+			GpuProfileScope scope(context.profiler, commandBuffers[currentFrame], "lighting");
+			vkCmdBindPipeline(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, lightingPipeline);
+			++RenderStats::frame().pipelineBinds;
+			vkCmdBindDescriptorSets(
+				commandBuffers[currentFrame],
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				lightingPipelineLayout,
+				0,
 				1,
 				&commonDescriptor.cameraMatrix.sets[currentFrame],
 				0,
 				nullptr
 			);
+			++RenderStats::frame().descriptorBinds;
 			vkCmdBindDescriptorSets(
 				commandBuffers[currentFrame],
 				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				gBufferPipelineLayout,
-				2,
+				lightingPipelineLayout,
+				1,
 				1,
 				&commonDescriptor.camera.sets[currentFrame],
 				0,
 				nullptr
 			);
+			++RenderStats::frame().descriptorBinds;
 			vkCmdBindDescriptorSets(
 				commandBuffers[currentFrame],
 				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				gBufferPipelineLayout,
+				lightingPipelineLayout,
+				2,
+				1,
+				&commonDescriptor.light.sets[currentFrame],
+				0,
+				nullptr
+			);
+			++RenderStats::frame().descriptorBinds;
+			vkCmdBindDescriptorSets(
+				commandBuffers[currentFrame],
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				lightingPipelineLayout,
 				3,
 				1,
-				&models[i].resource.descriptorSets[currentFrame],
+				&lightingDescriptor.sets[currentFrame],
 				0,
 				nullptr
 			);
-			vkCmdDrawIndexed(commandBuffers[currentFrame], static_cast<uint32_t>(models[i].resource.indexCount), 1, 0, 0, 0);
-		}
-
-		vkCmdNextSubpass(commandBuffers[currentFrame], VK_SUBPASS_CONTENTS_INLINE);
-
-		// SSAO subpass
-		vkCmdBindPipeline(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, ssaoPipeline);
-		vkCmdBindDescriptorSets(
-			commandBuffers[currentFrame],
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			ssaoPipelineLayout,
-			0,
-			1,
-			&commonDescriptor.cameraMatrix.sets[currentFrame],
-			0,
-			nullptr
-		);
-		vkCmdBindDescriptorSets(
-			commandBuffers[currentFrame],
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			ssaoPipelineLayout,
-			1,
-			1,
-			&commonDescriptor.camera.sets[currentFrame],
-			0,
-			nullptr
-		);
-		vkCmdBindDescriptorSets(
-			commandBuffers[currentFrame],
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			ssaoPipelineLayout,
-			2,
-			1,
-			&ssaoDescriptor.sets[currentFrame],
-			0,
-			nullptr
-		);
-		SSAOPushConstant pushConstant;
-		pushConstant.screenSize = glm::vec2(swapchain.extent.width, swapchain.extent.height);
-		vkCmdPushConstants(
-			commandBuffers[currentFrame],
-			ssaoPipelineLayout,
-			VK_SHADER_STAGE_FRAGMENT_BIT,
-			0,
-			sizeof(SSAOPushConstant),
-			&pushConstant
-		);
-
-		vkCmdDraw(commandBuffers[currentFrame], 4, 1, 0, 0);
+			++RenderStats::frame().descriptorBinds;
+			vkCmdBindDescriptorSets(
+				commandBuffers[currentFrame],
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				lightingPipelineLayout,
+				4,
+				1,
+				&shadowPass->getShadowMap()[currentFrame],
+				0,
+				nullptr
+			);
+			++RenderStats::frame().descriptorBinds;
+			vkCmdBindDescriptorSets(
+				commandBuffers[currentFrame],
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				lightingPipelineLayout,
+				5,
+				1,
+				&shadowPass->getLightMatrix()[currentFrame],
+				0,
+				nullptr
+			);
+			++RenderStats::frame().descriptorBinds;
 
-		vkCmdNextSubpass(commandBuffers[currentFrame], VK_SUBPASS_CONTENTS_INLINE);
+			vkCmdDraw(commandBuffers[currentFrame], 4, 1, 0, 0);
+			++RenderStats::frame().drawCalls;
+		}
+	} vkCmdEndRenderPass(commandBuffers[currentFrame]);
+}
 
-		// Lighting subpass
-		vkCmdBindPipeline(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, lightingPipeline);
-		vkCmdBindDescriptorSets(
-			commandBuffers[currentFrame],
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			lightingPipelineLayout,
-			0,
-			1,
-			&commonDescriptor.cameraMatrix.sets[currentFrame],
-			0,
-			nullptr
-		);
+void DeferredRenderPass::drawGBuffer(VkCommandBuffer commandBuffer, const FrameContext& context) {
+	uint32_t currentFrame = context.currentFrame;
+	const std::vector<AssetData>& models = *context.assets;
+
+	// not inherited by a secondary command buffer
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(swapchain.extent.width);
+	viewport.height = static_cast<float>(swapchain.extent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.offset = {0, 0};
+	scissor.extent = swapchain.extent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, gBufferPipeline);
+	++RenderStats::frame().pipelineBinds;
+	context.instanceBuffer->bind(commandBuffer);
+	// the same for every draw of the pass
+	vkCmdBindDescriptorSets(
+		commandBuffer,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		gBufferPipelineLayout,
+		1,
+		1,
+		&commonDescriptor.cameraMatrix.sets[currentFrame],
+		0,
+		nullptr
+	);
+	++RenderStats::frame().descriptorBinds;
+	vkCmdBindDescriptorSets(
+		commandBuffer,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		gBufferPipelineLayout,
+		2,
+		1,
+		&commonDescriptor.camera.sets[currentFrame],
+		0,
+		nullptr
+	);
+	++RenderStats::frame().descriptorBinds;
+
+	uint32_t boundBlock = GeometryArena::NO_BLOCK;
+	VkDescriptorSet boundTextures = VK_NULL_HANDLE;
+	for (uint32_t i : context.renderQueue->getOrder()) {
+		uint32_t offset = static_cast<uint32_t>(i * sizeof(TransformMatrixBuffer));
+		// consecutive models in the same arena block keep its binding
+		const GeometryArena::Allocation& geometry = models[i].resource.geometry;
+		if (geometry.block != boundBlock) {
+			context.geometryArena->bind(commandBuffer, geometry.block);
+			boundBlock = geometry.block;
+		}
 		vkCmdBindDescriptorSets(
-			commandBuffers[currentFrame],
+			commandBuffer,
 			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			lightingPipelineLayout,
-			1,
-			1,
-			&commonDescriptor.camera.sets[currentFrame],
+			gBufferPipelineLayout,
 			0,
-			nullptr
-		);
-		vkCmdBindDescriptorSets(
-			commandBuffers[currentFrame],
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			lightingPipelineLayout,
-			2,
 			1,
-			&commonDescriptor.light.sets[currentFrame],
-			0,
-			nullptr
-		);
-		vkCmdBindDescriptorSets(
-			commandBuffers[currentFrame],
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			lightingPipelineLayout,
-			3,
+			&commonDescriptor.modelMatrix.sets[currentFrame],
 			1,
-			&lightingDescriptor.sets[currentFrame],
-			0,
-			nullptr
+			&offset
 		);
-		vkCmdBindDescriptorSets(
-			commandBuffers[currentFrame],
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			lightingPipelineLayout,
-			4,
-			1,
-			&shadowPass->getShadowMap()[currentFrame],
-			0,
-			nullptr
-		);
-		vkCmdBindDescriptorSets(
-			commandBuffers[currentFrame],
-			VK_PIPELINE_BIND_POINT_GRAPHICS,
-			lightingPipelineLayout,
-			5,
-			1,
-			&shadowPass->getLightMatrix()[currentFrame],
-			0,
-			nullptr
-		);
-
-		vkCmdDraw(commandBuffers[currentFrame], 4, 1, 0, 0);
-	} vkCmdEndRenderPass(commandBuffers[currentFrame]);
+		++RenderStats::frame().descriptorBinds;
+		// the sorted order keeps draws of the same model adjacent, their textures stay bound
+		VkDescriptorSet textures = models[i].resource.descriptorSets[currentFrame];
+		if (textures != boundTextures) {
+			vkCmdBindDescriptorSets(
+				commandBuffer,
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				gBufferPipelineLayout,
+				3,
+				1,
+				&textures,
+				0,
+				nullptr
+			);
+			++RenderStats::frame().descriptorBinds;
+			boundTextures = textures;
+		}
+		if (context.meshletCuller == nullptr || !context.meshletCuller->drawCulled(commandBuffer, currentFrame, i)) {
+			const MeshFile::Lod& lod = models[i].resource.getLod(models[i].lod);
+			vkCmdDrawIndexed(
+				commandBuffer,
+				lod.indexCount,
+				models[i].instanceCount,
+				geometry.firstIndex + lod.firstIndex,
+				static_cast<int32_t>(geometry.firstVertex),
+				models[i].firstInstance
+			);
+			RenderStats::frame().triangles += lod.indexCount / 3 * models[i].instanceCount;
+		}
+		++RenderStats::frame().drawCalls;
+		RenderStats::frame().instances += models[i].instanceCount;
+	}
 }
\ No newline at end of file
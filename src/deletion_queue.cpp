@@ -0,0 +1,52 @@
+#include "deletion_queue.hpp"
+
+#include <iterator>
+#include <limits>
+#include <utility>
+
+void DeletionQueue::push(std::function<void()> destroy) {
+	entries.push_back({submissions, std::move(destroy)});
+}
+
+void DeletionQueue::retireFramebuffers(VkDevice device, std::vector<VkFramebuffer>& framebuffers) {
+	if (!framebuffers.empty()) {
+		push([device, framebuffers]() {
+			for (auto framebuffer : framebuffers) {
+				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			}
+		});
+	}
+	framebuffers.clear();
+}
+
+void DeletionQueue::submit(uint32_t frame) {
+	frameSubmissions[frame] = ++submissions;
+}
+
+void DeletionQueue::collect(uint32_t frame) {
+	// a fence signals after every earlier submission to the queue, not only its own
+	run(frameSubmissions[frame]);
+}
+
+void DeletionQueue::flush() {
+	while (!entries.empty()) {
+		run(std::numeric_limits<uint64_t>::max());
+	}
+}
+
+void DeletionQueue::run(uint64_t completed) {
+	size_t count = 0;
+	while (count < entries.size() && entries[count].submission <= completed) {
+		++count;
+	}
+	if (count == 0) {
+		return;
+	}
+	// destroy may push, entries can't be iterated while it runs
+	ready.assign(std::make_move_iterator(entries.begin()), std::make_move_iterator(entries.begin() + count));
+	entries.erase(entries.begin(), entries.begin() + count);
+	for (auto& entry : ready) {
+		entry.destroy();
+	}
+	ready.clear();
+}
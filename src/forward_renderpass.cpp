@@ -13,39 +13,45 @@
 #include "vulkan_types.hpp"
 #include "buffer_types.hpp"
 #include "gui_renderpass.hpp"
+#include "render_stats.hpp"
+#include "meshlet_culler.hpp"
+#include "render_queue.hpp"
+#include "gpu_profiler.hpp"
+#include "command_cache.hpp"
+#include "deletion_queue.hpp"
 
 void ForwardRenderPass::init() {
 	createRenderPass();
 	createImageResources();
 	createGraphicsPipeline();
+	prepassCache.init(device, commandPool);
+	shadingCache.init(device, commandPool);
 }
 
 void ForwardRenderPass::cleanup() {
+	prepassCache.cleanup();
+	shadingCache.cleanup();
 	cleanupImageResources();
 	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipeline(device, shadingPipeline, nullptr);
+	vkDestroyPipeline(device, depthPrepassPipeline, nullptr);
 	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 	vkDestroyRenderPass(device, renderPass, nullptr);
 }
 
 void ForwardRenderPass::createImageResources() {
-	createColorResources();
-	;
-	createDepthResources();
+	createGraph();
 	createFramebuffers();
 }
 
 void ForwardRenderPass::cleanupImageResources() {
-	vkDestroyImageView(device, depthImageView, nullptr);
-	vkDestroyImage(device, depthImage, nullptr);
-	vkFreeMemory(device, depthImageMemory, nullptr);
-
-	vkDestroyImageView(device, colorImageView, nullptr);
-	vkDestroyImage(device, colorImage, nullptr);
-	vkFreeMemory(device, colorImageMemory, nullptr);
+	deletionQueue->retireFramebuffers(device, framebuffers);
+	cleanupGraph();
+}
 
-	for (auto framebuffer : framebuffers) {
-		vkDestroyFramebuffer(device, framebuffer, nullptr);
-	}
+void ForwardRenderPass::resizeFramebuffers() {
+	deletionQueue->retireFramebuffers(device, framebuffers);
+	createFramebuffers();
 }
 
 #include <iostream>
@@ -55,7 +61,7 @@ void ForwardRenderPass::createRenderPass() {
 	colorAttachment.format = swapchain.imageFormat;
 	colorAttachment.samples = msaaSamples;
 	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -66,7 +72,7 @@ void ForwardRenderPass::createRenderPass() {
 	depthAttachment.format = depthFormat;
 	depthAttachment.samples = msaaSamples;
 	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -94,81 +100,64 @@ void ForwardRenderPass::createRenderPass() {
 	colorAttachmentResolveReference.attachment = 2;
 	colorAttachmentResolveReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
-	VkSubpassDescription subpass{};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorAttachmentReference;
-	subpass.pDepthStencilAttachment = &depthAttachmentReference;
-	subpass.pResolveAttachments = &colorAttachmentResolveReference;
-
-	VkSubpassDependency subpassDependency{};
-	subpassDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	subpassDependency.dstSubpass = 0;
-	subpassDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	subpassDependency.srcAccessMask = 0;
-	subpassDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	subpassDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	// depth pre-pass subpass, left empty when the pre-pass is off
+	std::array<VkSubpassDescription, 2> subpasses{};
+	subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpasses[0].pDepthStencilAttachment = &depthAttachmentReference;
+
+	// shading subpass
+	subpasses[1].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpasses[1].colorAttachmentCount = 1;
+	subpasses[1].pColorAttachments = &colorAttachmentReference;
+	subpasses[1].pDepthStencilAttachment = &depthAttachmentReference;
+	subpasses[1].pResolveAttachments = &colorAttachmentResolveReference;
+
+	std::array<VkSubpassDependency, 3> subpassDependencies{};
+	subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	subpassDependencies[0].dstSubpass = 0;
+	subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	subpassDependencies[0].srcAccessMask = 0;
+	subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	subpassDependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	subpassDependencies[1].srcSubpass = VK_SUBPASS_EXTERNAL;
+	subpassDependencies[1].dstSubpass = 1;
+	subpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	subpassDependencies[1].srcAccessMask = 0;
+	subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	subpassDependencies[1].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	// the shading subpass tests against the pre-pass depth
+	subpassDependencies[2].srcSubpass = 0;
+	subpassDependencies[2].dstSubpass = 1;
+	subpassDependencies[2].srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	subpassDependencies[2].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	subpassDependencies[2].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	subpassDependencies[2].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	subpassDependencies[2].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
 	std::array<VkAttachmentDescription, 3> attachments = {colorAttachment, depthAttachment, colorAttachmentResolve};
 	VkRenderPassCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
 	createInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
 	createInfo.pAttachments = attachments.data();
-	createInfo.subpassCount = 1;
-	createInfo.pSubpasses = &subpass;
-	createInfo.dependencyCount = 1;
-	createInfo.pDependencies = &subpassDependency;
+	createInfo.subpassCount = static_cast<uint32_t>(subpasses.size());
+	createInfo.pSubpasses = subpasses.data();
+	createInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
+	createInfo.pDependencies = subpassDependencies.data();
 
 	if (vkCreateRenderPass(device, &createInfo, nullptr, &renderPass) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create render pass");
 	}
 }
 
-void ForwardRenderPass::createColorResources() {
-	VkFormat colorFormat = swapchain.imageFormat;
-	VulkanUtils::createImage(
-		physicalDevice,
-		device,
-		swapchain.extent.width,
-		swapchain.extent.height,
-		1,
-		msaaSamples,
-		colorFormat,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		colorImage,
-		colorImageMemory
-	);
-	colorImageView = VulkanUtils::createImageView(device, colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-}
-
-void ForwardRenderPass::createDepthResources() {
-	VulkanUtils::createImage(
-		physicalDevice,
-		device,
-		swapchain.extent.width,
-		swapchain.extent.height,
-		1,
-		msaaSamples,
-		depthFormat,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		depthImage,
-		depthImageMemory
-	);
-	depthImageView = VulkanUtils::createImageView(device, depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
-}
-
-
 void ForwardRenderPass::createFramebuffers() {
 	framebuffers.resize(swapchain.imageViews.size());
 
 	for (size_t i = 0; i < swapchain.imageViews.size(); ++i) {
 		std::array<VkImageView, 3> attachments = {
-			colorImageView,
-			depthImageView,
+			graph->getImage(colorImage).imageView,
+			graph->getImage(depthImage).imageView,
 			swapchain.imageViews[i],
 		};
 
@@ -237,12 +226,12 @@ void ForwardRenderPass::createGraphicsPipeline() {
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	auto bindingDescriptions = PackedVertex::getBindingDescriptions();
+	auto attributeDescriptions = PackedVertex::getAttributeDescriptions();
 
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
 	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -315,31 +304,96 @@ void ForwardRenderPass::createGraphicsPipeline() {
 	pipelineInfo.pDynamicState = &dynamicState;
 	pipelineInfo.layout = pipelineLayout;
 	pipelineInfo.renderPass = renderPass;
-	pipelineInfo.subpass = 0;
+	pipelineInfo.subpass = 1;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
 	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create graphics pipeline");
 	}
 
+	// after the pre-pass, only the nearest fragment of each sample passes and depth is already written
+	depthStencil.depthWriteEnable = VK_FALSE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_EQUAL;
+	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &shadingPipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create graphics pipeline");
+	}
+
 	vkDestroyShaderModule(device, fragmentShaderModule, nullptr);
 	vkDestroyShaderModule(device, vertexShaderModule, nullptr);
+
+	// depth only, from the position stream
+	auto prepassShaderCode = VulkanUtils::readFile("../shaders/depth_prepass_vert.spv");
+	VkShaderModule prepassShaderModule = VulkanUtils::createShaderModule(device, prepassShaderCode);
+	vertexShaderStageInfo.module = prepassShaderModule;
+
+	auto positionBindingDescriptions = PackedVertex::getPositionBindingDescriptions();
+	auto positionAttributeDescriptions = PackedVertex::getPositionAttributeDescriptions();
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(positionBindingDescriptions.size());
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(positionAttributeDescriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = positionBindingDescriptions.data();
+	vertexInputInfo.pVertexAttributeDescriptions = positionAttributeDescriptions.data();
+
+	depthStencil.depthWriteEnable = VK_TRUE;
+	depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+
+	colorBlending.attachmentCount = 0;
+	colorBlending.pAttachments = nullptr;
+
+	pipelineInfo.stageCount = 1;
+	pipelineInfo.pStages = &vertexShaderStageInfo;
+	pipelineInfo.subpass = 0;
+	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &depthPrepassPipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create graphics pipeline");
+	}
+
+	vkDestroyShaderModule(device, prepassShaderModule, nullptr);
+}
+
+void ForwardRenderPass::buildGraph(RenderGraph& graph) {
+	RenderGraphImageDesc colorDesc{};
+	colorDesc.width = attachmentExtent.width;
+	colorDesc.height = attachmentExtent.height;
+	colorDesc.format = swapchain.imageFormat;
+	colorDesc.samples = msaaSamples;
+	colorDesc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	colorDesc.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	colorImage = graph.createImage("forward color", colorDesc);
+
+	RenderGraphImageDesc depthDesc = colorDesc;
+	depthDesc.format = depthFormat;
+	depthDesc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	depthDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+	depthImage = graph.createImage("forward depth", depthDesc);
+
+	graph.addPass("forward", [this](const FrameContext& context) { draw(context); })
+		.write(
+			colorImage,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		)
+		.write(
+			depthImage,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		)
+		.write(
+			swapchainImage,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		);
 }
 
-void ForwardRenderPass::render(
-	std::vector<VkCommandBuffer>& commandBuffers,
-	uint32_t imageIndex,
-	uint32_t currentFrame,
-	std::vector<void*>& modelMatrixBuffersMapped,
-	const std::vector<AssetData>& models,
-	const Camera& camera,
-	const std::vector<DirectionalLightBuffer>& directionalLights,
-	GLFWwindow* window
-) {
+void ForwardRenderPass::draw(const FrameContext& context) {
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	renderPassInfo.renderPass = renderPass;
-	renderPassInfo.framebuffer = framebuffers[imageIndex];
+	renderPassInfo.framebuffer = framebuffers[context.imageIndex];
 	renderPassInfo.renderArea.offset = {0, 0};
 	renderPassInfo.renderArea.extent = swapchain.extent;
 
@@ -350,97 +404,176 @@ void ForwardRenderPass::render(
 	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 	renderPassInfo.pClearValues = clearValues.data();
 
-	vkCmdBeginRenderPass(commandBuffers[currentFrame], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-	{
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = (float) swapchain.extent.width;
-		viewport.height = (float) swapchain.extent.height;
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		vkCmdSetViewport(commandBuffers[currentFrame], 0, 1, &viewport);
-
-		VkRect2D scissor{};
-		scissor.offset = {0, 0};
-		scissor.extent = swapchain.extent;
-		vkCmdSetScissor(commandBuffers[currentFrame], 0, 1, &scissor);
-
-		vkCmdBindPipeline(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-
-		for(size_t i = 0; i < models.size(); ++i) {
-			uint32_t offset = i * sizeof(TransformMatrixBuffer);
-			TransformMatrixBuffer matrixUBO{};
-			matrixUBO.model = models[i].object.getModelMatrix();
-			void* target = static_cast<char*>(modelMatrixBuffersMapped[currentFrame]) + offset;
-			memcpy(target, &matrixUBO, sizeof(matrixUBO));
-			VkBuffer vertexBuffers[] = {models[i].resource.vertexBufferResource.buffer};
-			VkDeviceSize offsets[] = {0};
-			vkCmdBindVertexBuffers(commandBuffers[currentFrame], 0, 1, vertexBuffers, offsets);
-			vkCmdBindIndexBuffer(commandBuffers[currentFrame], models[i].resource.indexBufferResource.buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdBindDescriptorSets(
-				commandBuffers[currentFrame],
-				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				pipelineLayout,
-				0,
-				1,
-				&commonDescriptor.modelMatrix.sets[currentFrame],
-				1,
-				&offset
-			);
-			vkCmdBindDescriptorSets(
-				commandBuffers[currentFrame],
-				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				pipelineLayout,
-				1,
-				1,
-				&commonDescriptor.cameraMatrix.sets[currentFrame],
-				0,
-				nullptr
-			);
-			vkCmdBindDescriptorSets(
-				commandBuffers[currentFrame],
-				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				pipelineLayout,
-				2,
-				1,
-				&commonDescriptor.camera.sets[currentFrame],
-				0,
-				nullptr
-			);
-			vkCmdBindDescriptorSets(
-				commandBuffers[currentFrame],
-				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				pipelineLayout,
-				3,
-				1,
-				&commonDescriptor.light.sets[currentFrame],
-				0,
-				nullptr
-			);
+	vkCmdBeginRenderPass(context.commandBuffer(), &renderPassInfo, CommandCache::getSubpassContents(context));
+	if (context.depthPrepass) {
+		prepassCache.record(context, renderPass, 0, [&](VkCommandBuffer commandBuffer) {
+			// timestamps can't go into cached buffers
+			GpuProfileScope scope(context.cacheCommands ? nullptr : context.profiler, commandBuffer, "depth prepass");
+			drawDepth(commandBuffer, context);
+		});
+	}
+	vkCmdNextSubpass(context.commandBuffer(), CommandCache::getSubpassContents(context));
+	shadingCache.record(context, renderPass, 1, [&](VkCommandBuffer commandBuffer) {
+		GpuProfileScope scope(context.cacheCommands ? nullptr : context.profiler, commandBuffer, "shading");
+		drawShaded(commandBuffer, context);
+	});
+	vkCmdEndRenderPass(context.commandBuffer());
+}
+
+void ForwardRenderPass::drawDepth(VkCommandBuffer commandBuffer, const FrameContext& context) {
+	const std::vector<AssetData>& models = *context.assets;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPrepassPipeline);
+	++RenderStats::frame().pipelineBinds;
+	bindCommonState(commandBuffer, context);
+
+	uint32_t boundBlock = GeometryArena::NO_BLOCK;
+	for (uint32_t i : context.renderQueue->getOrder()) {
+		const GeometryArena::Allocation& geometry = models[i].resource.geometry;
+		if (geometry.block != boundBlock) {
+			context.geometryArena->bindPositions(commandBuffer, geometry.block);
+			boundBlock = geometry.block;
+		}
+		bindModelMatrix(commandBuffer, context.currentFrame, i);
+		drawModel(commandBuffer, context, i);
+	}
+}
+
+void ForwardRenderPass::drawShaded(VkCommandBuffer commandBuffer, const FrameContext& context) {
+	const std::vector<AssetData>& models = *context.assets;
+	uint32_t currentFrame = context.currentFrame;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, context.depthPrepass ? shadingPipeline : pipeline);
+	++RenderStats::frame().pipelineBinds;
+	bindCommonState(commandBuffer, context);
+
+	uint32_t boundBlock = GeometryArena::NO_BLOCK;
+	VkDescriptorSet boundTextures = VK_NULL_HANDLE;
+	for (uint32_t i : context.renderQueue->getOrder()) {
+		// consecutive models in the same arena block keep its binding
+		const GeometryArena::Allocation& geometry = models[i].resource.geometry;
+		if (geometry.block != boundBlock) {
+			context.geometryArena->bind(commandBuffer, geometry.block);
+			boundBlock = geometry.block;
+		}
+		bindModelMatrix(commandBuffer, currentFrame, i);
+		// the sorted order keeps draws of the same model adjacent, their textures stay bound
+		VkDescriptorSet textures = models[i].resource.descriptorSets[currentFrame];
+		if (textures != boundTextures) {
 			vkCmdBindDescriptorSets(
-				commandBuffers[currentFrame],
+				commandBuffer,
 				VK_PIPELINE_BIND_POINT_GRAPHICS,
 				pipelineLayout,
 				4,
 				1,
-				&models[i].resource.descriptorSets[currentFrame],
+				&textures,
 				0,
 				nullptr
 			);
+			++RenderStats::frame().descriptorBinds;
+			boundTextures = textures;
+		}
+		drawModel(commandBuffer, context, i);
+	}
+}
 
-			vkCmdBindDescriptorSets(
-				commandBuffers[currentFrame],
-				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				pipelineLayout,
-				5,
-				1,
-				&output.sets[currentFrame],
-				0,
-				nullptr
-			);
+void ForwardRenderPass::bindCommonState(VkCommandBuffer commandBuffer, const FrameContext& context) {
+	uint32_t currentFrame = context.currentFrame;
+
+	// neither is inherited by a secondary command buffer
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float) swapchain.extent.width;
+	viewport.height = (float) swapchain.extent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.offset = {0, 0};
+	scissor.extent = swapchain.extent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	context.instanceBuffer->bind(commandBuffer);
+
+	// the same for every draw of the pass
+	vkCmdBindDescriptorSets(
+		commandBuffer,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		pipelineLayout,
+		1,
+		1,
+		&commonDescriptor.cameraMatrix.sets[currentFrame],
+		0,
+		nullptr
+	);
+	++RenderStats::frame().descriptorBinds;
+	vkCmdBindDescriptorSets(
+		commandBuffer,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		pipelineLayout,
+		2,
+		1,
+		&commonDescriptor.camera.sets[currentFrame],
+		0,
+		nullptr
+	);
+	++RenderStats::frame().descriptorBinds;
+	vkCmdBindDescriptorSets(
+		commandBuffer,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		pipelineLayout,
+		3,
+		1,
+		&commonDescriptor.light.sets[currentFrame],
+		0,
+		nullptr
+	);
+	++RenderStats::frame().descriptorBinds;
+	vkCmdBindDescriptorSets(
+		commandBuffer,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		pipelineLayout,
+		5,
+		1,
+		&output.sets[currentFrame],
+		0,
+		nullptr
+	);
+	++RenderStats::frame().descriptorBinds;
+}
 
-			vkCmdDrawIndexed(commandBuffers[currentFrame], static_cast<uint32_t>(models[i].resource.indexCount), 1, 0, 0, 0);
-		}
-	} vkCmdEndRenderPass(commandBuffers[currentFrame]);
+void ForwardRenderPass::bindModelMatrix(VkCommandBuffer commandBuffer, uint32_t currentFrame, uint32_t index) {
+	uint32_t offset = index * sizeof(TransformMatrixBuffer);
+	vkCmdBindDescriptorSets(
+		commandBuffer,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		pipelineLayout,
+		0,
+		1,
+		&commonDescriptor.modelMatrix.sets[currentFrame],
+		1,
+		&offset
+	);
+	++RenderStats::frame().descriptorBinds;
+}
+
+void ForwardRenderPass::drawModel(VkCommandBuffer commandBuffer, const FrameContext& context, uint32_t index) {
+	const AssetData& model = (*context.assets)[index];
+	if (context.meshletCuller == nullptr || !context.meshletCuller->drawCulled(commandBuffer, context.currentFrame, index)) {
+		const GeometryArena::Allocation& geometry = model.resource.geometry;
+		const MeshFile::Lod& lod = model.resource.getLod(model.lod);
+		vkCmdDrawIndexed(
+			commandBuffer,
+			lod.indexCount,
+			model.instanceCount,
+			geometry.firstIndex + lod.firstIndex,
+			static_cast<int32_t>(geometry.firstVertex),
+			model.firstInstance
+		);
+		RenderStats::frame().triangles += lod.indexCount / 3 * model.instanceCount;
+	}
+	++RenderStats::frame().drawCalls;
+	RenderStats::frame().instances += model.instanceCount;
 }
\ No newline at end of file
@@ -0,0 +1,35 @@
+#include "frame_arena.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+
+FrameArena::FrameArena(size_t capacity) : memory(std::make_unique<std::byte[]>(capacity)), capacity(capacity) {}
+
+void* FrameArena::allocateBytes(size_t size, size_t alignment) {
+	uintptr_t base = reinterpret_cast<uintptr_t>(memory.get());
+	uintptr_t aligned = (base + used + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+	size_t end = static_cast<size_t>(aligned - base) + size;
+	if (end <= capacity) {
+		used = end;
+		peak = std::max(peak, used + overflowBytes);
+		return reinterpret_cast<void*>(aligned);
+	}
+
+	// new[] of std::byte is aligned for any fundamental type
+	overflow.push_back(std::make_unique<std::byte[]>(size));
+	overflowBytes += size + alignment;
+	peak = std::max(peak, used + overflowBytes);
+	return overflow.back().get();
+}
+
+void FrameArena::reset() {
+	if (!overflow.empty()) {
+		// grow once so the following frames fit without touching the heap
+		capacity = std::max(capacity * 2, peak);
+		memory = std::make_unique<std::byte[]>(capacity);
+		overflow.clear();
+		overflowBytes = 0;
+	}
+	used = 0;
+}
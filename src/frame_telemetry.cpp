@@ -0,0 +1,181 @@
+#include "frame_telemetry.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+
+namespace {
+	size_t percentileIndex(size_t count, float percentile) {
+		return std::min(count - 1, static_cast<size_t>(percentile * static_cast<float>(count)));
+	}
+}
+
+void FrameTelemetry::beginFrame(int64_t nowNs) {
+	if (lastFrameNs == 0) {
+		lastFrameNs = nowNs;
+		pendingSubsystems = 0;
+		return;
+	}
+	float frameMs = static_cast<float>(nowNs - lastFrameNs) * 1e-6f;
+	lastFrameNs = nowNs;
+
+	// work tagged in the previous frame can still show up as a late fence in this one
+	uint32_t subsystems = pendingSubsystems | previousSubsystems;
+	previousSubsystems = pendingSubsystems;
+	pendingSubsystems = 0;
+
+	// compare against the median before this frame so a spike can't raise its own threshold
+	bool stutter = sampleCount > 0
+		&& frameMs > stutterConfig.minMs
+		&& frameMs > stats.p50Ms * stutterConfig.medianFactor;
+	if (stutter) {
+		Stutter& entry = stutters[stutterCount % MAX_STUTTERS];
+		entry.frame = sampleCount;
+		entry.frameMs = frameMs;
+		entry.medianMs = stats.p50Ms;
+		entry.subsystems = subsystems;
+		++stutterCount;
+	}
+
+	frameTimes[sampleHead] = frameMs;
+	sampleSubsystems[sampleHead] = subsystems;
+	sampleStutters[sampleHead] = stutter;
+	sampleHead = (sampleHead + 1) % WINDOW_FRAMES;
+	++sampleCount;
+
+	size_t bucket = std::min(BUCKET_COUNT - 1, static_cast<size_t>(frameMs / BUCKET_MS));
+	++histogram[bucket];
+	runMaxMs = std::max(runMaxMs, frameMs);
+
+	updateStats();
+}
+
+void FrameTelemetry::updateStats() {
+	size_t count = getSampleCount();
+	std::copy(frameTimes.begin(), frameTimes.begin() + count, sortScratch.begin());
+	auto begin = sortScratch.begin();
+	auto end = sortScratch.begin() + count;
+
+	// each nth_element only needs to look at the range above the previous percentile
+	size_t p50 = percentileIndex(count, 0.50f);
+	size_t p95 = percentileIndex(count, 0.95f);
+	size_t p99 = percentileIndex(count, 0.99f);
+	std::nth_element(begin, begin + p50, end);
+	std::nth_element(begin + p50, begin + p95, end);
+	std::nth_element(begin + p95, begin + p99, end);
+
+	stats.p50Ms = sortScratch[p50];
+	stats.p95Ms = sortScratch[p95];
+	stats.p99Ms = sortScratch[p99];
+	stats.maxMs = *std::max_element(begin + p99, end);
+}
+
+FrameTelemetry::Stats FrameTelemetry::getRunStats() const {
+	Stats runStats;
+	runStats.maxMs = runMaxMs;
+	if (sampleCount == 0) {
+		return runStats;
+	}
+
+	const float percentiles[] = {0.50f, 0.95f, 0.99f};
+	float* results[] = {&runStats.p50Ms, &runStats.p95Ms, &runStats.p99Ms};
+	uint64_t cumulative = 0;
+	size_t next = 0;
+	for (size_t i = 0; i < BUCKET_COUNT && next < 3; ++i) {
+		cumulative += histogram[i];
+		while (next < 3 && cumulative > static_cast<uint64_t>(percentiles[next] * static_cast<float>(sampleCount))) {
+			// upper edge of the bucket, the overflow bucket reports the run maximum
+			*results[next] = i == BUCKET_COUNT - 1 ? runMaxMs : std::min(runMaxMs, (i + 1) * BUCKET_MS);
+			++next;
+		}
+	}
+	return runStats;
+}
+
+std::string FrameTelemetry::subsystemNames(uint32_t subsystems) {
+	std::string names;
+	auto append = [&names](const char* name) {
+		if (!names.empty()) {
+			names += '|';
+		}
+		names += name;
+	};
+	if (subsystems & SWAPCHAIN_RECREATE) {
+		append("swapchain_recreate");
+	}
+	if (subsystems & PASS_REBUILD) {
+		append("pass_rebuild");
+	}
+	if (subsystems & ASSET_UPLOAD) {
+		append("asset_upload");
+	}
+	return names;
+}
+
+bool FrameTelemetry::writeCsv(const std::string& path) const {
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	file << "frame,frame_ms,stutter,subsystems\n";
+	size_t count = getSampleCount();
+	size_t offset = getSampleOffset();
+	uint64_t firstFrame = sampleCount - count;
+	for (size_t i = 0; i < count; ++i) {
+		size_t index = (offset + i) % WINDOW_FRAMES;
+		file << firstFrame + i << ','
+			<< frameTimes[index] << ','
+			<< (sampleStutters[index] ? 1 : 0) << ','
+			<< subsystemNames(sampleSubsystems[index]) << '\n';
+	}
+	return true;
+}
+
+bool FrameTelemetry::writeJson(const std::string& path) const {
+	auto statsJson = [](const Stats& value) {
+		return nlohmann::json{
+			{"p50Ms", value.p50Ms},
+			{"p95Ms", value.p95Ms},
+			{"p99Ms", value.p99Ms},
+			{"maxMs", value.maxMs}
+		};
+	};
+
+	nlohmann::json json;
+	json["frames"] = sampleCount;
+	json["window"] = statsJson(stats);
+	json["window"]["frames"] = getSampleCount();
+	json["run"] = statsJson(getRunStats());
+	json["histogram"] = {
+		{"bucketMs", BUCKET_MS},
+		{"counts", histogram}
+	};
+	json["stutterConfig"] = {
+		{"medianFactor", stutterConfig.medianFactor},
+		{"minMs", stutterConfig.minMs}
+	};
+	json["stutterCount"] = stutterCount;
+
+	nlohmann::json stutterList = nlohmann::json::array();
+	uint64_t firstStutter = stutterCount > MAX_STUTTERS ? stutterCount - MAX_STUTTERS : 0;
+	for (uint64_t i = firstStutter; i < stutterCount; ++i) {
+		const Stutter& stutter = stutters[i % MAX_STUTTERS];
+		stutterList.push_back({
+			{"frame", stutter.frame},
+			{"frameMs", stutter.frameMs},
+			{"medianMs", stutter.medianMs},
+			{"subsystems", subsystemNames(stutter.subsystems)}
+		});
+	}
+	json["stutters"] = stutterList;
+
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		return false;
+	}
+	file << json.dump(4);
+	return true;
+}
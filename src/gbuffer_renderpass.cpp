@@ -13,6 +13,10 @@
 #include "vulkan_utils.hpp"
 #include "constants.hpp"
 #include "vulkan_vertex.hpp"
+#include "render_stats.hpp"
+#include "meshlet_culler.hpp"
+#include "render_queue.hpp"
+#include "deletion_queue.hpp"
 
 enum BINDING {
 	ALBEDO = 0,
@@ -22,56 +26,118 @@ enum BINDING {
 	DEPTH = 4
 };
 
-void GBufferRenderPass::init() {
+void GBufferRenderPass::init(VkCommandPool commandPool) {
 	createRenderPass();
 	createSampler();
-	createImageResources();
 	createGraphicsPipeline();
+	commandCache.init(device, commandPool);
 }
 
-void GBufferRenderPass::createImageResources(){
-	createGBufferResources();
-	createFramebuffers();
+void GBufferRenderPass::updateExtent() {
+	extent.width = (swapchain.extent.width + resolutionDivisor - 1) / resolutionDivisor;
+	extent.height = (swapchain.extent.height + resolutionDivisor - 1) / resolutionDivisor;
+}
+
+void GBufferRenderPass::declareResources(RenderGraph& graph, VkExtent2D attachmentExtent) {
+	updateExtent();
+
+	RenderGraphImageDesc colorDesc{};
+	colorDesc.width = (attachmentExtent.width + resolutionDivisor - 1) / resolutionDivisor;
+	colorDesc.height = (attachmentExtent.height + resolutionDivisor - 1) / resolutionDivisor;
+	colorDesc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	colorDesc.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+
+	colorDesc.format = VK_FORMAT_R8G8B8A8_UNORM;
+	gBufferImages[BINDING::ALBEDO] = graph.createImage("gbuffer albedo", colorDesc);
+	colorDesc.format = VK_FORMAT_R32G32B32A32_SFLOAT;
+	gBufferImages[BINDING::POSITION] = graph.createImage("gbuffer position", colorDesc);
+	gBufferImages[BINDING::NORMAL] = graph.createImage("gbuffer normal", colorDesc);
+	colorDesc.format = VK_FORMAT_R8G8_UNORM;
+	gBufferImages[BINDING::MATERIAL] = graph.createImage("gbuffer material", colorDesc);
+
+	RenderGraphImageDesc depthDesc = colorDesc;
+	depthDesc.format = depthFormat;
+	depthDesc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	depthDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+	gBufferImages[BINDING::DEPTH] = graph.createImage("gbuffer depth", depthDesc);
+
+	auto pass = graph.addPass("gbuffer", [this](const FrameContext& context) {
+		generateGBuffer(context);
+
+	});
+	for (size_t i = BINDING::ALBEDO; i <= BINDING::MATERIAL; ++i) {
+		pass.write(
+			gBufferImages[i],
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		);
+	}
+	pass.write(
+		gBufferImages[BINDING::DEPTH],
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+		VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+	);
+}
+
+void GBufferRenderPass::readGBuffer(RenderGraph::PassBuilder& pass) const {
+	for (size_t i = BINDING::ALBEDO; i <= BINDING::MATERIAL; ++i) {
+		pass.read(
+			gBufferImages[i],
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_SHADER_READ_BIT
+		);
+	}
+	pass.read(
+		gBufferImages[BINDING::DEPTH],
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		VK_ACCESS_SHADER_READ_BIT
+	);
+}
+
+void GBufferRenderPass::createImageResources(const RenderGraph& graph){
+	createFramebuffers(graph);
 	createDescriptorSetLayout();
 	createDescriptorPool();
-	createDescriptorSets();
+	createDescriptorSets(graph);
 }
 
 void GBufferRenderPass::cleanup() {
-	cleanupImageResources();
+	commandCache.cleanup();
 	vkDestroySampler(device, sampler, nullptr);
 	vkDestroyPipeline(device, pipeline, nullptr);
 	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
 	vkDestroyRenderPass(device, renderPass, nullptr);
 }
 
-void GBufferRenderPass::cleanupImageResources() {
-	albedo.cleanup(device);
-	position.cleanup(device);
-	normal.cleanup(device);
-	material.cleanup(device);
-	depth.cleanup(device);
+void GBufferRenderPass::cleanupImageResources(DeletionQueue& deletionQueue) {
+	deletionQueue.retireFramebuffers(device, framebuffers);
+	deletionQueue.push([device = device, layout = descriptor.layout, pool = descriptorPool]() {
+		vkDestroyDescriptorSetLayout(device, layout, nullptr);
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	});
+	descriptorPool = VK_NULL_HANDLE;
+}
 
-	for (auto framebuffer : framebuffers) {
-		vkDestroyFramebuffer(device, framebuffer, nullptr);
-	}
-	descriptor.cleanup(device);
-	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+void GBufferRenderPass::resizeFramebuffers(DeletionQueue& deletionQueue, const RenderGraph& graph) {
+	// the descriptor sets sample the same images
+	updateExtent();
+	deletionQueue.retireFramebuffers(device, framebuffers);
+	createFramebuffers(graph);
 }
 
-void GBufferRenderPass::generateGBuffer(
-	std::vector<VkCommandBuffer>& commandBuffers,
-	uint32_t imageIndex,
-	uint32_t currentFrame,
-	std::vector<void*>& modelMatrixBuffersMapped,
-	const std::vector<AssetData>& models
-) {
+void GBufferRenderPass::generateGBuffer(const FrameContext& context) {
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	renderPassInfo.renderPass = renderPass;
-	renderPassInfo.framebuffer = framebuffers[imageIndex];
+	renderPassInfo.framebuffer = framebuffers[context.imageIndex];
 	renderPassInfo.renderArea.offset = {0, 0};
-	renderPassInfo.renderArea.extent = swapchain.extent;
+	renderPassInfo.renderArea.extent = extent;
 
 	std::array<VkClearValue, 7> clearValues{};
 	clearValues[0].color = {{0.0f, 0.0f, 0.0f, 0.0f}};
@@ -83,80 +149,112 @@ void GBufferRenderPass::generateGBuffer(
 	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 	renderPassInfo.pClearValues = clearValues.data();
 
-	vkCmdBeginRenderPass(commandBuffers[currentFrame], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-	{
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(swapchain.extent.width);
-		viewport.height = static_cast<float>(swapchain.extent.height);
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		vkCmdSetViewport(commandBuffers[currentFrame], 0, 1, &viewport);
-
-		VkRect2D scissor{};
-		scissor.offset = {0, 0};
-		scissor.extent = swapchain.extent;
-		vkCmdSetScissor(commandBuffers[currentFrame], 0, 1, &scissor);
-
-		vkCmdBindPipeline(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-
-		for(size_t i = 0; i < models.size(); ++i) {
-			uint32_t offset = static_cast<uint32_t>(i * sizeof(TransformMatrixBuffer));
-			TransformMatrixBuffer matrixUBO{};
-			matrixUBO.model = models[i].object.getModelMatrix();
-			void* target = static_cast<char*>(modelMatrixBuffersMapped[currentFrame]) + offset;
-			memcpy(target, &matrixUBO, sizeof(matrixUBO));
-			VkBuffer vertexBuffers[] = {models[i].resource.vertexBufferResource.buffer};
-			VkDeviceSize offsets[] = {0};
-			vkCmdBindVertexBuffers(commandBuffers[currentFrame], 0, 1, vertexBuffers, offsets);
-			vkCmdBindIndexBuffer(commandBuffers[currentFrame], models[i].resource.indexBufferResource.buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdBindDescriptorSets(
-				commandBuffers[currentFrame],
-				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				pipelineLayout,
-				0,
-				1,
-				&commonDescriptor.modelMatrix.sets[currentFrame],
-				1,
-				&offset
-			);
-			vkCmdBindDescriptorSets(
-				commandBuffers[currentFrame],
-				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				pipelineLayout,
-				1,
-				1,
-				&commonDescriptor.cameraMatrix.sets[currentFrame],
-				0,
-				nullptr
-			);
-			vkCmdBindDescriptorSets(
-				commandBuffers[currentFrame],
-				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				pipelineLayout,
-				2,
-				1,
-				&commonDescriptor.camera.sets[currentFrame],
-				0,
-				nullptr
-			);
+	vkCmdBeginRenderPass(context.commandBuffer(), &renderPassInfo, CommandCache::getSubpassContents(context));
+	commandCache.record(context, renderPass, 0, [&](VkCommandBuffer commandBuffer) {
+		drawGBuffer(commandBuffer, context);
+	});
+	vkCmdEndRenderPass(context.commandBuffer());
+}
+
+void GBufferRenderPass::drawGBuffer(VkCommandBuffer commandBuffer, const FrameContext& context) {
+	uint32_t currentFrame = context.currentFrame;
+	const std::vector<AssetData>& models = *context.assets;
+
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	// unrounded so that every texel maps to exactly resolutionDivisor screen pixels
+	viewport.width = static_cast<float>(swapchain.extent.width) / resolutionDivisor;
+	viewport.height = static_cast<float>(swapchain.extent.height) / resolutionDivisor;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.offset = {0, 0};
+	scissor.extent = extent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	++RenderStats::frame().pipelineBinds;
+	context.instanceBuffer->bind(commandBuffer);
+
+	// the same for every draw of the pass
+	vkCmdBindDescriptorSets(
+		commandBuffer,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		pipelineLayout,
+		1,
+		1,
+		&commonDescriptor.cameraMatrix.sets[currentFrame],
+		0,
+		nullptr
+	);
+	++RenderStats::frame().descriptorBinds;
+	vkCmdBindDescriptorSets(
+		commandBuffer,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		pipelineLayout,
+		2,
+		1,
+		&commonDescriptor.camera.sets[currentFrame],
+		0,
+		nullptr
+	);
+	++RenderStats::frame().descriptorBinds;
+
+	uint32_t boundBlock = GeometryArena::NO_BLOCK;
+	VkDescriptorSet boundTextures = VK_NULL_HANDLE;
+	for (uint32_t i : context.renderQueue->getOrder()) {
+		uint32_t offset = static_cast<uint32_t>(i * sizeof(TransformMatrixBuffer));
+		// consecutive models in the same arena block keep its binding
+		const GeometryArena::Allocation& geometry = models[i].resource.geometry;
+		if (geometry.block != boundBlock) {
+			context.geometryArena->bind(commandBuffer, geometry.block);
+			boundBlock = geometry.block;
+		}
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			pipelineLayout,
+			0,
+			1,
+			&commonDescriptor.modelMatrix.sets[currentFrame],
+			1,
+			&offset
+		);
+		++RenderStats::frame().descriptorBinds;
+		// the sorted order keeps draws of the same model adjacent, their textures stay bound
+		VkDescriptorSet textures = models[i].resource.descriptorSets[currentFrame];
+		if (textures != boundTextures) {
 			vkCmdBindDescriptorSets(
-				commandBuffers[currentFrame],
+				commandBuffer,
 				VK_PIPELINE_BIND_POINT_GRAPHICS,
 				pipelineLayout,
 				3,
 				1,
-				&models[i].resource.descriptorSets[currentFrame],
+				&textures,
 				0,
 				nullptr
 			);
-			vkCmdDrawIndexed(commandBuffers[currentFrame], static_cast<uint32_t>(models[i].resource.indexCount), 1, 0, 0, 0);
+			++RenderStats::frame().descriptorBinds;
+			boundTextures = textures;
 		}
-
-	} vkCmdEndRenderPass(commandBuffers[currentFrame]);
-
-	transitionGBufferToSampler(commandBuffers[currentFrame]);
+		if (context.meshletCuller == nullptr || !context.meshletCuller->drawCulled(commandBuffer, currentFrame, i)) {
+			const MeshFile::Lod& lod = models[i].resource.getLod(models[i].lod);
+			vkCmdDrawIndexed(
+				commandBuffer,
+				lod.indexCount,
+				models[i].instanceCount,
+				geometry.firstIndex + lod.firstIndex,
+				static_cast<int32_t>(geometry.firstVertex),
+				models[i].firstInstance
+			);
+			RenderStats::frame().triangles += lod.indexCount / 3 * models[i].instanceCount;
+		}
+		++RenderStats::frame().drawCalls;
+		RenderStats::frame().instances += models[i].instanceCount;
+	}
 }
 
 void GBufferRenderPass::createRenderPass() {
@@ -165,7 +263,7 @@ void GBufferRenderPass::createRenderPass() {
 	albedoAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	albedoAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 	albedoAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	albedoAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	albedoAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 	albedoAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentDescription positionAttachment{};
@@ -173,7 +271,7 @@ void GBufferRenderPass::createRenderPass() {
 	positionAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	positionAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 	positionAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	positionAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	positionAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 	positionAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentDescription normalAttachment{};
@@ -181,7 +279,7 @@ void GBufferRenderPass::createRenderPass() {
 	normalAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	normalAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 	normalAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	normalAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	normalAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 	normalAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentDescription materialAttachment{};
@@ -189,7 +287,7 @@ void GBufferRenderPass::createRenderPass() {
 	materialAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	materialAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 	materialAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	materialAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	materialAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 	materialAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentDescription depthAttachment{};
@@ -199,7 +297,7 @@ void GBufferRenderPass::createRenderPass() {
 	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 	// G-Buffer subpass settings
@@ -249,107 +347,25 @@ void GBufferRenderPass::createRenderPass() {
 	}
 }
 
-void GBufferRenderPass::createGBufferResources() {
-	VulkanUtils::createImage(
-		physicalDevice,
-		device,
-		swapchain.extent.width,
-		swapchain.extent.height,
-		1,
-		VK_SAMPLE_COUNT_1_BIT,
-		VK_FORMAT_R8G8B8A8_UNORM,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		albedo.image,
-		albedo.imageMemory
-	);
-	albedo.imageView = VulkanUtils::createImageView(device, albedo.image, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-
-	VulkanUtils::createImage(
-		physicalDevice,
-		device,
-		swapchain.extent.width,
-		swapchain.extent.height,
-		1,
-		VK_SAMPLE_COUNT_1_BIT,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		position.image,
-		position.imageMemory
-	);
-	position.imageView = VulkanUtils::createImageView(device, position.image, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-
-	VulkanUtils::createImage(
-		physicalDevice,
-		device,
-		swapchain.extent.width,
-		swapchain.extent.height,
-		1,
-		VK_SAMPLE_COUNT_1_BIT,
-		VK_FORMAT_R32G32B32A32_SFLOAT,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		normal.image,
-		normal.imageMemory
-	);
-	normal.imageView = VulkanUtils::createImageView(device, normal.image, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-
-	VulkanUtils::createImage(
-		physicalDevice,
-		device,
-		swapchain.extent.width,
-		swapchain.extent.height,
-		1,
-		VK_SAMPLE_COUNT_1_BIT,
-		VK_FORMAT_R8G8_UNORM,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		material.image,
-		material.imageMemory
-	);
-	material.imageView = VulkanUtils::createImageView(device, material.image, VK_FORMAT_R8G8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-
-	VulkanUtils::createImage(
-		physicalDevice,
-		device,
-		swapchain.extent.width,
-		swapchain.extent.height,
-		1,
-		VK_SAMPLE_COUNT_1_BIT,
-		depthFormat,
-		VK_IMAGE_TILING_OPTIMAL,
-		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		depth.image,
-		depth.imageMemory
-	);
-	depth.imageView = VulkanUtils::createImageView(device, depth.image, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
-}
-
-void GBufferRenderPass::createFramebuffers() {
+void GBufferRenderPass::createFramebuffers(const RenderGraph& graph) {
 	framebuffers.resize(swapchain.imageViews.size());
 
 	for (size_t i = 0; i < swapchain.imageViews.size(); ++i) {
-		std::array<VkImageView, 5> attachments = {
-			albedo.imageView,
-			position.imageView,
-			normal.imageView,
-			material.imageView,
-			depth.imageView
+		std::array<VkImageView, 5> imageViews = {
+			graph.getImage(gBufferImages[BINDING::ALBEDO]).imageView,
+			graph.getImage(gBufferImages[BINDING::POSITION]).imageView,
+			graph.getImage(gBufferImages[BINDING::NORMAL]).imageView,
+			graph.getImage(gBufferImages[BINDING::MATERIAL]).imageView,
+			graph.getImage(gBufferImages[BINDING::DEPTH]).imageView
 		};
 
 		VkFramebufferCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 		createInfo.renderPass = renderPass;
-		createInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-		createInfo.pAttachments = attachments.data();
-		createInfo.width = swapchain.extent.width;
-		createInfo.height = swapchain.extent.height;
+		createInfo.attachmentCount = static_cast<uint32_t>(imageViews.size());
+		createInfo.pAttachments = imageViews.data();
+		createInfo.width = extent.width;
+		createInfo.height = extent.height;
 		createInfo.layers = 1;
 
 		if (vkCreateFramebuffer(device, &createInfo, nullptr, &framebuffers[i]) != VK_SUCCESS) {
@@ -397,12 +413,12 @@ void GBufferRenderPass::createGraphicsPipeline() {
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	auto bindingDescriptions = PackedVertex::getBindingDescriptions();
+	auto attributeDescriptions = PackedVertex::getAttributeDescriptions();
 
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
 	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -564,7 +580,7 @@ void GBufferRenderPass::createDescriptorPool() {
 	}
 }
 
-void GBufferRenderPass::createDescriptorSets() {
+void GBufferRenderPass::createDescriptorSets(const RenderGraph& graph) {
 
 	std::vector<VkDescriptorSetLayout> descriptorSetLayouts(Config::MAX_FRAMES_IN_FLIGHT, descriptor.layout);
 
@@ -580,27 +596,27 @@ void GBufferRenderPass::createDescriptorSets() {
 	}
 
 	VkDescriptorImageInfo albedoImageInfo{};
-	albedoImageInfo.imageView = albedo.imageView;
+	albedoImageInfo.imageView = graph.getImage(gBufferImages[BINDING::ALBEDO]).imageView;
 	albedoImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	albedoImageInfo.sampler = sampler;
 
 	VkDescriptorImageInfo positionImageInfo{};
-	positionImageInfo.imageView = position.imageView;
+	positionImageInfo.imageView = graph.getImage(gBufferImages[BINDING::POSITION]).imageView;
 	positionImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	positionImageInfo.sampler = sampler;
 
 	VkDescriptorImageInfo normalImageInfo{};
-	normalImageInfo.imageView = normal.imageView;
+	normalImageInfo.imageView = graph.getImage(gBufferImages[BINDING::NORMAL]).imageView;
 	normalImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	normalImageInfo.sampler = sampler;
 
 	VkDescriptorImageInfo materialImageInfo{};
-	materialImageInfo.imageView = material.imageView;
+	materialImageInfo.imageView = graph.getImage(gBufferImages[BINDING::MATERIAL]).imageView;
 	materialImageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	materialImageInfo.sampler = sampler;
 
 	VkDescriptorImageInfo depthImageInfo{};
-	depthImageInfo.imageView = depth.imageView;
+	depthImageInfo.imageView = graph.getImage(gBufferImages[BINDING::DEPTH]).imageView;
 	depthImageInfo.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 	depthImageInfo.sampler = sampler;
 
@@ -675,124 +691,4 @@ void GBufferRenderPass::createSampler() {
 	if (vkCreateSampler(device, &createInfo, nullptr, &sampler) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create texture sampler");
 	}
-}
-
-void GBufferRenderPass::transitionGBufferToSampler(VkCommandBuffer commandBuffer) {
-	VulkanUtils::transitionLayout(
-		commandBuffer,
-		albedo.image,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_ACCESS_SHADER_READ_BIT,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-	);
-	VulkanUtils::transitionLayout(
-		commandBuffer,
-		position.image,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_ACCESS_SHADER_READ_BIT,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-	);
-	VulkanUtils::transitionLayout(
-		commandBuffer,
-		normal.image,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_ACCESS_SHADER_READ_BIT,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-	);
-	VulkanUtils::transitionLayout(
-		commandBuffer,
-		material.image,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_ACCESS_SHADER_READ_BIT,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-	);
-	VulkanUtils::transitionLayout(
-		commandBuffer,
-		depth.image,
-		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_IMAGE_ASPECT_DEPTH_BIT,
-		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-		VK_ACCESS_SHADER_READ_BIT,
-		VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-	);
-
-	isTransitioned = true;
-}
-
-void GBufferRenderPass::transitionGBufferToAttachment(VkCommandBuffer commandBuffer) {
-	VulkanUtils::transitionLayout(
-		commandBuffer,
-		albedo.image,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_ACCESS_SHADER_READ_BIT,
-		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-	);
-	VulkanUtils::transitionLayout(
-		commandBuffer,
-		position.image,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_ACCESS_SHADER_READ_BIT,
-		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-	);
-	VulkanUtils::transitionLayout(
-		commandBuffer,
-		normal.image,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_ACCESS_SHADER_READ_BIT,
-		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-	);
-	VulkanUtils::transitionLayout(
-		commandBuffer,
-		material.image,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_ACCESS_SHADER_READ_BIT,
-		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-	);
-	VulkanUtils::transitionLayout(
-		commandBuffer,
-		depth.image,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-		VK_IMAGE_ASPECT_DEPTH_BIT,
-		VK_ACCESS_SHADER_READ_BIT,
-		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-		VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT
-	);
-
-	isTransitioned = false;
 }
\ No newline at end of file
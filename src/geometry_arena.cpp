@@ -0,0 +1,210 @@
+#include "geometry_arena.hpp"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <stdexcept>
+
+#include "constants.hpp"
+#include "render_stats.hpp"
+#include "vulkan_utils.hpp"
+#include "vulkan_vertex.hpp"
+
+RangeAllocator::RangeAllocator(uint32_t capacity) : capacity(capacity) {
+	freeRanges.push_back({0, capacity});
+}
+
+uint32_t RangeAllocator::allocate(uint32_t size) {
+	for (size_t i = 0; i < freeRanges.size(); ++i) {
+		Range& range = freeRanges[i];
+		if (range.size < size) {
+			continue;
+		}
+		uint32_t offset = range.offset;
+		range.offset += size;
+		range.size -= size;
+		if (range.size == 0) {
+			freeRanges.erase(freeRanges.begin() + i);
+		}
+		used += size;
+		return offset;
+	}
+	return INVALID;
+}
+
+void RangeAllocator::free(uint32_t offset, uint32_t size) {
+	auto next = std::lower_bound(freeRanges.begin(), freeRanges.end(), offset, [](const Range& range, uint32_t offset) {
+		return range.offset < offset;
+	});
+	used -= size;
+	bool mergesPrevious = next != freeRanges.begin() && std::prev(next)->offset + std::prev(next)->size == offset;
+	bool mergesNext = next != freeRanges.end() && offset + size == next->offset;
+	if (mergesPrevious && mergesNext) {
+		std::prev(next)->size += size + next->size;
+		freeRanges.erase(next);
+	} else if (mergesPrevious) {
+		std::prev(next)->size += size;
+	} else if (mergesNext) {
+		next->offset = offset;
+		next->size += size;
+	} else {
+		freeRanges.insert(next, {offset, size});
+	}
+}
+
+void GeometryArena::init(VkPhysicalDevice physicalDevice, VkDevice device, const std::vector<uint32_t>& queueFamilies) {
+	this->physicalDevice = physicalDevice;
+	this->device = device;
+	this->queueFamilies = queueFamilies;
+}
+
+void GeometryArena::cleanup() {
+	for (auto& block : blocks) {
+		vkDestroyBuffer(device, block.vertexBuffer, nullptr);
+		vkFreeMemory(device, block.vertexMemory, nullptr);
+		vkDestroyBuffer(device, block.indexBuffer, nullptr);
+		vkFreeMemory(device, block.indexMemory, nullptr);
+	}
+	blocks.clear();
+}
+
+GeometryArena::Allocation GeometryArena::allocate(uint32_t vertexCount, uint32_t indexCount) {
+	Allocation allocation;
+	allocation.vertexCount = vertexCount;
+	allocation.indexCount = indexCount;
+	for (uint32_t i = 0; i < blocks.size(); ++i) {
+		Block& block = blocks[i];
+		uint32_t firstVertex = block.vertices.allocate(vertexCount);
+		if (firstVertex == RangeAllocator::INVALID) {
+			continue;
+		}
+		uint32_t firstIndex = block.indices.allocate(indexCount);
+		if (firstIndex == RangeAllocator::INVALID) {
+			block.vertices.free(firstVertex, vertexCount);
+			continue;
+		}
+		allocation.block = i;
+		allocation.firstVertex = firstVertex;
+		allocation.firstIndex = firstIndex;
+		++block.allocations;
+		return allocation;
+	}
+
+	createBlock(std::max(vertexCount, Config::GEOMETRY_BLOCK_VERTICES), std::max(indexCount, Config::GEOMETRY_BLOCK_INDICES));
+	Block& block = blocks.back();
+	allocation.block = static_cast<uint32_t>(blocks.size() - 1);
+	allocation.firstVertex = block.vertices.allocate(vertexCount);
+	allocation.firstIndex = block.indices.allocate(indexCount);
+	++block.allocations;
+	return allocation;
+}
+
+void GeometryArena::free(const Allocation& allocation) {
+	if (allocation.block == NO_BLOCK) {
+		return;
+	}
+	Block& block = blocks[allocation.block];
+	block.vertices.free(allocation.firstVertex, allocation.vertexCount);
+	block.indices.free(allocation.firstIndex, allocation.indexCount);
+	--block.allocations;
+}
+
+void GeometryArena::copyVertices(VkCommandBuffer commandBuffer, const Allocation& allocation, VkBuffer stagingBuffer) const {
+	const Block& block = blocks[allocation.block];
+	std::array<VkBufferCopy, 2> regions{};
+	regions[0].srcOffset = 0;
+	regions[0].dstOffset = static_cast<VkDeviceSize>(PackedVertex::POSITION_STRIDE) * allocation.firstVertex;
+	regions[0].size = static_cast<VkDeviceSize>(PackedVertex::POSITION_STRIDE) * allocation.vertexCount;
+	regions[1].srcOffset = PackedVertex::getAttributeOffset(allocation.vertexCount);
+	regions[1].dstOffset = block.attributeOffset + sizeof(PackedVertex::Attributes) * allocation.firstVertex;
+	regions[1].size = sizeof(PackedVertex::Attributes) * allocation.vertexCount;
+	vkCmdCopyBuffer(commandBuffer, stagingBuffer, block.vertexBuffer, static_cast<uint32_t>(regions.size()), regions.data());
+}
+
+void GeometryArena::copyIndices(VkCommandBuffer commandBuffer, const Allocation& allocation, VkBuffer stagingBuffer) const {
+	VkBufferCopy region{};
+	region.srcOffset = 0;
+	region.dstOffset = sizeof(uint32_t) * allocation.firstIndex;
+	region.size = sizeof(uint32_t) * allocation.indexCount;
+	vkCmdCopyBuffer(commandBuffer, stagingBuffer, blocks[allocation.block].indexBuffer, 1, &region);
+}
+
+void GeometryArena::bind(VkCommandBuffer commandBuffer, uint32_t block) const {
+	// both streams live in one buffer
+	VkBuffer vertexBuffers[] = {blocks[block].vertexBuffer, blocks[block].vertexBuffer};
+	VkDeviceSize offsets[] = {0, blocks[block].attributeOffset};
+	vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, blocks[block].indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	++RenderStats::frame().bufferBinds;
+}
+
+void GeometryArena::bindPositions(VkCommandBuffer commandBuffer, uint32_t block) const {
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &blocks[block].vertexBuffer, &offset);
+	vkCmdBindIndexBuffer(commandBuffer, blocks[block].indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+	++RenderStats::frame().bufferBinds;
+}
+
+GeometryArena::Stats GeometryArena::getStats() const {
+	Stats stats;
+	stats.blocks = static_cast<uint32_t>(blocks.size());
+	for (const auto& block : blocks) {
+		stats.allocations += block.allocations;
+		stats.usedVertices += block.vertices.getUsed();
+		stats.vertexCapacity += block.vertices.getCapacity();
+		stats.usedIndices += block.indices.getUsed();
+		stats.indexCapacity += block.indices.getCapacity();
+	}
+	return stats;
+}
+
+void GeometryArena::createBlock(uint32_t vertexCapacity, uint32_t indexCapacity) {
+	Block block;
+	block.attributeOffset = PackedVertex::getAttributeOffset(vertexCapacity);
+	block.vertices = RangeAllocator(vertexCapacity);
+	block.indices = RangeAllocator(indexCapacity);
+	createBuffer(
+		PackedVertex::getSize(vertexCapacity),
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		block.vertexBuffer,
+		block.vertexMemory
+	);
+	createBuffer(
+		sizeof(uint32_t) * static_cast<VkDeviceSize>(indexCapacity),
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		block.indexBuffer,
+		block.indexMemory
+	);
+	blocks.push_back(std::move(block));
+}
+
+void GeometryArena::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer, VkDeviceMemory& memory) {
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	if (queueFamilies.size() > 1) {
+		bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(queueFamilies.size());
+		bufferInfo.pQueueFamilyIndices = queueFamilies.data();
+	} else {
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create buffer");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = memoryRequirements.size;
+	allocateInfo.memoryTypeIndex = VulkanUtils::findMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (vkAllocateMemory(device, &allocateInfo, nullptr, &memory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate buffer memory");
+	}
+	++RenderStats::frame().allocations;
+
+	vkBindBufferMemory(device, buffer, memory, 0);
+}
@@ -0,0 +1,276 @@
+#include "gpu_profiler.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "cpu_profiler.hpp"
+#include "vulkan_utils.hpp"
+
+namespace {
+	const uint32_t INVALID_SCOPE = UINT32_MAX;
+}
+
+void GpuProfiler::init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, bool pipelineStatistics) {
+	this->device = device;
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+	if (validBits == 0) {
+		// the queue can't write timestamps, leave the profiler disabled
+		return;
+	}
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	timestampPeriod = properties.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	createInfo.queryCount = Config::MAX_FRAMES_IN_FLIGHT * MAX_SCOPES * 2;
+
+	if (vkCreateQueryPool(device, &createInfo, nullptr, &queryPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create timestamp query pool");
+	}
+
+	queryResults.resize(MAX_SCOPES * 2);
+
+	if (pipelineStatistics) {
+		createInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		createInfo.queryCount = Config::MAX_FRAMES_IN_FLIGHT * MAX_SCOPES;
+		createInfo.pipelineStatistics = PIPELINE_STATISTICS;
+
+		if (vkCreateQueryPool(device, &createInfo, nullptr, &statisticsQueryPool) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create pipeline statistics query pool");
+		}
+		statisticsResults.resize(MAX_SCOPES * PIPELINE_STATISTIC_COUNT);
+	}
+	timings.reserve(MAX_SCOPES);
+	history.reserve(HISTORY_FRAMES);
+}
+
+void GpuProfiler::cleanup() {
+	if (queryPool != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(device, queryPool, nullptr);
+		queryPool = VK_NULL_HANDLE;
+	}
+	if (statisticsQueryPool != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(device, statisticsQueryPool, nullptr);
+		statisticsQueryPool = VK_NULL_HANDLE;
+	}
+}
+
+void GpuProfiler::calibrate(VkCommandPool commandPool, VkQueue queue) {
+	if (!isEnabled()) {
+		return;
+	}
+
+	VkCommandBuffer commandBuffer = VulkanUtils::beginSingleTimeCommands(device, commandPool);
+	vkCmdResetQueryPool(commandBuffer, queryPool, 0, 1);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 0);
+	int64_t submitNs = CpuProfiler::now();
+	VulkanUtils::endSingleTimeCommands(device, commandPool, commandBuffer, queue);
+	int64_t idleNs = CpuProfiler::now();
+
+	uint64_t timestamp = 0;
+	VkResult result = vkGetQueryPoolResults(
+		device,
+		queryPool,
+		0,
+		1,
+		sizeof(uint64_t),
+		&timestamp,
+		sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT
+	);
+	if (result != VK_SUCCESS) {
+		return;
+	}
+
+	// the timestamp was written somewhere between submit and idle, the midpoint is good to a few microseconds
+	baseTimestamp = timestamp & timestampMask;
+	baseCpuNs = submitNs + (idleNs - submitNs) / 2;
+	hasBaseTimestamp = true;
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+	if (!isEnabled()) {
+		return;
+	}
+	currentFrame = frameIndex;
+	currentDepth = 0;
+
+	// the fence of this frame slot has been waited on, so its queries are complete
+	FrameQueries& frame = frames[frameIndex];
+	if (frame.recorded) {
+		resolveFrame(frameIndex);
+	}
+
+	vkCmdResetQueryPool(commandBuffer, queryPool, frameIndex * MAX_SCOPES * 2, MAX_SCOPES * 2);
+	if (hasPipelineStatistics()) {
+		vkCmdResetQueryPool(commandBuffer, statisticsQueryPool, frameIndex * MAX_SCOPES, MAX_SCOPES);
+	}
+	frame.scopeCount = 0;
+	frame.statisticsCount = 0;
+	frame.recorded = true;
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer commandBuffer, const std::string& name) {
+	FrameQueries& frame = frames[currentFrame];
+	if (!isEnabled() || frame.scopeCount >= MAX_SCOPES) {
+		return INVALID_SCOPE;
+	}
+
+	uint32_t scope = frame.scopeCount++;
+	PendingScope& pending = frame.scopes[scope];
+	pending.name = name;
+	pending.depth = currentDepth++;
+	pending.statisticsQuery = INVALID_SCOPE;
+
+	uint32_t query = (currentFrame * MAX_SCOPES + scope) * 2;
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, query);
+
+	if (pending.depth == 0 && hasPipelineStatistics()) {
+		pending.statisticsQuery = frame.statisticsCount++;
+		vkCmdBeginQuery(commandBuffer, statisticsQueryPool, currentFrame * MAX_SCOPES + pending.statisticsQuery, 0);
+	}
+	return scope;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+	if (scope == INVALID_SCOPE) {
+		return;
+	}
+	--currentDepth;
+
+	uint32_t statisticsQuery = frames[currentFrame].scopes[scope].statisticsQuery;
+	if (statisticsQuery != INVALID_SCOPE) {
+		vkCmdEndQuery(commandBuffer, statisticsQueryPool, currentFrame * MAX_SCOPES + statisticsQuery);
+	}
+
+	uint32_t query = (currentFrame * MAX_SCOPES + scope) * 2 + 1;
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, query);
+}
+
+void GpuProfiler::resolveFrame(uint32_t frameIndex) {
+	FrameQueries& frame = frames[frameIndex];
+	if (frame.scopeCount == 0) {
+		return;
+	}
+
+	uint32_t queryCount = frame.scopeCount * 2;
+	VkResult result = vkGetQueryPoolResults(
+		device,
+		queryPool,
+		frameIndex * MAX_SCOPES * 2,
+		queryCount,
+		queryCount * sizeof(uint64_t),
+		queryResults.data(),
+		sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT
+	);
+	// never wait here, a late frame is simply skipped
+	if (result != VK_SUCCESS) {
+		return;
+	}
+
+	if (!hasBaseTimestamp) {
+		// uncalibrated, the GPU work finished shortly before now
+		baseTimestamp = queryResults[0] & timestampMask;
+		baseCpuNs = CpuProfiler::now();
+		hasBaseTimestamp = true;
+	}
+
+	double frameBeginMs = 0.0;
+	double frameEndMs = 0.0;
+	timings.resize(frame.scopeCount);
+	for (uint32_t i = 0; i < frame.scopeCount; ++i) {
+		uint64_t begin = queryResults[i * 2] & timestampMask;
+		uint64_t end = queryResults[i * 2 + 1] & timestampMask;
+
+		ScopeTiming& timing = timings[i];
+		timing.name = frame.scopes[i].name;
+		timing.depth = frame.scopes[i].depth;
+		timing.beginMs = static_cast<double>(begin - baseTimestamp) * timestampPeriod * 1e-6;
+		timing.durationMs = static_cast<double>(end - begin) * timestampPeriod * 1e-6;
+		timing.hasStatistics = false;
+
+		double endMs = timing.beginMs + timing.durationMs;
+		frameBeginMs = i == 0 ? timing.beginMs : std::min(frameBeginMs, timing.beginMs);
+		frameEndMs = std::max(frameEndMs, endMs);
+	}
+	frameTimeMs = frameEndMs - frameBeginMs;
+
+	if (frame.statisticsCount > 0) {
+		result = vkGetQueryPoolResults(
+			device,
+			statisticsQueryPool,
+			frameIndex * MAX_SCOPES,
+			frame.statisticsCount,
+			frame.statisticsCount * PIPELINE_STATISTIC_COUNT * sizeof(uint64_t),
+			statisticsResults.data(),
+			PIPELINE_STATISTIC_COUNT * sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT
+		);
+		if (result == VK_SUCCESS) {
+			for (uint32_t i = 0; i < frame.scopeCount; ++i) {
+				uint32_t statisticsQuery = frame.scopes[i].statisticsQuery;
+				if (statisticsQuery == INVALID_SCOPE) {
+					continue;
+				}
+				const uint64_t* values = &statisticsResults[statisticsQuery * PIPELINE_STATISTIC_COUNT];
+				PipelineStatistics& statistics = timings[i].statistics;
+				statistics.vertexInvocations = values[0];
+				statistics.clippingInvocations = values[1];
+				statistics.clippingPrimitives = values[2];
+				statistics.fragmentInvocations = values[3];
+				statistics.computeInvocations = values[4];
+				timings[i].hasStatistics = true;
+			}
+		}
+	}
+
+	if (history.size() < HISTORY_FRAMES) {
+		history.push_back(timings);
+	} else {
+		history[historyHead] = timings;
+	}
+	historyHead = (historyHead + 1) % HISTORY_FRAMES;
+}
+
+void GpuProfiler::appendTraceEvents(nlohmann::json& events) const {
+	events.push_back({
+		{"name", "thread_name"},
+		{"ph", "M"},
+		{"pid", 0},
+		{"tid", 0},
+		{"args", {{"name", "GPU"}}}
+	});
+
+	double baseUs = static_cast<double>(baseCpuNs) * 1e-3;
+	size_t first = history.size() < HISTORY_FRAMES ? 0 : historyHead;
+	for (size_t i = 0; i < history.size(); ++i) {
+		for (const auto& timing : history[(first + i) % history.size()]) {
+			events.push_back({
+				{"name", timing.name},
+				{"cat", "gpu"},
+				{"ph", "X"},
+				{"pid", 0},
+				{"tid", 0},
+				{"ts", baseUs + timing.beginMs * 1000.0},
+				{"dur", timing.durationMs * 1000.0}
+			});
+		}
+	}
+}
@@ -12,8 +12,31 @@ void GraphicsSystem::init() {
 void GraphicsSystem::createLevelResource(size_t assetCount, size_t pointLightCount, size_t dirLightCount) {
 	vulkanState.createLevelResource(assetCount, pointLightCount, dirLightCount);
 }
-ModelResource GraphicsSystem::createModelResource(std::string textureDir, std::string modelDir, nlohmann::json data) {
-	return vulkanState.createModelResource(textureDir, modelDir, data);
+ModelResource GraphicsSystem::createModelResource(const std::string& textureDir, const std::string& modelDir, const SceneFile::ModelRef& model) {
+	return vulkanState.createModelResource(textureDir, modelDir, model);
+}
+ModelResource GraphicsSystem::requestModelResource(const std::string& textureDir, const std::string& modelDir, const SceneFile::ModelRef& model) {
+	return vulkanState.requestModelResource(textureDir, modelDir, model);
+}
+void GraphicsSystem::updateAssetStreaming() {
+	vulkanState.updateAssetStreaming();
+}
+bool GraphicsSystem::applyResidentModels(std::vector<AssetData>& assets, int64_t* uploadBeginNs) {
+	return vulkanState.applyResidentModels(assets, uploadBeginNs);
+}
+void GraphicsSystem::releaseModelResource(const ModelResource& model) {
+	vulkanState.releaseModelResource(model);
+}
+AssetData GraphicsSystem::requestInstanceGroup(
+	const std::string& textureDir,
+	const std::string& modelDir,
+	const SceneFile::Scene& scene,
+	const SceneFile::InstanceGroup& group
+) {
+	return vulkanState.requestInstanceGroup(textureDir, modelDir, scene, group);
+}
+void GraphicsSystem::releaseInstances(const AssetData& asset) {
+	vulkanState.releaseInstances(asset);
 }
 void GraphicsSystem::updateLights(std::vector<PointLightBuffer>& pointLights, std::vector<DirectionalLightBuffer>& directionalLights) {
 	vulkanState.updateLightSSBO(pointLights, directionalLights);
@@ -7,11 +7,24 @@
 #include "imgui/imgui_impl_vulkan.h"
 #include "imgui/imgui_impl_glfw.h"
 
+#include <algorithm>
+#include <cfloat>
 #include <stdexcept>
 #include <memory>
 #include <vector>
 
 #include "vulkan_types.hpp"
+#include "gpu_profiler.hpp"
+#include "cpu_profiler.hpp"
+#include "frame_telemetry.hpp"
+#include "render_stats.hpp"
+#include "texture_streamer.hpp"
+#include "lod_selector.hpp"
+#include "meshlet_culler.hpp"
+#include "geometry_arena.hpp"
+#include "render_queue.hpp"
+#include "world_streamer.hpp"
+#include "deletion_queue.hpp"
 
 void VulkanGUI::init(
 	GLFWwindow* window,
@@ -73,10 +86,8 @@ void VulkanGUI::createFramebuffer(VkDevice device, Swapchain& swapchain) {
 	}
 }
 
-void VulkanGUI::recreateFramebuffer(VkDevice device, Swapchain& swapchain) {
-	for (auto framebuffer : framebuffers) {
-		vkDestroyFramebuffer(device, framebuffer, nullptr);
-	}
+void VulkanGUI::recreateFramebuffer(VkDevice device, Swapchain& swapchain, DeletionQueue& deletionQueue) {
+	deletionQueue.retireFramebuffers(device, framebuffers);
 	createFramebuffer(device, swapchain);
 }
 
@@ -103,6 +114,24 @@ void VulkanGUI::render(VkCommandBuffer commandBuffer, VkExtent2D swapchainExtent
 		if (ImGui::Combo("Render Pass (R)", &mode, renderModes.data(), renderModes.size(), renderModes.size())) {
 			renderModeChangedCallback();
 		}
+		if (isPixelMode()) {
+			// the G-buffer size depends on the block size, so rebuild the render mode once dragging ends
+			ImGui::SliderInt("Block Size", &pixelBlockSize, 1, 32);
+			if (ImGui::IsItemDeactivatedAfterEdit()) {
+				renderModeChangedCallback();
+			}
+		}
+		if (isForwardMode()) {
+			renderDepthPrepass(swapchainExtent);
+		}
+		renderFrameTelemetry();
+		renderGpuTimings();
+		renderRenderCounters();
+		renderTextureStreaming();
+		renderLevelOfDetail();
+		renderMeshletCulling();
+		renderGeometryArena();
+		renderWorldStreaming();
 		ImGui::Text("Key Configs:");
 		ImGui::Text("Camera: %s", "arrows + Shift");
 		ImGui::Text("Player(if exists): %s", "WASD + Space");
@@ -117,6 +146,257 @@ void VulkanGUI::render(VkCommandBuffer commandBuffer, VkExtent2D swapchainExtent
 	vkCmdEndRenderPass(commandBuffer);
 }
 
+void VulkanGUI::renderGpuTimings() {
+	if (gpuProfiler == nullptr || !gpuProfiler->isEnabled()) {
+		return;
+	}
+	if (ImGui::CollapsingHeader("GPU Timings", ImGuiTreeNodeFlags_DefaultOpen)) {
+		ImGui::Text("GPU frame: %.3f ms", gpuProfiler->getFrameTimeMs());
+		for (const auto& timing : gpuProfiler->getTimings()) {
+			ImGui::Text("%*s%-12s %7.3f ms", static_cast<int>(timing.depth * 2), "", timing.name.c_str(), timing.durationMs);
+			if (timing.hasStatistics) {
+				const auto& statistics = timing.statistics;
+				ImGui::TextDisabled(
+					"  vs %llu  clip %llu/%llu  fs %llu  cs %llu",
+					static_cast<unsigned long long>(statistics.vertexInvocations),
+					static_cast<unsigned long long>(statistics.clippingInvocations),
+					static_cast<unsigned long long>(statistics.clippingPrimitives),
+					static_cast<unsigned long long>(statistics.fragmentInvocations),
+					static_cast<unsigned long long>(statistics.computeInvocations)
+				);
+			}
+		}
+		// CPU zones are empty unless built with RTG_CPU_PROFILER
+		if (ImGui::Button("Dump CPU/GPU Trace")) {
+			CpuProfiler::writeChromeTrace("trace.json", gpuProfiler);
+		}
+	}
+}
+
+void VulkanGUI::renderDepthPrepass(VkExtent2D swapchainExtent) {
+	ImGui::Checkbox("Depth Pre-Pass", &depthPrepass);
+	if (gpuProfiler == nullptr || !gpuProfiler->hasPipelineStatistics()) {
+		return;
+	}
+	// fragment shader runs per pixel of the forward pass, 1 when nothing is shaded twice
+	for (const auto& timing : gpuProfiler->getTimings()) {
+		if (timing.name == "forward" && timing.hasStatistics) {
+			double pixels = static_cast<double>(swapchainExtent.width) * swapchainExtent.height;
+			ImGui::Text("Shaded per pixel: %.2f", static_cast<double>(timing.statistics.fragmentInvocations) / pixels);
+		}
+	}
+}
+
+void VulkanGUI::renderRenderCounters() {
+	if (ImGui::CollapsingHeader("Render Counters")) {
+		if (renderQueue != nullptr) {
+			bool sorted = renderQueue->isEnabled();
+			if (ImGui::Checkbox("Sort draws", &sorted)) {
+				renderQueue->setEnabled(sorted);
+			}
+		}
+		ImGui::Checkbox("Cache command buffers", &cacheCommands);
+		const auto& counters = RenderStats::lastFrame();
+		ImGui::Text("Draw calls:       %llu", static_cast<unsigned long long>(counters.drawCalls));
+		ImGui::Text("Triangles:        %llu", static_cast<unsigned long long>(counters.triangles));
+		ImGui::Text("Instances:        %llu", static_cast<unsigned long long>(counters.instances));
+		ImGui::Text("Descriptor binds: %llu", static_cast<unsigned long long>(counters.descriptorBinds));
+		ImGui::Text("Buffer binds:     %llu", static_cast<unsigned long long>(counters.bufferBinds));
+		ImGui::Text("Pipeline binds:   %llu", static_cast<unsigned long long>(counters.pipelineBinds));
+		ImGui::Text("Barriers:         %llu", static_cast<unsigned long long>(counters.barriers));
+		ImGui::Text("Bytes uploaded:   %llu", static_cast<unsigned long long>(counters.bytesUploaded));
+		ImGui::Text("Allocations:      %llu", static_cast<unsigned long long>(counters.allocations));
+		ImGui::Text("Replayed passes:  %llu", static_cast<unsigned long long>(counters.replays));
+	}
+}
+
+void VulkanGUI::renderTextureStreaming() {
+	if (textureStreamer == nullptr || textureStreamer->getTextures().empty()) {
+		return;
+	}
+	if (ImGui::CollapsingHeader("Texture Streaming")) {
+		const float megabyte = 1024.0f * 1024.0f;
+		float budget = static_cast<float>(textureStreamer->getBudget()) / megabyte;
+		if (ImGui::SliderFloat("Budget (MB)", &budget, 1.0f, 2048.0f, "%.0f", ImGuiSliderFlags_Logarithmic)) {
+			textureStreamer->setBudget(static_cast<size_t>(budget * megabyte));
+		}
+		ImGui::Text("Resident: %.1f MB", static_cast<float>(textureStreamer->getCommittedBytes()) / megabyte);
+		ImGui::Text("Pending uploads: %zu", textureStreamer->getPendingUploadCount());
+		for (const auto& texture : textureStreamer->getTextures()) {
+			const char* name = texture.path.c_str();
+			size_t separator = texture.path.find_last_of('/');
+			if (separator != std::string::npos) {
+				name += separator + 1;
+			}
+			ImGui::TextDisabled(
+				"%-28s mip %u/%u (wants %u)%s",
+				name,
+				texture.residentMip,
+				texture.getLevelCount() - 1,
+				texture.wantedMip,
+				texture.uploading ? " uploading" : ""
+			);
+		}
+	}
+}
+
+void VulkanGUI::renderLevelOfDetail() {
+	if (lodSelector == nullptr) {
+		return;
+	}
+	if (ImGui::CollapsingHeader("Level of Detail")) {
+		float errorPixels = lodSelector->getErrorPixels();
+		if (ImGui::SliderFloat("Error (px)", &errorPixels, 0.1f, 16.0f, "%.1f", ImGuiSliderFlags_Logarithmic)) {
+			lodSelector->setErrorPixels(errorPixels);
+		}
+		float hysteresis = lodSelector->getHysteresis();
+		if (ImGui::SliderFloat("Hysteresis", &hysteresis, 0.0f, 0.9f, "%.2f")) {
+			lodSelector->setHysteresis(hysteresis);
+		}
+		float shadowBias = lodSelector->getShadowBias();
+		if (ImGui::SliderFloat("Shadow bias", &shadowBias, 1.0f, 16.0f, "%.1f", ImGuiSliderFlags_Logarithmic)) {
+			lodSelector->setShadowBias(shadowBias);
+		}
+		const auto& stats = lodSelector->getStats();
+		ImGui::Text("Triangles: %llu of %llu, shadow %llu",
+			static_cast<unsigned long long>(stats.selectedTriangles),
+			static_cast<unsigned long long>(stats.fullTriangles),
+			static_cast<unsigned long long>(stats.shadowTriangles));
+		for (size_t i = 0; i < stats.objectsPerLod.size(); ++i) {
+			ImGui::Text("LOD %zu: %u objects", i, stats.objectsPerLod[i]);
+		}
+	}
+}
+
+void VulkanGUI::renderMeshletCulling() {
+	if (meshletCuller == nullptr) {
+		return;
+	}
+	if (ImGui::CollapsingHeader("Meshlet Culling")) {
+		if (!meshletCuller->isSupported()) {
+			ImGui::Text("Unsupported: no multiDrawIndirect");
+			return;
+		}
+		bool enabled = meshletCuller->isEnabled();
+		if (ImGui::Checkbox("Enabled", &enabled)) {
+			meshletCuller->setEnabled(enabled);
+		}
+		const auto& stats = meshletCuller->getStats();
+		ImGui::Text("Objects: %u", stats.culledObjects);
+		ImGui::Text("Meshlets: %u of %u visible", stats.visibleMeshlets, stats.testedMeshlets);
+		ImGui::Text("Triangles: %llu", static_cast<unsigned long long>(stats.visibleTriangles));
+	}
+}
+
+void VulkanGUI::renderGeometryArena() {
+	if (geometryArena == nullptr) {
+		return;
+	}
+	if (ImGui::CollapsingHeader("Geometry Arena")) {
+		GeometryArena::Stats stats = geometryArena->getStats();
+		ImGui::Text("Blocks: %u", stats.blocks);
+		ImGui::Text("Meshes: %u", stats.allocations);
+		ImGui::Text("Vertices: %llu of %llu", static_cast<unsigned long long>(stats.usedVertices), static_cast<unsigned long long>(stats.vertexCapacity));
+		ImGui::Text("Indices: %llu of %llu", static_cast<unsigned long long>(stats.usedIndices), static_cast<unsigned long long>(stats.indexCapacity));
+	}
+}
+
+void VulkanGUI::renderWorldStreaming() {
+	if (worldStreamer == nullptr || worldStreamer->getCells().empty()) {
+		return;
+	}
+	if (ImGui::CollapsingHeader("World Streaming")) {
+		const float megabyte = 1024.0f * 1024.0f;
+		float budget = static_cast<float>(worldStreamer->getBudget()) / megabyte;
+		if (ImGui::SliderFloat("Cell budget (MB)", &budget, 1.0f, 4096.0f, "%.0f", ImGuiSliderFlags_Logarithmic)) {
+			worldStreamer->setBudget(static_cast<size_t>(budget * megabyte));
+		}
+		float radius = worldStreamer->getLoadRadius();
+		if (ImGui::SliderFloat("Load radius", &radius, worldStreamer->getCellSize(), 1024.0f, "%.0f", ImGuiSliderFlags_Logarithmic)) {
+			worldStreamer->setLoadRadius(radius);
+		}
+		uint32_t loading = 0;
+		uint32_t resident = 0;
+		for (const auto& cell : worldStreamer->getCells()) {
+			loading += cell.state == WorldStreamer::CellState::LOADING ? 1 : 0;
+			resident += cell.state == WorldStreamer::CellState::RESIDENT ? 1 : 0;
+		}
+		ImGui::Text("Cells: %u resident, %u loading, %zu total", resident, loading, worldStreamer->getCells().size());
+		ImGui::Text("Resident: %.1f MB", static_cast<float>(worldStreamer->getCommittedBytes()) / megabyte);
+
+		auto latencyText = [](const char* label, const WorldStreamer::Latency& latency) {
+			ImGui::Text("%-6s last %.2f  mean %.2f  max %.2f ms", label, latency.lastMs, latency.meanMs, latency.maxMs);
+		};
+		latencyText("load", worldStreamer->getLoadLatency());
+		latencyText("upload", worldStreamer->getUploadLatency());
+		latencyText("unload", worldStreamer->getUnloadLatency());
+	}
+}
+
+void VulkanGUI::renderFrameTelemetry() {
+	if (frameTelemetry == nullptr) {
+		return;
+	}
+	if (ImGui::CollapsingHeader("Frame Times")) {
+		const auto& stats = frameTelemetry->getStats();
+		ImGui::Text("p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms", stats.p50Ms, stats.p95Ms, stats.p99Ms, stats.maxMs);
+
+		const auto& frameTimes = frameTelemetry->getFrameTimes();
+		ImGui::PlotLines(
+			"##frameTimes",
+			frameTimes.data(),
+			static_cast<int>(frameTelemetry->getSampleCount()),
+			static_cast<int>(frameTelemetry->getSampleOffset()),
+			nullptr,
+			0.0f,
+			stats.maxMs,
+			ImVec2(0, 60)
+		);
+		ImGui::PlotHistogram(
+			"##histogram",
+			[](void* data, int index) {
+				return static_cast<float>(static_cast<const uint64_t*>(data)[index]);
+			},
+			const_cast<uint64_t*>(frameTelemetry->getHistogram().data()),
+			static_cast<int>(FrameTelemetry::BUCKET_COUNT),
+			0,
+			"run histogram (0.5 ms buckets)",
+			0.0f,
+			FLT_MAX,
+			ImVec2(0, 60)
+		);
+
+		auto& config = frameTelemetry->getStutterConfig();
+		ImGui::SliderFloat("Stutter x median", &config.medianFactor, 1.1f, 5.0f);
+		ImGui::SliderFloat("Stutter min ms", &config.minMs, 0.0f, 50.0f);
+
+		// most recent first
+		uint64_t stutterCount = frameTelemetry->getStutterCount();
+		ImGui::Text("Stutters: %llu", static_cast<unsigned long long>(stutterCount));
+		const auto& stutters = frameTelemetry->getStutters();
+		for (uint64_t i = 0; i < std::min<uint64_t>(stutterCount, 5); ++i) {
+			const auto& stutter = stutters[(stutterCount - 1 - i) % FrameTelemetry::MAX_STUTTERS];
+			// no std::string here, the GUI is part of the zero-allocation frame
+			ImGui::Text(
+				"  #%llu %.2f ms %s%s%s",
+				static_cast<unsigned long long>(stutter.frame),
+				stutter.frameMs,
+				(stutter.subsystems & FrameTelemetry::SWAPCHAIN_RECREATE) ? "swapchain_recreate " : "",
+				(stutter.subsystems & FrameTelemetry::PASS_REBUILD) ? "pass_rebuild " : "",
+				(stutter.subsystems & FrameTelemetry::ASSET_UPLOAD) ? "asset_upload" : ""
+			);
+		}
+
+		if (ImGui::Button("Export CSV")) {
+			frameTelemetry->writeCsv("frame_times.csv");
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Export JSON")) {
+			frameTelemetry->writeJson("frame_times.json");
+		}
+	}
+}
+
 void VulkanGUI::cleanup(VkDevice device) {
 	ImGui_ImplVulkan_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
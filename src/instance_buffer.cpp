@@ -0,0 +1,56 @@
+#include "instance_buffer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "constants.hpp"
+#include "render_stats.hpp"
+#include "vulkan_utils.hpp"
+#include "vulkan_vertex.hpp"
+
+void InstanceBuffer::init(VkPhysicalDevice physicalDevice, VkDevice device) {
+	this->device = device;
+	VkDeviceSize size = sizeof(glm::mat4) * static_cast<VkDeviceSize>(Config::MAX_INSTANCES);
+	VulkanUtils::createBuffer(
+		physicalDevice,
+		device,
+		size,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		buffer,
+		memory,
+		nullptr
+	);
+	vkMapMemory(device, memory, 0, size, 0, reinterpret_cast<void**>(&mapped));
+
+	ranges = RangeAllocator(Config::MAX_INSTANCES);
+	ranges.allocate(1);
+	mapped[IDENTITY] = glm::mat4(1.0f);
+}
+
+void InstanceBuffer::cleanup() {
+	vkUnmapMemory(device, memory);
+	vkDestroyBuffer(device, buffer, nullptr);
+	vkFreeMemory(device, memory, nullptr);
+	mapped = nullptr;
+}
+
+uint32_t InstanceBuffer::allocate(const std::vector<glm::mat4>& transforms) {
+	uint32_t firstInstance = ranges.allocate(static_cast<uint32_t>(transforms.size()));
+	if (firstInstance == RangeAllocator::INVALID) {
+		throw std::runtime_error("failed to allocate instances, Config::MAX_INSTANCES is exhausted");
+	}
+	std::copy(transforms.begin(), transforms.end(), mapped + firstInstance);
+	RenderStats::frame().bytesUploaded += sizeof(glm::mat4) * transforms.size();
+	return firstInstance;
+}
+
+void InstanceBuffer::free(uint32_t firstInstance, uint32_t instanceCount) {
+	ranges.free(firstInstance, instanceCount);
+}
+
+void InstanceBuffer::bind(VkCommandBuffer commandBuffer) const {
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(commandBuffer, PackedVertex::INSTANCE_BINDING, 1, &buffer, &offset);
+	++RenderStats::frame().bufferBinds;
+}
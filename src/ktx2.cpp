@@ -0,0 +1,266 @@
+#include "ktx2.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace Ktx2;
+
+namespace {
+	const uint8_t IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+	const size_t HEADER_SIZE = 80;
+	const size_t LEVEL_INDEX_ENTRY_SIZE = 24;
+
+	// Khronos data format descriptor values
+	const uint8_t DF_MODEL_RGBSDA = 1;
+	const uint8_t DF_MODEL_BC1A = 128;
+	const uint8_t DF_MODEL_BC5 = 132;
+	const uint8_t DF_MODEL_BC7 = 134;
+	const uint8_t DF_PRIMARIES_BT709 = 1;
+	const uint8_t DF_TRANSFER_LINEAR = 1;
+	const uint8_t DF_TRANSFER_SRGB = 2;
+	const uint8_t DF_CHANNEL_ALPHA = 15;
+	const uint8_t DF_SAMPLE_LINEAR = 0x10;
+
+	struct Sample {
+		uint16_t bitOffset;
+		uint8_t bitLength;
+		uint8_t channel;
+		uint32_t upper;
+	};
+
+	bool isSrgb(uint32_t vkFormat) {
+		return vkFormat == FORMAT_R8G8B8A8_SRGB || vkFormat == FORMAT_BC1_RGB_SRGB || vkFormat == FORMAT_BC7_SRGB;
+	}
+
+	template <typename T>
+	void append(std::vector<uint8_t>& bytes, T value) {
+		size_t offset = bytes.size();
+		bytes.resize(offset + sizeof(T));
+		std::memcpy(bytes.data() + offset, &value, sizeof(T));
+	}
+
+	template <typename T>
+	T load(const uint8_t* bytes, size_t offset) {
+		T value;
+		std::memcpy(&value, bytes + offset, sizeof(T));
+		return value;
+	}
+
+	void padTo(std::vector<uint8_t>& bytes, size_t alignment) {
+		bytes.resize((bytes.size() + alignment - 1) / alignment * alignment, 0);
+	}
+
+	std::vector<uint8_t> createDataFormatDescriptor(uint32_t vkFormat) {
+		uint8_t model = DF_MODEL_RGBSDA;
+		uint8_t blockDimension = 0;
+		Sample samples[4] = {};
+		size_t sampleCount = 1;
+		switch (vkFormat) {
+			case FORMAT_BC1_RGB_UNORM:
+			case FORMAT_BC1_RGB_SRGB:
+				model = DF_MODEL_BC1A;
+				blockDimension = 3;
+				samples[0] = {0, 63, 0, 0xFFFFFFFF};
+				break;
+			case FORMAT_BC5_UNORM:
+				model = DF_MODEL_BC5;
+				blockDimension = 3;
+				samples[0] = {0, 63, 0, 0xFFFFFFFF};
+				samples[1] = {64, 63, 1, 0xFFFFFFFF};
+				sampleCount = 2;
+				break;
+			case FORMAT_BC7_UNORM:
+			case FORMAT_BC7_SRGB:
+				model = DF_MODEL_BC7;
+				blockDimension = 3;
+				samples[0] = {0, 127, 0, 0xFFFFFFFF};
+				break;
+			default: {
+				// alpha is never sRGB encoded
+				uint8_t alpha = DF_CHANNEL_ALPHA | (isSrgb(vkFormat) ? DF_SAMPLE_LINEAR : 0);
+				for (uint8_t channel = 0; channel < 4; ++channel) {
+					samples[channel] = {static_cast<uint16_t>(channel * 8), 7, channel == 3 ? alpha : channel, 255};
+				}
+				sampleCount = 4;
+				break;
+			}
+		}
+
+		uint16_t blockSize = static_cast<uint16_t>(24 + 16 * sampleCount);
+		std::vector<uint8_t> dfd;
+		append<uint32_t>(dfd, 4 + blockSize);
+		// vendor id and descriptor type are both zero for the basic block
+		append<uint32_t>(dfd, 0);
+		append<uint16_t>(dfd, 2);
+		append<uint16_t>(dfd, blockSize);
+		dfd.push_back(model);
+		dfd.push_back(DF_PRIMARIES_BT709);
+		dfd.push_back(isSrgb(vkFormat) ? DF_TRANSFER_SRGB : DF_TRANSFER_LINEAR);
+		dfd.push_back(0);
+		dfd.insert(dfd.end(), {blockDimension, blockDimension, 0, 0});
+		uint8_t bytesPlane[8] = {static_cast<uint8_t>(Ktx2::blockSize(vkFormat)), 0, 0, 0, 0, 0, 0, 0};
+		dfd.insert(dfd.end(), std::begin(bytesPlane), std::end(bytesPlane));
+		for (size_t i = 0; i < sampleCount; ++i) {
+			const Sample& sample = samples[i];
+			append<uint16_t>(dfd, sample.bitOffset);
+			dfd.push_back(sample.bitLength);
+			dfd.push_back(sample.channel);
+			append<uint32_t>(dfd, 0);
+			append<uint32_t>(dfd, 0);
+			append<uint32_t>(dfd, sample.upper);
+		}
+		return dfd;
+	}
+}
+
+namespace Ktx2 {
+	uint32_t blockSize(uint32_t vkFormat) {
+		switch (vkFormat) {
+			case FORMAT_R8G8B8A8_UNORM:
+			case FORMAT_R8G8B8A8_SRGB:
+				return 4;
+			case FORMAT_BC1_RGB_UNORM:
+			case FORMAT_BC1_RGB_SRGB:
+				return 8;
+			case FORMAT_BC5_UNORM:
+			case FORMAT_BC7_UNORM:
+			case FORMAT_BC7_SRGB:
+				return 16;
+			default:
+				return 0;
+		}
+	}
+
+	bool isBlockCompressed(uint32_t vkFormat) {
+		return blockSize(vkFormat) >= 8;
+	}
+
+	size_t levelSize(uint32_t vkFormat, uint32_t width, uint32_t height) {
+		if (isBlockCompressed(vkFormat)) {
+			return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockSize(vkFormat);
+		}
+		return static_cast<size_t>(width) * height * blockSize(vkFormat);
+	}
+
+	bool read(const std::string& path, Texture& texture) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			return false;
+		}
+		std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		return parse(bytes.data(), bytes.size(), texture);
+	}
+
+	bool parse(const uint8_t* bytes, size_t byteCount, Texture& texture) {
+		if (byteCount < HEADER_SIZE || std::memcmp(bytes, IDENTIFIER, sizeof(IDENTIFIER)) != 0) {
+			return false;
+		}
+
+		uint32_t vkFormat = load<uint32_t>(bytes, 12);
+		uint32_t width = load<uint32_t>(bytes, 20);
+		uint32_t height = load<uint32_t>(bytes, 24);
+		uint32_t depth = load<uint32_t>(bytes, 28);
+		uint32_t layerCount = load<uint32_t>(bytes, 32);
+		uint32_t faceCount = load<uint32_t>(bytes, 36);
+		uint32_t levelCount = std::max<uint32_t>(load<uint32_t>(bytes, 40), 1);
+		uint32_t supercompression = load<uint32_t>(bytes, 44);
+		if (blockSize(vkFormat) == 0 || width == 0 || height == 0 || depth != 0 || layerCount > 1 || faceCount != 1 || supercompression != 0) {
+			return false;
+		}
+		if (levelCount > 32 || byteCount < HEADER_SIZE + levelCount * LEVEL_INDEX_ENTRY_SIZE) {
+			return false;
+		}
+
+		std::vector<Level> fileLevels(levelCount);
+		size_t begin = byteCount;
+		size_t end = 0;
+		for (uint32_t level = 0; level < levelCount; ++level) {
+			size_t entry = HEADER_SIZE + level * LEVEL_INDEX_ENTRY_SIZE;
+			uint64_t offset = load<uint64_t>(bytes, entry);
+			uint64_t size = load<uint64_t>(bytes, entry + 8);
+			uint32_t levelWidth = std::max<uint32_t>(width >> level, 1);
+			uint32_t levelHeight = std::max<uint32_t>(height >> level, 1);
+			// offset + size could wrap around
+			if (size != levelSize(vkFormat, levelWidth, levelHeight) || offset > byteCount || size > byteCount - offset) {
+				return false;
+			}
+			fileLevels[level] = {static_cast<size_t>(offset), static_cast<size_t>(size)};
+			// the smaller levels come first and don't overlap, streaming relies on it
+			if (level > 0 && fileLevels[level].offset + fileLevels[level].size > fileLevels[level - 1].offset) {
+				return false;
+			}
+			begin = std::min(begin, fileLevels[level].offset);
+			end = std::max(end, fileLevels[level].offset + fileLevels[level].size);
+		}
+
+		// keep only the level payload, offsets become relative to it
+		texture.vkFormat = vkFormat;
+		texture.width = width;
+		texture.height = height;
+		texture.data.assign(bytes + begin, bytes + end);
+		texture.levels = std::move(fileLevels);
+		for (auto& level : texture.levels) {
+			level.offset -= begin;
+		}
+		return true;
+	}
+
+	bool write(const std::string& path, const Texture& texture) {
+		uint32_t levelCount = static_cast<uint32_t>(texture.levels.size());
+		if (blockSize(texture.vkFormat) == 0 || levelCount == 0) {
+			return false;
+		}
+
+		std::vector<uint8_t> dfd = createDataFormatDescriptor(texture.vkFormat);
+		size_t dfdOffset = HEADER_SIZE + levelCount * LEVEL_INDEX_ENTRY_SIZE;
+
+		std::vector<uint8_t> bytes(IDENTIFIER, IDENTIFIER + sizeof(IDENTIFIER));
+		append<uint32_t>(bytes, texture.vkFormat);
+		// typeSize is 1 for both the 8 bit and the block compressed formats
+		append<uint32_t>(bytes, 1);
+		append<uint32_t>(bytes, texture.width);
+		append<uint32_t>(bytes, texture.height);
+		append<uint32_t>(bytes, 0);
+		append<uint32_t>(bytes, 0);
+		append<uint32_t>(bytes, 1);
+		append<uint32_t>(bytes, levelCount);
+		append<uint32_t>(bytes, 0);
+		append<uint32_t>(bytes, static_cast<uint32_t>(dfdOffset));
+		append<uint32_t>(bytes, static_cast<uint32_t>(dfd.size()));
+		append<uint32_t>(bytes, 0);
+		append<uint32_t>(bytes, 0);
+		append<uint64_t>(bytes, 0);
+		append<uint64_t>(bytes, 0);
+
+		// the level index is filled in once the payload offsets are known
+		bytes.resize(dfdOffset, 0);
+		bytes.insert(bytes.end(), dfd.begin(), dfd.end());
+
+		// the spec stores the smallest level first so streaming can start from the tail
+		size_t alignment = std::max<size_t>(blockSize(texture.vkFormat), 4);
+		for (uint32_t level = levelCount; level-- > 0;) {
+			const Level& source = texture.levels[level];
+			if (source.offset + source.size > texture.data.size()) {
+				return false;
+			}
+			padTo(bytes, alignment);
+			uint64_t offset = bytes.size();
+			bytes.insert(bytes.end(), texture.data.begin() + source.offset, texture.data.begin() + source.offset + source.size);
+
+			size_t entry = HEADER_SIZE + level * LEVEL_INDEX_ENTRY_SIZE;
+			uint64_t size = source.size;
+			std::memcpy(bytes.data() + entry, &offset, sizeof(offset));
+			std::memcpy(bytes.data() + entry + 8, &size, sizeof(size));
+			std::memcpy(bytes.data() + entry + 16, &size, sizeof(size));
+		}
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		return file.good();
+	}
+}
@@ -0,0 +1,53 @@
+#include "lod_selector.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "camera.hpp"
+
+void LodSelector::update(std::vector<AssetData>& objects, const Camera& camera, VkExtent2D extent) {
+	stats = Stats{};
+	glm::vec3 cameraPosition = camera.getPosition();
+	// the orthographic projection spans two units vertically at any distance
+	float pixelsPerUnitAtOne = camera.isPerspective()
+		? static_cast<float>(extent.height) / (2.0f * std::tan(camera.getFOV() * 0.5f))
+		: static_cast<float>(extent.height) * 0.5f;
+
+	for (auto& object : objects) {
+		const ModelResource& model = object.resource;
+		if (model.lodCount == 0) {
+			continue;
+		}
+		float pixelsPerUnit = pixelsPerUnitAtOne;
+		if (camera.isPerspective()) {
+			// an instance group shares one LOD, the one its nearest instance could need
+			glm::vec4 sphere = object.getBoundingSphere();
+			float distance = glm::length(glm::vec3(sphere) - cameraPosition);
+			pixelsPerUnit /= std::max(distance - sphere.w, camera.getNearPlane());
+		}
+		if (object.isInstanceGroup()) {
+			// the errors are in object space, the largest instance scale magnifies them the most
+			pixelsPerUnit *= object.instanceScale;
+		}
+		object.lod = select(model, object.lod, pixelsPerUnit, errorPixels);
+		object.shadowLod = select(model, object.shadowLod, pixelsPerUnit, errorPixels * shadowBias);
+
+		stats.fullTriangles += model.lods[0].indexCount / 3 * object.instanceCount;
+		stats.selectedTriangles += model.getLod(object.lod).indexCount / 3 * object.instanceCount;
+		stats.shadowTriangles += model.getLod(object.shadowLod).indexCount / 3 * object.instanceCount;
+		++stats.objectsPerLod[object.lod];
+	}
+}
+
+uint32_t LodSelector::select(const ModelResource& model, uint32_t current, float pixelsPerUnit, float threshold) const {
+	uint32_t lod = 0;
+	for (uint32_t i = 1; i < model.lodCount; ++i) {
+		// errors grow with the LOD, the first one over the threshold ends the search
+		float limit = i > current ? threshold * (1.0f - hysteresis) : threshold;
+		if (model.lods[i].error * pixelsPerUnit > limit) {
+			break;
+		}
+		lod = i;
+	}
+	return lod;
+}
@@ -1,9 +1,16 @@
 #include "rt_graphics_app.hpp"
+#include <cstdlib>
 #include <exception>
 #include <iostream>
+#include <string>
 
-int main() {
+int main(int argc, char** argv) {
 	RTGraphicsApp app;
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (std::string(argv[i]) == "--benchmark") {
+			app.setBenchmarkFrames(static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10)));
+		}
+	}
 	try {
 		app.run();
 	} catch (const std::exception& e) {
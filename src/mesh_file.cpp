@@ -0,0 +1,146 @@
+#include "mesh_file.hpp"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <streambuf>
+
+namespace MeshFile {
+	namespace {
+		const char IDENTIFIER[8] = {'R', 'T', 'G', 'M', 'E', 'S', 'H', 0};
+
+		static_assert(sizeof(Header) == 48, "mesh header layout changed, bump VERSION");
+		static_assert(sizeof(Lod) == 12, "mesh LOD layout changed, bump VERSION");
+		static_assert(sizeof(Meshlet) == 48, "meshlet layout changed, bump VERSION and meshlet_cull.comp");
+		static_assert(sizeof(Vertex) == 44, "mesh vertex layout changed, bump VERSION");
+
+		class MemoryBuffer : public std::streambuf {
+		public:
+			MemoryBuffer(const uint8_t* bytes, size_t size) {
+				char* begin = reinterpret_cast<char*>(const_cast<uint8_t*>(bytes));
+				setg(begin, begin, begin + size);
+			}
+		};
+
+		// the welder compares vertices bytewise, negative zeros are folded so that equal values merge
+		float fold(float value) {
+			return value + 0.0f;
+		}
+	}
+
+	bool loadObj(const uint8_t* bytes, size_t size, Mesh& mesh, std::string& error) {
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string warningMessage, errorMessage;
+
+		// materials come from the scene, mtllib statements are ignored
+		MemoryBuffer buffer(bytes, size);
+		std::istream stream(&buffer);
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warningMessage, &errorMessage, &stream)) {
+			error = warningMessage + errorMessage;
+			return false;
+		}
+
+		size_t indexCount = 0;
+		for (const auto& shape : shapes) {
+			indexCount += shape.mesh.indices.size();
+		}
+		mesh.vertices.reserve(indexCount);
+		mesh.indices.reserve(indexCount);
+		for (const auto& shape : shapes) {
+			for (const auto& index : shape.mesh.indices) {
+				Vertex vertex{};
+				for (int i = 0; i < 3; ++i) {
+					vertex.position[i] = fold(attrib.vertices[3 * index.vertex_index + i]);
+					vertex.normal[i] = fold(attrib.normals[3 * index.normal_index + i]);
+					vertex.color[i] = 1.0f;
+				}
+				vertex.texCoord[0] = fold(attrib.texcoords[2 * index.texcoord_index + 0]);
+				vertex.texCoord[1] = fold(1.0f - attrib.texcoords[2 * index.texcoord_index + 1]);
+
+				mesh.indices.push_back(static_cast<uint32_t>(mesh.vertices.size()));
+				mesh.vertices.push_back(vertex);
+			}
+		}
+		return true;
+	}
+
+	bool parse(const uint8_t* bytes, size_t size, View& view) {
+		if (size < sizeof(Header)) {
+			return false;
+		}
+		Header header;
+		std::memcpy(&header, bytes, sizeof(header));
+		if (std::memcmp(header.identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0 || header.version != VERSION || header.fileSize != size) {
+			return false;
+		}
+		if (header.lodCount == 0 || header.lodCount > MAX_LODS || header.lodOffset % alignof(Lod) != 0
+			|| header.meshletOffset % alignof(Meshlet) != 0 || header.vertexOffset % alignof(Vertex) != 0 || header.indexOffset % alignof(uint32_t) != 0
+			|| static_cast<uint64_t>(header.lodOffset) + static_cast<uint64_t>(header.lodCount) * sizeof(Lod) > size
+			|| static_cast<uint64_t>(header.meshletOffset) + static_cast<uint64_t>(header.meshletCount) * sizeof(Meshlet) > size
+			|| static_cast<uint64_t>(header.vertexOffset) + static_cast<uint64_t>(header.vertexCount) * sizeof(Vertex) > size
+			|| static_cast<uint64_t>(header.indexOffset) + static_cast<uint64_t>(header.indexCount) * sizeof(uint32_t) > size) {
+			return false;
+		}
+		view.vertices = reinterpret_cast<const Vertex*>(bytes + header.vertexOffset);
+		view.vertexCount = header.vertexCount;
+		view.indices = reinterpret_cast<const uint32_t*>(bytes + header.indexOffset);
+		view.indexCount = header.indexCount;
+		view.lods = reinterpret_cast<const Lod*>(bytes + header.lodOffset);
+		view.lodCount = header.lodCount;
+		view.meshlets = reinterpret_cast<const Meshlet*>(bytes + header.meshletOffset);
+		view.meshletCount = header.meshletCount;
+		for (uint32_t i = 0; i < view.indexCount; ++i) {
+			if (view.indices[i] >= view.vertexCount) {
+				return false;
+			}
+		}
+		for (uint32_t i = 0; i < view.lodCount; ++i) {
+			if (static_cast<uint64_t>(view.lods[i].firstIndex) + view.lods[i].indexCount > view.indexCount || view.lods[i].indexCount % 3 != 0) {
+				return false;
+			}
+		}
+		for (uint32_t i = 0; i < view.meshletCount; ++i) {
+			const Meshlet& meshlet = view.meshlets[i];
+			if (static_cast<uint64_t>(meshlet.firstIndex) + meshlet.indexCount > static_cast<uint64_t>(view.lods[0].firstIndex) + view.lods[0].indexCount
+				|| meshlet.firstIndex < view.lods[0].firstIndex || meshlet.indexCount % 3 != 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool write(const std::string& path, const Mesh& mesh) {
+		std::vector<Lod> lods = mesh.lods;
+		if (lods.empty()) {
+			lods.push_back({0, static_cast<uint32_t>(mesh.indices.size()), 0.0f});
+		}
+		Header header{};
+		std::memcpy(header.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+		header.version = VERSION;
+		header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+		header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+		header.lodCount = static_cast<uint32_t>(lods.size());
+		header.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+		header.lodOffset = sizeof(Header);
+		header.meshletOffset = header.lodOffset + header.lodCount * static_cast<uint32_t>(sizeof(Lod));
+		header.vertexOffset = header.meshletOffset + header.meshletCount * static_cast<uint32_t>(sizeof(Meshlet));
+		header.indexOffset = header.vertexOffset + header.vertexCount * static_cast<uint32_t>(sizeof(Vertex));
+		header.fileSize = header.indexOffset + header.indexCount * static_cast<uint32_t>(sizeof(uint32_t));
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(lods.data()), static_cast<std::streamsize>(lods.size() * sizeof(Lod)));
+		file.write(reinterpret_cast<const char*>(mesh.meshlets.data()), static_cast<std::streamsize>(mesh.meshlets.size() * sizeof(Meshlet)));
+		file.write(reinterpret_cast<const char*>(mesh.vertices.data()), static_cast<std::streamsize>(mesh.vertices.size() * sizeof(Vertex)));
+		file.write(reinterpret_cast<const char*>(mesh.indices.data()), static_cast<std::streamsize>(mesh.indices.size() * sizeof(uint32_t)));
+		return file.good();
+	}
+}
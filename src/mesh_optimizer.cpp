@@ -0,0 +1,901 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace MeshOptimizer {
+	namespace {
+		// vertex scoring of Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+		const float CACHE_DECAY_POWER = 1.5f;
+		const float LAST_TRIANGLE_SCORE = 0.75f;
+		const float VALENCE_BOOST_SCALE = 2.0f;
+		const float VALENCE_BOOST_POWER = 0.5f;
+		// valences above it score like it
+		const uint32_t MAX_VALENCE = 32;
+		const uint32_t EMPTY = UINT32_MAX;
+
+		struct ScoreTables {
+			std::array<float, LRU_CACHE_SIZE> cache;
+			std::array<float, MAX_VALENCE + 1> valence;
+		};
+
+		const ScoreTables& getScoreTables() {
+			static const ScoreTables tables = [] {
+				ScoreTables result{};
+				for (uint32_t i = 0; i < LRU_CACHE_SIZE; ++i) {
+					// the last triangle's vertices score the same so that the order within it doesn't matter
+					result.cache[i] = i < 3 ? LAST_TRIANGLE_SCORE
+						: std::pow(1.0f - static_cast<float>(i - 3) / static_cast<float>(LRU_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+				}
+				for (uint32_t i = 1; i <= MAX_VALENCE; ++i) {
+					// vertices with few triangles left go first so they don't end up as lone stragglers
+					result.valence[i] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+				}
+				return result;
+			}();
+			return tables;
+		}
+
+		float vertexScore(int32_t cachePosition, uint32_t valence) {
+			if (valence == 0) {
+				return -1.0f;
+			}
+			const ScoreTables& tables = getScoreTables();
+			float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+			return score + tables.valence[std::min(valence, MAX_VALENCE)];
+		}
+
+		// a FIFO cache simulated with timestamps: a vertex is cached while fewer than size misses followed its own
+		class FifoCache {
+		public:
+			FifoCache(size_t vertexCount, uint32_t size) : timestamps(vertexCount, 0), time(size + 1), size(size) {
+			}
+
+			inline uint32_t access(uint32_t vertex) {
+				if (time - timestamps[vertex] > size) {
+					timestamps[vertex] = time++;
+					return 1;
+				}
+				return 0;
+			}
+			inline uint32_t access(const uint32_t* triangle) {
+				return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+			}
+			inline void flush() {
+				time += size + 1;
+			}
+
+		private:
+			std::vector<uint32_t> timestamps;
+			uint32_t time;
+			uint32_t size;
+		};
+
+		uint64_t hashVertex(const MeshFile::Vertex& vertex) {
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&vertex);
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < sizeof(MeshFile::Vertex); ++i) {
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+			// the table is indexed with the low bits, spread the high ones into them
+			hash ^= hash >> 33;
+			hash *= 0xff51afd7ed558ccdull;
+			hash ^= hash >> 33;
+			return hash;
+		}
+
+		struct Vec3 {
+			float x = 0.0f;
+			float y = 0.0f;
+			float z = 0.0f;
+		};
+
+		inline Vec3 subtract(const float* a, const float* b) {
+			return {a[0] - b[0], a[1] - b[1], a[2] - b[2]};
+		}
+
+		inline Vec3 cross(const Vec3& a, const Vec3& b) {
+			return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+		}
+
+		inline float dot(const Vec3& a, const Vec3& b) {
+			return a.x * b.x + a.y * b.y + a.z * b.z;
+		}
+
+		inline float length(const Vec3& a) {
+			return std::sqrt(dot(a, a));
+		}
+
+		// open edges are held in place by planes this much heavier than the surface
+		const double BORDER_WEIGHT = 10.0;
+
+		// sum of squared distances to weighted planes, divided by the weight it is a mean squared distance
+		struct Quadric {
+			double a2 = 0.0, b2 = 0.0, c2 = 0.0;
+			double ab = 0.0, ac = 0.0, bc = 0.0;
+			double ad = 0.0, bd = 0.0, cd = 0.0;
+			double d2 = 0.0;
+			double weight = 0.0;
+
+			void addPlane(const Vec3& normal, double d, double w) {
+				double a = normal.x, b = normal.y, c = normal.z;
+				a2 += a * a * w; b2 += b * b * w; c2 += c * c * w;
+				ab += a * b * w; ac += a * c * w; bc += b * c * w;
+				ad += a * d * w; bd += b * d * w; cd += c * d * w;
+				d2 += d * d * w;
+				weight += w;
+			}
+
+			void add(const Quadric& other) {
+				a2 += other.a2; b2 += other.b2; c2 += other.c2;
+				ab += other.ab; ac += other.ac; bc += other.bc;
+				ad += other.ad; bd += other.bd; cd += other.cd;
+				d2 += other.d2;
+				weight += other.weight;
+			}
+
+			double evaluate(const float* p) const {
+				double x = p[0], y = p[1], z = p[2];
+				double error = a2 * x * x + b2 * y * y + c2 * z * z
+					+ 2.0 * (ab * x * y + ac * x * z + bc * y * z)
+					+ 2.0 * (ad * x + bd * y + cd * z) + d2;
+				return std::max(error, 0.0);
+			}
+		};
+
+		// the first vertex with the same position for every vertex
+		std::vector<uint32_t> remapPositions(const std::vector<MeshFile::Vertex>& vertices) {
+			size_t vertexCount = vertices.size();
+			std::vector<uint32_t> positionRemap(vertexCount);
+			size_t capacity = 16;
+			while (capacity < vertexCount * 2) {
+				capacity *= 2;
+			}
+			std::vector<uint32_t> table(capacity, EMPTY);
+			for (uint32_t i = 0; i < vertexCount; ++i) {
+				const float* position = vertices[i].position;
+				uint64_t hash = 14695981039346656037ull;
+				const uint8_t* bytes = reinterpret_cast<const uint8_t*>(position);
+				for (size_t b = 0; b < sizeof(float) * 3; ++b) {
+					hash ^= bytes[b];
+					hash *= 1099511628211ull;
+				}
+				hash ^= hash >> 33;
+				size_t slot = static_cast<size_t>(hash) & (capacity - 1);
+				while (table[slot] != EMPTY && std::memcmp(vertices[table[slot]].position, position, sizeof(float) * 3) != 0) {
+					slot = (slot + 1) & (capacity - 1);
+				}
+				if (table[slot] == EMPTY) {
+					table[slot] = i;
+				}
+				positionRemap[i] = table[slot];
+			}
+			return positionRemap;
+		}
+
+		// clusters facing away from the mesh centroid are drawn first, they tend to occlude the rest.
+		// clusters holds the first triangle of each, returns their drawing order
+		std::vector<uint32_t> sortClusters(const std::vector<uint32_t>& indices, const std::vector<MeshFile::Vertex>& vertices, const std::vector<uint32_t>& clusters, size_t triangleCount) {
+			Vec3 meshCentroid;
+			float meshArea = 0.0f;
+			std::vector<Vec3> centroids(clusters.size());
+			std::vector<Vec3> normals(clusters.size());
+			for (size_t c = 0; c < clusters.size(); ++c) {
+				uint32_t begin = clusters[c];
+				uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : static_cast<uint32_t>(triangleCount);
+				float clusterArea = 0.0f;
+				for (uint32_t i = begin; i < end; ++i) {
+					const float* p0 = vertices[indices[i * 3]].position;
+					const float* p1 = vertices[indices[i * 3 + 1]].position;
+					const float* p2 = vertices[indices[i * 3 + 2]].position;
+					Vec3 normal = cross(subtract(p1, p0), subtract(p2, p0));
+					float area = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+					centroids[c].x += (p0[0] + p1[0] + p2[0]) * area;
+					centroids[c].y += (p0[1] + p1[1] + p2[1]) * area;
+					centroids[c].z += (p0[2] + p1[2] + p2[2]) * area;
+					normals[c].x += normal.x;
+					normals[c].y += normal.y;
+					normals[c].z += normal.z;
+					clusterArea += area;
+				}
+				meshCentroid.x += centroids[c].x;
+				meshCentroid.y += centroids[c].y;
+				meshCentroid.z += centroids[c].z;
+				meshArea += clusterArea;
+				float inverse = clusterArea > 0.0f ? 1.0f / (clusterArea * 3.0f) : 0.0f;
+				centroids[c] = {centroids[c].x * inverse, centroids[c].y * inverse, centroids[c].z * inverse};
+			}
+			float inverseMeshArea = meshArea > 0.0f ? 1.0f / (meshArea * 3.0f) : 0.0f;
+			meshCentroid = {meshCentroid.x * inverseMeshArea, meshCentroid.y * inverseMeshArea, meshCentroid.z * inverseMeshArea};
+
+			std::vector<float> keys(clusters.size());
+			for (size_t c = 0; c < clusters.size(); ++c) {
+				const Vec3& normal = normals[c];
+				float length = std::sqrt(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+				float dot = (centroids[c].x - meshCentroid.x) * normal.x + (centroids[c].y - meshCentroid.y) * normal.y + (centroids[c].z - meshCentroid.z) * normal.z;
+				keys[c] = length > 0.0f ? dot / length : 0.0f;
+			}
+			std::vector<uint32_t> order(clusters.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) {
+				return keys[a] > keys[b];
+			});
+			return order;
+		}
+
+		struct Collapse {
+			uint32_t from;
+			uint32_t to;
+			float error;
+		};
+
+		inline uint64_t edgeKey(uint32_t a, uint32_t b) {
+			return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+		}
+
+		// how far apart the shading attributes of two vertices at the same position are
+		inline float attributeDistance(const MeshFile::Vertex& a, const MeshFile::Vertex& b) {
+			float distance = 0.0f;
+			for (int i = 0; i < 3; ++i) {
+				distance += (a.normal[i] - b.normal[i]) * (a.normal[i] - b.normal[i]);
+			}
+			for (int i = 0; i < 2; ++i) {
+				distance += (a.texCoord[i] - b.texCoord[i]) * (a.texCoord[i] - b.texCoord[i]);
+			}
+			return distance;
+		}
+	}
+
+	uint32_t weld(MeshFile::Mesh& mesh) {
+		size_t capacity = 16;
+		while (capacity < mesh.vertices.size() * 2) {
+			capacity *= 2;
+		}
+		// open addressing with linear probing, the slots hold indices into the unique vertices
+		std::vector<uint32_t> table(capacity, EMPTY);
+		std::vector<uint32_t> remap(mesh.vertices.size());
+		std::vector<MeshFile::Vertex> unique;
+		unique.reserve(mesh.vertices.size());
+		for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+			const MeshFile::Vertex& vertex = mesh.vertices[i];
+			size_t slot = static_cast<size_t>(hashVertex(vertex)) & (capacity - 1);
+			while (table[slot] != EMPTY && std::memcmp(&unique[table[slot]], &vertex, sizeof(vertex)) != 0) {
+				slot = (slot + 1) & (capacity - 1);
+			}
+			if (table[slot] == EMPTY) {
+				table[slot] = static_cast<uint32_t>(unique.size());
+				unique.push_back(vertex);
+			}
+			remap[i] = table[slot];
+		}
+		for (auto& index : mesh.indices) {
+			index = remap[index];
+		}
+		uint32_t welded = static_cast<uint32_t>(mesh.vertices.size() - unique.size());
+		mesh.vertices.swap(unique);
+		return welded;
+	}
+
+	void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0) {
+			return;
+		}
+
+		// the triangles around each vertex, emitted ones are swapped out of their vertices' ranges
+		std::vector<uint32_t> valence(vertexCount, 0);
+		for (uint32_t index : indices) {
+			++valence[index];
+		}
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (size_t i = 0; i < vertexCount; ++i) {
+			adjacencyOffsets[i + 1] = adjacencyOffsets[i] + valence[i];
+		}
+		std::vector<uint32_t> adjacency(indices.size());
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i) {
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		std::vector<float> vertexScores(vertexCount);
+		for (size_t i = 0; i < vertexCount; ++i) {
+			vertexScores[i] = vertexScore(-1, valence[i]);
+		}
+		std::vector<float> triangleScores(triangleCount);
+		for (size_t i = 0; i < triangleCount; ++i) {
+			triangleScores[i] = vertexScores[indices[i * 3]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+		}
+		std::vector<uint8_t> emitted(triangleCount, 0);
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		std::array<uint32_t, LRU_CACHE_SIZE + 3> cache;
+		std::array<uint32_t, LRU_CACHE_SIZE + 3> newCache;
+		uint32_t cacheCount = 0;
+		size_t cursor = 0;
+		int64_t best = -1;
+		while (result.size() < indices.size()) {
+			if (best < 0) {
+				// nothing in the cache touches a triangle that is left, continue in input order
+				while (emitted[cursor]) {
+					++cursor;
+				}
+				best = static_cast<int64_t>(cursor);
+			}
+			uint32_t triangle = static_cast<uint32_t>(best);
+			const uint32_t* corners = &indices[triangle * 3];
+			emitted[triangle] = 1;
+
+			// the triangle's vertices move to the front of the cache
+			uint32_t newCount = 0;
+			for (int corner = 0; corner < 3; ++corner) {
+				uint32_t vertex = corners[corner];
+				result.push_back(vertex);
+				uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+				for (uint32_t i = 0; i < valence[vertex]; ++i) {
+					if (begin[i] == triangle) {
+						begin[i] = begin[valence[vertex] - 1];
+						break;
+					}
+				}
+				--valence[vertex];
+				if (std::find(newCache.begin(), newCache.begin() + newCount, vertex) == newCache.begin() + newCount) {
+					newCache[newCount++] = vertex;
+				}
+			}
+			for (uint32_t i = 0; i < cacheCount; ++i) {
+				if (cache[i] != corners[0] && cache[i] != corners[1] && cache[i] != corners[2]) {
+					newCache[newCount++] = cache[i];
+				}
+			}
+
+			// rescore the vertices that moved or fell out, and the triangles left around them
+			for (uint32_t i = 0; i < newCount; ++i) {
+				uint32_t vertex = newCache[i];
+				int32_t position = i < LRU_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+				float score = vertexScore(position, valence[vertex]);
+				float delta = score - vertexScores[vertex];
+				vertexScores[vertex] = score;
+				const uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+				for (uint32_t j = 0; j < valence[vertex]; ++j) {
+					triangleScores[begin[j]] += delta;
+				}
+			}
+			cacheCount = std::min(newCount, LRU_CACHE_SIZE);
+			std::copy(newCache.begin(), newCache.begin() + cacheCount, cache.begin());
+
+			best = -1;
+			float bestScore = -1.0f;
+			for (uint32_t i = 0; i < cacheCount; ++i) {
+				uint32_t vertex = cache[i];
+				const uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+				for (uint32_t j = 0; j < valence[vertex]; ++j) {
+					if (triangleScores[begin[j]] > bestScore) {
+						bestScore = triangleScores[begin[j]];
+						best = begin[j];
+					}
+				}
+			}
+		}
+		indices.swap(result);
+	}
+
+	uint32_t optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<MeshFile::Vertex>& vertices, float threshold) {
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0) {
+			return 0;
+		}
+
+		// hard boundaries where the cache starts over anyway, a triangle of three misses.
+		// the clusters between them are split further while their ACMR stays close to the whole cluster's
+		FifoCache cache(vertices.size(), FIFO_CACHE_SIZE);
+		std::vector<uint32_t> hardBoundaries;
+		for (size_t i = 0; i < triangleCount; ++i) {
+			if (cache.access(&indices[i * 3]) == 3 || i == 0) {
+				hardBoundaries.push_back(static_cast<uint32_t>(i));
+			}
+		}
+		std::vector<uint32_t> clusters;
+		for (size_t c = 0; c < hardBoundaries.size(); ++c) {
+			uint32_t begin = hardBoundaries[c];
+			uint32_t end = c + 1 < hardBoundaries.size() ? hardBoundaries[c + 1] : static_cast<uint32_t>(triangleCount);
+			cache.flush();
+			uint32_t misses = 0;
+			for (uint32_t i = begin; i < end; ++i) {
+				misses += cache.access(&indices[i * 3]);
+			}
+			float clusterThreshold = threshold * static_cast<float>(misses) / static_cast<float>(end - begin);
+
+			clusters.push_back(begin);
+			cache.flush();
+			uint32_t runningMisses = 0;
+			uint32_t runningTriangles = 0;
+			for (uint32_t i = begin; i < end; ++i) {
+				runningMisses += cache.access(&indices[i * 3]);
+				++runningTriangles;
+				if (static_cast<float>(runningMisses) / static_cast<float>(runningTriangles) <= clusterThreshold) {
+					clusters.push_back(i + 1);
+					cache.flush();
+					runningMisses = 0;
+					runningTriangles = 0;
+				}
+			}
+			if (clusters.back() == end) {
+				clusters.pop_back();
+			}
+		}
+
+		std::vector<uint32_t> order = sortClusters(indices, vertices, clusters, triangleCount);
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		for (uint32_t c : order) {
+			uint32_t begin = clusters[c];
+			uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : static_cast<uint32_t>(triangleCount);
+			result.insert(result.end(), indices.begin() + begin * 3, indices.begin() + end * 3);
+		}
+		indices.swap(result);
+		return static_cast<uint32_t>(clusters.size());
+	}
+
+	void optimizeVertexFetch(MeshFile::Mesh& mesh) {
+		std::vector<uint32_t> remap(mesh.vertices.size(), EMPTY);
+		std::vector<MeshFile::Vertex> vertices;
+		vertices.reserve(mesh.vertices.size());
+		for (auto& index : mesh.indices) {
+			if (remap[index] == EMPTY) {
+				remap[index] = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(mesh.vertices[index]);
+			}
+			index = remap[index];
+		}
+		mesh.vertices.swap(vertices);
+	}
+
+	float simplify(std::vector<uint32_t>& indices, const std::vector<MeshFile::Vertex>& vertices, size_t targetIndexCount) {
+		size_t vertexCount = vertices.size();
+		if (indices.size() <= targetIndexCount || vertexCount == 0) {
+			return 0.0f;
+		}
+
+		// topology is that of positions: seams split vertices that share one, collapses move all of them.
+		// the first vertex at a position stands for it, the rest are listed as its siblings
+		std::vector<uint32_t> positionRemap = remapPositions(vertices);
+		std::vector<uint32_t> siblingOffsets(vertexCount + 1, 0);
+		for (uint32_t i = 0; i < vertexCount; ++i) {
+			++siblingOffsets[positionRemap[i] + 1];
+		}
+		std::partial_sum(siblingOffsets.begin(), siblingOffsets.end(), siblingOffsets.begin());
+		std::vector<uint32_t> siblings(vertexCount);
+		std::vector<uint32_t> fill(siblingOffsets.begin(), siblingOffsets.end() - 1);
+		for (uint32_t i = 0; i < vertexCount; ++i) {
+			siblings[fill[positionRemap[i]]++] = i;
+		}
+
+		auto position = [&](uint32_t vertex) {
+			return vertices[vertex].position;
+		};
+		auto corner = [&](size_t triangle, int index) {
+			return positionRemap[indices[triangle * 3 + index]];
+		};
+
+		// quadrics of the input surface, collapsed vertices hand theirs on so the error stays measured against it
+		std::vector<Quadric> quadrics(vertexCount);
+		std::unordered_map<uint64_t, uint32_t> edgeUses;
+		for (size_t t = 0; t < indices.size() / 3; ++t) {
+			for (int k = 0; k < 3; ++k) {
+				++edgeUses[edgeKey(corner(t, k), corner(t, (k + 1) % 3))];
+			}
+		}
+		for (size_t t = 0; t < indices.size() / 3; ++t) {
+			uint32_t c[3] = {corner(t, 0), corner(t, 1), corner(t, 2)};
+			Vec3 normal = cross(subtract(position(c[1]), position(c[0])), subtract(position(c[2]), position(c[0])));
+			float area = length(normal);
+			if (area <= 0.0f) {
+				continue;
+			}
+			normal = {normal.x / area, normal.y / area, normal.z / area};
+			double d = -(normal.x * position(c[0])[0] + normal.y * position(c[0])[1] + normal.z * position(c[0])[2]);
+			for (int k = 0; k < 3; ++k) {
+				quadrics[c[k]].addPlane(normal, d, area * 0.5);
+			}
+			// open edges get a plane through them perpendicular to the triangle, so borders don't shrink
+			for (int k = 0; k < 3; ++k) {
+				uint32_t a = c[k];
+				uint32_t b = c[(k + 1) % 3];
+				if (edgeUses[edgeKey(a, b)] != 1) {
+					continue;
+				}
+				Vec3 edge = subtract(position(b), position(a));
+				Vec3 borderNormal = cross(edge, normal);
+				float edgeLength = length(borderNormal);
+				if (edgeLength <= 0.0f) {
+					continue;
+				}
+				borderNormal = {borderNormal.x / edgeLength, borderNormal.y / edgeLength, borderNormal.z / edgeLength};
+				double borderD = -(borderNormal.x * position(a)[0] + borderNormal.y * position(a)[1] + borderNormal.z * position(a)[2]);
+				double w = static_cast<double>(edgeLength) * edgeLength * BORDER_WEIGHT;
+				quadrics[a].addPlane(borderNormal, borderD, w);
+				quadrics[b].addPlane(borderNormal, borderD, w);
+			}
+		}
+
+		float maxError = 0.0f;
+		std::vector<Collapse> collapses;
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+		std::vector<uint32_t> adjacency;
+		std::vector<uint8_t> locked(vertexCount);
+		std::vector<uint32_t> remap(vertexCount);
+		// each pass collapses the cheapest edges whose neighborhoods don't overlap, then rebuilds the indices
+		while (indices.size() > targetIndexCount) {
+			size_t triangleCount = indices.size() / 3;
+			collapses.clear();
+			for (size_t t = 0; t < triangleCount; ++t) {
+				for (int k = 0; k < 3; ++k) {
+					uint32_t a = corner(t, k);
+					uint32_t b = corner(t, (k + 1) % 3);
+					// interior edges are seen from both of their triangles, once is enough
+					if (a > b && edgeUses[edgeKey(a, b)] > 1) {
+						continue;
+					}
+					Quadric quadric = quadrics[a];
+					quadric.add(quadrics[b]);
+					double weight = std::max(quadric.weight, 1e-12);
+					double toB = quadric.evaluate(position(b)) / weight;
+					double toA = quadric.evaluate(position(a)) / weight;
+					collapses.push_back(toB <= toA ? Collapse{a, b, static_cast<float>(toB)} : Collapse{b, a, static_cast<float>(toA)});
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+				return a.error < b.error;
+			});
+
+			std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+			for (size_t t = 0; t < triangleCount; ++t) {
+				for (int k = 0; k < 3; ++k) {
+					++adjacencyOffsets[corner(t, k) + 1];
+				}
+			}
+			std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+			adjacency.resize(indices.size());
+			fill.assign(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t t = 0; t < triangleCount; ++t) {
+				for (int k = 0; k < 3; ++k) {
+					adjacency[fill[corner(t, k)]++] = static_cast<uint32_t>(t);
+				}
+			}
+
+			std::fill(locked.begin(), locked.end(), 0);
+			std::iota(remap.begin(), remap.end(), 0);
+			size_t removableTriangles = (indices.size() - targetIndexCount + 2) / 3;
+			size_t removedTriangles = 0;
+			uint32_t performed = 0;
+			for (const auto& collapse : collapses) {
+				if (removedTriangles >= removableTriangles) {
+					break;
+				}
+				uint32_t from = collapse.from;
+				uint32_t to = collapse.to;
+				if (from == to || locked[from] || locked[to]) {
+					continue;
+				}
+
+				// the triangles that stay must not flip over
+				bool flips = false;
+				for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1] && !flips; ++i) {
+					uint32_t t = adjacency[i];
+					uint32_t c[3] = {corner(t, 0), corner(t, 1), corner(t, 2)};
+					if (c[0] == to || c[1] == to || c[2] == to) {
+						continue;
+					}
+					Vec3 before = cross(subtract(position(c[1]), position(c[0])), subtract(position(c[2]), position(c[0])));
+					for (auto& v : c) {
+						v = v == from ? to : v;
+					}
+					Vec3 after = cross(subtract(position(c[1]), position(c[0])), subtract(position(c[2]), position(c[0])));
+					flips = dot(before, after) <= 0.0f;
+				}
+				if (flips) {
+					continue;
+				}
+
+				// every vertex at the collapsed position moves onto the one at the target with the closest attributes
+				for (uint32_t i = siblingOffsets[from]; i < siblingOffsets[from + 1]; ++i) {
+					uint32_t vertex = siblings[i];
+					float closest = FLT_MAX;
+					for (uint32_t j = siblingOffsets[to]; j < siblingOffsets[to + 1]; ++j) {
+						float distance = attributeDistance(vertices[vertex], vertices[siblings[j]]);
+						if (distance < closest) {
+							closest = distance;
+							remap[vertex] = siblings[j];
+						}
+					}
+				}
+				for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; ++i) {
+					uint32_t t = adjacency[i];
+					bool degenerates = false;
+					for (int k = 0; k < 3; ++k) {
+						locked[corner(t, k)] = 1;
+						degenerates |= corner(t, k) == to;
+					}
+					removedTriangles += degenerates ? 1 : 0;
+				}
+				locked[to] = 1;
+				quadrics[to].add(quadrics[from]);
+				maxError = std::max(maxError, std::sqrt(collapse.error));
+				++performed;
+			}
+			if (performed == 0) {
+				break;
+			}
+
+			size_t written = 0;
+			for (size_t t = 0; t < triangleCount; ++t) {
+				uint32_t a = remap[indices[t * 3]];
+				uint32_t b = remap[indices[t * 3 + 1]];
+				uint32_t c = remap[indices[t * 3 + 2]];
+				if (positionRemap[a] == positionRemap[b] || positionRemap[b] == positionRemap[c] || positionRemap[c] == positionRemap[a]) {
+					continue;
+				}
+				indices[written++] = a;
+				indices[written++] = b;
+				indices[written++] = c;
+			}
+			indices.resize(written);
+
+			// the edges of the new surface
+			edgeUses.clear();
+			for (size_t t = 0; t < indices.size() / 3; ++t) {
+				for (int k = 0; k < 3; ++k) {
+					++edgeUses[edgeKey(corner(t, k), corner(t, (k + 1) % 3))];
+				}
+			}
+		}
+		return maxError;
+	}
+
+	void generateLods(MeshFile::Mesh& mesh) {
+		uint32_t baseCount = static_cast<uint32_t>(mesh.indices.size());
+		mesh.lods.assign(1, {0, baseCount, 0.0f});
+		// every LOD is simplified from the full mesh, so its error is measured against it
+		std::vector<uint32_t> base(mesh.indices);
+		std::vector<uint32_t> lod;
+		size_t previousCount = baseCount;
+		float error = 0.0f;
+		while (mesh.lods.size() < MeshFile::MAX_LODS) {
+			size_t targetTriangles = static_cast<size_t>(static_cast<float>(previousCount / 3) * LOD_REDUCTION);
+			if (targetTriangles < LOD_MIN_TRIANGLES) {
+				break;
+			}
+			lod = base;
+			float lodError = simplify(lod, mesh.vertices, targetTriangles * 3);
+			if (static_cast<float>(lod.size()) > static_cast<float>(previousCount) * LOD_MIN_REDUCTION) {
+				break;
+			}
+			optimizeVertexCache(lod, mesh.vertices.size());
+			error = std::max(error, lodError);
+			mesh.lods.push_back({static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(lod.size()), error});
+			mesh.indices.insert(mesh.indices.end(), lod.begin(), lod.end());
+			previousCount = lod.size();
+		}
+	}
+
+	void buildMeshlets(MeshFile::Mesh& mesh) {
+		mesh.meshlets.clear();
+		uint32_t first = mesh.lods.empty() ? 0 : mesh.lods[0].firstIndex;
+		uint32_t count = mesh.lods.empty() ? static_cast<uint32_t>(mesh.indices.size()) : mesh.lods[0].indexCount;
+		std::vector<uint32_t> indices(mesh.indices.begin() + first, mesh.indices.begin() + first + count);
+		size_t triangleCount = indices.size() / 3;
+		size_t vertexCount = mesh.vertices.size();
+		auto position = [&](uint32_t vertex) {
+			return mesh.vertices[vertex].position;
+		};
+
+		std::vector<Vec3> faceNormals(triangleCount);
+		for (size_t t = 0; t < triangleCount; ++t) {
+			const float* a = position(indices[t * 3]);
+			Vec3 normal = cross(subtract(position(indices[t * 3 + 1]), a), subtract(position(indices[t * 3 + 2]), a));
+			float area = length(normal);
+			faceNormals[t] = area > 0.0f ? Vec3{normal.x / area, normal.y / area, normal.z / area} : Vec3{};
+		}
+		// triangles are neighbors when they share a position, attribute seams don't split meshlets
+		std::vector<uint32_t> positionRemap = remapPositions(mesh.vertices);
+		std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+		for (uint32_t index : indices) {
+			++adjacencyOffsets[positionRemap[index] + 1];
+		}
+		std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+		std::vector<uint32_t> adjacency(indices.size());
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; ++t) {
+			for (int k = 0; k < 3; ++k) {
+				adjacency[fill[positionRemap[indices[t * 3 + k]]]++] = static_cast<uint32_t>(t);
+			}
+		}
+
+		// grows each meshlet from a seed over the triangles sharing its vertices: fewest new vertices
+		// first, then the normal closest to the meshlet's so its cone stays narrow. seeds follow the
+		// cache order, which keeps neighboring meshlets close
+		std::vector<uint8_t> emitted(triangleCount, 0);
+		// the meshlet a vertex was last counted for
+		std::vector<uint32_t> stamps(vertexCount, EMPTY);
+		std::vector<uint32_t> meshletVertices;
+		std::vector<uint32_t> meshletTriangles;
+		std::vector<uint32_t> order;
+		order.reserve(triangleCount);
+		std::vector<uint32_t> clusters;
+		size_t seed = 0;
+		while (order.size() < triangleCount) {
+			while (emitted[seed]) {
+				++seed;
+			}
+			uint32_t meshletIndex = static_cast<uint32_t>(clusters.size());
+			clusters.push_back(static_cast<uint32_t>(order.size()));
+			meshletVertices.clear();
+			meshletTriangles.clear();
+			Vec3 normalSum{};
+			uint32_t next = static_cast<uint32_t>(seed);
+			while (next != EMPTY) {
+				emitted[next] = 1;
+				meshletTriangles.push_back(next);
+				for (int k = 0; k < 3; ++k) {
+					uint32_t vertex = indices[next * 3 + k];
+					if (stamps[vertex] != meshletIndex) {
+						stamps[vertex] = meshletIndex;
+						meshletVertices.push_back(vertex);
+					}
+				}
+				normalSum = {normalSum.x + faceNormals[next].x, normalSum.y + faceNormals[next].y, normalSum.z + faceNormals[next].z};
+				if (meshletTriangles.size() == MESHLET_MAX_TRIANGLES) {
+					break;
+				}
+
+				float normalLength = length(normalSum);
+				Vec3 meshletNormal = normalLength > 0.0f ? Vec3{normalSum.x / normalLength, normalSum.y / normalLength, normalSum.z / normalLength} : Vec3{};
+				next = EMPTY;
+				uint32_t bestAdded = 4;
+				float bestFacing = -FLT_MAX;
+				for (uint32_t vertex : meshletVertices) {
+					uint32_t canonical = positionRemap[vertex];
+					for (uint32_t i = adjacencyOffsets[canonical]; i < adjacencyOffsets[canonical + 1]; ++i) {
+						uint32_t t = adjacency[i];
+						if (emitted[t]) {
+							continue;
+						}
+						uint32_t added = 0;
+						for (int k = 0; k < 3; ++k) {
+							added += stamps[indices[t * 3 + k]] != meshletIndex ? 1 : 0;
+						}
+						if (meshletVertices.size() + added > MESHLET_MAX_VERTICES) {
+							continue;
+						}
+						float facing = dot(faceNormals[t], meshletNormal);
+						if (added < bestAdded || (added == bestAdded && facing > bestFacing)) {
+							next = t;
+							bestAdded = added;
+							bestFacing = facing;
+						}
+					}
+				}
+			}
+			order.insert(order.end(), meshletTriangles.begin(), meshletTriangles.end());
+		}
+
+		std::vector<uint32_t> grouped(indices.size());
+		for (size_t i = 0; i < order.size(); ++i) {
+			std::copy_n(indices.begin() + order[i] * 3, 3, grouped.begin() + i * 3);
+		}
+		indices.swap(grouped);
+
+		// meshlets take the place of the overdraw clusters, each is ordered for the vertex cache
+		std::vector<uint32_t> meshletOrder = sortClusters(indices, mesh.vertices, clusters, triangleCount);
+		uint32_t written = first;
+		std::vector<uint32_t> local;
+		for (uint32_t c : meshletOrder) {
+			uint32_t begin = clusters[c] * 3;
+			uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] * 3 : static_cast<uint32_t>(indices.size());
+			local.assign(indices.begin() + begin, indices.begin() + end);
+			optimizeVertexCache(local, vertexCount);
+			std::copy(local.begin(), local.end(), mesh.indices.begin() + written);
+
+			MeshFile::Meshlet meshlet{};
+			meshlet.firstIndex = written;
+			meshlet.indexCount = end - begin;
+			written += end - begin;
+
+			// sphere around the center of the bounds
+			float minimum[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+			float maximum[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+			for (uint32_t vertex : local) {
+				if (stamps[vertex] != EMPTY - 1) {
+					stamps[vertex] = EMPTY - 1;
+					++meshlet.vertexCount;
+				}
+				for (int axis = 0; axis < 3; ++axis) {
+					minimum[axis] = std::min(minimum[axis], position(vertex)[axis]);
+					maximum[axis] = std::max(maximum[axis], position(vertex)[axis]);
+				}
+			}
+			for (uint32_t vertex : local) {
+				stamps[vertex] = EMPTY;
+			}
+			for (int axis = 0; axis < 3; ++axis) {
+				meshlet.center[axis] = (minimum[axis] + maximum[axis]) * 0.5f;
+			}
+			for (uint32_t vertex : local) {
+				meshlet.radius = std::max(meshlet.radius, length(subtract(position(vertex), meshlet.center)));
+			}
+
+			// cone around the average face normal, as wide as the normal furthest from it
+			Vec3 axis{};
+			for (uint32_t t = begin / 3; t < end / 3; ++t) {
+				axis = {axis.x + faceNormals[order[t]].x, axis.y + faceNormals[order[t]].y, axis.z + faceNormals[order[t]].z};
+			}
+			float axisLength = length(axis);
+			float minimumDot = axisLength > 0.0f ? 1.0f : -1.0f;
+			if (axisLength > 0.0f) {
+				axis = {axis.x / axisLength, axis.y / axisLength, axis.z / axisLength};
+				for (uint32_t t = begin / 3; t < end / 3; ++t) {
+					const Vec3& normal = faceNormals[order[t]];
+					if (dot(normal, normal) > 0.0f) {
+						minimumDot = std::min(minimumDot, dot(normal, axis));
+					}
+				}
+			}
+			meshlet.coneAxis[0] = axis.x;
+			meshlet.coneAxis[1] = axis.y;
+			meshlet.coneAxis[2] = axis.z;
+			// a cutoff of 1 never culls
+			meshlet.coneCutoff = minimumDot <= MESHLET_MIN_CONE_COSINE ? 1.0f : std::sqrt(1.0f - minimumDot * minimumDot);
+			mesh.meshlets.push_back(meshlet);
+		}
+	}
+
+	float computeAcmr(const std::vector<uint32_t>& indices, uint32_t cacheSize) {
+		size_t triangleCount = indices.size() / 3;
+		if (triangleCount == 0) {
+			return 0.0f;
+		}
+		uint32_t vertexCount = *std::max_element(indices.begin(), indices.end()) + 1;
+		FifoCache cache(vertexCount, cacheSize);
+		uint64_t misses = 0;
+		for (size_t i = 0; i < triangleCount; ++i) {
+			misses += cache.access(&indices[i * 3]);
+		}
+		return static_cast<float>(misses) / static_cast<float>(triangleCount);
+	}
+
+	float computeAtvr(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+		if (vertexCount == 0) {
+			return 0.0f;
+		}
+		return computeAcmr(indices, cacheSize) * static_cast<float>(indices.size() / 3) / static_cast<float>(vertexCount);
+	}
+
+	Stats optimize(MeshFile::Mesh& mesh) {
+		Stats stats;
+		stats.weldedVertices = weld(mesh);
+		stats.acmrBefore = computeAcmr(mesh.indices);
+		stats.atvrBefore = computeAtvr(mesh.indices, mesh.vertices.size());
+		optimizeVertexCache(mesh.indices, mesh.vertices.size());
+		stats.clusters = optimizeOverdraw(mesh.indices, mesh.vertices);
+		generateLods(mesh);
+		buildMeshlets(mesh);
+		// renumbering the vertices for fetch doesn't change the ratios, they are of LOD 0 alone
+		std::vector<uint32_t> lod0(mesh.indices.begin(), mesh.indices.begin() + mesh.lods[0].indexCount);
+		stats.acmrAfter = computeAcmr(lod0);
+		stats.atvrAfter = computeAtvr(lod0, mesh.vertices.size());
+		optimizeVertexFetch(mesh);
+		stats.meshlets = static_cast<uint32_t>(mesh.meshlets.size());
+		stats.lodCount = static_cast<uint32_t>(mesh.lods.size());
+		stats.lodTriangles = mesh.lods.back().indexCount / 3;
+		stats.lodError = mesh.lods.back().error;
+		return stats;
+	}
+}
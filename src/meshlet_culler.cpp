@@ -0,0 +1,408 @@
+#include "meshlet_culler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include "mesh_file.hpp"
+#include "render_stats.hpp"
+#include "vulkan_utils.hpp"
+
+namespace {
+	const uint32_t WORKGROUP_SIZE = 64;
+	const VkDeviceSize DRAW_STRIDE = sizeof(VkDrawIndexedIndirectCommand);
+
+	// Gribb-Hartmann planes of a zero to one depth projection, pointing inwards
+	std::array<glm::vec4, 6> extractPlanes(const glm::mat4& m) {
+		glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+		return {row3 + row0, row3 - row0, row3 + row1, row3 - row1, row2, row3 - row2};
+	}
+
+	void destroyBuffer(VkDevice device, VkBuffer& buffer, VkDeviceMemory& memory) {
+		vkDestroyBuffer(device, buffer, nullptr);
+		vkFreeMemory(device, memory, nullptr);
+		buffer = VK_NULL_HANDLE;
+		memory = VK_NULL_HANDLE;
+	}
+}
+
+void MeshletCuller::init(VkPhysicalDevice physicalDevice, VkDevice device, bool multiDrawIndirect, bool drawIndirectCount) {
+	this->physicalDevice = physicalDevice;
+	this->device = device;
+	this->drawIndirectCount = drawIndirectCount;
+	if (!multiDrawIndirect) {
+		return;
+	}
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	maxDrawCount = properties.limits.maxDrawIndirectCount;
+	createPipeline();
+
+	std::array<VkDescriptorPoolSize, 1> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[0].descriptorCount = Config::MAX_FRAMES_IN_FLIGHT * 2;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = Config::MAX_FRAMES_IN_FLIGHT;
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &framePool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create descriptor pool");
+	}
+
+	std::array<VkDescriptorSetLayout, Config::MAX_FRAMES_IN_FLIGHT> layouts;
+	layouts.fill(frameSetLayout);
+	std::array<VkDescriptorSet, Config::MAX_FRAMES_IN_FLIGHT> sets;
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = framePool;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+	allocInfo.pSetLayouts = layouts.data();
+	if (vkAllocateDescriptorSets(device, &allocInfo, sets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate descriptor set");
+	}
+	for (size_t i = 0; i < frames.size(); ++i) {
+		frames[i].descriptorSet = sets[i];
+	}
+}
+
+void MeshletCuller::cleanup() {
+	for (auto& frame : frames) {
+		destroyBuffer(device, frame.draws, frame.drawsMemory);
+		destroyBuffer(device, frame.counts, frame.countsMemory);
+		frame = FrameBuffers{};
+	}
+	vkDestroyDescriptorPool(device, framePool, nullptr);
+	for (auto pool : modelPools) {
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	}
+	modelPools.clear();
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, frameSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, modelSetLayout, nullptr);
+	pipeline = VK_NULL_HANDLE;
+}
+
+void MeshletCuller::createPipeline() {
+	// set 0 holds the frame's draws and counts, set 1 the meshlets of one model
+	std::array<VkDescriptorSetLayoutBinding, 2> frameBindings{};
+	for (uint32_t binding = 0; binding < frameBindings.size(); ++binding) {
+		frameBindings[binding].binding = binding;
+		frameBindings[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		frameBindings[binding].descriptorCount = 1;
+		frameBindings[binding].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(frameBindings.size());
+	layoutInfo.pBindings = frameBindings.data();
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &frameSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create descriptor set layout");
+	}
+	layoutInfo.bindingCount = 1;
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &modelSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create descriptor set layout");
+	}
+
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(PushConstants);
+
+	std::array<VkDescriptorSetLayout, 2> setLayouts = {frameSetLayout, modelSetLayout};
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline layout");
+	}
+
+	auto computeShaderCode = VulkanUtils::readFile("../shaders/meshlet_cull_comp.spv");
+	VkShaderModule computeShaderModule = VulkanUtils::createShaderModule(device, computeShaderCode);
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = computeShaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = pipelineLayout;
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create compute pipeline");
+	}
+
+	vkDestroyShaderModule(device, computeShaderModule, nullptr);
+}
+
+void MeshletCuller::createModelSet(ModelResource& model) {
+	if (!isSupported() || model.meshletCount == 0) {
+		return;
+	}
+	if (modelPools.empty()) {
+		growModelPool();
+	}
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = modelPools.back();
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &modelSetLayout;
+	VkResult result = vkAllocateDescriptorSets(device, &allocInfo, &model.meshletDescriptorSet);
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+		growModelPool();
+		allocInfo.descriptorPool = modelPools.back();
+		result = vkAllocateDescriptorSets(device, &allocInfo, &model.meshletDescriptorSet);
+	}
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate descriptor set");
+	}
+	model.meshletDescriptorPool = allocInfo.descriptorPool;
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = model.meshletBufferResource.buffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = sizeof(MeshFile::Meshlet) * model.meshletCount;
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = model.meshletDescriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &bufferInfo;
+	vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+}
+
+void MeshletCuller::freeModelSet(ModelResource& model) {
+	if (model.meshletDescriptorSet == VK_NULL_HANDLE) {
+		return;
+	}
+	vkFreeDescriptorSets(device, model.meshletDescriptorPool, 1, &model.meshletDescriptorSet);
+	model.meshletDescriptorSet = VK_NULL_HANDLE;
+	model.meshletDescriptorPool = VK_NULL_HANDLE;
+}
+
+void MeshletCuller::growModelPool() {
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = Config::MODEL_DESCRIPTOR_POOL_GROWTH;
+
+	VkDescriptorPoolCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	createInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+	createInfo.poolSizeCount = 1;
+	createInfo.pPoolSizes = &poolSize;
+	createInfo.maxSets = Config::MODEL_DESCRIPTOR_POOL_GROWTH;
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(device, &createInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create descriptor pool");
+	}
+	modelPools.push_back(pool);
+}
+
+void MeshletCuller::record(
+	VkCommandBuffer commandBuffer,
+	uint32_t currentFrame,
+	const std::vector<AssetData>& objects,
+	const glm::mat4& viewProjection,
+	const glm::vec3& cameraPosition
+) {
+	FrameBuffers& frame = frames[currentFrame];
+	readStats(frame);
+	recorded = false;
+	frame.culledObjects = 0;
+	if (!enabled || !isSupported()) {
+		return;
+	}
+
+	// only the full resolution LOD is split into meshlets. instance groups are drawn whole, the
+	// meshlets of one copy can't stand for the others
+	draws.assign(objects.size(), Draw{0, 0});
+	uint32_t drawCount = 0;
+	uint32_t culledObjects = 0;
+	for (size_t i = 0; i < objects.size(); ++i) {
+		const ModelResource& model = objects[i].resource;
+		if (objects[i].lod != 0 || objects[i].isInstanceGroup() || model.meshletDescriptorSet == VK_NULL_HANDLE || model.meshletCount > maxDrawCount) {
+			continue;
+		}
+		draws[i] = {drawCount, model.meshletCount};
+		drawCount += model.meshletCount;
+		++culledObjects;
+	}
+	if (culledObjects == 0) {
+		return;
+	}
+	// the first count is the visible triangle indices of all objects
+	size_t countCount = objects.size() + 1;
+	reserve(frame, drawCount, countCount);
+	frame.culledObjects = culledObjects;
+	frame.objectCount = static_cast<uint32_t>(objects.size());
+	frame.testedMeshlets = drawCount;
+
+	vkCmdFillBuffer(commandBuffer, frame.counts, 0, sizeof(uint32_t) * countCount, 0);
+	if (!drawIndirectCount) {
+		// without a count buffer every draw of a range is issued, the invisible ones draw nothing
+		vkCmdFillBuffer(commandBuffer, frame.draws, 0, DRAW_STRIDE * drawCount, 0);
+	}
+	VkMemoryBarrier fillBarrier{};
+	fillBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	fillBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	fillBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &fillBarrier, 0, nullptr, 0, nullptr);
+	++RenderStats::frame().barriers;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	++RenderStats::frame().pipelineBinds;
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &frame.descriptorSet, 0, nullptr);
+	++RenderStats::frame().descriptorBinds;
+
+	// the meshlet bounds are in the space of the source mesh, before position quantization
+	std::array<glm::vec4, 6> planes = extractPlanes(viewProjection);
+	for (size_t i = 0; i < objects.size(); ++i) {
+		if (draws[i].count == 0) {
+			continue;
+		}
+		const ModelResource& model = objects[i].resource;
+		glm::mat4 modelMatrix = objects[i].object.getModelMatrix();
+		PushConstants constants{};
+		for (size_t p = 0; p < planes.size(); ++p) {
+			constants.planes[p] = planes[p] * modelMatrix;
+		}
+		constants.cameraPosition = glm::vec3(glm::inverse(modelMatrix) * glm::vec4(cameraPosition, 1.0f));
+		constants.meshletCount = model.meshletCount;
+		constants.drawOffset = draws[i].offset;
+		constants.objectIndex = static_cast<uint32_t>(i);
+		constants.firstIndex = model.geometry.firstIndex;
+		constants.vertexOffset = static_cast<int32_t>(model.geometry.firstVertex);
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 1, 1, &model.meshletDescriptorSet, 0, nullptr);
+		++RenderStats::frame().descriptorBinds;
+		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+		vkCmdDispatch(commandBuffer, (model.meshletCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+	}
+
+	VkMemoryBarrier cullBarrier{};
+	cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+		0,
+		1,
+		&cullBarrier,
+		0,
+		nullptr,
+		0,
+		nullptr
+	);
+	++RenderStats::frame().barriers;
+
+	recorded = true;
+	recordedFrame = currentFrame;
+}
+
+bool MeshletCuller::drawCulled(VkCommandBuffer commandBuffer, uint32_t currentFrame, size_t objectIndex) const {
+	if (!recorded || currentFrame != recordedFrame || objectIndex >= draws.size() || draws[objectIndex].count == 0) {
+		return false;
+	}
+	const FrameBuffers& frame = frames[recordedFrame];
+	const Draw& draw = draws[objectIndex];
+	if (drawIndirectCount) {
+		vkCmdDrawIndexedIndirectCount(
+			commandBuffer,
+			frame.draws,
+			DRAW_STRIDE * draw.offset,
+			frame.counts,
+			sizeof(uint32_t) * (objectIndex + 1),
+			draw.count,
+			static_cast<uint32_t>(DRAW_STRIDE)
+		);
+	} else {
+		vkCmdDrawIndexedIndirect(commandBuffer, frame.draws, DRAW_STRIDE * draw.offset, draw.count, static_cast<uint32_t>(DRAW_STRIDE));
+	}
+	return true;
+}
+
+void MeshletCuller::readStats(const FrameBuffers& frame) {
+	stats = Stats{};
+	if (frame.culledObjects == 0) {
+		return;
+	}
+	const uint32_t* counts = static_cast<const uint32_t*>(frame.countsMapped);
+	stats.culledObjects = frame.culledObjects;
+	stats.testedMeshlets = frame.testedMeshlets;
+	stats.visibleTriangles = counts[0] / 3;
+	for (uint32_t i = 0; i < frame.objectCount; ++i) {
+		stats.visibleMeshlets += counts[i + 1];
+	}
+	// passes can't count the triangles of indirect draws, the frame slot's last frame stands in
+	RenderStats::frame().triangles += stats.visibleTriangles;
+}
+
+// called after the frame's fence wait, the frame's old buffers are idle
+void MeshletCuller::reserve(FrameBuffers& frame, size_t drawCount, size_t countCount) {
+	bool grown = false;
+	if (drawCount > frame.drawCapacity) {
+		destroyBuffer(device, frame.draws, frame.drawsMemory);
+		frame.drawCapacity = std::max(drawCount, frame.drawCapacity * 2);
+		VulkanUtils::createBuffer(
+			physicalDevice,
+			device,
+			DRAW_STRIDE * frame.drawCapacity,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			frame.draws,
+			frame.drawsMemory,
+			nullptr
+		);
+		grown = true;
+	}
+	if (countCount > frame.countCapacity) {
+		destroyBuffer(device, frame.counts, frame.countsMemory);
+		frame.countCapacity = std::max(countCount, frame.countCapacity * 2);
+		VkDeviceSize size = sizeof(uint32_t) * frame.countCapacity;
+		VulkanUtils::createBuffer(
+			physicalDevice,
+			device,
+			size,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.counts,
+			frame.countsMemory,
+			nullptr
+		);
+		vkMapMemory(device, frame.countsMemory, 0, size, 0, &frame.countsMapped);
+		grown = true;
+	}
+	if (!grown) {
+		return;
+	}
+	++reallocations;
+
+	std::array<VkDescriptorBufferInfo, 2> bufferInfos{};
+	bufferInfos[0].buffer = frame.draws;
+	bufferInfos[0].range = VK_WHOLE_SIZE;
+	bufferInfos[1].buffer = frame.counts;
+	bufferInfos[1].range = VK_WHOLE_SIZE;
+
+	std::array<VkWriteDescriptorSet, 2> descriptorWrites{};
+	for (uint32_t binding = 0; binding < descriptorWrites.size(); ++binding) {
+		descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[binding].dstSet = frame.descriptorSet;
+		descriptorWrites[binding].dstBinding = binding;
+		descriptorWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[binding].descriptorCount = 1;
+		descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+	}
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
@@ -13,23 +13,23 @@
 #include "vulkan_types.hpp"
 #include "buffer_types.hpp"
 #include "gui_renderpass.hpp"
+#include "render_stats.hpp"
+#include "deletion_queue.hpp"
 
-struct ResolutionPushConstant{
-	glm::vec2 screenSize;
+struct PixelPushConstant{
+	int blockSize;
 };
 
 void PixelRenderPass::init() {
-	gBuffer->init();
+	gBuffer->init(commandPool);
 	createRenderPass();
-	createFramebuffers();
+	createImageResources();
 	createGraphicsPipeline();
 }
 
 void PixelRenderPass::cleanup() {
+	cleanupImageResources();
 	gBuffer->cleanup();
-	for (auto framebuffer : framebuffers) {
-		vkDestroyFramebuffer(device, framebuffer, nullptr);
-	}
 
 	vkDestroyPipeline(device, pipeline, nullptr);
 	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
@@ -37,15 +37,35 @@ void PixelRenderPass::cleanup() {
 }
 
 void PixelRenderPass::createImageResources() {
-	gBuffer->createImageResources();
+	createGraph();
+	gBuffer->createImageResources(*graph);
 	createFramebuffers();
 }
 
 void PixelRenderPass::cleanupImageResources() {
-	gBuffer->cleanupImageResources();
-	for (auto framebuffer : framebuffers) {
-		vkDestroyFramebuffer(device, framebuffer, nullptr);
-	}
+	gBuffer->cleanupImageResources(*deletionQueue);
+	deletionQueue->retireFramebuffers(device, framebuffers);
+	cleanupGraph();
+}
+
+void PixelRenderPass::resizeFramebuffers() {
+	gBuffer->resizeFramebuffers(*deletionQueue, *graph);
+	deletionQueue->retireFramebuffers(device, framebuffers);
+	createFramebuffers();
+}
+
+void PixelRenderPass::buildGraph(RenderGraph& graph) {
+	gBuffer->declareResources(graph, attachmentExtent);
+
+	auto pass = graph.addPass("pixel", [this](const FrameContext& context) { draw(context); });
+	gBuffer->readGBuffer(pass);
+	pass.write(
+		swapchainImage,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+	);
 }
 
 void PixelRenderPass::createRenderPass() {
@@ -130,10 +150,10 @@ void PixelRenderPass::createGraphicsPipeline() {
 
 	VkPipelineShaderStageCreateInfo shaderStages[] = {vertexShaderStageInfo, fragmentShaderStageInfo};
 
-	VkPushConstantRange resolutionPushConstant{};
-	resolutionPushConstant.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-	resolutionPushConstant.offset = 0;
-	resolutionPushConstant.size = sizeof(ResolutionPushConstant);
+	VkPushConstantRange pixelPushConstant{};
+	pixelPushConstant.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pixelPushConstant.offset = 0;
+	pixelPushConstant.size = sizeof(PixelPushConstant);
 
 	std::array<VkDescriptorSetLayout, 4> layouts{
 		commonDescriptor.cameraMatrix.layout,
@@ -146,7 +166,7 @@ void PixelRenderPass::createGraphicsPipeline() {
 	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layouts.size());
 	pipelineLayoutInfo.pSetLayouts = layouts.data();
 	pipelineLayoutInfo.pushConstantRangeCount = 1;
-	pipelineLayoutInfo.pPushConstantRanges = &resolutionPushConstant;
+	pipelineLayoutInfo.pPushConstantRanges = &pixelPushConstant;
 
 	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create pipeline layout");
@@ -240,23 +260,10 @@ void PixelRenderPass::createGraphicsPipeline() {
 	vkDestroyShaderModule(device, vertexShaderModule, nullptr);
 }
 
-void PixelRenderPass::render(
-	std::vector<VkCommandBuffer>& commandBuffers,
-	uint32_t imageIndex,
-	uint32_t currentFrame,
-	std::vector<void*>& modelMatrixBuffersMapped,
-	const std::vector<AssetData>& models,
-	const Camera& camera,
-	const std::vector<DirectionalLightBuffer>& directionalLights,
-	GLFWwindow* window
-) {
-	gBuffer->generateGBuffer(
-		commandBuffers,
-		imageIndex,
-		currentFrame,
-		modelMatrixBuffersMapped,
-		models
-	);
+void PixelRenderPass::draw(const FrameContext& context) {
+	std::vector<VkCommandBuffer>& commandBuffers = *context.commandBuffers;
+	uint32_t imageIndex = context.imageIndex;
+	uint32_t currentFrame = context.currentFrame;
 
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -289,6 +296,7 @@ void PixelRenderPass::render(
 		vkCmdSetScissor(commandBuffers[currentFrame], 0, 1, &scissor);
 
 		vkCmdBindPipeline(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		++RenderStats::frame().pipelineBinds;
 
 		vkCmdBindDescriptorSets(
 			commandBuffers[currentFrame],
@@ -300,6 +308,7 @@ void PixelRenderPass::render(
 			0,
 			nullptr
 		);
+		++RenderStats::frame().descriptorBinds;
 		vkCmdBindDescriptorSets(
 			commandBuffers[currentFrame],
 			VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -310,6 +319,7 @@ void PixelRenderPass::render(
 			0,
 			nullptr
 		);
+		++RenderStats::frame().descriptorBinds;
 		vkCmdBindDescriptorSets(
 			commandBuffers[currentFrame],
 			VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -320,6 +330,7 @@ void PixelRenderPass::render(
 			0,
 			nullptr
 		);
+		++RenderStats::frame().descriptorBinds;
 		vkCmdBindDescriptorSets(
 			commandBuffers[currentFrame],
 			VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -330,20 +341,22 @@ void PixelRenderPass::render(
 			0,
 			nullptr
 		);
+		++RenderStats::frame().descriptorBinds;
 
-		ResolutionPushConstant pushConstant;
-		pushConstant.screenSize = glm::vec2(swapchain.extent.width, swapchain.extent.height);
+		PixelPushConstant pushConstant;
+		pushConstant.blockSize = static_cast<int>(blockSize);
 		vkCmdPushConstants(
 			commandBuffers[currentFrame],
 			pipelineLayout,
 			VK_SHADER_STAGE_FRAGMENT_BIT,
 			0,
-			sizeof(ResolutionPushConstant),
+			sizeof(PixelPushConstant),
 			&pushConstant
 		);
 
 
 		vkCmdDraw(commandBuffers[currentFrame], 4, 1, 0, 0);
+		++RenderStats::frame().drawCalls;
 
 	} vkCmdEndRenderPass(commandBuffers[currentFrame]);
 }
\ No newline at end of file
@@ -10,6 +10,7 @@
 
 #include "vulkan_utils.hpp"
 #include "constants.hpp"
+#include "render_stats.hpp"
 
 struct PushConstants{
 	glm::vec2 windowSize;
@@ -66,6 +67,7 @@ void RayTracingPipeline::render(
 	VkExtent2D extent
 ) {
 	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, pipeline);
+	++RenderStats::frame().pipelineBinds;
 
 	vkCmdBindDescriptorSets(
 		commandBuffer,
@@ -77,6 +79,7 @@ void RayTracingPipeline::render(
 		0,
 		nullptr
 	);
+	++RenderStats::frame().descriptorBinds;
 	vkCmdBindDescriptorSets(
 		commandBuffer,
 		VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR,
@@ -87,6 +90,7 @@ void RayTracingPipeline::render(
 		0,
 		nullptr
 	);
+	++RenderStats::frame().descriptorBinds;
 	vkCmdBindDescriptorSets(
 		commandBuffer,
 		VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR,
@@ -97,6 +101,7 @@ void RayTracingPipeline::render(
 		0,
 		nullptr
 	);
+	++RenderStats::frame().descriptorBinds;
 	vkCmdBindDescriptorSets(
 		commandBuffer,
 		VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR,
@@ -107,6 +112,7 @@ void RayTracingPipeline::render(
 		0,
 		nullptr
 	);
+	++RenderStats::frame().descriptorBinds;
 	vkCmdBindDescriptorSets(
 		commandBuffer,
 		VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR,
@@ -117,6 +123,7 @@ void RayTracingPipeline::render(
 		0,
 		nullptr
 	);
+	++RenderStats::frame().descriptorBinds;
 
 	PushConstants pushConstants{};
 	pushConstants.windowSize = glm::vec2(extent.width, extent.height);
@@ -141,6 +148,7 @@ void RayTracingPipeline::render(
 		extent.height,
 		1
 	);
+	++RenderStats::frame().drawCalls;
 }
 
 void RayTracingPipeline::getRayTracingProperties() {
@@ -193,6 +201,7 @@ void RayTracingPipeline::createBLAS() {
 
 	vkMapMemory(device, aabbBufferResource.buffersMemory[0], 0, aabbBufferSize, 0, &aabbBufferResource.buffersMapped[0]);
 	memcpy(aabbBufferResource.buffersMapped[0], &aabb, static_cast<size_t>(aabbBufferSize));
+	RenderStats::frame().bytesUploaded += aabbBufferSize;
 	vkUnmapMemory(device, aabbBufferResource.buffersMemory[0]);
 
 	VkBufferDeviceAddressInfo bufferDeviceAddressInfo{};
@@ -335,6 +344,7 @@ void RayTracingPipeline::createTLAS() {
 
     vkMapMemory(device, instanceBufferResource.buffersMemory[0], 0, instanceBufferSize, 0, &instanceBufferResource.buffersMapped[0]);
 	memcpy(instanceBufferResource.buffersMapped[0], instances.data(), static_cast<size_t>(instanceBufferSize));
+	RenderStats::frame().bytesUploaded += instanceBufferSize;
 
 	VkBufferDeviceAddressInfo instanceBufferAddressInfo{};
     instanceBufferAddressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
@@ -487,16 +497,19 @@ void RayTracingPipeline::createSBT() {
 
 	pData = pSBTBuffer;
 	memcpy(pData, getHandle(handleIdx++), handleSize);
+	RenderStats::frame().bytesUploaded += handleSize;
 
 	pData = pSBTBuffer + raygenSBT.size;
 	for(uint32_t c = 0; c < missCount; c++) {
 		memcpy(pData, getHandle(handleIdx++), handleSize);
+		RenderStats::frame().bytesUploaded += handleSize;
 		pData += missSBT.stride;
 	}
 
 	pData = pSBTBuffer + raygenSBT.size + missSBT.size;
 	for(uint32_t c = 0; c < hitCount; c++) {
 		memcpy(pData, getHandle(handleIdx++), handleSize);
+		RenderStats::frame().bytesUploaded += handleSize;
 		pData += hitSBT.stride;
 	}
 
@@ -518,6 +531,7 @@ void RayTracingPipeline::createSphereSSBO() {
 	);
 	vkMapMemory(device, sphereBufferResource.buffersMemory[0], 0, size, 0, &sphereBufferResource.buffersMapped[0]);
 	memcpy(sphereBufferResource.buffersMapped[0], spheres.data(), static_cast<size_t>(size));
+	RenderStats::frame().bytesUploaded += size;
 }
 
 void RayTracingPipeline::createDescriptorPool() {
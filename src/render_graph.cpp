@@ -0,0 +1,476 @@
+#include "render_graph.hpp"
+
+#include <vulkan/vulkan.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "vulkan_utils.hpp"
+#include "gpu_profiler.hpp"
+#include "cpu_profiler.hpp"
+#include "frame_arena.hpp"
+#include "render_stats.hpp"
+
+namespace {
+	const VkAccessFlags WRITE_ACCESS_MASK =
+		VK_ACCESS_SHADER_WRITE_BIT |
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_TRANSFER_WRITE_BIT |
+		VK_ACCESS_HOST_WRITE_BIT |
+		VK_ACCESS_MEMORY_WRITE_BIT;
+
+	const VkImageUsageFlags ATTACHMENT_USAGE_MASK =
+		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+		VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+	bool findLazyMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, uint32_t& typeIndex) {
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+		VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i) {
+			if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				typeIndex = i;
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(
+	RenderGraphResource resource,
+	VkImageLayout layout,
+	VkPipelineStageFlags stage,
+	VkAccessFlags access
+) {
+	graph.passes[index].accesses.push_back(Access{resource, layout, VK_IMAGE_LAYOUT_UNDEFINED, stage, access, false});
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::write(
+	RenderGraphResource resource,
+	VkImageLayout layout,
+	VkImageLayout finalLayout,
+	VkPipelineStageFlags stage,
+	VkAccessFlags access
+) {
+	graph.passes[index].accesses.push_back(Access{resource, layout, finalLayout, stage, access, true});
+	return *this;
+}
+
+RenderGraphResource RenderGraph::createImage(const std::string& name, const RenderGraphImageDesc& desc) {
+	Resource resource{};
+	resource.name = name;
+	resource.desc = desc;
+	resources.push_back(resource);
+	return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::importImage(
+	const std::string& name,
+	VkImage image,
+	VkImageAspectFlags aspect,
+	VkImageLayout initialLayout,
+	bool persistent
+) {
+	Resource resource{};
+	resource.name = name;
+	resource.desc.aspect = aspect;
+	resource.image.image = image;
+	resource.imported = true;
+	resource.persistent = persistent;
+	resource.initialLayout = initialLayout;
+	resource.state.layout = initialLayout;
+	resources.push_back(resource);
+	return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+void RenderGraph::setImportedImage(RenderGraphResource resource, VkImage image) {
+	resources[resource].image.image = image;
+}
+
+void RenderGraph::setOutput(RenderGraphResource resource) {
+	resources[resource].output = true;
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(const std::string& name, RecordFunc record) {
+	Pass pass{};
+	pass.name = name;
+	pass.profileName = CpuProfiler::intern(name);
+	pass.record = std::move(record);
+	passes.push_back(std::move(pass));
+	return PassBuilder(*this, passes.size() - 1);
+}
+
+void RenderGraph::compile() {
+	if (compiled) {
+		throw std::runtime_error("render graph is already compiled");
+	}
+	cullPasses();
+	computeLifetimes();
+	allocateTransientImages();
+	compiled = true;
+}
+
+void RenderGraph::cullPasses() {
+	std::vector<uint32_t> readerCounts(resources.size(), 0);
+	std::vector<std::vector<size_t>> writers(resources.size());
+
+	for (size_t i = 0; i < passes.size(); ++i) {
+		passes[i].refCount = 0;
+		passes[i].culled = false;
+		for (const auto& access : passes[i].accesses) {
+			if (access.write) {
+				++passes[i].refCount;
+				writers[access.resource].push_back(i);
+			} else {
+				++readerCounts[access.resource];
+			}
+		}
+	}
+
+	// a pass survives only if something it writes is read later or leaves the graph
+	std::vector<RenderGraphResource> unreferenced;
+	auto cull = [&](Pass& pass) {
+		pass.culled = true;
+		for (const auto& access : pass.accesses) {
+			if (!access.write && --readerCounts[access.resource] == 0 && !resources[access.resource].output) {
+				unreferenced.push_back(access.resource);
+			}
+		}
+	};
+
+	for (auto& pass : passes) {
+		if (pass.refCount == 0) {
+			cull(pass);
+		}
+	}
+	for (size_t i = 0; i < resources.size(); ++i) {
+		if (readerCounts[i] == 0 && !resources[i].output) {
+			unreferenced.push_back(static_cast<RenderGraphResource>(i));
+		}
+	}
+
+	while (!unreferenced.empty()) {
+		RenderGraphResource resource = unreferenced.back();
+		unreferenced.pop_back();
+		for (size_t passIndex : writers[resource]) {
+			Pass& pass = passes[passIndex];
+			if (pass.culled || --pass.refCount > 0) {
+				continue;
+			}
+			cull(pass);
+		}
+	}
+}
+
+void RenderGraph::computeLifetimes() {
+	for (size_t i = 0; i < passes.size(); ++i) {
+		if (passes[i].culled) {
+			continue;
+		}
+		for (const auto& access : passes[i].accesses) {
+			Resource& resource = resources[access.resource];
+			if (resource.firstPass < 0) {
+				if (!resource.imported && !access.write) {
+					throw std::runtime_error("render graph reads " + resource.name + " before it is written");
+				}
+				resource.firstPass = static_cast<int>(i);
+			}
+			resource.lastPass = static_cast<int>(i);
+		}
+	}
+}
+
+void RenderGraph::allocateTransientImages() {
+	std::vector<RenderGraphResource> aliasCandidates;
+
+	for (size_t i = 0; i < resources.size(); ++i) {
+		Resource& resource = resources[i];
+		if (resource.imported || resource.firstPass < 0) {
+			continue;
+		}
+
+		// attachments that never leave their pass don't need backing memory on tilers
+		VkImageUsageFlags usage = resource.desc.usage;
+		bool passLocal = resource.firstPass == resource.lastPass && (usage & ~ATTACHMENT_USAGE_MASK) == 0;
+		if (passLocal) {
+			usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		}
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = resource.desc.width;
+		imageInfo.extent.height = resource.desc.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = resource.desc.format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = usage;
+		imageInfo.samples = resource.desc.samples;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateImage(device, &imageInfo, nullptr, &resource.image.image) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create render graph image " + resource.name);
+		}
+		vkGetImageMemoryRequirements(device, resource.image.image, &resource.memoryRequirements);
+		requestedMemorySize += resource.memoryRequirements.size;
+
+		uint32_t lazyTypeIndex = 0;
+		if (passLocal && findLazyMemoryType(physicalDevice, resource.memoryRequirements.memoryTypeBits, lazyTypeIndex)) {
+			VkMemoryAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocInfo.allocationSize = resource.memoryRequirements.size;
+			allocInfo.memoryTypeIndex = lazyTypeIndex;
+
+			if (vkAllocateMemory(device, &allocInfo, nullptr, &resource.image.imageMemory) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate render graph image memory");
+			}
+			++RenderStats::frame().allocations;
+			vkBindImageMemory(device, resource.image.image, resource.image.imageMemory, 0);
+			allocatedMemorySize += resource.memoryRequirements.size;
+			continue;
+		}
+		aliasCandidates.push_back(static_cast<RenderGraphResource>(i));
+	}
+
+	// greedy first-fit, largest images first
+	std::sort(aliasCandidates.begin(), aliasCandidates.end(), [this](RenderGraphResource a, RenderGraphResource b) {
+		return resources[a].memoryRequirements.size > resources[b].memoryRequirements.size;
+	});
+
+	for (RenderGraphResource candidate : aliasCandidates) {
+		Resource& resource = resources[candidate];
+		uint32_t memoryTypeIndex = VulkanUtils::findMemoryType(
+			physicalDevice,
+			resource.memoryRequirements.memoryTypeBits,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+		);
+
+		int blockIndex = -1;
+		for (size_t i = 0; i < memoryBlocks.size() && blockIndex < 0; ++i) {
+			if (memoryBlocks[i].memoryTypeIndex != memoryTypeIndex) {
+				continue;
+			}
+			bool overlaps = false;
+			for (RenderGraphResource occupant : memoryBlocks[i].resources) {
+				const Resource& other = resources[occupant];
+				if (resource.firstPass <= other.lastPass && other.firstPass <= resource.lastPass) {
+					overlaps = true;
+					break;
+				}
+			}
+			if (!overlaps) {
+				blockIndex = static_cast<int>(i);
+			}
+		}
+
+		if (blockIndex < 0) {
+			MemoryBlock block{};
+			block.memoryTypeIndex = memoryTypeIndex;
+			memoryBlocks.push_back(block);
+			blockIndex = static_cast<int>(memoryBlocks.size() - 1);
+		}
+
+		MemoryBlock& block = memoryBlocks[blockIndex];
+		block.size = std::max(block.size, resource.memoryRequirements.size);
+		block.resources.push_back(candidate);
+		resource.memoryBlock = blockIndex;
+	}
+
+	for (auto& block : memoryBlocks) {
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = block.size;
+		allocInfo.memoryTypeIndex = block.memoryTypeIndex;
+
+		if (vkAllocateMemory(device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate render graph memory");
+		}
+		++RenderStats::frame().allocations;
+		allocatedMemorySize += block.size;
+
+		for (RenderGraphResource occupant : block.resources) {
+			vkBindImageMemory(device, resources[occupant].image.image, block.memory, 0);
+		}
+	}
+
+	for (auto& resource : resources) {
+		if (resource.imported || resource.image.image == VK_NULL_HANDLE) {
+			continue;
+		}
+		resource.image.imageView = VulkanUtils::createImageView(
+			device,
+			resource.image.image,
+			resource.desc.format,
+			resource.desc.aspect,
+			1
+		);
+	}
+}
+
+void RenderGraph::syncAccess(const Access& access, Resource& resource) {
+	ResourceState previous = resource.state;
+	MemoryBlock* block = resource.memoryBlock >= 0 ? &memoryBlocks[resource.memoryBlock] : nullptr;
+	bool firstUse = resource.pendingFirstUse;
+
+	// transient contents never outlive a frame, so sync against whoever touched the memory last
+	if (firstUse) {
+		previous.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		if (block != nullptr) {
+			previous.stage = block->state.stage;
+			previous.access = block->state.access;
+		}
+	}
+
+	bool previousWrite = (previous.access & WRITE_ACCESS_MASK) != 0;
+	bool transition = access.layout != VK_IMAGE_LAYOUT_UNDEFINED && access.layout != previous.layout;
+	bool hazard = previous.stage != 0 && (previousWrite || access.write);
+
+	if (transition || hazard) {
+		srcStageMask |= previous.stage;
+		dstStageMask |= access.stage;
+
+		if (access.layout == VK_IMAGE_LAYOUT_UNDEFINED) {
+			// the pass's render pass owns the layout, only order the memory accesses
+			if (previousWrite) {
+				srcAccessMask |= previous.access & WRITE_ACCESS_MASK;
+				dstAccessMask |= access.access;
+			}
+		} else {
+			VkImageMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.oldLayout = access.write ? VK_IMAGE_LAYOUT_UNDEFINED : previous.layout;
+			barrier.newLayout = access.layout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = resource.image.image;
+			barrier.subresourceRange.aspectMask = resource.desc.aspect;
+			barrier.subresourceRange.baseMipLevel = 0;
+			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.baseArrayLayer = 0;
+			barrier.subresourceRange.layerCount = 1;
+			barrier.srcAccessMask = previous.access & WRITE_ACCESS_MASK;
+			barrier.dstAccessMask = access.access;
+			imageBarriers[imageBarrierCount++] = barrier;
+		}
+	}
+
+	VkImageLayout layout = access.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED ? access.finalLayout : access.layout;
+	if (!access.write && !previousWrite && !transition) {
+		// concurrent readers, a later writer has to wait for all of them
+		resource.state.stage |= access.stage;
+		resource.state.access |= access.access;
+	} else {
+		resource.state = ResourceState{layout, access.stage, access.access};
+	}
+	resource.pendingFirstUse = false;
+
+	if (block != nullptr) {
+		if (firstUse) {
+			block->state = ResourceState{};
+		}
+		block->state.stage |= access.stage;
+		block->state.access |= access.access;
+	}
+}
+
+void RenderGraph::execute(const FrameContext& context) {
+	if (!compiled) {
+		throw std::runtime_error("render graph executed before compile");
+	}
+
+	for (auto& resource : resources) {
+		if (!resource.imported) {
+			resource.pendingFirstUse = true;
+		} else if (!resource.persistent) {
+			resource.state = ResourceState{resource.initialLayout, 0, 0};
+		}
+	}
+
+	VkCommandBuffer commandBuffer = context.commandBuffer();
+	for (auto& pass : passes) {
+		if (pass.culled) {
+			continue;
+		}
+		// barriers are included so that stalls show up on the waiting pass
+		PROFILE_ZONE(pass.profileName);
+		GpuProfileScope scope(context.profiler, commandBuffer, pass.name);
+
+		imageBarriers = context.arena->allocate<VkImageMemoryBarrier>(pass.accesses.size());
+		imageBarrierCount = 0;
+		srcStageMask = 0;
+		dstStageMask = 0;
+		srcAccessMask = 0;
+		dstAccessMask = 0;
+		for (const auto& access : pass.accesses) {
+			syncAccess(access, resources[access.resource]);
+		}
+
+		// one batched barrier per pass
+		if (dstStageMask != 0) {
+			VkMemoryBarrier memoryBarrier{};
+			memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			memoryBarrier.srcAccessMask = srcAccessMask;
+			memoryBarrier.dstAccessMask = dstAccessMask;
+			uint32_t memoryBarrierCount = (srcAccessMask != 0 || dstAccessMask != 0) ? 1 : 0;
+
+			vkCmdPipelineBarrier(
+				commandBuffer,
+				srcStageMask != 0 ? srcStageMask : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+				dstStageMask,
+				0,
+				memoryBarrierCount, &memoryBarrier,
+				0, nullptr,
+				imageBarrierCount, imageBarriers
+			);
+			++RenderStats::frame().barriers;
+		}
+
+		pass.record(context);
+	}
+}
+
+void RenderGraph::cleanup() {
+	for (auto& resource : resources) {
+		if (resource.imported || resource.image.image == VK_NULL_HANDLE) {
+			continue;
+		}
+		vkDestroyImageView(device, resource.image.imageView, nullptr);
+		vkDestroyImage(device, resource.image.image, nullptr);
+		if (resource.image.imageMemory != VK_NULL_HANDLE) {
+			vkFreeMemory(device, resource.image.imageMemory, nullptr);
+		}
+	}
+	for (auto& block : memoryBlocks) {
+		vkFreeMemory(device, block.memory, nullptr);
+	}
+
+	resources.clear();
+	passes.clear();
+	memoryBlocks.clear();
+	allocatedMemorySize = 0;
+	requestedMemorySize = 0;
+	compiled = false;
+}
+
+const ImageResource& RenderGraph::getImage(RenderGraphResource resource) const {
+	return resources[resource].image;
+}
+
+bool RenderGraph::isPassCulled(const std::string& name) const {
+	for (const auto& pass : passes) {
+		if (pass.name == name) {
+			return pass.culled;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,97 @@
+#include "render_queue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "cpu_profiler.hpp"
+
+void RenderQueue::build(const std::vector<AssetData>& objects, const glm::vec3& cameraPosition, const glm::vec3& cameraFront) {
+	PROFILE_ZONE("render queue");
+	order.resize(objects.size());
+	if (!enabled) {
+		for (uint32_t i = 0; i < order.size(); ++i) {
+			order[i] = i;
+		}
+		sign(objects);
+		return;
+	}
+
+	entries.resize(objects.size());
+	for (uint32_t i = 0; i < objects.size(); ++i) {
+		const AssetData& object = objects[i];
+		// objects behind the camera sort first, they're culled by the rasterizer anyway
+		float depth = glm::dot(glm::vec3(object.getBoundingSphere()) - cameraPosition, cameraFront);
+		entries[i] = {makeKey(object.resource.geometry.block, object.resource.sortId, depth), i};
+	}
+	sort();
+	for (size_t i = 0; i < entries.size(); ++i) {
+		order[i] = entries[i].index;
+	}
+	sign(objects);
+}
+
+uint64_t RenderQueue::makeKey(uint32_t block, uint32_t model, float depth) {
+	// non-negative floats order like their bits
+	depth = std::max(depth, 0.0f);
+	uint32_t depthBits;
+	std::memcpy(&depthBits, &depth, sizeof(depthBits));
+	return static_cast<uint64_t>(std::min(block, 0xFFu)) << 56
+		| static_cast<uint64_t>(model & 0xFFFFFFu) << 32
+		| depthBits;
+}
+
+void RenderQueue::sort() {
+	if (entries.size() < 2) {
+		return;
+	}
+	const size_t DIGITS = sizeof(uint64_t);
+	std::array<std::array<uint32_t, 256>, DIGITS> counts{};
+	for (const auto& entry : entries) {
+		for (size_t digit = 0; digit < DIGITS; ++digit) {
+			++counts[digit][(entry.key >> (digit * 8)) & 0xFF];
+		}
+	}
+
+	scratch.resize(entries.size());
+	for (size_t digit = 0; digit < DIGITS; ++digit) {
+		auto& count = counts[digit];
+		if (count[(entries[0].key >> (digit * 8)) & 0xFF] == entries.size()) {
+			continue;
+		}
+		uint32_t offset = 0;
+		for (auto& bucket : count) {
+			uint32_t size = bucket;
+			bucket = offset;
+			offset += size;
+		}
+		for (const auto& entry : entries) {
+			scratch[count[(entry.key >> (digit * 8)) & 0xFF]++] = entry;
+		}
+		entries.swap(scratch);
+	}
+}
+
+void RenderQueue::sign(const std::vector<AssetData>& objects) {
+	// FNV-1a over 64-bit words
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](uint64_t value) {
+		hash ^= value;
+		hash *= 1099511628211ull;
+	};
+	for (uint32_t i : order) {
+		const AssetData& object = objects[i];
+		const GeometryArena::Allocation& geometry = object.resource.geometry;
+		mix(i);
+		mix(object.resource.sortId);
+		mix(static_cast<uint64_t>(object.lod) << 32 | object.shadowLod);
+		mix(static_cast<uint64_t>(object.firstInstance) << 32 | object.instanceCount);
+		mix(static_cast<uint64_t>(geometry.block) << 32 | geometry.firstIndex);
+		mix(geometry.firstVertex);
+		mix(reinterpret_cast<uint64_t>(object.resource.meshletDescriptorSet));
+		for (VkDescriptorSet descriptorSet : object.resource.descriptorSets) {
+			mix(reinterpret_cast<uint64_t>(descriptorSet));
+		}
+	}
+	signature = hash;
+}
@@ -0,0 +1,61 @@
+#include "render_stats.hpp"
+
+namespace {
+	RenderCounters currentCounters;
+	RenderCounters lastCounters;
+	RenderCounters totalCounters;
+	uint64_t finishedFrames = 0;
+}
+
+RenderCounters& RenderCounters::operator+=(const RenderCounters& other) {
+	drawCalls += other.drawCalls;
+	triangles += other.triangles;
+	instances += other.instances;
+	descriptorBinds += other.descriptorBinds;
+	bufferBinds += other.bufferBinds;
+	pipelineBinds += other.pipelineBinds;
+	barriers += other.barriers;
+	bytesUploaded += other.bytesUploaded;
+	allocations += other.allocations;
+	replays += other.replays;
+	return *this;
+}
+
+RenderCounters& RenderCounters::operator-=(const RenderCounters& other) {
+	drawCalls -= other.drawCalls;
+	triangles -= other.triangles;
+	instances -= other.instances;
+	descriptorBinds -= other.descriptorBinds;
+	bufferBinds -= other.bufferBinds;
+	pipelineBinds -= other.pipelineBinds;
+	barriers -= other.barriers;
+	bytesUploaded -= other.bytesUploaded;
+	allocations -= other.allocations;
+	replays -= other.replays;
+	return *this;
+}
+
+namespace RenderStats {
+	RenderCounters& frame() {
+		return currentCounters;
+	}
+
+	void endFrame() {
+		lastCounters = currentCounters;
+		totalCounters += currentCounters;
+		currentCounters = RenderCounters{};
+		++finishedFrames;
+	}
+
+	const RenderCounters& lastFrame() {
+		return lastCounters;
+	}
+
+	const RenderCounters& total() {
+		return totalCounters;
+	}
+
+	uint64_t frameCount() {
+		return finishedFrames;
+	}
+}
@@ -1,11 +1,12 @@
 #include "rt_graphics_app.hpp"
 
 #include <GLFW/glfw3.h>
-#include <nlohmann/json.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 #include <cstddef>
 #include <chrono>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -13,26 +14,76 @@
 #include "input_manager.hpp"
 #include "update_system.hpp"
 #include "graphics_system.hpp"
+#include "world_streamer.hpp"
+#include "scene_file.hpp"
+#include "vfs.hpp"
+#include "cook_manifest.hpp"
 #include "game_object.hpp"
 #include "vulkan_types.hpp"
 #include "buffer_types.hpp"
+#include "cpu_profiler.hpp"
+#include "alloc_tracker.hpp"
+#include "constants.hpp"
 
 void RTGraphicsApp::run() {
 	setCallback();
+	// one mapping instead of a file open per shader, model and texture. loose files without a pack
+	if (Vfs::mount("../assets.rtgpack")) {
+		std::cout << "mounted ../assets.rtgpack (" << Vfs::getMountedFileCount() << " files)" << std::endl;
+	}
+	// cooked textures and meshes are only used when rtg-cook recorded them
+	CookManifest::load("../cook_manifest.json");
 	graphicsSystem.init();
 	loadAssets("../assets.json");
 	auto lastTime = std::chrono::steady_clock::now();
+	uint32_t renderedFrames = 0;
+	bool allocationCheckStarted = false;
 	while (!windowState.windowShouldClose()) {
-		glfwPollEvents();
+		PROFILE_ZONE("frame");
+		{
+			PROFILE_ZONE("glfwPollEvents");
+			glfwPollEvents();
+		}
 		auto currentTime = std::chrono::steady_clock::now();
 		delta = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - lastTime).count();
 		lastTime = currentTime;
 		updateSystem.update(player.value().object, camera, inputManager, delta);
-		std::vector<AssetData> assets(props);
-		assets.push_back(player.value());
+		graphicsSystem.updateAssetStreaming();
+		bool assetsChanged = graphicsSystem.applyResidentModels(props);
+		assetsChanged |= worldStreamer.update(camera.getPosition(), graphicsSystem);
+		if (assetsChanged) {
+			rebuildDrawList();
+		}
+		assets.back().object = player.value().object;
+		graphicsSystem.selectLods(assets, camera);
 		graphicsSystem.render(assets, camera, directionalLights);
+		if (benchmarkFrames > 0) {
+			++renderedFrames;
+			// uploads and cells arriving allocate, the check starts once streaming has settled
+			bool settled = graphicsSystem.isStreamingIdle() && !worldStreamer.isLoading();
+			if (!allocationCheckStarted && renderedFrames >= Config::ALLOCATION_WARMUP_FRAMES && settled) {
+				AllocTracker::resetPeak();
+				allocationCheckStarted = true;
+			}
+			if (renderedFrames >= benchmarkFrames) {
+				break;
+			}
+		}
+	}
+	if (benchmarkFrames > 0) {
+		graphicsSystem.printBenchmarkReport(std::cout);
 	}
+	worldStreamer.cleanup(graphicsSystem);
 	graphicsSystem.cleanup(player.value(), props);
+	Vfs::unmount();
+
+	// the benchmark doubles as the zero-allocation check of the steady-state frame
+	if (benchmarkFrames > 0 && !allocationCheckStarted) {
+		std::cout << "allocation check skipped, streaming didn't settle within the benchmark" << std::endl;
+	}
+	if (allocationCheckStarted && AllocTracker::peakFrameAllocations() > 0) {
+		throw std::runtime_error("steady-state frames allocated on the heap");
+	}
 }
 
 void RTGraphicsApp::setCallback() {
@@ -45,77 +96,88 @@ void RTGraphicsApp::setCallback() {
 }
 
 void RTGraphicsApp::loadAssets(std::string filepath) {
-	std::ifstream assetData(filepath);
-	nlohmann::json json;
-	assetData >> json;
-	std::string textureDir = json["textureDir"];
-	std::string modelDir = json["modelDir"];
-	auto characterData = json["characters"];
-	auto propsData = json["props"];
-	auto pointLightData = json["lights"]["point"];
-	auto directionalLightData = json["lights"]["directional"];
-
-	graphicsSystem.createLevelResource(characterData.size() + propsData.size(), pointLightData.size(), directionalLightData.size());
+	// maps the compiled scene when SceneCompiler wrote an up-to-date one, the JSON stays the authoring format
+	SceneFile::Scene scene;
+	scene.open(filepath);
+	std::string textureDir(scene.getString(scene.getHeader().textureDir));
+	std::string modelDir(scene.getString(scene.getHeader().modelDir));
+	auto characterData = scene.getCharacters();
+	auto propsData = scene.getProps();
+	auto instanceGroupData = scene.getInstanceGroups();
+	auto pointLightData = scene.getPointLights();
+	auto directionalLightData = scene.getDirectionalLights();
+
+	graphicsSystem.createLevelResource(characterData.size() + propsData.size() + instanceGroupData.size(), pointLightData.size(), directionalLightData.size());
 
 	for (const auto& character : characterData) {
 		// currently load the last character for the player
-		glm::vec3 position(character["position"][0], character["position"][1], character["position"][2]);
-		glm::vec3 direction(character["direction"][0], character["direction"][1], character["direction"][2]);
-		GameObject gameObject(position, direction);
+		GameObject gameObject(glm::make_vec3(character.position), glm::make_vec3(character.direction));
 		AssetData characterAsset{gameObject};
-		characterAsset.resource = graphicsSystem.createModelResource(textureDir, modelDir, character);
+		characterAsset.resource = graphicsSystem.createModelResource(textureDir, modelDir, scene.getModel(character.model));
 		player = characterAsset;
 	}
 
-	props.resize(propsData.size());
-	for (size_t i = 0; i < propsData.size(); ++i) {
-		glm::vec3 position(propsData[i]["position"][0], propsData[i]["position"][1], propsData[i]["position"][2]);
-		glm::vec3 direction(propsData[i]["direction"][0], propsData[i]["direction"][1], propsData[i]["direction"][2]);
-		GameObject gameObject(position, direction);
-		AssetData propsAsset{gameObject};
-		propsAsset.resource = graphicsSystem.createModelResource(textureDir, modelDir, propsData[i]);
-		props[i] = propsAsset;
+	// props stream in while the first frames render
+	props.reserve(propsData.size() + instanceGroupData.size());
+	for (const auto& prop : propsData) {
+		GameObject gameObject(glm::make_vec3(prop.position), glm::make_vec3(prop.direction));
+		requestProp(textureDir, modelDir, scene.getModel(prop.model), gameObject);
+	}
+	// an instance group is one prop drawing all of its copies
+	for (const auto& group : instanceGroupData) {
+		props.push_back(graphicsSystem.requestInstanceGroup(textureDir, modelDir, scene, group));
 	}
 
 	pointLights.resize(pointLightData.size());
 	for (size_t i = 0; i < pointLightData.size(); ++i) {
 		PointLightBuffer buffer;
-		buffer.position = glm::vec3(
-			static_cast<float>(pointLightData[i]["position"][0]),
-			static_cast<float>(pointLightData[i]["position"][1]),
-			static_cast<float>(pointLightData[i]["position"][2])
-		);
-		buffer.color = glm::vec3(
-			static_cast<float>(pointLightData[i]["color"][0]),
-			static_cast<float>(pointLightData[i]["color"][1]),
-			static_cast<float>(pointLightData[i]["color"][2])
-		);
-		buffer.intensity = static_cast<float>(pointLightData[i]["intensity"]);
+		buffer.position = glm::make_vec3(pointLightData[i].position);
+		buffer.color = glm::make_vec3(pointLightData[i].color);
+		buffer.intensity = pointLightData[i].intensity;
 		pointLights[i] = buffer;
 	}
 
 	directionalLights.resize(directionalLightData.size());
 	for (size_t i = 0; i < directionalLightData.size(); ++i) {
 		DirectionalLightBuffer buffer;
-		buffer.direction = glm::vec3(
-			static_cast<float>(directionalLightData[i]["direction"][0]),
-			static_cast<float>(directionalLightData[i]["direction"][1]),
-			static_cast<float>(directionalLightData[i]["direction"][2])
-		);
-		buffer.color = glm::vec3(
-			static_cast<float>(directionalLightData[i]["color"][0]),
-			static_cast<float>(directionalLightData[i]["color"][1]),
-			static_cast<float>(directionalLightData[i]["color"][2])
-		);
-		buffer.intensity = static_cast<float>(directionalLightData[i]["intensity"]);
+		buffer.direction = glm::make_vec3(directionalLightData[i].direction);
+		buffer.color = glm::make_vec3(directionalLightData[i].color);
+		buffer.intensity = directionalLightData[i].intensity;
 		directionalLights[i] = buffer;
 	}
 
+	// cells of the world partition stream in and out around the camera
+	if (scene.getCells().size() > 0) {
+		worldStreamer.load(scene, "../");
+	}
+	graphicsSystem.setWorldStreamer(&worldStreamer);
+	if (scene.getHeader().flags & SceneFile::FLAG_DEPTH_PREPASS) {
+		graphicsSystem.setDepthPrepass(true);
+	}
+
+	rebuildDrawList();
+
 	// TODO Enable real-time modification of light parameters
 	graphicsSystem.updateLights(pointLights, directionalLights);
 
 }
 
+void RTGraphicsApp::requestProp(const std::string& textureDir, const std::string& modelDir, const SceneFile::ModelRef& model, const GameObject& object) {
+	AssetData propsAsset{object};
+	propsAsset.resource = graphicsSystem.requestModelResource(textureDir, modelDir, model);
+	props.push_back(propsAsset);
+	if (player.has_value()) {
+		rebuildDrawList();
+	}
+}
+
+void RTGraphicsApp::rebuildDrawList() {
+	// the per-frame draw list, only the player's transform changes between frames. the player stays last
+	assets = props;
+	worldStreamer.appendProps(assets);
+	assets.push_back(player.value());
+}
+
 inline void RTGraphicsApp::mouseButtonCallback(GLFWwindow *window, int button, int action, int mods) {
 	auto app = static_cast<RTGraphicsApp*>(glfwGetWindowUserPointer(window));
 }
@@ -0,0 +1,391 @@
+#include "scene_file.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "vfs.hpp"
+
+namespace SceneFile {
+	namespace {
+		const char IDENTIFIER[8] = {'R', 'T', 'G', 'S', 'C', 'E', 'N', 'E'};
+
+		// every record is made of 4 byte fields, sections are aligned to that
+		const size_t ALIGNMENT = 4;
+
+		static_assert(sizeof(Header) == 108, "scene header layout changed, bump VERSION");
+		static_assert(sizeof(Model) == 16, "scene model layout changed, bump VERSION");
+		static_assert(sizeof(Object) == 28, "scene object layout changed, bump VERSION");
+		static_assert(sizeof(PointLight) == 28, "scene point light layout changed, bump VERSION");
+		static_assert(sizeof(DirectionalLight) == 28, "scene directional light layout changed, bump VERSION");
+		static_assert(sizeof(Cell) == 12, "scene cell layout changed, bump VERSION");
+		static_assert(sizeof(InstanceGroup) == 12, "scene instance group layout changed, bump VERSION");
+		static_assert(sizeof(Instance) == 28, "scene instance layout changed, bump VERSION");
+
+		class StringTable {
+		public:
+			uint32_t add(const std::string& value) {
+				auto found = offsets.find(value);
+				if (found != offsets.end()) {
+					return found->second;
+				}
+				uint32_t offset = static_cast<uint32_t>(bytes.size());
+				bytes.insert(bytes.end(), value.begin(), value.end());
+				bytes.push_back(0);
+				offsets.emplace(value, offset);
+				return offset;
+			}
+
+			std::vector<uint8_t> bytes;
+
+		private:
+			std::unordered_map<std::string, uint32_t> offsets;
+		};
+
+		void readFloats(const nlohmann::json& values, float* out, size_t count) {
+			for (size_t i = 0; i < count; ++i) {
+				out[i] = values.at(i).get<float>();
+			}
+		}
+
+		// xorshift32, unlike the std distributions it scatters the same way on every platform
+		class Random {
+		public:
+			explicit Random(uint32_t seed) : state(seed != 0 ? seed : 1) {}
+
+			// in [0, 1)
+			float next() {
+				state ^= state << 13;
+				state ^= state >> 17;
+				state ^= state << 5;
+				return static_cast<float>(state >> 8) / static_cast<float>(1 << 24);
+			}
+			float next(float min, float max) {
+				return min + (max - min) * next();
+			}
+
+		private:
+			uint32_t state;
+		};
+
+		// positions uniform in the box from min to max, a random yaw and a scale in the given range
+		void scatter(const nlohmann::json& data, std::vector<Instance>& instances) {
+			float min[3];
+			float max[3];
+			readFloats(data.at("min"), min, 3);
+			readFloats(data.at("max"), max, 3);
+			float scale[2] = {1.0f, 1.0f};
+			if (data.contains("scale")) {
+				readFloats(data["scale"], scale, 2);
+			}
+			Random random(data.value("seed", 1u));
+			uint32_t count = data.at("count").get<uint32_t>();
+			for (uint32_t i = 0; i < count; ++i) {
+				Instance instance{};
+				for (size_t axis = 0; axis < 3; ++axis) {
+					instance.position[axis] = random.next(min[axis], max[axis]);
+				}
+				float yaw = random.next(0.0f, 6.28318531f);
+				instance.direction[0] = std::cos(yaw);
+				instance.direction[2] = std::sin(yaw);
+				instance.scale = random.next(scale[0], scale[1]);
+				instances.push_back(instance);
+			}
+		}
+
+		template <typename T>
+		void appendSection(std::vector<uint8_t>& bytes, Range& range, const T* records, size_t count) {
+			bytes.resize((bytes.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, 0);
+			range.offset = static_cast<uint32_t>(bytes.size());
+			range.count = static_cast<uint32_t>(count);
+			const uint8_t* begin = reinterpret_cast<const uint8_t*>(records);
+			bytes.insert(bytes.end(), begin, begin + count * sizeof(T));
+		}
+
+		bool isInside(const Range& range, size_t recordSize, size_t fileSize) {
+			return range.offset % ALIGNMENT == 0 && static_cast<uint64_t>(range.offset) + static_cast<uint64_t>(range.count) * recordSize <= fileSize;
+		}
+	}
+
+	std::vector<uint8_t> compile(const nlohmann::json& json) {
+		StringTable strings;
+		std::vector<Model> models;
+		// models are shared by string offsets, the table stores every string once
+		std::map<std::array<uint32_t, 4>, uint32_t> modelIndices;
+
+		auto addModel = [&](const nlohmann::json& data) {
+			Model model{};
+			model.path = strings.add(data.at("model").get<std::string>());
+			for (size_t slot = 0; slot < TEXTURE_SLOTS.size(); ++slot) {
+				model.textures[slot] = NO_STRING;
+				if (data.contains("textures") && data["textures"].contains(TEXTURE_SLOTS[slot])) {
+					model.textures[slot] = strings.add(data["textures"][TEXTURE_SLOTS[slot]].get<std::string>());
+				}
+			}
+			std::array<uint32_t, 4> key = {model.path, model.textures[0], model.textures[1], model.textures[2]};
+			auto found = modelIndices.find(key);
+			if (found != modelIndices.end()) {
+				return found->second;
+			}
+			uint32_t index = static_cast<uint32_t>(models.size());
+			models.push_back(model);
+			modelIndices.emplace(key, index);
+			return index;
+		};
+
+		auto readObjects = [&](const char* group) {
+			std::vector<Object> objects;
+			if (!json.contains(group)) {
+				return objects;
+			}
+			objects.reserve(json[group].size());
+			for (const auto& data : json[group]) {
+				Object object{};
+				readFloats(data.at("position"), object.position, 3);
+				readFloats(data.at("direction"), object.direction, 3);
+				object.model = addModel(data);
+				objects.push_back(object);
+			}
+			return objects;
+		};
+
+		Header header{};
+		std::memcpy(header.identifier, IDENTIFIER, sizeof(IDENTIFIER));
+		header.version = VERSION;
+		header.textureDir = json.contains("textureDir") ? strings.add(json["textureDir"].get<std::string>()) : NO_STRING;
+		header.modelDir = json.contains("modelDir") ? strings.add(json["modelDir"].get<std::string>()) : NO_STRING;
+		if (json.value("depthPrepass", false)) {
+			header.flags |= FLAG_DEPTH_PREPASS;
+		}
+
+		std::vector<Object> characters = readObjects("characters");
+		std::vector<Object> props = readObjects("props");
+
+		// explicit transforms first, then the scattered ones
+		std::vector<InstanceGroup> instanceGroups;
+		std::vector<Instance> instances;
+		for (const auto& data : json.value("instances", nlohmann::json::array())) {
+			InstanceGroup group{};
+			group.model = addModel(data);
+			group.firstInstance = static_cast<uint32_t>(instances.size());
+			for (const auto& transform : data.value("transforms", nlohmann::json::array())) {
+				Instance instance{};
+				readFloats(transform.at("position"), instance.position, 3);
+				readFloats(transform.at("direction"), instance.direction, 3);
+				instance.scale = transform.value("scale", 1.0f);
+				instances.push_back(instance);
+			}
+			if (data.contains("scatter")) {
+				scatter(data["scatter"], instances);
+			}
+			group.instanceCount = static_cast<uint32_t>(instances.size()) - group.firstInstance;
+			if (group.instanceCount > 0) {
+				instanceGroups.push_back(group);
+			}
+		}
+
+		std::vector<PointLight> pointLights;
+		std::vector<DirectionalLight> directionalLights;
+		if (json.contains("lights")) {
+			const auto& lights = json["lights"];
+			for (const auto& data : lights.value("point", nlohmann::json::array())) {
+				PointLight light{};
+				readFloats(data.at("position"), light.position, 3);
+				light.intensity = data.at("intensity").get<float>();
+				readFloats(data.at("color"), light.color, 3);
+				pointLights.push_back(light);
+			}
+			for (const auto& data : lights.value("directional", nlohmann::json::array())) {
+				DirectionalLight light{};
+				readFloats(data.at("direction"), light.direction, 3);
+				light.intensity = data.at("intensity").get<float>();
+				readFloats(data.at("color"), light.color, 3);
+				directionalLights.push_back(light);
+			}
+		}
+
+		std::vector<Cell> cells;
+		if (json.contains("world")) {
+			const auto& world = json["world"];
+			header.cellSize = world.at("cellSize").get<float>();
+			header.loadRadius = world.value("loadRadius", 0.0f);
+			for (const auto& data : world.at("cells")) {
+				Cell cell{};
+				cell.x = data.at("cell").at(0).get<int32_t>();
+				cell.z = data.at("cell").at(1).get<int32_t>();
+				cell.manifest = strings.add(data.at("manifest").get<std::string>());
+				cells.push_back(cell);
+			}
+		}
+
+		std::vector<uint8_t> bytes(sizeof(Header));
+		appendSection(bytes, header.models, models.data(), models.size());
+		appendSection(bytes, header.characters, characters.data(), characters.size());
+		appendSection(bytes, header.props, props.data(), props.size());
+		appendSection(bytes, header.pointLights, pointLights.data(), pointLights.size());
+		appendSection(bytes, header.directionalLights, directionalLights.data(), directionalLights.size());
+		appendSection(bytes, header.cells, cells.data(), cells.size());
+		appendSection(bytes, header.instanceGroups, instanceGroups.data(), instanceGroups.size());
+		appendSection(bytes, header.instances, instances.data(), instances.size());
+		appendSection(bytes, header.strings, strings.bytes.data(), strings.bytes.size());
+		header.fileSize = static_cast<uint32_t>(bytes.size());
+		std::memcpy(bytes.data(), &header, sizeof(Header));
+		return bytes;
+	}
+
+	bool write(const std::string& path, const std::vector<uint8_t>& bytes) {
+		std::ofstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			return false;
+		}
+		file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+		return file.good();
+	}
+
+	std::string compiledPath(const std::string& manifestPath) {
+		return std::filesystem::path(manifestPath).replace_extension(EXTENSION).string();
+	}
+
+	void Scene::open(const std::string& manifestPath) {
+		std::string path = compiledPath(manifestPath);
+		// the pack ships what it was built from, loose files aren't compared against it
+		Vfs::File packed = Vfs::find(path);
+		if (packed.data != nullptr) {
+			file.close();
+			bytes.clear();
+			if (openMemory(packed.data, packed.size)) {
+				return;
+			}
+			std::cerr << path << " in the pack is not a valid scene of version " << VERSION << std::endl;
+		}
+
+		std::error_code error;
+		auto manifestTime = std::filesystem::last_write_time(manifestPath, error);
+		bool hasManifest = !error;
+		auto compiledTime = std::filesystem::last_write_time(path, error);
+		bool hasCompiled = !error;
+
+		if (hasCompiled && (!hasManifest || compiledTime >= manifestTime)) {
+			if (openCompiled(path)) {
+				return;
+			}
+			std::cerr << path << " is not a valid scene of version " << VERSION << ", reading " << manifestPath << std::endl;
+		} else if (hasCompiled) {
+			std::cerr << path << " is older than " << manifestPath << ", reading the manifest" << std::endl;
+		}
+
+		Vfs::File manifestData;
+		if (!Vfs::open(manifestPath, manifestData)) {
+			throw std::runtime_error("failed to open scene " + manifestPath);
+		}
+		openJson(nlohmann::json::parse(manifestData.data, manifestData.data + manifestData.size));
+	}
+
+	bool Scene::openCompiled(const std::string& path) {
+		bytes.clear();
+		if (!file.open(path)) {
+			data = nullptr;
+			size = 0;
+			return false;
+		}
+		if (!openMemory(file.getData(), file.getSize())) {
+			file.close();
+			return false;
+		}
+		return true;
+	}
+
+	bool Scene::openMemory(const uint8_t* memory, size_t memorySize) {
+		data = memory;
+		size = memorySize;
+		if (!validate()) {
+			data = nullptr;
+			size = 0;
+			return false;
+		}
+		return true;
+	}
+
+	void Scene::openJson(const nlohmann::json& json) {
+		file.close();
+		bytes = compile(json);
+		data = bytes.data();
+		size = bytes.size();
+	}
+
+	ModelRef Scene::getModel(uint32_t index) const {
+		const Model& model = getArray<Model>(getHeader().models)[index];
+		ModelRef ref;
+		ref.path = getString(model.path);
+		for (size_t slot = 0; slot < ref.textures.size(); ++slot) {
+			ref.textures[slot] = getString(model.textures[slot]);
+		}
+		return ref;
+	}
+
+	// everything read in place is checked once so a truncated or foreign file can't read out of bounds
+	bool Scene::validate() const {
+		if (size < sizeof(Header)) {
+			return false;
+		}
+		const Header& header = getHeader();
+		if (std::memcmp(header.identifier, IDENTIFIER, sizeof(IDENTIFIER)) != 0 || header.version != VERSION || header.fileSize != size) {
+			return false;
+		}
+		if (!isInside(header.strings, 1, size)
+			|| !isInside(header.models, sizeof(Model), size)
+			|| !isInside(header.characters, sizeof(Object), size)
+			|| !isInside(header.props, sizeof(Object), size)
+			|| !isInside(header.pointLights, sizeof(PointLight), size)
+			|| !isInside(header.directionalLights, sizeof(DirectionalLight), size)
+			|| !isInside(header.cells, sizeof(Cell), size)
+			|| !isInside(header.instanceGroups, sizeof(InstanceGroup), size)
+			|| !isInside(header.instances, sizeof(Instance), size)) {
+			return false;
+		}
+		uint32_t stringBytes = header.strings.count;
+		if (stringBytes > 0 && data[header.strings.offset + stringBytes - 1] != 0) {
+			return false;
+		}
+		auto isString = [stringBytes](uint32_t offset) {
+			return offset == NO_STRING || offset < stringBytes;
+		};
+
+		if (!isString(header.textureDir) || !isString(header.modelDir)) {
+			return false;
+		}
+		for (const auto& model : getArray<Model>(header.models)) {
+			if (model.path == NO_STRING || !isString(model.path)) {
+				return false;
+			}
+			for (uint32_t texture : model.textures) {
+				if (!isString(texture)) {
+					return false;
+				}
+			}
+		}
+		for (const Array<Object>& objects : {getCharacters(), getProps()}) {
+			for (const auto& object : objects) {
+				if (object.model >= header.models.count) {
+					return false;
+				}
+			}
+		}
+		for (const auto& group : getInstanceGroups()) {
+			if (group.model >= header.models.count || static_cast<uint64_t>(group.firstInstance) + group.instanceCount > header.instances.count) {
+				return false;
+			}
+		}
+		for (const auto& cell : getCells()) {
+			if (cell.manifest == NO_STRING || !isString(cell.manifest)) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
@@ -13,13 +13,18 @@
 #include "constants.hpp"
 #include "vulkan_vertex.hpp"
 #include "camera.hpp"
+#include "render_stats.hpp"
+#include "render_graph.hpp"
+#include "geometry_arena.hpp"
+#include "instance_buffer.hpp"
+#include "render_queue.hpp"
 
 struct ShadowMapLight {
 	glm::mat4 view;
 	glm::mat4 proj;
 };
 
-void BaseShadowRenderPass::init() {
+void BaseShadowRenderPass::init(VkCommandPool commandPool) {
 	// create UBO (light view ...)
 	shadowMapLight.buffers.resize(Config::MAX_FRAMES_IN_FLIGHT);
 	shadowMapLight.buffersMemory.resize(Config::MAX_FRAMES_IN_FLIGHT);
@@ -193,7 +198,8 @@ void BaseShadowRenderPass::init() {
 	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	// the render graph moves the shadow map into and out of attachment layout
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentReference depthReference{};
@@ -267,13 +273,14 @@ void BaseShadowRenderPass::init() {
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	// depth only, the position stream and instance transforms are all it fetches
+	auto bindingDescriptions = PackedVertex::getPositionBindingDescriptions();
+	auto attributeDescriptions = PackedVertex::getPositionAttributeDescriptions();
 
-	vertexInputInfo.vertexBindingDescriptionCount = 1;
-	vertexInputInfo.vertexAttributeDescriptionCount = 1;
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-	vertexInputInfo.pVertexAttributeDescriptions = &attributeDescriptions[0];
+	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
 	inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -356,8 +363,11 @@ void BaseShadowRenderPass::init() {
 
 	vkDestroyShaderModule(device, fsShadowMapModule, nullptr);
 	vkDestroyShaderModule(device, vsShadowMapModule, nullptr);
+
+	commandCache.init(device, commandPool);
 }
 void BaseShadowRenderPass::cleanup() {
+	commandCache.cleanup();
 	shadowMap.cleanup(device);
 	lightDescriptor.cleanup(device);
 	shadowMapDescriptor.cleanup(device);
@@ -369,25 +379,11 @@ void BaseShadowRenderPass::cleanup() {
 	vkDestroyFramebuffer(device, framebuffer, nullptr);
 	vkDestroyRenderPass(device, renderPass, nullptr);
 }
-void BaseShadowRenderPass::generateShadowMap(
-	std::vector<VkCommandBuffer>& commandBuffers,
-	uint32_t imageIndex,
-	uint32_t currentFrame,
-	std::vector<void*>& modelMatrixBuffersMapped,
-	const std::vector<AssetData>& models,
-	const Camera& camera,
-	const std::vector<DirectionalLightBuffer>& directionalLights,
-	GLFWwindow* window
-) {
-
-	if (currentLayout != VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-		resetLayout(commandBuffers[currentFrame]);
-	}
-
+void BaseShadowRenderPass::generateShadowMap(const FrameContext& context) {
 	int width, height;
-	glfwGetFramebufferSize(window, &width, &height);
+	glfwGetFramebufferSize(context.window, &width, &height);
 	float aspect = (float)width / height;
-	updateLightMatrix(camera, directionalLights, aspect);
+	updateLightMatrix(*context.camera, *context.directionalLights, aspect);
 
 	// record shadow map to VkImage
 	VkRenderPassBeginInfo renderPassInfo{};
@@ -403,117 +399,84 @@ void BaseShadowRenderPass::generateShadowMap(
 	renderPassInfo.clearValueCount = 1;
 	renderPassInfo.pClearValues = &clearValue;
 
-	vkCmdBeginRenderPass(commandBuffers[currentFrame], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-	{
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(SHADOW_MAP_RESOLUTION);
-		viewport.height = static_cast<float>(SHADOW_MAP_RESOLUTION);
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		vkCmdSetViewport(commandBuffers[currentFrame], 0, 1, &viewport);
-
-		VkRect2D scissor{};
-		scissor.offset = {0, 0};
-		scissor.extent = VkExtent2D{SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION};
-		vkCmdSetScissor(commandBuffers[currentFrame], 0, 1, &scissor);
-
-		vkCmdBindPipeline(commandBuffers[currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-
-
-		for(size_t i = 0; i < models.size(); ++i) {
-			uint32_t offset = models[i].updateModelTransformMatrix(i, modelMatrixBuffersMapped[currentFrame]);
-			VkBuffer vertexBuffers[] = {models[i].resource.vertexBufferResource.buffer};
-			VkDeviceSize offsets[] = {0};
-			vkCmdBindVertexBuffers(commandBuffers[currentFrame], 0, 1, vertexBuffers, offsets);
-			vkCmdBindIndexBuffer(commandBuffers[currentFrame], models[i].resource.indexBufferResource.buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdBindDescriptorSets(
-				commandBuffers[currentFrame],
-				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				pipelineLayout,
-				0,
-				1,
-				&commonDescriptor.modelMatrix.sets[currentFrame],
-				1,
-				&offset
-			);
-			vkCmdBindDescriptorSets(
-				commandBuffers[currentFrame],
-				VK_PIPELINE_BIND_POINT_GRAPHICS,
-				pipelineLayout,
-				1,
-				1,
-				&lightDescriptor.sets[currentFrame],
-				0,
-				nullptr
-			);
-
-			vkCmdDrawIndexed(commandBuffers[currentFrame], static_cast<uint32_t>(models[i].resource.indexCount), 1, 0, 0, 0);
-		}
-	}
-	vkCmdEndRenderPass(commandBuffers[currentFrame]);
-
-	VkImageMemoryBarrier barrier{};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	barrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.image = shadowMap.image;
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = 1;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
-
-	barrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-	vkCmdPipelineBarrier(
-		commandBuffers[currentFrame],
-		VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-		0,
-		0, nullptr,
-		0, nullptr,
-		1, &barrier
-	);
-
-	currentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	vkCmdBeginRenderPass(context.commandBuffer(), &renderPassInfo, CommandCache::getSubpassContents(context));
+	commandCache.record(context, renderPass, 0, [&](VkCommandBuffer commandBuffer) {
+		drawShadowCasters(commandBuffer, context);
+	});
+	vkCmdEndRenderPass(context.commandBuffer());
 }
 
-void BaseShadowRenderPass::resetLayout(VkCommandBuffer commandBuffer) {
-	VkImageMemoryBarrier resetBarrier{};
-	resetBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-	resetBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	resetBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-	resetBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	resetBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	resetBarrier.image = shadowMap.image;
-	resetBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-	resetBarrier.subresourceRange.baseMipLevel = 0;
-	resetBarrier.subresourceRange.levelCount = 1;
-	resetBarrier.subresourceRange.baseArrayLayer = 0;
-	resetBarrier.subresourceRange.layerCount = 1;
-	resetBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-	resetBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-	vkCmdPipelineBarrier(
+void BaseShadowRenderPass::drawShadowCasters(VkCommandBuffer commandBuffer, const FrameContext& context) {
+	uint32_t currentFrame = context.currentFrame;
+	const std::vector<AssetData>& models = *context.assets;
+
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(SHADOW_MAP_RESOLUTION);
+	viewport.height = static_cast<float>(SHADOW_MAP_RESOLUTION);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.offset = {0, 0};
+	scissor.extent = VkExtent2D{SHADOW_MAP_RESOLUTION, SHADOW_MAP_RESOLUTION};
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	++RenderStats::frame().pipelineBinds;
+	context.instanceBuffer->bind(commandBuffer);
+
+	// the same for every draw of the pass
+	vkCmdBindDescriptorSets(
 		commandBuffer,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-		VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_PIPELINE_BIND_POINT_GRAPHICS,
+		pipelineLayout,
+		1,
+		1,
+		&lightDescriptor.sets[currentFrame],
 		0,
-		0, nullptr,
-		0, nullptr,
-		1, &resetBarrier
+		nullptr
 	);
-
-	currentLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	++RenderStats::frame().descriptorBinds;
+
+	uint32_t boundBlock = GeometryArena::NO_BLOCK;
+	for (uint32_t i : context.renderQueue->getOrder()) {
+		uint32_t offset = static_cast<uint32_t>(i * sizeof(TransformMatrixBuffer));
+		const GeometryArena::Allocation& geometry = models[i].resource.geometry;
+		if (geometry.block != boundBlock) {
+			context.geometryArena->bindPositions(commandBuffer, geometry.block);
+			boundBlock = geometry.block;
+		}
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			pipelineLayout,
+			0,
+			1,
+			&commonDescriptor.modelMatrix.sets[currentFrame],
+			1,
+			&offset
+		);
+		++RenderStats::frame().descriptorBinds;
+
+		const MeshFile::Lod& lod = models[i].resource.getLod(models[i].shadowLod);
+		vkCmdDrawIndexed(
+			commandBuffer,
+			lod.indexCount,
+			models[i].instanceCount,
+			geometry.firstIndex + lod.firstIndex,
+			static_cast<int32_t>(geometry.firstVertex),
+			models[i].firstInstance
+		);
+		++RenderStats::frame().drawCalls;
+		RenderStats::frame().triangles += lod.indexCount / 3 * models[i].instanceCount;
+		RenderStats::frame().instances += models[i].instanceCount;
+	}
 }
 
-
-void BaseShadowRenderPass::updateLightMatrix(const Camera& camera, const std::vector<DirectionalLightBuffer> directionalLights, float aspect) {
+void BaseShadowRenderPass::updateLightMatrix(const Camera& camera, const std::vector<DirectionalLightBuffer>& directionalLights, float aspect) {
 	// currently just pick up the first one
 	// TODO enable multi-lighting
 	DirectionalLightBuffer directionalLight = directionalLights[0];
@@ -543,5 +506,6 @@ void BaseShadowRenderPass::updateLightMatrix(const Camera& camera, const std::ve
 		lightUBOData.proj[1][1] *= -1;
 
 		memcpy(shadowMapLight.buffersMapped[i], &lightUBOData, sizeof(ShadowMapLight));
+		RenderStats::frame().bytesUploaded += sizeof(ShadowMapLight);
 	}
 }
\ No newline at end of file
@@ -11,6 +11,8 @@
 #include "vulkan_types.hpp"
 #include "constants.hpp"
 #include "vulkan_utils.hpp"
+#include "render_stats.hpp"
+#include "deletion_queue.hpp"
 
 void SwapchainRenderPass::init() {
 	createSampler();
@@ -43,18 +45,6 @@ void SwapchainRenderPass::render(VkCommandBuffer commandBuffer, uint32_t imageIn
 	renderPassBeginInfo.clearValueCount = 1;
 	renderPassBeginInfo.pClearValues = &clearColor;
 
-	VulkanUtils::transitionLayout(
-		commandBuffer,
-		renderedImageResource.image,
-		VK_IMAGE_LAYOUT_GENERAL,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_ACCESS_SHADER_WRITE_BIT,
-		VK_ACCESS_SHADER_READ_BIT,
-		VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-	);
-
 	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 	{
 
@@ -72,6 +62,7 @@ void SwapchainRenderPass::render(VkCommandBuffer commandBuffer, uint32_t imageIn
 		scissor.extent = swapchain.extent;
 		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		++RenderStats::frame().pipelineBinds;
 		vkCmdBindDescriptorSets(
 			commandBuffer,
 			VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -82,20 +73,10 @@ void SwapchainRenderPass::render(VkCommandBuffer commandBuffer, uint32_t imageIn
 			0,
 			nullptr
 		);
+		++RenderStats::frame().descriptorBinds;
 		vkCmdDraw(commandBuffer, 4, 1, 0, 0);
+		++RenderStats::frame().drawCalls;
 	} vkCmdEndRenderPass(commandBuffer);
-
-	VulkanUtils::transitionLayout(
-		commandBuffer,
-		renderedImageResource.image,
-		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-		VK_IMAGE_LAYOUT_GENERAL,
-		VK_IMAGE_ASPECT_COLOR_BIT,
-		VK_ACCESS_SHADER_READ_BIT,
-		VK_ACCESS_SHADER_WRITE_BIT,
-		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-		VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-	);
 }
 
 void SwapchainRenderPass::createImageResources(){
@@ -106,13 +87,39 @@ void SwapchainRenderPass::createImageResources(){
 }
 
 void SwapchainRenderPass::cleanupImageResources() {
-	renderedImageResource.cleanup(device);
-	renderedImageDescriptor.cleanup(device);
-	samplerDescriptor.cleanup(device);
-	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
-	for (auto framebuffer : framebuffers) {
-		vkDestroyFramebuffer(device, framebuffer, nullptr);
+	// frames in flight may still trace into the image or sample it
+	deletionQueue.push([
+		device = device,
+		image = renderedImageResource,
+		renderedImageLayout = renderedImageDescriptor.layout,
+		samplerLayout = samplerDescriptor.layout,
+		pool = descriptorPool
+	]() mutable {
+		image.cleanup(device);
+		vkDestroyDescriptorSetLayout(device, renderedImageLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device, samplerLayout, nullptr);
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	});
+	descriptorPool = VK_NULL_HANDLE;
+	deletionQueue.retireFramebuffers(device, framebuffers);
+}
+
+void SwapchainRenderPass::prepare(VkCommandBuffer commandBuffer) {
+	if (!renderedImageUndefined) {
+		return;
 	}
+	VulkanUtils::transitionLayout(
+		commandBuffer,
+		renderedImageResource.image,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_GENERAL,
+		VK_IMAGE_ASPECT_COLOR_BIT,
+		0,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+	);
+	renderedImageUndefined = false;
 }
 
 void SwapchainRenderPass::createRenderedImage() {
@@ -131,21 +138,8 @@ void SwapchainRenderPass::createRenderedImage() {
 		renderedImageResource.imageMemory
 	);
 	renderedImageResource.imageView = VulkanUtils::createImageView(device, renderedImageResource.image, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-
-	VkCommandBuffer commandBuffer = VulkanUtils::beginSingleTimeCommands(device, commandPool);
-	{
-		VulkanUtils::transitionLayout(
-			commandBuffer,
-			renderedImageResource.image,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_GENERAL,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			0,
-			VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-		);
-	} VulkanUtils::endSingleTimeCommands(device, commandPool, commandBuffer, graphicsQueue);
+	// the next frame transitions it, a one-time submit here would wait for the queue to drain
+	renderedImageUndefined = true;
 }
 
 void SwapchainRenderPass::createDescriptorPool() {
@@ -0,0 +1,380 @@
+#include "texture_streamer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include "camera.hpp"
+#include "render_stats.hpp"
+#include "vulkan_utils.hpp"
+
+void TextureStreamer::init(VkPhysicalDevice physicalDevice, VkDevice device, TransferQueue* transferQueue, VkSampler sampler) {
+	this->physicalDevice = physicalDevice;
+	this->device = device;
+	this->transferQueue = transferQueue;
+	this->sampler = sampler;
+}
+
+void TextureStreamer::cleanup() {
+	for (const auto& upload : uploads) {
+		transferQueue->wait(upload.value);
+		finishUpload(upload);
+	}
+	uploads.clear();
+	for (auto& texture : textures) {
+		texture.retiredImage.cleanup(device);
+		texture.image.cleanup(device);
+	}
+	textures.clear();
+	users.clear();
+}
+
+bool TextureStreamer::load(const std::string& path, Ktx2::Texture&& source, int32_t& textureId) {
+	// models sharing a texture share its residency too
+	for (size_t i = 0; i < textures.size(); ++i) {
+		if (textures[i].path == path) {
+			textureId = static_cast<int32_t>(i);
+			return true;
+		}
+	}
+
+	StreamedTexture texture;
+	texture.source = std::move(source);
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, static_cast<VkFormat>(texture.source.vkFormat), &formatProperties);
+	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+		return false;
+	}
+
+	texture.path = path;
+	uint32_t levelCount = texture.getLevelCount();
+	texture.chainSizes.resize(levelCount + 1, 0);
+	for (uint32_t level = levelCount; level-- > 0;) {
+		texture.chainSizes[level] = texture.chainSizes[level + 1] + texture.source.levels[level].size;
+	}
+	while (texture.tailMip + 1 < levelCount &&
+		std::max(texture.source.width, texture.source.height) >> texture.tailMip > Config::TEXTURE_STREAMING_TAIL_SIZE) {
+		++texture.tailMip;
+	}
+	texture.residentMip = texture.tailMip;
+	texture.wantedMip = texture.tailMip;
+
+	textureId = static_cast<int32_t>(textures.size());
+	textures.push_back(std::move(texture));
+	candidates.reserve(textures.size());
+	uploads.reserve(textures.size());
+
+	beginUpload(textureId, textures[textureId].tailMip);
+	transferQueue->wait(uploads.back().value);
+	finishUpload(uploads.back());
+	uploads.pop_back();
+	return true;
+}
+
+void TextureStreamer::addUser(int32_t textureId, const std::vector<VkDescriptorSet>& descriptorSets, uint32_t binding) {
+	users.push_back({textureId, descriptorSets, binding});
+}
+
+void TextureStreamer::removeUser(const std::vector<VkDescriptorSet>& descriptorSets) {
+	users.erase(
+		std::remove_if(users.begin(), users.end(), [&](const User& user) { return user.descriptorSets == descriptorSets; }),
+		users.end()
+	);
+}
+
+size_t TextureStreamer::getCommittedBytes() const {
+	size_t committed = 0;
+	for (const auto& texture : textures) {
+		committed += texture.chainSizes[texture.uploading ? texture.uploadMip : texture.residentMip];
+	}
+	return committed;
+}
+
+void TextureStreamer::update(uint32_t currentFrame, const std::vector<AssetData>& objects, const Camera& camera, VkExtent2D extent) {
+	++frameIndex;
+
+	for (size_t i = 0; i < uploads.size();) {
+		if (transferQueue->isComplete(uploads[i].value)) {
+			finishUpload(uploads[i]);
+			uploads[i] = uploads.back();
+			uploads.pop_back();
+		} else {
+			++i;
+		}
+	}
+
+	uint32_t frameBit = 1u << currentFrame;
+	for (size_t i = 0; i < textures.size(); ++i) {
+		StreamedTexture& texture = textures[i];
+		if (!(texture.staleDescriptorMask & frameBit)) {
+			continue;
+		}
+		writeDescriptors(static_cast<int32_t>(i), currentFrame);
+		texture.staleDescriptorMask &= ~frameBit;
+		// every frame recorded from now on samples the new image, and the frames that sampled
+		// the old one have passed their fence wait
+		if (texture.staleDescriptorMask == 0) {
+			texture.retiredImage.cleanup(device);
+			texture.retiredImage = {};
+		}
+	}
+
+	estimateWantedMips(objects, camera, extent);
+	scheduleUploads();
+}
+
+void TextureStreamer::beginUpload(int32_t textureId, uint32_t firstMip) {
+	StreamedTexture& texture = textures[textureId];
+	const Ktx2::Texture& source = texture.source;
+	uint32_t levelCount = texture.getLevelCount() - firstMip;
+
+	// KTX2 stores the smallest level first, so the chain from firstMip down is one contiguous range
+	size_t begin = source.levels.back().offset;
+	size_t end = source.levels[firstMip].offset + source.levels[firstMip].size;
+
+	Upload upload{};
+	upload.texture = textureId;
+	upload.firstMip = firstMip;
+	VulkanUtils::createBuffer(
+		physicalDevice,
+		device,
+		end - begin,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		upload.stagingBuffer,
+		upload.stagingBufferMemory,
+		nullptr
+	);
+
+	void* data;
+	vkMapMemory(device, upload.stagingBufferMemory, 0, end - begin, 0, &data);
+	{
+		memcpy(data, source.data.data() + begin, end - begin);
+		RenderStats::frame().bytesUploaded += end - begin;
+	}
+	vkUnmapMemory(device, upload.stagingBufferMemory);
+
+	VkFormat format = static_cast<VkFormat>(source.vkFormat);
+	uint32_t width = std::max(source.width >> firstMip, 1u);
+	uint32_t height = std::max(source.height >> firstMip, 1u);
+	VulkanUtils::createImage(
+		physicalDevice,
+		device,
+		width,
+		height,
+		levelCount,
+		VK_SAMPLE_COUNT_1_BIT,
+		format,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		upload.image.image,
+		upload.image.imageMemory
+	);
+	upload.image.imageView = VulkanUtils::createImageView(device, upload.image.image, format, VK_IMAGE_ASPECT_COLOR_BIT, levelCount);
+
+	VkCommandBuffer commandBuffer = transferQueue->begin();
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = upload.image.image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = levelCount;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	++RenderStats::frame().barriers;
+
+	// level 0 of the new image is firstMip of the source
+	std::array<VkBufferImageCopy, 32> copyRegions{};
+	for (uint32_t level = 0; level < levelCount; ++level) {
+		VkBufferImageCopy& copyRegion = copyRegions[level];
+		copyRegion.bufferOffset = source.levels[firstMip + level].offset - begin;
+		copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copyRegion.imageSubresource.mipLevel = level;
+		copyRegion.imageSubresource.baseArrayLayer = 0;
+		copyRegion.imageSubresource.layerCount = 1;
+		copyRegion.imageOffset = {0, 0, 0};
+		copyRegion.imageExtent = {std::max(width >> level, 1u), std::max(height >> level, 1u), 1};
+	}
+	vkCmdCopyBufferToImage(
+		commandBuffer,
+		upload.stagingBuffer,
+		upload.image.image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		levelCount,
+		copyRegions.data()
+	);
+
+	// ownership goes to the graphics family, update() queues the acquire once the copy completed
+	transferQueue->releaseImage(commandBuffer, upload.image.image, levelCount);
+	upload.value = transferQueue->submit(commandBuffer);
+
+	texture.uploading = true;
+	texture.uploadMip = firstMip;
+	uploads.push_back(upload);
+}
+
+void TextureStreamer::finishUpload(const Upload& upload) {
+	StreamedTexture& texture = textures[upload.texture];
+	if (texture.image.image != VK_NULL_HANDLE) {
+		texture.retiredImage = texture.image;
+		texture.staleDescriptorMask = (1u << Config::MAX_FRAMES_IN_FLIGHT) - 1;
+	}
+	texture.image = upload.image;
+	texture.residentMip = upload.firstMip;
+	texture.uploading = false;
+	transferQueue->acquireImage(upload.image.image, texture.getLevelCount() - upload.firstMip, upload.value);
+
+	vkDestroyBuffer(device, upload.stagingBuffer, nullptr);
+	vkFreeMemory(device, upload.stagingBufferMemory, nullptr);
+}
+
+void TextureStreamer::writeDescriptors(int32_t textureId, uint32_t frame) {
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = textures[textureId].image.imageView;
+	imageInfo.sampler = sampler;
+
+	for (const auto& user : users) {
+		if (user.texture != textureId) {
+			continue;
+		}
+		VkWriteDescriptorSet descriptorWrite{};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = user.descriptorSets[frame];
+		descriptorWrite.dstBinding = user.binding;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pImageInfo = &imageInfo;
+		vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+		++descriptorWrites;
+	}
+}
+
+// a texel should cover about one pixel: compare the texels per world unit of the mesh's
+// UV mapping with the pixels per world unit at the nearest point of its bounding sphere
+void TextureStreamer::estimateWantedMips(const std::vector<AssetData>& objects, const Camera& camera, VkExtent2D extent) {
+	for (auto& texture : textures) {
+		texture.wantedMip = texture.tailMip;
+	}
+
+	glm::vec3 cameraPosition = camera.getPosition();
+	glm::vec3 cameraFront = glm::normalize(camera.getFront());
+	float pixelsPerUnitAtOne = static_cast<float>(extent.height) / (2.0f * std::tan(camera.getFOV() * 0.5f));
+
+	for (const auto& object : objects) {
+		const ModelResource& model = object.resource;
+		glm::vec4 sphere = object.getBoundingSphere();
+		glm::vec3 toObject = glm::vec3(sphere) - cameraPosition;
+		float distance = glm::length(toObject);
+		if (model.uvDensity <= 0.0f || glm::dot(toObject, cameraFront) < -sphere.w || distance - sphere.w > camera.getFarPlane()) {
+			continue;
+		}
+		float pixelsPerUnit = pixelsPerUnitAtOne / std::max(distance - sphere.w, camera.getNearPlane());
+
+		for (int32_t textureId : model.streamedTextures) {
+			if (textureId < 0) {
+				continue;
+			}
+			StreamedTexture& texture = textures[textureId];
+			float texelsPerUnit = model.uvDensity * static_cast<float>(std::max(texture.source.width, texture.source.height));
+			if (object.isInstanceGroup()) {
+				// uvDensity is per object-space unit, scaled up instances spread the texels wider
+				texelsPerUnit /= object.instanceScale;
+			}
+			float lod = std::log2(std::max(texelsPerUnit / pixelsPerUnit, 1.0f));
+			uint32_t mip = std::min(static_cast<uint32_t>(lod), texture.tailMip);
+			texture.wantedMip = std::min(texture.wantedMip, mip);
+			texture.lastUsedFrame = frameIndex;
+		}
+	}
+}
+
+void TextureStreamer::scheduleUploads() {
+	size_t committed = getCommittedBytes();
+
+	// a lowered budget first gives back mips nothing needs right now
+	while (committed > budget) {
+		int32_t victim = findEvictionVictim(-1);
+		if (victim < 0) {
+			break;
+		}
+		StreamedTexture& texture = textures[victim];
+		committed -= texture.chainSizes[texture.residentMip] - texture.chainSizes[texture.wantedMip];
+		beginUpload(victim, texture.wantedMip);
+	}
+
+	candidates.clear();
+	for (size_t i = 0; i < textures.size(); ++i) {
+		if (!isBusy(static_cast<int32_t>(i)) && textures[i].wantedMip < textures[i].residentMip) {
+			candidates.push_back(static_cast<int32_t>(i));
+		}
+	}
+	// the blurriest textures first
+	std::sort(candidates.begin(), candidates.end(), [this](int32_t a, int32_t b) {
+		return textures[a].residentMip - textures[a].wantedMip > textures[b].residentMip - textures[b].wantedMip;
+	});
+
+	size_t upgrades = 0;
+	for (int32_t textureId : candidates) {
+		if (upgrades >= Config::TEXTURE_STREAMING_MAX_UPLOADS) {
+			break;
+		}
+		StreamedTexture& texture = textures[textureId];
+		size_t current = texture.chainSizes[texture.residentMip];
+
+		// make room from the least recently used textures holding more mips than they need
+		while (committed - current + texture.chainSizes[texture.wantedMip] > budget) {
+			int32_t victim = findEvictionVictim(textureId);
+			if (victim < 0) {
+				break;
+			}
+			StreamedTexture& evicted = textures[victim];
+			committed -= evicted.chainSizes[evicted.residentMip] - evicted.chainSizes[evicted.wantedMip];
+			beginUpload(victim, evicted.wantedMip);
+		}
+
+		uint32_t target = texture.wantedMip;
+		while (target < texture.residentMip && committed - current + texture.chainSizes[target] > budget) {
+			++target;
+		}
+		if (target == texture.residentMip) {
+			continue;
+		}
+		committed += texture.chainSizes[target] - current;
+		beginUpload(textureId, target);
+		++upgrades;
+	}
+}
+
+int32_t TextureStreamer::findEvictionVictim(int32_t exclude) const {
+	int32_t victim = -1;
+	for (size_t i = 0; i < textures.size(); ++i) {
+		int32_t textureId = static_cast<int32_t>(i);
+		const StreamedTexture& texture = textures[i];
+		if (textureId == exclude || isBusy(textureId) || texture.residentMip >= texture.wantedMip) {
+			continue;
+		}
+		if (victim < 0 || texture.lastUsedFrame < textures[victim].lastUsedFrame) {
+			victim = textureId;
+		}
+	}
+	return victim;
+}
+
+bool TextureStreamer::isBusy(int32_t textureId) const {
+	const StreamedTexture& texture = textures[textureId];
+	return texture.uploading || texture.retiredImage.image != VK_NULL_HANDLE;
+}
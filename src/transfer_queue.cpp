@@ -0,0 +1,247 @@
+#include "transfer_queue.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "render_stats.hpp"
+
+namespace {
+	VkImageMemoryBarrier createImageOwnershipBarrier(VkImage image, uint32_t levelCount, uint32_t srcFamily, uint32_t dstFamily) {
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcQueueFamilyIndex = srcFamily;
+		barrier.dstQueueFamilyIndex = dstFamily;
+		barrier.image = image;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = levelCount;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+		return barrier;
+	}
+
+	VkBufferMemoryBarrier createBufferOwnershipBarrier(VkBuffer buffer, uint32_t srcFamily, uint32_t dstFamily) {
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = srcFamily;
+		barrier.dstQueueFamilyIndex = dstFamily;
+		barrier.buffer = buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		return barrier;
+	}
+}
+
+void TransferQueue::init(VkDevice device, uint32_t graphicsFamily, uint32_t transferFamily, VkQueue transferQueue) {
+	this->device = device;
+	this->graphicsFamily = graphicsFamily;
+	this->transferFamily = transferFamily;
+	queue = transferQueue;
+
+	VkCommandPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = transferFamily;
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create transfer command pool");
+	}
+
+	VkSemaphoreTypeCreateInfo typeInfo{};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreInfo.pNext = &typeInfo;
+	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &timelineSemaphore) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create transfer timeline semaphore");
+	}
+
+	submissions.reserve(16);
+	imageAcquires.reserve(16);
+	bufferAcquires.reserve(16);
+}
+
+void TransferQueue::cleanup() {
+	wait(nextValue - 1);
+	freeCompletedCommandBuffers();
+	vkDestroySemaphore(device, timelineSemaphore, nullptr);
+	vkDestroyCommandPool(device, commandPool, nullptr);
+}
+
+VkCommandBuffer TransferQueue::begin() {
+	freeCompletedCommandBuffers();
+
+	VkCommandBufferAllocateInfo allocateInfo{};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandPool = commandPool;
+	allocateInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(device, &allocateInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate transfer command buffer");
+	}
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	return commandBuffer;
+}
+
+uint64_t TransferQueue::submit(VkCommandBuffer commandBuffer) {
+	vkEndCommandBuffer(commandBuffer);
+
+	uint64_t value = nextValue++;
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &value;
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &timelineSemaphore;
+	if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("failed to submit transfer command buffer");
+	}
+
+	submissions.push_back({commandBuffer, value});
+	return value;
+}
+
+bool TransferQueue::isComplete(uint64_t value) const {
+	uint64_t completed = 0;
+	vkGetSemaphoreCounterValue(device, timelineSemaphore, &completed);
+	return completed >= value;
+}
+
+void TransferQueue::wait(uint64_t value) const {
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &timelineSemaphore;
+	waitInfo.pValues = &value;
+	vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+}
+
+void TransferQueue::releaseImage(VkCommandBuffer commandBuffer, VkImage image, uint32_t levelCount) {
+	VkImageMemoryBarrier barrier = createImageOwnershipBarrier(image, levelCount, transferFamily, graphicsFamily);
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	if (!isDedicated()) {
+		// same queue family, a plain layout transition does the whole job
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	}
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	++RenderStats::frame().barriers;
+}
+
+void TransferQueue::releaseBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer) {
+	VkBufferMemoryBarrier barrier = createBufferOwnershipBarrier(buffer, transferFamily, graphicsFamily);
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	VkPipelineStageFlags dstStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	if (!isDedicated()) {
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+		dstStage = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	}
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+	++RenderStats::frame().barriers;
+}
+
+void TransferQueue::acquireImage(VkImage image, uint32_t levelCount, uint64_t value) {
+	if (!isDedicated()) {
+		return;
+	}
+	VkImageMemoryBarrier barrier = createImageOwnershipBarrier(image, levelCount, transferFamily, graphicsFamily);
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	imageAcquires.push_back(barrier);
+	acquireValue = std::max(acquireValue, value);
+}
+
+void TransferQueue::acquireBuffer(VkBuffer buffer, uint64_t value) {
+	if (!isDedicated()) {
+		return;
+	}
+	VkBufferMemoryBarrier barrier = createBufferOwnershipBarrier(buffer, transferFamily, graphicsFamily);
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	bufferAcquires.push_back(barrier);
+	acquireValue = std::max(acquireValue, value);
+}
+
+void TransferQueue::releaseShared(VkCommandBuffer commandBuffer) {
+	if (isDedicated()) {
+		return;
+	}
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		1,
+		&barrier,
+		0,
+		nullptr,
+		0,
+		nullptr
+	);
+	++RenderStats::frame().barriers;
+}
+
+void TransferQueue::acquireShared(uint64_t value) {
+	if (!isDedicated()) {
+		return;
+	}
+	acquireValue = std::max(acquireValue, value);
+}
+
+uint64_t TransferQueue::recordAcquires(VkCommandBuffer commandBuffer) {
+	if (!imageAcquires.empty() || !bufferAcquires.empty()) {
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0,
+			0,
+			nullptr,
+			static_cast<uint32_t>(bufferAcquires.size()),
+			bufferAcquires.data(),
+			static_cast<uint32_t>(imageAcquires.size()),
+			imageAcquires.data()
+		);
+		++RenderStats::frame().barriers;
+		imageAcquires.clear();
+		bufferAcquires.clear();
+	}
+	return acquireValue;
+}
+
+void TransferQueue::freeCompletedCommandBuffers() {
+	uint64_t completed = 0;
+	vkGetSemaphoreCounterValue(device, timelineSemaphore, &completed);
+	for (size_t i = 0; i < submissions.size();) {
+		if (submissions[i].value <= completed) {
+			vkFreeCommandBuffers(device, commandPool, 1, &submissions[i].commandBuffer);
+			submissions[i] = submissions.back();
+			submissions.pop_back();
+		} else {
+			++i;
+		}
+	}
+}
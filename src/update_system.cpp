@@ -6,8 +6,10 @@
 #include "input_manager.hpp"
 #include "game_object.hpp"
 #include "camera.hpp"
+#include "cpu_profiler.hpp"
 
 void UpdateSystem::update(GameObject& player, Camera& camera, InputManager& inputManager, float delta) {
+	PROFILE_ZONE("UpdateSystem::update");
 	if (inputManager.isKeyPressed(GLFW_KEY_A)) {
 		player.move(LEFT, delta);
 	}
@@ -0,0 +1,121 @@
+#include "vfs.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+
+#include "asset_pack.hpp"
+#include "mapped_file.hpp"
+
+namespace Vfs {
+	namespace {
+		MappedFile pack;
+		std::filesystem::path root;
+		const AssetPack::Entry* entries = nullptr;
+		uint32_t entryCount = 0;
+		const char* strings = nullptr;
+
+		// the path relative to the pack directory with forward slashes, empty when it is outside
+		std::string toPackPath(const std::string& path) {
+			std::filesystem::path normal = std::filesystem::path(path).lexically_normal();
+			if (!root.empty()) {
+				normal = normal.lexically_relative(root);
+			}
+			std::string packPath = normal.generic_string();
+			if (packPath.empty() || packPath.compare(0, 2, "..") == 0) {
+				return {};
+			}
+			return packPath;
+		}
+
+		const AssetPack::Entry* findEntry(const std::string& path) {
+			if (entries == nullptr) {
+				return nullptr;
+			}
+			std::string packPath = toPackPath(path);
+			if (packPath.empty()) {
+				return nullptr;
+			}
+			uint64_t hash = AssetPack::hashPath(packPath);
+			size_t low = 0;
+			size_t high = entryCount;
+			while (low < high) {
+				size_t middle = (low + high) / 2;
+				if (entries[middle].hash < hash) {
+					low = middle + 1;
+				} else {
+					high = middle;
+				}
+			}
+			for (size_t i = low; i < entryCount && entries[i].hash == hash; ++i) {
+				if (packPath == std::string_view(strings + entries[i].path)) {
+					return &entries[i];
+				}
+			}
+			return nullptr;
+		}
+	}
+
+	bool mount(const std::string& packPath) {
+		unmount();
+		if (!pack.open(packPath)) {
+			return false;
+		}
+		if (!AssetPack::validate(pack.getData(), pack.getSize())) {
+			pack.close();
+			return false;
+		}
+		AssetPack::Header header;
+		std::memcpy(&header, pack.getData(), sizeof(header));
+		entries = reinterpret_cast<const AssetPack::Entry*>(pack.getData() + header.directoryOffset);
+		entryCount = header.entryCount;
+		strings = reinterpret_cast<const char*>(pack.getData() + header.stringsOffset);
+		root = std::filesystem::path(packPath).parent_path().lexically_normal();
+		return true;
+	}
+
+	void unmount() {
+		pack.close();
+		entries = nullptr;
+		entryCount = 0;
+		strings = nullptr;
+		root.clear();
+	}
+
+	bool isMounted() {
+		return pack.isOpen();
+	}
+
+	size_t getMountedFileCount() {
+		return entryCount;
+	}
+
+	bool open(const std::string& path, File& file) {
+		file = find(path);
+		if (file.data != nullptr) {
+			return true;
+		}
+		std::ifstream stream(path, std::ios::binary);
+		if (!stream.is_open()) {
+			return false;
+		}
+		file.bytes.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+		file.data = file.bytes.data();
+		file.size = file.bytes.size();
+		file.packed = false;
+		return true;
+	}
+
+	File find(const std::string& path) {
+		File file;
+		const AssetPack::Entry* entry = findEntry(path);
+		if (entry != nullptr) {
+			file.data = pack.getData() + entry->offset;
+			file.size = static_cast<size_t>(entry->size);
+			file.packed = true;
+		}
+		return file;
+	}
+}
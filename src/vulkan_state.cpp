@@ -10,15 +10,12 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/glm.hpp>
 #include <glm/gtx/hash.hpp>
-
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
-
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 #include <algorithm>
 #include <array>
+#include <cfloat>
 #include <chrono>
 #include <cmath>
 #include <cstddef>
@@ -44,6 +41,9 @@
 #include "raytracing_pipeline.hpp"
 #include "constants.hpp"
 #include "buffer_types.hpp"
+#include "cpu_profiler.hpp"
+#include "render_stats.hpp"
+#include "alloc_tracker.hpp"
 
 const std::vector<const char*> validationLayers = {
 	"VK_LAYER_KHRONOS_validation"
@@ -66,12 +66,6 @@ const bool enableValidationLayers = false;
 const bool enableValidationLayers = true;
 #endif
 
-const std::unordered_map<std::string, int> VulkanState::textureTypeMap = {
-	{"albedo", 0},
-	{"normal", 1},
-	{"material", 2}
-};
-
 enum TEXTURE_TYPES {
 	ALBEDO = 0,
 	NORMAL = 1,
@@ -97,7 +91,14 @@ void VulkanState::init() {
 	gui.setRenderModeChangedCallback([this]() {
 		switchRenderPassCallback();
 	});
-	swapchainRenderPass = std::make_unique<SwapchainRenderPass>(physicalDevice, device, swapchain, graphicsQueue, commandPool);
+	gui.setGpuProfiler(&gpuProfiler);
+	gui.setFrameTelemetry(&frameTelemetry);
+	gui.setTextureStreamer(&textureStreamer);
+	gui.setLodSelector(&lodSelector);
+	gui.setMeshletCuller(&meshletCuller);
+	gui.setGeometryArena(&geometryArena);
+	gui.setRenderQueue(&renderQueue);
+	swapchainRenderPass = std::make_unique<SwapchainRenderPass>(physicalDevice, device, swapchain, deletionQueue);
 	swapchainRenderPass->init();
 }
 
@@ -117,14 +118,42 @@ void VulkanState::createCommonResource() {
 	createCommandBuffers();
 	createTextureSampler();
 	createSyncObjects();
+	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+	transferQueue.init(
+		device,
+		indices.graphicsFamily.value(),
+		indices.transferFamily.value_or(indices.graphicsFamily.value()),
+		transferQueueHandle
+	);
+	std::vector<uint32_t> geometryFamilies = {indices.graphicsFamily.value()};
+	if (transferQueue.isDedicated()) {
+		geometryFamilies.push_back(indices.transferFamily.value());
+	}
+	geometryArena.init(physicalDevice, device, geometryFamilies);
+	instanceBuffer.init(physicalDevice, device);
+	textureStreamer.init(physicalDevice, device, &transferQueue, textureSampler);
+	meshletCuller.init(physicalDevice, device, multiDrawIndirectEnabled, drawIndirectCountEnabled);
+	assetLoader.init(Config::ASSET_LOADER_WORKERS);
+	gpuProfiler.init(
+		physicalDevice,
+		device,
+		findQueueFamilies(physicalDevice).graphicsFamily.value(),
+		pipelineStatisticsEnabled
+	);
+	gpuProfiler.calibrate(commandPool, graphicsQueue);
 }
 
 void VulkanState::createRenderModeResource() {
 	if (gui.isRayTracingMode()) {
 		return;
 	}
+	PROFILE_ZONE("createRenderModeResource");
+	frameTelemetry.markSubsystem(FrameTelemetry::PASS_REBUILD);
 	if (renderModeManager != nullptr) {
-    	oldRenderPassQueue[currentFrame].push_back(std::move(renderModeManager));
+		std::shared_ptr<BaseRenderPass> retired = std::move(renderModeManager);
+		deletionQueue.push([retired]() {
+			retired->cleanup();
+		});
 	}
 	switch (gui.getMode()) {
 		case 1: {
@@ -146,7 +175,8 @@ void VulkanState::createRenderModeResource() {
 				commonDescriptor,
 				modelTextureDescriptorSetLayout,
 				swapchain,
-				VulkanUtils::findDepthFormat(physicalDevice)
+				VulkanUtils::findDepthFormat(physicalDevice),
+				gui.getPixelBlockSize()
 			);
 			renderModeManager = std::move(renderPass);
 			break;
@@ -165,7 +195,17 @@ void VulkanState::createRenderModeResource() {
 			renderModeManager = std::move(renderPass);
 			break;
 	}
+	renderModeManager->setProfiler(&gpuProfiler);
+	renderModeManager->setFrameArena(&frameArena);
+	renderModeManager->setMeshletCuller(&meshletCuller);
+	renderModeManager->setGeometryArena(&geometryArena);
+	renderModeManager->setInstanceBuffer(&instanceBuffer);
+	renderModeManager->setRenderQueue(&renderQueue);
+	renderModeManager->setCommandPool(commandPool);
+	renderModeManager->setDeletionQueue(&deletionQueue);
 	renderModeManager->init();
+	// the new passes and the level's descriptor sets aren't in any cached command buffer yet
+	++sceneGeneration;
 }
 
 void VulkanState::cleanupRenderModeResource() {
@@ -176,17 +216,23 @@ void VulkanState::cleanupRenderModeResource() {
 }
 
 void VulkanState::updateLightSSBO(std::vector<PointLightBuffer>& pointLights, std::vector<DirectionalLightBuffer>& directionalLights) {
+	frameTelemetry.markSubsystem(FrameTelemetry::ASSET_UPLOAD);
 	for (size_t i = 0; i < Config::MAX_FRAMES_IN_FLIGHT; ++i) {
 		memcpy(pointLightSSBOResource.buffersMapped[i], pointLights.data(), sizeof(PointLightBuffer) * pointLights.size());
+		RenderStats::frame().bytesUploaded += sizeof(PointLightBuffer) * pointLights.size();
 	}
 
 	for (size_t i = 0; i < Config::MAX_FRAMES_IN_FLIGHT; ++i) {
 		memcpy(directionalLightSSBOResource.buffersMapped[i], directionalLights.data(), sizeof(DirectionalLightBuffer) * directionalLights.size());
+		RenderStats::frame().bytesUploaded += sizeof(DirectionalLightBuffer) * directionalLights.size();
 	}
 }
 
 void VulkanState::createLevelResource(size_t modelCount, size_t pointLightCount, size_t dirLightCount) {
+	// models requested later grow the buffers in reserveModelMatrices
+	modelCount = std::max<size_t>(modelCount, 1);
 	createBufferResource(sizeof(TransformMatrixBuffer) * modelCount, modelMatrixUBOResource, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+	modelMatrixCapacity.fill(modelCount);
 	createBufferResource(sizeof(CameraMatrixBuffer), cameraMatrixUBOResource, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
 	createBufferResource(sizeof(CameraBuffer), cameraUBOResource, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
 	createBufferResource(sizeof(PointLightBuffer) * pointLightCount, pointLightSSBOResource, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
@@ -198,6 +244,7 @@ void VulkanState::createLevelResource(size_t modelCount, size_t pointLightCount,
 	createCameraUBODescriptor();
 	createLightSSBODescriptor(pointLightCount, dirLightCount);
 	createModelTextureDescriptorSetLayout();
+	createPlaceholderModelResource();
 	createRenderModeResource();
 
 	// for debugging purpose
@@ -211,6 +258,66 @@ void VulkanState::createLevelResource(size_t modelCount, size_t pointLightCount,
 			swapchainRenderPass->getRenderTargetResource()
 		);
 		rayTracingPipeline->init();
+		createRayTracingGraph();
+	}
+}
+
+void VulkanState::createRayTracingGraph() {
+	rayTracingGraph = std::make_unique<RenderGraph>(physicalDevice, device);
+	RenderGraphResource renderedImage = rayTracingGraph->importImage(
+		"rendered image",
+		swapchainRenderPass->getRenderedImage(),
+		VK_IMAGE_ASPECT_COLOR_BIT,
+		VK_IMAGE_LAYOUT_GENERAL,
+		true
+	);
+	rayTracingSwapchainImage = rayTracingGraph->importImage("swapchain", VK_NULL_HANDLE, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false);
+	rayTracingGraph->setOutput(rayTracingSwapchainImage);
+
+	rayTracingGraph->addPass("raytrace", [this](const FrameContext& context) {
+		rayTracingPipeline->render(
+			context.commandBuffer(),
+			context.imageIndex,
+			context.currentFrame,
+			*context.camera,
+			*context.directionalLights,
+			swapchain.extent
+		);
+	})
+		.write(
+			renderedImage,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_PIPELINE_STAGE_RAY_TRACING_SHADER_BIT_KHR,
+			VK_ACCESS_SHADER_WRITE_BIT
+		);
+
+	rayTracingGraph->addPass("swapchain", [this](const FrameContext& context) {
+		swapchainRenderPass->render(context.commandBuffer(), context.imageIndex, context.currentFrame);
+	})
+		.read(
+			renderedImage,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_SHADER_READ_BIT
+		)
+		.write(
+			rayTracingSwapchainImage,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		);
+
+	rayTracingGraph->compile();
+}
+
+void VulkanState::cleanupRayTracingGraph() {
+	if (rayTracingGraph != nullptr) {
+		std::shared_ptr<RenderGraph> retired = std::move(rayTracingGraph);
+		deletionQueue.push([retired]() {
+			retired->cleanup();
+		});
 	}
 }
 
@@ -224,15 +331,44 @@ void VulkanState::cleanupSwapchain() {
 
 void VulkanState::cleanup(AssetData& player, std::vector<AssetData>& props) {
 	gui.cleanup(device);
+	cleanupRayTracingGraph();
 	rayTracingPipeline->cleanup();
 	swapchainRenderPass->cleanup();
 
+	assetLoader.cleanup();
+	for (auto& pending : pendingModels) {
+		transferQueue.wait(pending.value);
+		finishModelUpload(pending);
+		destroyModelResource(pending.resource);
+	}
+	for (auto& resident : residentModels) {
+		if (resident.ticket != 0) {
+			destroyModelResource(resident.resource);
+		}
+	}
+	for (auto& models : retiredModels) {
+		for (auto& model : models) {
+			destroyModelResource(model);
+		}
+		models.clear();
+	}
 	player.resource.cleanup(device);
 	for (auto& prop : props) {
-		prop.resource.cleanup(device);
+		// placeholder copies share placeholderModel's resources
+		if (prop.resource.streamTicket == 0) {
+			prop.resource.cleanup(device);
+		}
 	}
+	placeholderModel.cleanup(device);
+	// also takes the geometry of the player, props and placeholder
+	geometryArena.cleanup();
+	instanceBuffer.cleanup();
+	meshletCuller.cleanup();
+	textureStreamer.cleanup();
+	transferQueue.cleanup();
 
 	renderModeManager->cleanup();
+	deletionQueue.flush();
 	commonDescriptor.cleanup(device);
 	cleanupSwapchain();
 
@@ -250,8 +386,12 @@ void VulkanState::cleanup(AssetData& player, std::vector<AssetData>& props) {
 
 	vkDestroyDescriptorSetLayout(device, modelTextureDescriptorSetLayout, nullptr);
 	vkDestroyDescriptorPool(device, modelDescriptorPool, nullptr);
+	for (auto pool : grownModelDescriptorPools) {
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	}
 	vkDestroySampler(device, textureSampler, nullptr);
 	vkDestroyCommandPool(device, commandPool, nullptr);
+	gpuProfiler.cleanup();
 	vkDestroyDevice(device, nullptr);
 
 	if (enableValidationLayers) {
@@ -263,6 +403,8 @@ void VulkanState::cleanup(AssetData& player, std::vector<AssetData>& props) {
 }
 
 void VulkanState::recreateSwapchain() {
+	PROFILE_ZONE("recreateSwapchain");
+	frameTelemetry.markSubsystem(FrameTelemetry::SWAPCHAIN_RECREATE);
 	int width = 0, height = 0;
 	glfwGetFramebufferSize(windowState.getWindow(), &width, &height);
 	while (width == 0 || height == 0) {
@@ -270,20 +412,31 @@ void VulkanState::recreateSwapchain() {
 		glfwWaitEvents();
 	}
 
-	vkDeviceWaitIdle(device);
-	renderModeManager->cleanupImageResources();
-	swapchainRenderPass->cleanupImageResources();
-	cleanupSwapchain();
-
+	// no device wait, everything the frames in flight still use is retired to the deletion queue
+	Swapchain retired = swapchain;
 	createSwapchain();
 	createSwapchainImageViews();
+	deletionQueue.push([this, retired]() {
+		for (auto imageView : retired.imageViews) {
+			vkDestroyImageView(device, imageView, nullptr);
+		}
+		vkDestroySwapchainKHR(device, retired.handle, nullptr);
+	});
 
 	renderModeManager->setSwapchain(swapchain);
-	renderModeManager->createImageResources();
+	renderModeManager->resize();
 	swapchainRenderPass->setSwapchain(swapchain);
+	swapchainRenderPass->cleanupImageResources();
 	swapchainRenderPass->createImageResources();
+	if (rayTracingGraph != nullptr) {
+		// the rendered image was recreated with the swapchain
+		cleanupRayTracingGraph();
+		createRayTracingGraph();
+	}
 
-	gui.recreateFramebuffer(device, swapchain);
+	gui.recreateFramebuffer(device, swapchain, deletionQueue);
+	// cached command buffers still hold the old extent and attachment descriptor sets
+	++sceneGeneration;
 }
 
 void VulkanState::createInstance() {
@@ -376,6 +529,9 @@ void VulkanState::createLogicalDevice() {
 
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+	if (indices.transferFamily.has_value()) {
+		uniqueQueueFamilies.insert(indices.transferFamily.value());
+	}
 
 	float queuePriority = 1.0f;
 	for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -387,39 +543,66 @@ void VulkanState::createLogicalDevice() {
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	VkPhysicalDeviceFeatures supportedFeatures{};
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+	pipelineStatisticsEnabled = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+	textureCompressionEnabled = supportedFeatures.textureCompressionBC == VK_TRUE;
+	multiDrawIndirectEnabled = supportedFeatures.multiDrawIndirect == VK_TRUE;
+
+	VkPhysicalDeviceVulkan12Features supportedVulkan12Features{};
+	supportedVulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 supportedFeatures2{};
+	supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supportedFeatures2.pNext = &supportedVulkan12Features;
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+	drawIndirectCountEnabled = supportedVulkan12Features.drawIndirectCount == VK_TRUE;
+	// a cached pass is executed inside the pass scope of the profiler, whose statistics query is active then
+	commandCachingSupported = !pipelineStatisticsEnabled || supportedFeatures.inheritedQueries == VK_TRUE;
+
 	VkPhysicalDeviceFeatures basicFeatures{};
 	basicFeatures.samplerAnisotropy = VK_TRUE;
+	basicFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+	basicFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	// several meshlet draws per indirect call
+	basicFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+	// secondary command buffers executed while a query is active
+	basicFeatures.inheritedQueries = supportedFeatures.inheritedQueries;
 
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
-	createInfo.pEnabledFeatures = &basicFeatures;
-
-	VkPhysicalDeviceBufferDeviceAddressFeatures bufferDeviceAddressFeatures{};
-	bufferDeviceAddressFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
-	bufferDeviceAddressFeatures.bufferDeviceAddress = VK_TRUE;
-	bufferDeviceAddressFeatures.pNext = nullptr;
-
 	VkPhysicalDeviceRayTracingPipelineFeaturesKHR rtPipelineFeatures{};
 	rtPipelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_TRACING_PIPELINE_FEATURES_KHR;
 	rtPipelineFeatures.rayTracingPipeline = VK_TRUE;
-	rtPipelineFeatures.pNext = &bufferDeviceAddressFeatures;
+	rtPipelineFeatures.pNext = nullptr;
 
 	VkPhysicalDeviceAccelerationStructureFeaturesKHR asFeatures{};
 	asFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR;
 	asFeatures.accelerationStructure = VK_TRUE;
 	asFeatures.pNext = &rtPipelineFeatures;
 
+	// core since 1.2: timeline semaphores track transfer queue completion, the indirect count
+	// bounds meshlet draws by what the culling pass emitted. the feature structs of these can't be
+	// chained next to this one
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.timelineSemaphore = VK_TRUE;
+	vulkan12Features.drawIndirectCount = supportedVulkan12Features.drawIndirectCount;
+	vulkan12Features.pNext = nullptr;
+
 	VkPhysicalDeviceFeatures2 deviceFeatures2{};
 	deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
-	deviceFeatures2.pNext = &asFeatures;
+	deviceFeatures2.pNext = &vulkan12Features;
 	deviceFeatures2.features = basicFeatures;
 
+	createInfo.pNext = &deviceFeatures2;
+	createInfo.pEnabledFeatures = nullptr;
+
 	std::vector<const char*> requiredExtensions = deviceExtensions;
 	if (gui.isRayTracingAvailable()) {
 		requiredExtensions.insert(requiredExtensions.end(), rtExtensions.begin(), rtExtensions.end());
-		createInfo.pNext = &deviceFeatures2;
-		createInfo.pEnabledFeatures = nullptr;
+		vulkan12Features.bufferDeviceAddress = VK_TRUE;
+		vulkan12Features.pNext = &asFeatures;
 	}
 
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
@@ -440,6 +623,11 @@ void VulkanState::createLogicalDevice() {
 
 	vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
 	vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+	if (indices.transferFamily.has_value()) {
+		vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueueHandle);
+	} else {
+		transferQueueHandle = graphicsQueue;
+	}
 }
 
 void VulkanState::createSwapchain() {
@@ -482,6 +670,8 @@ void VulkanState::createSwapchain() {
 	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE;
+	// lets the presentation engine hand over from the swapchain being replaced, null at startup
+	createInfo.oldSwapchain = swapchain.handle;
 
 	if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapchain.handle) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create swapchain");
@@ -516,21 +706,14 @@ void VulkanState::createCommandPool() {
 	}
 }
 
-void VulkanState::createTextureImage(std::string path, VkImage& image, VkDeviceMemory& imageMemory) {
-	int textureWidth, textureHeight, textureChannels;
-	stbi_uc* pixels = stbi_load(
-		path.c_str(),
-		&textureWidth,
-		&textureHeight,
-		&textureChannels,
-		STBI_rgb_alpha
-	);
-	VkDeviceSize imageSize = textureWidth * textureHeight * 4;
-	mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max<int>(textureWidth, textureHeight)))) + 1;
+void VulkanState::createTextureImage(const AssetLoader::DecodedTexture& texture, int textureType, VkImage& image, VkDeviceMemory& imageMemory, VkFormat& format) {
+	// only albedo holds color, normal and material maps are sampled as linear data
+	format = textureType == TEXTURE_TYPES::ALBEDO ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
 
-	if (!pixels) {
-		throw std::runtime_error("failed to load texture image");
-	}
+	uint32_t textureWidth = texture.width;
+	uint32_t textureHeight = texture.height;
+	VkDeviceSize imageSize = texture.rgba.size();
+	mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(textureWidth, textureHeight)))) + 1;
 
 	VkBuffer stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
@@ -548,12 +731,11 @@ void VulkanState::createTextureImage(std::string path, VkImage& image, VkDeviceM
 	void* data;
 	vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
 	{
-		memcpy(data, pixels, static_cast<size_t>(imageSize));
+		memcpy(data, texture.rgba.data(), static_cast<size_t>(imageSize));
+		RenderStats::frame().bytesUploaded += imageSize;
 	}
 	vkUnmapMemory(device, stagingBufferMemory);
 
-	stbi_image_free(pixels);
-
 	VulkanUtils::createImage(
 		physicalDevice,
 		device,
@@ -561,7 +743,7 @@ void VulkanState::createTextureImage(std::string path, VkImage& image, VkDeviceM
 		textureHeight,
 		mipLevels,
 		VK_SAMPLE_COUNT_1_BIT,
-		VK_FORMAT_R8G8B8A8_SRGB,
+		format,
 		VK_IMAGE_TILING_OPTIMAL,
 		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
@@ -571,17 +753,17 @@ void VulkanState::createTextureImage(std::string path, VkImage& image, VkDeviceM
 
 	transitionImageLayout(
 		image,
-		VK_FORMAT_R8G8B8A8_SRGB,
+		format,
 		VK_IMAGE_LAYOUT_UNDEFINED,
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
 		mipLevels
 	);
-	copyBufferToImage(stagingBuffer, image, static_cast<uint32_t>(textureWidth), static_cast<uint32_t>(textureHeight));
+	copyBufferToImage(stagingBuffer, image, textureWidth, textureHeight);
 
 	vkDestroyBuffer(device, stagingBuffer, nullptr);
 	vkFreeMemory(device, stagingBufferMemory, nullptr);
 
-	generateMipmaps(image, VK_FORMAT_R8G8B8A8_SRGB, textureWidth, textureHeight, mipLevels);
+	generateMipmaps(image, format, textureWidth, textureHeight, mipLevels);
 }
 
 // TODO read explanation
@@ -627,6 +809,7 @@ void VulkanState::generateMipmaps(VkImage image, VkFormat format, uint32_t width
 			1,
 			&barrier
 		);
+		++RenderStats::frame().barriers;
 
 		VkImageBlit blit{};
 		blit.srcOffsets[0] = {0, 0, 0};
@@ -670,6 +853,7 @@ void VulkanState::generateMipmaps(VkImage image, VkFormat format, uint32_t width
 			1,
 			&barrier
 		);
+		++RenderStats::frame().barriers;
 
 		if (mipWidth > 1) {
 			mipWidth /= 2;
@@ -697,6 +881,7 @@ void VulkanState::generateMipmaps(VkImage image, VkFormat format, uint32_t width
 		1,
 		&barrier
 	);
+	++RenderStats::frame().barriers;
 
 	VulkanUtils::endSingleTimeCommands(device, commandPool, commandBuffer, graphicsQueue);
 }
@@ -746,7 +931,8 @@ void VulkanState::createTextureSampler() {
 	createInfo.compareOp = VK_COMPARE_OP_ALWAYS;
 	createInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 	createInfo.minLod = 0.0f;
-	createInfo.maxLod = static_cast<float>(mipLevels);
+	// shared by every texture, each image view limits the levels it exposes
+	createInfo.maxLod = VK_LOD_CLAMP_NONE;
 	createInfo.mipLodBias = 0.0f;
 
 	if (vkCreateSampler(device, &createInfo, nullptr, &textureSampler) != VK_SUCCESS) {
@@ -796,6 +982,7 @@ void VulkanState::transitionImageLayout(
 	}
 
 	vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	++RenderStats::frame().barriers;
 
 	VulkanUtils::endSingleTimeCommands(device, commandPool, commandBuffer, graphicsQueue);
 }
@@ -819,93 +1006,347 @@ void VulkanState::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t wid
 	VulkanUtils::endSingleTimeCommands(device, commandPool, commandBuffer, graphicsQueue);
 }
 
-ModelResource VulkanState::createModelResource(std::string textureDir, std::string modelDir, nlohmann::json data) {
-	ModelResource model{};
-	std::array<VkImageView, 3> textureImageViews;
+ModelResource VulkanState::createModelResource(const std::string& textureDir, const std::string& modelDir, const SceneFile::ModelRef& model) {
+	PROFILE_ZONE("createModelResource");
+	frameTelemetry.markSubsystem(FrameTelemetry::ASSET_UPLOAD);
+	AssetLoader::DecodedModel decoded;
+	AssetLoader::decode(createAssetRequest(textureDir, modelDir, model), decoded);
+
+	PendingModel pending{};
+	uploadModelResource(decoded, pending);
+	transferQueue.wait(pending.value);
+	finishModelUpload(pending);
+	return pending.resource;
+}
 
-	// create texture resources
-	for (const auto& [key, value] : data["textures"].items()) {
-		int index = textureTypeMap.at(key);
-		auto& textureResource = model.textureResources[index];
-		std::string filename = value;
-		createTextureImage("../" + textureDir + "/" + filename, textureResource.image, textureResource.imageMemory);
-		textureResource.imageView = VulkanUtils::createImageView(device, textureResource.image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
-		textureImageViews[index] = textureResource.imageView;
+ModelResource VulkanState::requestModelResource(const std::string& textureDir, const std::string& modelDir, const SceneFile::ModelRef& model) {
+	AssetLoader::Request request = createAssetRequest(textureDir, modelDir, model);
+	request.ticket = nextAssetTicket++;
+
+	ModelResource placeholder = placeholderModel;
+	placeholder.streamTicket = request.ticket;
+	assetLoader.request(std::move(request));
+	return placeholder;
+}
+
+void VulkanState::updateAssetStreaming() {
+	PROFILE_ZONE("asset streaming");
+	// models nobody claimed last frame were released before their placeholder got swapped
+	for (auto& resident : residentModels) {
+		if (resident.ticket != 0) {
+			resident.resource.streamTicket = 0;
+			releaseModelResource(resident.resource);
+		}
 	}
+	residentModels.clear();
 
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string warningMessage, errorMessage;
+	// a few models per frame bound the upload cost of a single frame
+	for (uint32_t i = 0; i < Config::ASSET_STREAMING_MAX_UPLOADS && assetLoader.poll(decodedModel); ++i) {
+		if (!decodedModel.error.empty()) {
+			// the asset keeps its placeholder
+			std::cerr << "failed to stream asset: " << decodedModel.error << std::endl;
+			continue;
+		}
+		frameTelemetry.markSubsystem(FrameTelemetry::ASSET_UPLOAD);
+		pendingModels.emplace_back();
+		pendingModels.back().uploadBeginNs = CpuProfiler::now();
+		uploadModelResource(decodedModel, pendingModels.back());
+	}
 
-	std::string modelName = data["model"];
-	if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warningMessage, &errorMessage, ("../" + modelDir + "/" + modelName).c_str())) {
-		throw std::runtime_error(warningMessage + errorMessage);
+	for (size_t i = 0; i < pendingModels.size();) {
+		PendingModel& pending = pendingModels[i];
+		if (!transferQueue.isComplete(pending.value)) {
+			++i;
+			continue;
+		}
+		finishModelUpload(pending);
+		auto cancelled = std::find(cancelledTickets.begin(), cancelledTickets.end(), pending.ticket);
+		if (cancelled != cancelledTickets.end()) {
+			cancelledTickets.erase(cancelled);
+			releaseModelResource(pending.resource);
+		} else {
+			residentModels.push_back(pending);
+		}
+		pendingModels[i] = std::move(pendingModels.back());
+		pendingModels.pop_back();
 	}
+}
 
-	std::unordered_map<Vertex, uint32_t> uniqueVertices{};
+bool VulkanState::applyResidentModels(std::vector<AssetData>& assets, int64_t* uploadBeginNs) {
+	bool changed = false;
+	for (auto& resident : residentModels) {
+		if (resident.ticket == 0) {
+			continue;
+		}
+		for (auto& asset : assets) {
+			if (asset.resource.streamTicket != resident.ticket) {
+				continue;
+			}
+			asset.resource = resident.resource;
+			if (uploadBeginNs != nullptr && (*uploadBeginNs == 0 || resident.uploadBeginNs < *uploadBeginNs)) {
+				*uploadBeginNs = resident.uploadBeginNs;
+			}
+			resident.ticket = 0;
+			changed = true;
+			break;
+		}
+	}
+	return changed;
+}
 
-	std::vector<Vertex> vertices;
-	std::vector<uint32_t> indices;
-	for (const auto& shape : shapes) {
-		for (const auto& index : shape.mesh.indices) {
-			Vertex vertex{};
-			vertex.pos = {
-				attrib.vertices[3 * index.vertex_index + 0],
-				attrib.vertices[3 * index.vertex_index + 1],
-				attrib.vertices[3 * index.vertex_index + 2]
-			};
-
-			vertex.normal = {
-				attrib.normals[3 * index.normal_index + 0],
-				attrib.normals[3 * index.normal_index + 1],
-				attrib.normals[3 * index.normal_index + 2]
-			};
-
-			vertex.texCoord = {
-				attrib.texcoords[2 * index.texcoord_index + 0],
-				1.0f - attrib.texcoords[2 * index.texcoord_index + 1]
-			};
+void VulkanState::releaseModelResource(const ModelResource& model) {
+	if (model.streamTicket != 0) {
+		// the shared placeholder stays, the model itself is dropped wherever it is
+		if (!assetLoader.cancel(model.streamTicket)) {
+			cancelledTickets.push_back(model.streamTicket);
+		}
+		return;
+	}
+	textureStreamer.removeUser(model.descriptorSets);
+	// the last submitted frame may still draw it, destroyed once that frame slot's fence is waited on again
+	uint32_t lastFrame = (currentFrame + Config::MAX_FRAMES_IN_FLIGHT - 1) % Config::MAX_FRAMES_IN_FLIGHT;
+	retiredModels[lastFrame].push_back(model);
+}
 
-			vertex.color = {1.0f, 1.0f, 1.0f};
+AssetData VulkanState::requestInstanceGroup(
+	const std::string& textureDir,
+	const std::string& modelDir,
+	const SceneFile::Scene& scene,
+	const SceneFile::InstanceGroup& group
+) {
+	// facing +x at the origin, the object's transform is the identity
+	AssetData asset{GameObject(glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f))};
+	asset.resource = requestModelResource(textureDir, modelDir, scene.getModel(group.model));
+
+	auto instances = scene.getInstances(group);
+	std::vector<glm::mat4> transforms;
+	transforms.reserve(instances.size());
+	glm::vec3 boundsMin(FLT_MAX);
+	glm::vec3 boundsMax(-FLT_MAX);
+	asset.instanceScale = 0.0f;
+	for (const auto& instance : instances) {
+		// placed like a prop with the same position and direction
+		GameObject object(glm::make_vec3(instance.position), glm::make_vec3(instance.direction));
+		transforms.push_back(glm::scale(object.getModelMatrix(), glm::vec3(instance.scale)));
+		boundsMin = glm::min(boundsMin, object.getPosition());
+		boundsMax = glm::max(boundsMax, object.getPosition());
+		asset.instanceScale = std::max(asset.instanceScale, instance.scale);
+	}
+	asset.instanceCenter = 0.5f * (boundsMin + boundsMax);
+	for (const auto& instance : instances) {
+		asset.instanceRadius = std::max(asset.instanceRadius, glm::length(glm::make_vec3(instance.position) - asset.instanceCenter));
+	}
+	asset.firstInstance = instanceBuffer.allocate(transforms);
+	asset.instanceCount = static_cast<uint32_t>(transforms.size());
+	return asset;
+}
 
-			if (uniqueVertices.count(vertex) == 0) {
-				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-				vertices.push_back(vertex);
-			}
+void VulkanState::releaseInstances(const AssetData& asset) {
+	if (!asset.isInstanceGroup()) {
+		return;
+	}
+	uint32_t lastFrame = (currentFrame + Config::MAX_FRAMES_IN_FLIGHT - 1) % Config::MAX_FRAMES_IN_FLIGHT;
+	retiredInstances[lastFrame].push_back({asset.firstInstance, asset.instanceCount});
+}
+
+bool VulkanState::isStreamingIdle() {
+	// residentModels clears on the frame after they were applied
+	return assetLoader.getPendingCount() == 0
+		&& pendingModels.empty()
+		&& residentModels.empty()
+		&& textureStreamer.getPendingUploadCount() == 0;
+}
+
+void VulkanState::destroyModelResource(ModelResource& model) {
+	meshletCuller.freeModelSet(model);
+	geometryArena.free(model.geometry);
+	vkFreeDescriptorSets(device, model.descriptorPool, static_cast<uint32_t>(model.descriptorSets.size()), model.descriptorSets.data());
+	model.cleanup(device);
+}
 
-			indices.push_back(uniqueVertices[vertex]);
+AssetLoader::Request VulkanState::createAssetRequest(const std::string& textureDir, const std::string& modelDir, const SceneFile::ModelRef& model) {
+	AssetLoader::Request request;
+	for (size_t slot = 0; slot < model.textures.size(); ++slot) {
+		if (!model.textures[slot].empty()) {
+			request.texturePaths[slot] = "../" + textureDir + "/" + std::string(model.textures[slot]);
 		}
 	}
+	request.modelPath = "../" + modelDir + "/" + std::string(model.path);
+	request.preferCooked = textureCompressionEnabled;
+	return request;
+}
 
-	// load vertices and create vertex buffer
-	VkBuffer vertexBuffer;
-	VkDeviceMemory vertexBufferMemory;
-	createVertexBuffer(vertices, vertexBuffer, vertexBufferMemory);
-	model.vertexBufferResource.buffer = vertexBuffer;
-	model.vertexBufferResource.bufferMemory = vertexBufferMemory;
+void VulkanState::uploadModelResource(AssetLoader::DecodedModel& decoded, PendingModel& pending) {
+	ModelResource& model = pending.resource;
+	pending.ticket = decoded.ticket;
 
-	// create index buffer
-	VkBuffer indexBuffer;
-	VkDeviceMemory indexBufferMemory;
-	createIndexBuffer(indices, indexBuffer, indexBufferMemory);
-	model.indexBufferResource.buffer = indexBuffer;
-	model.indexBufferResource.bufferMemory = indexBufferMemory;
-	model.indexCount = size(indices);
+	// slots the model has no texture for sample the placeholder's
+	std::array<VkImageView, 3> textureImageViews;
+	for (size_t i = 0; i < textureImageViews.size(); ++i) {
+		textureImageViews[i] = placeholderModel.textureResources[i].imageView;
+	}
+
+	// create texture resources
+	for (int index = 0; index < static_cast<int>(decoded.textures.size()); ++index) {
+		AssetLoader::DecodedTexture& texture = decoded.textures[index];
+		if (texture.path.empty()) {
+			continue;
+		}
+
+		// textures cooked by rtg-cook stream their mips, the rest stay fully resident
+		if (texture.cooked) {
+			if (textureStreamer.load(texture.path, std::move(texture.compressed), model.streamedTextures[index])) {
+				textureImageViews[index] = textureStreamer.getImageView(model.streamedTextures[index]);
+				continue;
+			}
+			AssetLoader::decodeImage(texture.path, texture);
+		}
+
+		auto& textureResource = model.textureResources[index];
+		VkFormat format;
+		createTextureImage(texture, index, textureResource.image, textureResource.imageMemory, format);
+		textureResource.imageView = VulkanUtils::createImageView(device, textureResource.image, format, VK_IMAGE_ASPECT_COLOR_BIT, mipLevels);
+		textureImageViews[index] = textureResource.imageView;
+		// the mip chain adds a third
+		model.residentBytes += texture.rgba.size() * 4 / 3;
+	}
+
+	// vertex, index and meshlet copies share one transfer submission, frames keep rendering meanwhile
+	VkCommandBuffer commandBuffer = transferQueue.begin();
+	model.sortId = nextSortId++;
+	model.geometry = geometryArena.allocate(
+		static_cast<uint32_t>(decoded.vertices.size()),
+		static_cast<uint32_t>(decoded.indices.size())
+	);
+	createVertexBuffer(
+		decoded.vertices,
+		model,
+		commandBuffer,
+		pending.stagingBuffers[0],
+		pending.stagingBuffersMemory[0]
+	);
+	createIndexBuffer(
+		decoded.indices,
+		model.geometry,
+		commandBuffer,
+		pending.stagingBuffers[1],
+		pending.stagingBuffersMemory[1]
+	);
+	if (!decoded.meshlets.empty()) {
+		createMeshletBuffer(
+			decoded.meshlets,
+			model.meshletBufferResource.buffer,
+			model.meshletBufferResource.bufferMemory,
+			commandBuffer,
+			pending.stagingBuffers[2],
+			pending.stagingBuffersMemory[2]
+		);
+		model.meshletCount = static_cast<uint32_t>(decoded.meshlets.size());
+	}
+	transferQueue.releaseShared(commandBuffer);
+	pending.value = transferQueue.submit(commandBuffer);
+	if (decoded.lods.empty()) {
+		decoded.lods.push_back({0, static_cast<uint32_t>(decoded.indices.size()), 0.0f});
+	}
+	model.lodCount = static_cast<uint32_t>(std::min<size_t>(decoded.lods.size(), model.lods.size()));
+	std::copy_n(decoded.lods.begin(), model.lodCount, model.lods.begin());
+	model.residentBytes += PackedVertex::getSize(decoded.vertices.size()) + sizeof(uint32_t) * decoded.indices.size();
+	model.residentBytes += sizeof(MeshFile::Meshlet) * decoded.meshlets.size();
+	meshletCuller.createModelSet(model);
+
+	const std::vector<Vertex>& vertices = decoded.vertices;
+	const uint32_t* indices = decoded.indices.data() + model.lods[0].firstIndex;
+	// inputs of the streaming mip estimate, the triangle area factors of 1/2 cancel out. of the full resolution LOD
+	float worldArea = 0.0f;
+	float uvArea = 0.0f;
+	for (size_t i = 0; i + 2 < model.lods[0].indexCount; i += 3) {
+		const Vertex& a = vertices[indices[i]];
+		const Vertex& b = vertices[indices[i + 1]];
+		const Vertex& c = vertices[indices[i + 2]];
+		worldArea += glm::length(glm::cross(b.pos - a.pos, c.pos - a.pos));
+		glm::vec2 uvEdge0 = b.texCoord - a.texCoord;
+		glm::vec2 uvEdge1 = c.texCoord - a.texCoord;
+		uvArea += std::abs(uvEdge0.x * uvEdge1.y - uvEdge0.y * uvEdge1.x);
+	}
+	model.uvDensity = worldArea > 0.0f ? std::sqrt(uvArea / worldArea) : 0.0f;
+	for (const auto& vertex : vertices) {
+		model.boundingRadius = std::max(model.boundingRadius, glm::length(vertex.pos));
+	}
 
 	// create DescriptorSet
 	std::vector<VkDescriptorSet> descriptorSets;
-	createModelTextureDescriptorSets(descriptorSets, textureImageViews);
+	createModelTextureDescriptorSets(descriptorSets, model.descriptorPool, textureImageViews);
 	model.descriptorSets = descriptorSets;
+	for (uint32_t binding = 0; binding < model.streamedTextures.size(); ++binding) {
+		if (model.streamedTextures[binding] >= 0) {
+			textureStreamer.addUser(model.streamedTextures[binding], descriptorSets, binding);
+		}
+	}
+}
 
-	return model;
+void VulkanState::finishModelUpload(PendingModel& pending) {
+	for (size_t i = 0; i < pending.stagingBuffers.size(); ++i) {
+		vkDestroyBuffer(device, pending.stagingBuffers[i], nullptr);
+		vkFreeMemory(device, pending.stagingBuffersMemory[i], nullptr);
+	}
+	transferQueue.acquireShared(pending.value);
+	if (pending.resource.meshletBufferResource.buffer != VK_NULL_HANDLE) {
+		transferQueue.acquireBuffer(pending.resource.meshletBufferResource.buffer, pending.value);
+	}
 }
 
-void VulkanState::createVertexBuffer(std::vector<Vertex>& vertices, VkBuffer& vertexBuffer, VkDeviceMemory& vertexBufferMemory) {
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
+// grey unit cube drawn in place of models that are still streaming in
+void VulkanState::createPlaceholderModelResource() {
+	AssetLoader::DecodedModel decoded;
+	const glm::vec3 faceNormals[] = {
+		{1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f},
+		{0.0f, 1.0f, 0.0f}, {0.0f, -1.0f, 0.0f},
+		{0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}
+	};
+	const glm::vec2 corners[] = {{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}};
+	for (const auto& normal : faceNormals) {
+		glm::vec3 tangent = std::abs(normal.y) > 0.5f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		glm::vec3 bitangent = glm::cross(normal, tangent);
+		uint32_t base = static_cast<uint32_t>(decoded.vertices.size());
+		for (const auto& corner : corners) {
+			Vertex vertex{};
+			vertex.pos = 0.5f * normal + (corner.x - 0.5f) * tangent + (corner.y - 0.5f) * bitangent;
+			vertex.normal = normal;
+			vertex.color = {1.0f, 1.0f, 1.0f};
+			vertex.texCoord = corner;
+			decoded.vertices.push_back(vertex);
+		}
+		// counter-clockwise seen from outside
+		for (uint32_t index : {0u, 1u, 2u, 2u, 3u, 0u}) {
+			decoded.indices.push_back(base + index);
+		}
+	}
+
+	// grey albedo, flat normal, dielectric and fully rough
+	const uint8_t texels[3][4] = {{128, 128, 128, 255}, {128, 128, 255, 255}, {0, 255, 0, 255}};
+	for (size_t i = 0; i < decoded.textures.size(); ++i) {
+		decoded.textures[i].path = "placeholder";
+		decoded.textures[i].width = 1;
+		decoded.textures[i].height = 1;
+		decoded.textures[i].rgba.assign(texels[i], texels[i] + 4);
+	}
+
+	PendingModel pending{};
+	uploadModelResource(decoded, pending);
+	transferQueue.wait(pending.value);
+	finishModelUpload(pending);
+	placeholderModel = pending.resource;
+}
+
+void VulkanState::createVertexBuffer(
+	const std::vector<Vertex>& vertices,
+	ModelResource& model,
+	VkCommandBuffer commandBuffer,
+	VkBuffer& stagingBuffer,
+	VkDeviceMemory& stagingBufferMemory
+) {
+	VkDeviceSize bufferSize = PackedVertex::getSize(vertices.size());
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
 	VulkanUtils::createBuffer(
 		physicalDevice,
 		device,
@@ -920,32 +1361,55 @@ void VulkanState::createVertexBuffer(std::vector<Vertex>& vertices, VkBuffer& ve
 	void* data;
 	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
 	{
-		memcpy(data, vertices.data(), (size_t) bufferSize);
+		model.positionDequantize = PackedVertex::pack(vertices, static_cast<uint8_t*>(data));
+		RenderStats::frame().bytesUploaded += bufferSize;
 	}
 	vkUnmapMemory(device, stagingBufferMemory);
 
+	geometryArena.copyVertices(commandBuffer, model.geometry, stagingBuffer);
+}
+
+void VulkanState::createIndexBuffer(
+	const std::vector<uint32_t>& indices,
+	const GeometryArena::Allocation& geometry,
+	VkCommandBuffer commandBuffer,
+	VkBuffer& stagingBuffer,
+	VkDeviceMemory& stagingBufferMemory
+) {
+	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+
 	VulkanUtils::createBuffer(
 		physicalDevice,
 		device,
 		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		vertexBuffer,
-		vertexBufferMemory,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stagingBuffer,
+		stagingBufferMemory,
 		nullptr
 	);
 
-	copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
+	void* data;
+	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
+	{
+		memcpy(data, indices.data(), (size_t) bufferSize);
+		RenderStats::frame().bytesUploaded += bufferSize;
+	}
+	vkUnmapMemory(device, stagingBufferMemory);
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	geometryArena.copyIndices(commandBuffer, geometry, stagingBuffer);
 }
 
-void VulkanState::createIndexBuffer(std::vector<uint32_t>& indices, VkBuffer& indexBuffer, VkDeviceMemory& indexBufferMemory) {
-	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
+void VulkanState::createMeshletBuffer(
+	const std::vector<MeshFile::Meshlet>& meshlets,
+	VkBuffer& meshletBuffer,
+	VkDeviceMemory& meshletBufferMemory,
+	VkCommandBuffer commandBuffer,
+	VkBuffer& stagingBuffer,
+	VkDeviceMemory& stagingBufferMemory
+) {
+	VkDeviceSize bufferSize = sizeof(meshlets[0]) * meshlets.size();
 
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
 	VulkanUtils::createBuffer(
 		physicalDevice,
 		device,
@@ -960,7 +1424,8 @@ void VulkanState::createIndexBuffer(std::vector<uint32_t>& indices, VkBuffer& in
 	void* data;
 	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
 	{
-		memcpy(data, indices.data(), (size_t) bufferSize);
+		memcpy(data, meshlets.data(), (size_t) bufferSize);
+		RenderStats::frame().bytesUploaded += bufferSize;
 	}
 	vkUnmapMemory(device, stagingBufferMemory);
 
@@ -968,17 +1433,14 @@ void VulkanState::createIndexBuffer(std::vector<uint32_t>& indices, VkBuffer& in
 		physicalDevice,
 		device,
 		bufferSize,
-		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		indexBuffer,
-		indexBufferMemory,
+		meshletBuffer,
+		meshletBufferMemory,
 		nullptr
 	);
 
-	copyBuffer(stagingBuffer, indexBuffer, bufferSize);
-
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	copyBuffer(commandBuffer, stagingBuffer, meshletBuffer, bufferSize);
 }
 
 void VulkanState::createBufferResource(VkDeviceSize bufferSize, BufferResource& bufferResource, VkBufferUsageFlags usage) {
@@ -1015,6 +1477,8 @@ void VulkanState::createModelDescriptorPool(size_t assetCount, size_t lightCount
 
 	VkDescriptorPoolCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	// models unloaded at runtime give their texture sets back
+	createInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
 	createInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
 	createInfo.pPoolSizes = poolSizes.data();
 	createInfo.maxSets = Config::MAX_FRAMES_IN_FLIGHT * 50;
@@ -1024,6 +1488,67 @@ void VulkanState::createModelDescriptorPool(size_t assetCount, size_t lightCount
 	}
 }
 
+// texture descriptor sets only, the common sets stay in modelDescriptorPool
+void VulkanState::growModelDescriptorPool() {
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = Config::MAX_FRAMES_IN_FLIGHT * Config::MODEL_DESCRIPTOR_POOL_GROWTH * 3;
+
+	VkDescriptorPoolCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	createInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+	createInfo.poolSizeCount = 1;
+	createInfo.pPoolSizes = &poolSize;
+	createInfo.maxSets = Config::MAX_FRAMES_IN_FLIGHT * Config::MODEL_DESCRIPTOR_POOL_GROWTH;
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(device, &createInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create descriptor pool");
+	}
+	grownModelDescriptorPools.push_back(pool);
+}
+
+void VulkanState::reserveModelMatrices(size_t modelCount) {
+	if (modelCount <= modelMatrixCapacity[currentFrame]) {
+		return;
+	}
+	// the fence wait of currentFrame already passed, no submission reads its buffer anymore
+	size_t capacity = std::max(modelCount, modelMatrixCapacity[currentFrame] * 2);
+	VkDeviceSize bufferSize = sizeof(TransformMatrixBuffer) * capacity;
+	vkDestroyBuffer(device, modelMatrixUBOResource.buffers[currentFrame], nullptr);
+	vkFreeMemory(device, modelMatrixUBOResource.buffersMemory[currentFrame], nullptr);
+	VulkanUtils::createBuffer(
+		physicalDevice,
+		device,
+		bufferSize,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		modelMatrixUBOResource.buffers[currentFrame],
+		modelMatrixUBOResource.buffersMemory[currentFrame],
+		nullptr
+	);
+	vkMapMemory(device, modelMatrixUBOResource.buffersMemory[currentFrame], 0, bufferSize, 0, &modelMatrixUBOResource.buffersMapped[currentFrame]);
+
+	VkDescriptorBufferInfo modelMatrixBufferInfo{};
+	modelMatrixBufferInfo.buffer = modelMatrixUBOResource.buffers[currentFrame];
+	modelMatrixBufferInfo.offset = 0;
+	modelMatrixBufferInfo.range = sizeof(TransformMatrixBuffer);
+
+	VkWriteDescriptorSet descriptorWrite{};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = commonDescriptor.modelMatrix.sets[currentFrame];
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &modelMatrixBufferInfo;
+	vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+	// the update invalidates command buffers that bound the set
+	++sceneGeneration;
+
+	modelMatrixCapacity[currentFrame] = capacity;
+}
+
 void VulkanState::createModelTextureDescriptorSetLayout() {
 	VkDescriptorSetLayoutBinding albedoLayoutBinding{};
 	albedoLayoutBinding.binding = TEXTURE_TYPES::ALBEDO;
@@ -1062,18 +1587,29 @@ void VulkanState::createModelTextureDescriptorSetLayout() {
 	}
 }
 
-void VulkanState::createModelTextureDescriptorSets(std::vector<VkDescriptorSet>& descriptorSets, std::array<VkImageView, 3>& textureImageViews) {
+void VulkanState::createModelTextureDescriptorSets(
+	std::vector<VkDescriptorSet>& descriptorSets,
+	VkDescriptorPool& descriptorPool,
+	std::array<VkImageView, 3>& textureImageViews
+) {
 	std::vector<VkDescriptorSetLayout> layouts(Config::MAX_FRAMES_IN_FLIGHT, modelTextureDescriptorSetLayout);
 	VkDescriptorSetAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = modelDescriptorPool;
+	allocInfo.descriptorPool = grownModelDescriptorPools.empty() ? modelDescriptorPool : grownModelDescriptorPools.back();
 	allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
 	allocInfo.pSetLayouts = layouts.data();
 
 	descriptorSets.resize(Config::MAX_FRAMES_IN_FLIGHT);
-	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+	VkResult result = vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data());
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+		growModelDescriptorPool();
+		allocInfo.descriptorPool = grownModelDescriptorPools.back();
+		result = vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data());
+	}
+	if (result != VK_SUCCESS) {
 		throw std::runtime_error("failed to allocate descriptor set");
 	}
+	descriptorPool = allocInfo.descriptorPool;
 
 	for (size_t i = 0; i < Config::MAX_FRAMES_IN_FLIGHT; ++i) {
 		std::vector<VkDescriptorImageInfo> imageInfos;
@@ -1313,14 +1849,12 @@ void VulkanState::createLightSSBODescriptor(size_t pointLightCount, size_t dirLi
 	}
 }
 
-void VulkanState::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-	VkCommandBuffer commandBuffer = VulkanUtils::beginSingleTimeCommands(device, commandPool);
-
+// records into a transfer queue command buffer, the caller acquires dstBuffer once it completed
+void VulkanState::copyBuffer(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
 	VkBufferCopy copyRegion{};
 	copyRegion.size = size;
 	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-	VulkanUtils::endSingleTimeCommands(device, commandPool, commandBuffer, graphicsQueue);
+	transferQueue.releaseBuffer(commandBuffer, dstBuffer);
 }
 
 void VulkanState::createCommandBuffers() {
@@ -1359,6 +1893,7 @@ void VulkanState::createSyncObjects() {
 }
 
 void VulkanState::updateCamera(const Camera& camera) {
+	PROFILE_ZONE("VulkanState::updateCamera");
 	CameraBuffer cameraUBO{};
 	cameraUBO.position = camera.getPosition();
 	cameraUBO.front = camera.getFront();
@@ -1366,6 +1901,7 @@ void VulkanState::updateCamera(const Camera& camera) {
 	cameraUBO.fov = camera.getFOV();
 
 	memcpy(cameraUBOResource.buffersMapped[currentFrame], &cameraUBO, sizeof(cameraUBO));
+	RenderStats::frame().bytesUploaded += sizeof(cameraUBO);
 
 	CameraMatrixBuffer cameraMatrixUBO{};
 	cameraMatrixUBO.view = camera.getViewMatrix();
@@ -1377,26 +1913,57 @@ void VulkanState::updateCamera(const Camera& camera) {
 	    ? glm::perspective(camera.getFOV(), aspect, camera.getNearPlane(), camera.getFarPlane())
 		: glm::ortho(-aspect, aspect, -1.0f, 1.0f, 0.1f, 100.0f);
 	cameraMatrixUBO.projection[1][1] *= -1;
+	viewProjection = cameraMatrixUBO.projection * cameraMatrixUBO.view;
 
 	memcpy(cameraMatrixUBOResource.buffersMapped[currentFrame], &cameraMatrixUBO, sizeof(cameraMatrixUBO));
+	RenderStats::frame().bytesUploaded += sizeof(cameraMatrixUBO);
+}
+
+void VulkanState::selectLods(std::vector<AssetData>& objects, const Camera& camera) {
+	PROFILE_ZONE("select LODs");
+	lodSelector.update(objects, camera, swapchain.extent);
 }
 
 void VulkanState::render(
 	const std::vector<AssetData>& objects,
 	const Camera& camera,
-	const std::vector<DirectionalLightBuffer> directionalLights
+	const std::vector<DirectionalLightBuffer>& directionalLights
 ) {
-	vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+	frameTelemetry.beginFrame(CpuProfiler::now());
+	frameArena.reset();
+
+	{
+		PROFILE_ZONE("wait fence");
+		vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+	}
+	deletionQueue.collect(currentFrame);
+	for (auto& model : retiredModels[currentFrame]) {
+		destroyModelResource(model);
+	}
+	retiredModels[currentFrame].clear();
+	for (const auto& [firstInstance, instanceCount] : retiredInstances[currentFrame]) {
+		instanceBuffer.free(firstInstance, instanceCount);
+	}
+	retiredInstances[currentFrame].clear();
+	reserveModelMatrices(objects.size());
+	{
+		PROFILE_ZONE("texture streaming");
+		textureStreamer.update(currentFrame, objects, camera, swapchain.extent);
+	}
 
 	uint32_t imageIndex;
-	VkResult result = vkAcquireNextImageKHR(
-		device,
-		swapchain.handle,
-		UINT64_MAX,
-		imageAvailableSemaphores[currentFrame],
-		VK_NULL_HANDLE,
-		&imageIndex
-	);
+	VkResult result;
+	{
+		PROFILE_ZONE("acquire");
+		result = vkAcquireNextImageKHR(
+			device,
+			swapchain.handle,
+			UINT64_MAX,
+			imageAvailableSemaphores[currentFrame],
+			VK_NULL_HANDLE,
+			&imageIndex
+		);
+	}
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
 		recreateSwapchain();
@@ -1415,11 +1982,48 @@ void VulkanState::render(
 	if (vkBeginCommandBuffer(commandBuffers[currentFrame], &beginInfo) != VK_SUCCESS) {
 		throw std::runtime_error("failed to begin recording command buffer");
 	}
+	gpuProfiler.beginFrame(commandBuffers[currentFrame], currentFrame);
+	swapchainRenderPass->prepare(commandBuffers[currentFrame]);
+	uint64_t transferValue = transferQueue.recordAcquires(commandBuffers[currentFrame]);
 
 	if (gui.isRayTracingMode()) {
-		rayTracingPipeline->render(commandBuffers[currentFrame], imageIndex, currentFrame, camera, directionalLights, swapchain.extent);
-		swapchainRenderPass->render(commandBuffers[currentFrame], imageIndex, currentFrame);
+		FrameContext context{};
+		context.commandBuffers = &commandBuffers;
+		context.imageIndex = imageIndex;
+		context.currentFrame = currentFrame;
+		context.camera = &camera;
+		context.directionalLights = &directionalLights;
+		context.window = windowState.getWindow();
+		context.profiler = &gpuProfiler;
+		context.arena = &frameArena;
+
+		rayTracingGraph->setImportedImage(rayTracingSwapchainImage, swapchain.images[imageIndex]);
+		rayTracingGraph->execute(context);
 	} else {
+		renderQueue.build(objects, camera.getPosition(), glm::normalize(camera.getFront()));
+		{
+			PROFILE_ZONE("meshlet cull");
+			GpuProfileScope scope(&gpuProfiler, commandBuffers[currentFrame], "meshlet cull");
+			meshletCuller.record(commandBuffers[currentFrame], currentFrame, objects, viewProjection, camera.getPosition());
+		}
+		// every object's matrix, the passes only bind its offset so that their cached draws stay valid
+		for (uint32_t i = 0; i < objects.size(); ++i) {
+			objects[i].updateModelTransformMatrix(i, modelMatrixUBOResource.buffersMapped[currentFrame]);
+		}
+		RenderStats::frame().bytesUploaded += sizeof(TransformMatrixBuffer) * objects.size();
+
+		DrawState drawState;
+		drawState.renderQueue = renderQueue.getSignature();
+		drawState.textureWrites = textureStreamer.getDescriptorWrites();
+		drawState.meshletReallocations = meshletCuller.getReallocations();
+		drawState.meshletCulling = meshletCuller.isEnabled();
+		drawState.depthPrepass = gui.isDepthPrepass();
+		if (drawState != lastDrawState) {
+			lastDrawState = drawState;
+			++sceneGeneration;
+		}
+		renderModeManager->setDepthPrepass(gui.isDepthPrepass());
+		renderModeManager->setCommandCaching(gui.isCacheCommands() && commandCachingSupported, sceneGeneration);
 		renderModeManager->render(
 			commandBuffers,
 			imageIndex,
@@ -1432,7 +2036,11 @@ void VulkanState::render(
 		);
 	}
 
-	gui.render(commandBuffers[currentFrame], swapchain.extent, imageIndex);
+	{
+		PROFILE_ZONE("gui");
+		GpuProfileScope scope(&gpuProfiler, commandBuffers[currentFrame], "gui");
+		gui.render(commandBuffers[currentFrame], swapchain.extent, imageIndex);
+	}
 
 	if (vkEndCommandBuffer(commandBuffers[currentFrame]) != VK_SUCCESS) {
 		throw std::runtime_error("failed to record command buffer");
@@ -1441,12 +2049,20 @@ void VulkanState::render(
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-	VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-	VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-	submitInfo.waitSemaphoreCount = 1;
+	// uploads the frame acquired ownership of are complete before it reads them
+	VkSemaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame], transferQueue.getTimelineSemaphore()};
+	VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
+	uint64_t waitValues[] = {0, transferValue};
+	submitInfo.waitSemaphoreCount = 2;
 	submitInfo.pWaitSemaphores = waitSemaphores;
 	submitInfo.pWaitDstStageMask = waitStages;
 
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = 2;
+	timelineInfo.pWaitSemaphoreValues = waitValues;
+	submitInfo.pNext = &timelineInfo;
+
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 
@@ -1454,9 +2070,13 @@ void VulkanState::render(
 	submitInfo.signalSemaphoreCount = 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
-	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-		throw std::runtime_error("failed to submit draw command buffer");
+	{
+		PROFILE_ZONE("submit");
+		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit draw command buffer");
+		}
 	}
+	deletionQueue.submit(currentFrame);
 
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -1470,7 +2090,10 @@ void VulkanState::render(
 
 	presentInfo.pImageIndices = &imageIndex;
 
-	result = vkQueuePresentKHR(presentQueue, &presentInfo);
+	{
+		PROFILE_ZONE("present");
+		result = vkQueuePresentKHR(presentQueue, &presentInfo);
+	}
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || windowState.isFramebufferResized()) {
 		windowState.setFramebufferResized(false);
@@ -1480,11 +2103,55 @@ void VulkanState::render(
 	}
 
 	currentFrame = (currentFrame + 1) % Config::MAX_FRAMES_IN_FLIGHT;
+	RenderStats::endFrame();
+	AllocTracker::endFrame();
+}
 
-	for (auto& oldRenderPassQueue : oldRenderPassQueue[currentFrame]) {
-		oldRenderPassQueue->cleanup();
+void VulkanState::printBenchmarkReport(std::ostream& out) const {
+	const auto& frameStats = frameTelemetry.getStats();
+	out << "frames: " << frameTelemetry.getFrameCount() << "\n";
+	out << "frame ms: p50 " << frameStats.p50Ms
+		<< " p95 " << frameStats.p95Ms
+		<< " p99 " << frameStats.p99Ms
+		<< " max " << frameStats.maxMs << "\n";
+	out << "stutters: " << frameTelemetry.getStutterCount() << "\n";
+
+	if (gpuProfiler.isEnabled()) {
+		out << "gpu ms: " << gpuProfiler.getFrameTimeMs() << "\n";
+		for (const auto& timing : gpuProfiler.getTimings()) {
+			out << std::string(timing.depth * 2 + 2, ' ') << timing.name << " " << timing.durationMs << " ms";
+			if (timing.hasStatistics) {
+				out << " vs " << timing.statistics.vertexInvocations
+					<< " clip " << timing.statistics.clippingInvocations << "/" << timing.statistics.clippingPrimitives
+					<< " fs " << timing.statistics.fragmentInvocations
+					<< " cs " << timing.statistics.computeInvocations;
+			}
+			out << "\n";
+		}
 	}
-	oldRenderPassQueue[currentFrame].clear();
+
+	AllocTracker::Counters heap = AllocTracker::lastFrame();
+	out << "heap: last frame " << heap.allocations << " allocations " << heap.bytes << " bytes"
+		<< ", steady-state peak " << AllocTracker::peakFrameAllocations() << " allocations\n";
+	std::array<AllocTracker::CallSite, 8> callSites;
+	size_t callSiteCount = AllocTracker::getCallSites(callSites.data(), callSites.size());
+	for (size_t i = 0; i < callSiteCount; ++i) {
+		out << "  " << callSites[i].address << " x" << callSites[i].count << "\n";
+	}
+
+	// per-frame averages, load-time uploads and allocations are included
+	uint64_t frames = std::max<uint64_t>(RenderStats::frameCount(), 1);
+	const auto& total = RenderStats::total();
+	out << "per frame: draws " << total.drawCalls / frames
+		<< " triangles " << total.triangles / frames
+		<< " instances " << total.instances / frames
+		<< " descriptor binds " << total.descriptorBinds / frames
+		<< " buffer binds " << total.bufferBinds / frames
+		<< " pipeline binds " << total.pipelineBinds / frames
+		<< " barriers " << total.barriers / frames
+		<< " bytes uploaded " << total.bytesUploaded / frames
+		<< " allocations " << total.allocations / frames
+		<< " replayed passes " << total.replays / frames << "\n";
 }
 
 VkSurfaceFormatKHR VulkanState::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
@@ -1557,10 +2224,18 @@ bool VulkanState::isDeviceSuitable(const VkPhysicalDevice& device) {
 		SwapchainSupportDetails swapchainSupport = querySwapchainSupport(device);
 		swapchainAdequate = !swapchainSupport.formats.empty() && !swapchainSupport.presentModes.empty();
 	}
-	VkPhysicalDeviceFeatures supportedFeatures;
-	vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
-
-	return indices.isComplete() && extensionsSupported && swapchainAdequate && supportedFeatures.samplerAnisotropy;
+	VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{};
+	timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+	VkPhysicalDeviceFeatures2 supportedFeatures{};
+	supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supportedFeatures.pNext = &timelineSemaphoreFeatures;
+	vkGetPhysicalDeviceFeatures2(device, &supportedFeatures);
+
+	return indices.isComplete()
+		&& extensionsSupported
+		&& swapchainAdequate
+		&& supportedFeatures.features.samplerAnisotropy
+		&& timelineSemaphoreFeatures.timelineSemaphore;
 }
 
 bool VulkanState::checkDeviceExtensionSupport(const VkPhysicalDevice& device) {
@@ -1593,19 +2268,23 @@ QueueFamilyIndices VulkanState::findQueueFamilies(const VkPhysicalDevice& device
 
 	int i = 0;
 	for (const auto& queueFamily : queueFamilies) {
-		if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-			indices.graphicsFamily = i;
-		}
+		if (!indices.isComplete()) {
+			if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+				indices.graphicsFamily = i;
+			}
 
-		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+			VkBool32 presentSupport = false;
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
 
-		if (presentSupport) {
-			indices.presentFamily = i;
+			if (presentSupport) {
+				indices.presentFamily = i;
+			}
 		}
 
-		if (indices.isComplete()) {
-			break;
+		// prefer the pure DMA family over an async compute one
+		bool transferOnly = (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+		if (transferOnly && (!indices.transferFamily.has_value() || !(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT))) {
+			indices.transferFamily = i;
 		}
 
 		++i;
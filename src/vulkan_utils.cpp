@@ -12,6 +12,8 @@
 
 #include "vulkan_vertex.hpp"
 #include "vulkan_types.hpp"
+#include "render_stats.hpp"
+#include "vfs.hpp"
 
 
 namespace VulkanUtils {
@@ -72,6 +74,7 @@ namespace VulkanUtils {
 		if (vkAllocateMemory(device, &allocateInfo, nullptr, &imageMemory) != VK_SUCCESS) {
 			throw std::runtime_error("failed to allocate image memory");
 		}
+		++RenderStats::frame().allocations;
 
 		vkBindImageMemory(device, image, imageMemory, 0);
 	}
@@ -111,21 +114,13 @@ namespace VulkanUtils {
 	}
 
 	std::vector<char> readFile(const std::string& filename) {
-		std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-		if (!file.is_open()) {
+		// the mounted pack first, then the loose file
+		Vfs::File file;
+		if (!Vfs::open(filename, file)) {
 			throw std::runtime_error("failed to open file");
 		}
-
-		std::size_t fileSize = (std::size_t) file.tellg();
-		std::vector<char> buffer(fileSize);
-
-		file.seekg(0);
-		file.read(buffer.data(), fileSize);
-
-		file.close();
-
-		return buffer;
+		const char* begin = reinterpret_cast<const char*>(file.data);
+		return std::vector<char>(begin, begin + file.size);
 	}
 
 	VkFormat findSupportedFormat(VkPhysicalDevice physicalDevice, const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
@@ -184,6 +179,7 @@ namespace VulkanUtils {
 		if (vkAllocateMemory(device, &allocateInfo, nullptr, &bufferMemory)) {
 			throw std::runtime_error("failed to allocate buffer memory");
 		}
+		++RenderStats::frame().allocations;
 
 		vkBindBufferMemory(device, buffer, bufferMemory, 0);
 	}
@@ -282,5 +278,6 @@ namespace VulkanUtils {
 			0, nullptr,
 			1, &resetBarrier
 		);
+		++RenderStats::frame().barriers;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "world_streamer.hpp"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include "cpu_profiler.hpp"
+#include "game_object.hpp"
+#include "graphics_system.hpp"
+
+namespace {
+	float toMilliseconds(int64_t ns) {
+		return static_cast<float>(ns) / 1000000.0f;
+	}
+}
+
+void WorldStreamer::load(const SceneFile::Scene& scene, const std::string& sceneDir) {
+	const SceneFile::Header& header = scene.getHeader();
+	textureDir = scene.getString(header.textureDir);
+	modelDir = scene.getString(header.modelDir);
+	cellSize = header.cellSize;
+	loadRadius = header.loadRadius > 0.0f ? header.loadRadius : Config::WORLD_STREAMING_LOAD_RADIUS;
+
+	auto cellData = scene.getCells();
+	cells.resize(cellData.size());
+	for (size_t i = 0; i < cellData.size(); ++i) {
+		cells[i].x = cellData[i].x;
+		cells[i].z = cellData[i].z;
+		cells[i].manifestPath = sceneDir + std::string(scene.getString(cellData[i].manifest));
+	}
+	candidates.reserve(cells.size());
+}
+
+bool WorldStreamer::update(const glm::vec3& cameraPosition, GraphicsSystem& graphicsSystem) {
+	PROFILE_ZONE("world streaming");
+	bool changed = false;
+	int64_t now = CpuProfiler::now();
+	float unloadRadius = getUnloadRadius();
+	size_t committed = 0;
+
+	for (auto& cell : cells) {
+		float minX = static_cast<float>(cell.x) * cellSize;
+		float minZ = static_cast<float>(cell.z) * cellSize;
+		float dx = std::max({minX - cameraPosition.x, 0.0f, cameraPosition.x - (minX + cellSize)});
+		float dz = std::max({minZ - cameraPosition.z, 0.0f, cameraPosition.z - (minZ + cellSize)});
+		cell.distance = std::sqrt(dx * dx + dz * dz);
+
+		if (cell.state == CellState::LOADING) {
+			changed |= graphicsSystem.applyResidentModels(cell.props, &cell.uploadBeginNs);
+			bool resident = std::all_of(cell.props.begin(), cell.props.end(), [](const AssetData& prop) {
+				return prop.resource.streamTicket == 0;
+			});
+			if (resident) {
+				cell.state = CellState::RESIDENT;
+				cell.residentBytes = 0;
+				for (const auto& prop : cell.props) {
+					cell.residentBytes += prop.resource.residentBytes;
+				}
+				loadLatency.add(toMilliseconds(now - cell.requestNs));
+				if (cell.uploadBeginNs != 0) {
+					uploadLatency.add(toMilliseconds(now - cell.uploadBeginNs));
+				}
+			}
+		}
+
+		if (cell.state != CellState::UNLOADED && cell.distance > unloadRadius) {
+			unloadCell(cell, graphicsSystem);
+			changed = true;
+		}
+		if (cell.state != CellState::UNLOADED) {
+			committed += cell.residentBytes;
+		}
+	}
+
+	// over budget the farthest cells go first
+	while (committed > budget) {
+		Cell* farthest = nullptr;
+		for (auto& cell : cells) {
+			if (cell.state != CellState::UNLOADED && (farthest == nullptr || cell.distance > farthest->distance)) {
+				farthest = &cell;
+			}
+		}
+		if (farthest == nullptr) {
+			break;
+		}
+		committed -= farthest->residentBytes;
+		unloadCell(*farthest, graphicsSystem);
+		changed = true;
+	}
+
+	// nearest cells first, a cell that was loaded before only comes back when its size fits.
+	// the size of a cell that was never loaded is unknown until it is resident
+	candidates.clear();
+	for (size_t i = 0; i < cells.size(); ++i) {
+		if (cells[i].state == CellState::UNLOADED && cells[i].distance <= loadRadius) {
+			candidates.push_back(i);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [this](size_t a, size_t b) {
+		return cells[a].distance < cells[b].distance;
+	});
+	uint32_t started = 0;
+	for (size_t index : candidates) {
+		if (started == Config::WORLD_STREAMING_MAX_CELL_LOADS) {
+			break;
+		}
+		Cell& cell = cells[index];
+		if (committed + cell.residentBytes > budget) {
+			continue;
+		}
+		loadCell(cell, graphicsSystem);
+		committed += cell.residentBytes;
+		++started;
+		changed = true;
+	}
+
+	committedBytes = committed;
+	return changed;
+}
+
+bool WorldStreamer::isLoading() const {
+	return std::any_of(cells.begin(), cells.end(), [](const Cell& cell) {
+		return cell.state == CellState::LOADING;
+	});
+}
+
+void WorldStreamer::cleanup(GraphicsSystem& graphicsSystem) {
+	for (auto& cell : cells) {
+		if (cell.state != CellState::UNLOADED) {
+			unloadCell(cell, graphicsSystem);
+		}
+	}
+	committedBytes = 0;
+}
+
+void WorldStreamer::appendProps(std::vector<AssetData>& assets) const {
+	for (const auto& cell : cells) {
+		assets.insert(assets.end(), cell.props.begin(), cell.props.end());
+	}
+}
+
+void WorldStreamer::loadCell(Cell& cell, GraphicsSystem& graphicsSystem) {
+	PROFILE_ZONE("load cell");
+	cell.requestNs = CpuProfiler::now();
+	cell.uploadBeginNs = 0;
+
+	// manifests are small, read on the main thread. the models they list stream in
+	SceneFile::Scene manifest;
+	manifest.open(cell.manifestPath);
+
+	auto propsData = manifest.getProps();
+	auto instanceGroupData = manifest.getInstanceGroups();
+	cell.props.reserve(propsData.size() + instanceGroupData.size());
+	for (const auto& prop : propsData) {
+		GameObject gameObject(glm::make_vec3(prop.position), glm::make_vec3(prop.direction));
+		AssetData propAsset{gameObject};
+		propAsset.resource = graphicsSystem.requestModelResource(textureDir, modelDir, manifest.getModel(prop.model));
+		cell.props.push_back(propAsset);
+	}
+	for (const auto& group : instanceGroupData) {
+		cell.props.push_back(graphicsSystem.requestInstanceGroup(textureDir, modelDir, manifest, group));
+	}
+	cell.state = CellState::LOADING;
+}
+
+void WorldStreamer::unloadCell(Cell& cell, GraphicsSystem& graphicsSystem) {
+	PROFILE_ZONE("unload cell");
+	int64_t begin = CpuProfiler::now();
+	for (const auto& prop : cell.props) {
+		graphicsSystem.releaseModelResource(prop.resource);
+		graphicsSystem.releaseInstances(prop);
+	}
+	cell.props.clear();
+	cell.state = CellState::UNLOADED;
+	unloadLatency.add(toMilliseconds(CpuProfiler::now() - begin));
+}
@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "asset_pack.hpp"
+
+namespace {
+	// scenes, cell manifests, models, textures and compiled shaders. shader sources stay out
+	bool isPacked(const std::filesystem::path& relative) {
+		std::string directory = relative.has_parent_path() ? relative.begin()->string() : "";
+		std::string extension = relative.extension().string();
+		if (directory.empty()) {
+			return extension == ".json" || extension == ".rtgscene";
+		}
+		if (directory == "shaders") {
+			return extension == ".spv";
+		}
+		return directory == "models" || directory == "textures" || directory == "cells";
+	}
+
+	bool packAssets(const std::filesystem::path& rootDir, const std::string& outputPath) {
+		std::vector<AssetPack::Source> sources;
+		std::error_code error;
+		for (auto it = std::filesystem::recursive_directory_iterator(rootDir, error); !error && it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+			if (!it->is_regular_file()) {
+				continue;
+			}
+			std::filesystem::path relative = it->path().lexically_relative(rootDir);
+			if (!isPacked(relative)) {
+				continue;
+			}
+			sources.push_back({relative.generic_string(), it->path().string()});
+		}
+		if (error) {
+			std::cerr << "failed to walk " << rootDir.string() << ": " << error.message() << std::endl;
+			return false;
+		}
+		std::sort(sources.begin(), sources.end(), [](const AssetPack::Source& a, const AssetPack::Source& b) {
+			return a.path < b.path;
+		});
+
+		std::string message;
+		if (!AssetPack::write(outputPath, sources, message)) {
+			std::cerr << message << std::endl;
+			return false;
+		}
+		std::cout << sources.size() << " files -> " << outputPath << std::endl;
+		return true;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	if (argc == 2 || argc == 3) {
+		std::filesystem::path rootDir = argv[1];
+		std::string outputPath = argc == 3 ? argv[2] : (rootDir / (std::string("assets") + AssetPack::EXTENSION)).string();
+		return packAssets(rootDir, outputPath) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	std::cerr << "usage: AssetPacker <root dir> [output.rtgpack]" << std::endl;
+	return EXIT_FAILURE;
+}
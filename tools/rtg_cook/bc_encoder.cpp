@@ -0,0 +1,264 @@
+#include "bc_encoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	const int TEXEL_COUNT = 16;
+	const int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+	// principal axis of the block by power iteration on the covariance matrix
+	void findEndpoints(const uint8_t* rgba, int channels, float* low, float* high) {
+		float mean[4] = {};
+		for (int i = 0; i < TEXEL_COUNT; ++i) {
+			for (int c = 0; c < channels; ++c) {
+				mean[c] += rgba[i * 4 + c];
+			}
+		}
+		for (int c = 0; c < channels; ++c) {
+			mean[c] /= TEXEL_COUNT;
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < TEXEL_COUNT; ++i) {
+			for (int a = 0; a < channels; ++a) {
+				for (int b = 0; b < channels; ++b) {
+					covariance[a][b] += (rgba[i * 4 + a] - mean[a]) * (rgba[i * 4 + b] - mean[b]);
+				}
+			}
+		}
+
+		float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+		for (int iteration = 0; iteration < 8; ++iteration) {
+			float next[4] = {};
+			float length = 0.0f;
+			for (int a = 0; a < channels; ++a) {
+				for (int b = 0; b < channels; ++b) {
+					next[a] += covariance[a][b] * axis[b];
+				}
+				length += next[a] * next[a];
+			}
+			if (length < 1e-6f) {
+				break;
+			}
+			length = std::sqrt(length);
+			for (int c = 0; c < channels; ++c) {
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float minProjection = 0.0f;
+		float maxProjection = 0.0f;
+		for (int i = 0; i < TEXEL_COUNT; ++i) {
+			float projection = 0.0f;
+			for (int c = 0; c < channels; ++c) {
+				projection += (rgba[i * 4 + c] - mean[c]) * axis[c];
+			}
+			minProjection = std::min(minProjection, projection);
+			maxProjection = std::max(maxProjection, projection);
+		}
+		for (int c = 0; c < channels; ++c) {
+			low[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+			high[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+		}
+	}
+
+	uint16_t packRGB565(const float* color) {
+		int r = static_cast<int>(std::lround(color[0] * 31.0f / 255.0f));
+		int g = static_cast<int>(std::lround(color[1] * 63.0f / 255.0f));
+		int b = static_cast<int>(std::lround(color[2] * 31.0f / 255.0f));
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void unpackRGB565(uint16_t packed, int* color) {
+		int r = (packed >> 11) & 31;
+		int g = (packed >> 5) & 63;
+		int b = packed & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	int distance(const uint8_t* texel, const int* color, int channels) {
+		int sum = 0;
+		for (int c = 0; c < channels; ++c) {
+			int difference = texel[c] - color[c];
+			sum += difference * difference;
+		}
+		return sum;
+	}
+
+	// 8 bytes: two 8 bit endpoints followed by sixteen 3 bit indices
+	void encodeBC4(const uint8_t* rgba, int channel, uint8_t* block) {
+		int high = 0;
+		int low = 255;
+		for (int i = 0; i < TEXEL_COUNT; ++i) {
+			high = std::max<int>(high, rgba[i * 4 + channel]);
+			low = std::min<int>(low, rgba[i * 4 + channel]);
+		}
+		block[0] = static_cast<uint8_t>(high);
+		block[1] = static_cast<uint8_t>(low);
+
+		// endpoint0 > endpoint1 selects the 8 value palette
+		int palette[8] = {high, low};
+		for (int i = 1; i < 7; ++i) {
+			palette[i + 1] = ((7 - i) * high + i * low + 3) / 7;
+		}
+
+		uint64_t indices = 0;
+		if (high != low) {
+			for (int i = 0; i < TEXEL_COUNT; ++i) {
+				int value = rgba[i * 4 + channel];
+				int best = 0;
+				for (int p = 1; p < 8; ++p) {
+					if (std::abs(value - palette[p]) < std::abs(value - palette[best])) {
+						best = p;
+					}
+				}
+				indices |= static_cast<uint64_t>(best) << (i * 3);
+			}
+		}
+		for (int i = 0; i < 6; ++i) {
+			block[2 + i] = static_cast<uint8_t>(indices >> (i * 8));
+		}
+	}
+
+	// little endian bit writer for the 128 bit BC7 block
+	struct BitWriter {
+		uint8_t* block;
+		int position = 0;
+
+		void write(uint32_t value, int count) {
+			for (int i = 0; i < count; ++i, ++position) {
+				if ((value >> i) & 1) {
+					block[position / 8] |= static_cast<uint8_t>(1 << (position % 8));
+				}
+			}
+		}
+	};
+
+	// mode 6 endpoints are 7 bits per channel plus one shared lsb per endpoint
+	void quantizeBC7Endpoint(const float* color, uint8_t* quantized, int& pbit) {
+		int bestError = -1;
+		for (int p = 0; p < 2; ++p) {
+			uint8_t candidate[4];
+			int error = 0;
+			for (int c = 0; c < 4; ++c) {
+				int value = std::clamp(static_cast<int>(std::lround((color[c] - p) / 2.0f)), 0, 127);
+				candidate[c] = static_cast<uint8_t>(value);
+				int difference = ((value << 1) | p) - static_cast<int>(std::lround(color[c]));
+				error += difference * difference;
+			}
+			if (bestError < 0 || error < bestError) {
+				bestError = error;
+				pbit = p;
+				std::memcpy(quantized, candidate, 4);
+			}
+		}
+	}
+}
+
+namespace BcEncoder {
+	void encodeBC1(const uint8_t* rgba, uint8_t* block) {
+		float low[4];
+		float high[4];
+		findEndpoints(rgba, 3, low, high);
+
+		uint16_t color0 = packRGB565(high);
+		uint16_t color1 = packRGB565(low);
+		if (color0 < color1) {
+			std::swap(color0, color1);
+		}
+
+		uint32_t indices = 0;
+		if (color0 != color1) {
+			int palette[4][3];
+			unpackRGB565(color0, palette[0]);
+			unpackRGB565(color1, palette[1]);
+			for (int c = 0; c < 3; ++c) {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+			}
+			for (int i = 0; i < TEXEL_COUNT; ++i) {
+				int best = 0;
+				for (int p = 1; p < 4; ++p) {
+					if (distance(rgba + i * 4, palette[p], 3) < distance(rgba + i * 4, palette[best], 3)) {
+						best = p;
+					}
+				}
+				indices |= static_cast<uint32_t>(best) << (i * 2);
+			}
+		}
+
+		block[0] = static_cast<uint8_t>(color0);
+		block[1] = static_cast<uint8_t>(color0 >> 8);
+		block[2] = static_cast<uint8_t>(color1);
+		block[3] = static_cast<uint8_t>(color1 >> 8);
+		for (int i = 0; i < 4; ++i) {
+			block[4 + i] = static_cast<uint8_t>(indices >> (i * 8));
+		}
+	}
+
+	void encodeBC5(const uint8_t* rgba, uint8_t* block) {
+		encodeBC4(rgba, 0, block);
+		encodeBC4(rgba, 1, block + 8);
+	}
+
+	void encodeBC7(const uint8_t* rgba, uint8_t* block) {
+		float low[4];
+		float high[4];
+		findEndpoints(rgba, 4, low, high);
+
+		uint8_t endpoints[2][4];
+		int pbits[2];
+		quantizeBC7Endpoint(low, endpoints[0], pbits[0]);
+		quantizeBC7Endpoint(high, endpoints[1], pbits[1]);
+
+		int palette[16][4];
+		for (int c = 0; c < 4; ++c) {
+			int e0 = (endpoints[0][c] << 1) | pbits[0];
+			int e1 = (endpoints[1][c] << 1) | pbits[1];
+			for (int i = 0; i < 16; ++i) {
+				palette[i][c] = ((64 - BC7_WEIGHTS[i]) * e0 + BC7_WEIGHTS[i] * e1 + 32) >> 6;
+			}
+		}
+
+		int indices[TEXEL_COUNT];
+		for (int i = 0; i < TEXEL_COUNT; ++i) {
+			int best = 0;
+			int bestDistance = distance(rgba + i * 4, palette[0], 4);
+			for (int p = 1; p < 16; ++p) {
+				int current = distance(rgba + i * 4, palette[p], 4);
+				if (current < bestDistance) {
+					best = p;
+					bestDistance = current;
+				}
+			}
+			indices[i] = best;
+		}
+
+		// the anchor texel stores only 3 bits, so its index must have a clear msb
+		if (indices[0] >= 8) {
+			std::swap(endpoints[0], endpoints[1]);
+			std::swap(pbits[0], pbits[1]);
+			for (int& index : indices) {
+				index = 15 - index;
+			}
+		}
+
+		std::memset(block, 0, 16);
+		BitWriter writer{block};
+		writer.write(1 << 6, 7);
+		for (int c = 0; c < 4; ++c) {
+			writer.write(endpoints[0][c], 7);
+			writer.write(endpoints[1][c], 7);
+		}
+		writer.write(pbits[0], 1);
+		writer.write(pbits[1], 1);
+		writer.write(indices[0], 3);
+		for (int i = 1; i < TEXEL_COUNT; ++i) {
+			writer.write(indices[i], 4);
+		}
+	}
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+// block compression of a single 4x4 block of RGBA8 texels (row major, 16 texels)
+namespace BcEncoder {
+	// 8 bytes, opaque 4 color mode
+	void encodeBC1(const uint8_t* rgba, uint8_t* block);
+	// 16 bytes, red and green as two BC4 halves
+	void encodeBC5(const uint8_t* rgba, uint8_t* block);
+	// 16 bytes, mode 6 only (single subset RGBA with 4 bit indices)
+	void encodeBC7(const uint8_t* rgba, uint8_t* block);
+}
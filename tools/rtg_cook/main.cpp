@@ -0,0 +1,355 @@
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "asset_pack.hpp"
+#include "cook_manifest.hpp"
+#include "ktx2.hpp"
+#include "mesh_file.hpp"
+#include "mesh_optimizer.hpp"
+#include "texture_cook.hpp"
+
+namespace {
+	// bump when an output changes without its settings string changing, recooks everything
+	const uint32_t COOK_VERSION = 4;
+	const char SPIRV_FORMAT[] = "spirv";
+
+	enum class JobKind {
+		TEXTURE,
+		MESH,
+		SHADER
+	};
+
+	struct Job {
+		Job(JobKind kind, std::string source, std::string output, std::string settings)
+			: kind(kind), source(std::move(source)), output(std::move(output)), settings(std::move(settings)) {}
+
+		JobKind kind;
+		// relative to the root, forward slashes
+		std::string source;
+		std::string output;
+		// texture role or shader compiler arguments, part of the input hash
+		std::string settings;
+		// bytes of the source, 0 when it can't be read
+		uintmax_t sourceSize = 0;
+
+		bool succeeded = false;
+		bool upToDate = false;
+		std::string message;
+		CookManifest::Entry entry;
+	};
+
+	struct Options {
+		std::filesystem::path root;
+		std::string assetsPath;
+		std::string glslc = "glslc";
+		uint32_t threadCount = 0;
+		bool force = false;
+	};
+
+	uint64_t hashBytes(const uint8_t* bytes, size_t size, uint64_t hash = 14695981039346656037ull) {
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	bool readFile(const std::filesystem::path& path, std::vector<uint8_t>& bytes) {
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			return false;
+		}
+		bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return true;
+	}
+
+	bool readJson(const std::filesystem::path& path, nlohmann::json& json) {
+		std::ifstream file(path);
+		if (!file.is_open()) {
+			std::cerr << "failed to open " << path.string() << std::endl;
+			return false;
+		}
+		json = nlohmann::json::parse(file, nullptr, false);
+		if (json.is_discarded()) {
+			std::cerr << "failed to parse " << path.string() << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	std::string replaceExtension(const std::string& path, const std::string& extension) {
+		return std::filesystem::path(path).replace_extension(extension).generic_string();
+	}
+
+	const char* formatOf(JobKind kind) {
+		switch (kind) {
+			case JobKind::TEXTURE:
+				return Ktx2::FORMAT;
+			case JobKind::MESH:
+				return MeshFile::FORMAT;
+			default:
+				return SPIRV_FORMAT;
+		}
+	}
+
+	// textures with their roles and the models of every object in the scene and its world cells
+	void collectAssets(const nlohmann::json& group, const std::string& textureDir, const std::string& modelDir, std::vector<Job>& jobs, std::unordered_set<std::string>& outputs) {
+		for (const auto& asset : group) {
+			if (asset.contains("textures")) {
+				for (const auto& [role, value] : asset["textures"].items()) {
+					std::string source = textureDir + "/" + value.get<std::string>();
+					std::string output = replaceExtension(source, ".ktx2");
+					if (outputs.insert(output).second) {
+						jobs.push_back({JobKind::TEXTURE, source, output, role});
+					}
+				}
+			}
+			std::string source = modelDir + "/" + asset["model"].get<std::string>();
+			std::string output = replaceExtension(source, MeshFile::EXTENSION);
+			if (outputs.insert(output).second) {
+				jobs.push_back({JobKind::MESH, source, output, ""});
+			}
+		}
+	}
+
+	bool collectSceneJobs(const Options& options, std::vector<Job>& jobs) {
+		nlohmann::json assets;
+		if (!readJson(options.assetsPath, assets)) {
+			return false;
+		}
+		std::string textureDir = assets["textureDir"];
+		std::string modelDir = assets["modelDir"];
+		std::unordered_set<std::string> outputs;
+		for (const char* group : {"characters", "props", "instances"}) {
+			if (assets.contains(group)) {
+				collectAssets(assets[group], textureDir, modelDir, jobs, outputs);
+			}
+		}
+		if (assets.contains("world")) {
+			for (const auto& cell : assets["world"]["cells"]) {
+				nlohmann::json manifest;
+				if (!readJson(options.root / cell["manifest"].get<std::string>(), manifest)) {
+					return false;
+				}
+				for (const char* group : {"props", "instances"}) {
+					if (manifest.contains(group)) {
+						collectAssets(manifest[group], textureDir, modelDir, jobs, outputs);
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	// every GLSL stage under shaders/, named like compile.sh does: forward.vert -> forward_vert.spv
+	void collectShaderJobs(const Options& options, std::vector<Job>& jobs) {
+		static const std::unordered_set<std::string> rasterStages = {".vert", ".frag", ".comp", ".geom", ".tesc", ".tese"};
+		static const std::unordered_set<std::string> rayTracingStages = {".rgen", ".rmiss", ".rchit", ".rahit", ".rint", ".rcall"};
+		std::error_code error;
+		for (const auto& file : std::filesystem::directory_iterator(options.root / "shaders", error)) {
+			std::string extension = file.path().extension().string();
+			bool rayTracing = rayTracingStages.count(extension) > 0;
+			if (!file.is_regular_file() || (!rayTracing && rasterStages.count(extension) == 0)) {
+				continue;
+			}
+			std::string source = "shaders/" + file.path().filename().string();
+			std::string output = "shaders/" + file.path().stem().string() + "_" + extension.substr(1) + ".spv";
+			jobs.push_back({JobKind::SHADER, source, output, rayTracing ? "--target-env=vulkan1.3" : ""});
+		}
+		std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) {
+			return a.source < b.source;
+		});
+	}
+
+	bool cookShader(const Options& options, const Job& job, std::string& message) {
+		std::filesystem::path input = options.root / job.source;
+		std::filesystem::path output = options.root / job.output;
+		std::string command = options.glslc + " \"" + input.string() + "\" " + job.settings + " -o \"" + output.string() + "\"";
+		if (std::system(command.c_str()) != 0) {
+			message = "glslc failed";
+			return false;
+		}
+		std::vector<uint8_t> code;
+		if (!readFile(output, code) || !AssetPack::isSpirv(code.data(), code.size())) {
+			message = "glslc didn't write SPIR-V";
+			return false;
+		}
+		message = std::to_string(code.size() / 4) + " words";
+		return true;
+	}
+
+	bool cookMesh(const Options& options, const Job& job, const std::vector<uint8_t>& bytes, std::string& message) {
+		MeshFile::Mesh mesh;
+		if (!MeshFile::loadObj(bytes.data(), bytes.size(), mesh, message)) {
+			return false;
+		}
+		MeshOptimizer::Stats stats = MeshOptimizer::optimize(mesh);
+		std::filesystem::path output = options.root / job.output;
+		if (!MeshFile::write(output.string(), mesh)) {
+			message = "failed to write " + output.string();
+			return false;
+		}
+		char acmr[160];
+		std::snprintf(acmr, sizeof(acmr), ", ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %u meshlets, %u LODs down to %u triangles at error %g",
+			stats.acmrBefore, stats.acmrAfter, stats.atvrBefore, stats.atvrAfter, stats.meshlets, stats.lodCount, stats.lodTriangles, stats.lodError);
+		message = std::to_string(mesh.vertices.size()) + " vertices, " + std::to_string(mesh.lods[0].indexCount / 3) + " triangles" + acmr;
+		return true;
+	}
+
+	void runJob(const Options& options, const CookManifest::Entries& previous, Job& job) {
+		std::vector<uint8_t> bytes;
+		if (!readFile(options.root / job.source, bytes)) {
+			job.message = "failed to open the source";
+			return;
+		}
+		std::string settings = std::to_string(COOK_VERSION) + " " + formatOf(job.kind) + " " + job.settings;
+		if (job.kind == JobKind::SHADER) {
+			settings += " " + options.glslc;
+		}
+		job.entry.source = job.source;
+		job.entry.format = formatOf(job.kind);
+		job.entry.inputHash = hashBytes(reinterpret_cast<const uint8_t*>(settings.data()), settings.size(), hashBytes(bytes.data(), bytes.size()));
+
+		std::filesystem::path output = options.root / job.output;
+		std::error_code error;
+		auto found = previous.find(job.output);
+		if (!options.force && found != previous.end() && found->second.inputHash == job.entry.inputHash && found->second.format == job.entry.format) {
+			uint64_t size = std::filesystem::file_size(output, error);
+			if (!error && size == found->second.size) {
+				job.entry = found->second;
+				job.upToDate = true;
+				job.succeeded = true;
+				return;
+			}
+		}
+
+		switch (job.kind) {
+			case JobKind::TEXTURE:
+				job.succeeded = cookTexture(job.settings, bytes.data(), bytes.size(), output.string(), job.message);
+				break;
+			case JobKind::MESH:
+				job.succeeded = cookMesh(options, job, bytes, job.message);
+				break;
+			case JobKind::SHADER:
+				job.succeeded = cookShader(options, job, job.message);
+				break;
+		}
+		if (job.succeeded) {
+			job.entry.size = std::filesystem::file_size(output, error);
+			job.succeeded = !error;
+		}
+	}
+
+	bool cook(const Options& options) {
+		std::vector<Job> jobs;
+		if (!collectSceneJobs(options, jobs)) {
+			return false;
+		}
+		std::vector<Job> shaderJobs;
+		collectShaderJobs(options, shaderJobs);
+		jobs.insert(jobs.end(), shaderJobs.begin(), shaderJobs.end());
+
+		std::filesystem::path manifestPath = options.root / CookManifest::FILENAME;
+		CookManifest::Entries previous;
+		CookManifest::read(manifestPath.string(), previous);
+
+		// the biggest sources tend to be the slowest, starting them first shortens the tail
+		for (auto& job : jobs) {
+			std::error_code sizeError;
+			uintmax_t size = std::filesystem::file_size(options.root / job.source, sizeError);
+			job.sourceSize = sizeError ? 0 : size;
+		}
+		std::stable_sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) {
+			return a.sourceSize > b.sourceSize;
+		});
+
+		std::atomic<size_t> nextJob{0};
+		std::mutex outputMutex;
+		auto worker = [&]() {
+			for (size_t i = nextJob++; i < jobs.size(); i = nextJob++) {
+				Job& job = jobs[i];
+				runJob(options, previous, job);
+				if (job.upToDate) {
+					continue;
+				}
+				std::lock_guard<std::mutex> lock(outputMutex);
+				if (job.succeeded) {
+					std::cout << job.source << " -> " << job.output << " (" << job.message << ")" << std::endl;
+				} else {
+					std::cerr << "failed to cook " << job.source << ": " << job.message << std::endl;
+				}
+			}
+		};
+		uint32_t threadCount = options.threadCount > 0 ? options.threadCount : std::max(std::thread::hardware_concurrency(), 1u);
+		threadCount = std::min<uint32_t>(threadCount, static_cast<uint32_t>(std::max<size_t>(jobs.size(), 1)));
+		std::vector<std::thread> threads;
+		for (uint32_t i = 1; i < threadCount; ++i) {
+			threads.emplace_back(worker);
+		}
+		worker();
+		for (auto& thread : threads) {
+			thread.join();
+		}
+
+		// failed outputs drop out of the manifest so the runtime falls back to their sources
+		CookManifest::Entries entries;
+		size_t cooked = 0;
+		size_t upToDate = 0;
+		size_t failed = 0;
+		for (const auto& job : jobs) {
+			if (!job.succeeded) {
+				++failed;
+				continue;
+			}
+			++(job.upToDate ? upToDate : cooked);
+			entries.emplace(job.output, job.entry);
+		}
+		if (!CookManifest::write(manifestPath.string(), entries)) {
+			std::cerr << "failed to write " << manifestPath.string() << std::endl;
+			return false;
+		}
+		std::cout << cooked << " cooked, " << upToDate << " up to date, " << failed << " failed on " << threadCount << " threads" << std::endl;
+		return failed == 0;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	Options options;
+	if (const char* glslc = std::getenv("GLSLC")) {
+		options.glslc = glslc;
+	}
+	for (int i = 1; i < argc; ++i) {
+		std::string argument = argv[i];
+		if (argument == "--force") {
+			options.force = true;
+		} else if (argument == "--jobs" && i + 1 < argc) {
+			options.threadCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (options.assetsPath.empty()) {
+			options.assetsPath = argument;
+		} else {
+			options.assetsPath.clear();
+			break;
+		}
+	}
+	if (options.assetsPath.empty()) {
+		std::cerr << "usage: rtg-cook <assets.json> [--force] [--jobs N]" << std::endl;
+		std::cerr << "       the GLSLC environment variable overrides the shader compiler" << std::endl;
+		return EXIT_FAILURE;
+	}
+	options.root = std::filesystem::path(options.assetsPath).parent_path();
+	return cook(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
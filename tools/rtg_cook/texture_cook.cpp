@@ -0,0 +1,154 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "texture_cook.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "bc_encoder.hpp"
+#include "ktx2.hpp"
+
+namespace {
+	struct Image {
+		uint32_t width = 0;
+		uint32_t height = 0;
+		std::vector<uint8_t> rgba;
+	};
+
+	float srgbToLinear(float value) {
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float linearToSrgb(float value) {
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+	}
+
+	// 2x2 box filter, colors are averaged in linear space when the image is sRGB encoded
+	Image downsample(const Image& source, bool srgb) {
+		static std::array<float, 256> decode = [] {
+			std::array<float, 256> table{};
+			for (int i = 0; i < 256; ++i) {
+				table[i] = srgbToLinear(i / 255.0f);
+			}
+			return table;
+		}();
+
+		Image result;
+		result.width = std::max<uint32_t>(source.width / 2, 1);
+		result.height = std::max<uint32_t>(source.height / 2, 1);
+		result.rgba.resize(static_cast<size_t>(result.width) * result.height * 4);
+		for (uint32_t y = 0; y < result.height; ++y) {
+			for (uint32_t x = 0; x < result.width; ++x) {
+				float sum[4] = {};
+				for (uint32_t dy = 0; dy < 2; ++dy) {
+					for (uint32_t dx = 0; dx < 2; ++dx) {
+						uint32_t sx = std::min(x * 2 + dx, source.width - 1);
+						uint32_t sy = std::min(y * 2 + dy, source.height - 1);
+						const uint8_t* texel = &source.rgba[(static_cast<size_t>(sy) * source.width + sx) * 4];
+						for (int c = 0; c < 4; ++c) {
+							sum[c] += (srgb && c < 3) ? decode[texel[c]] : texel[c] / 255.0f;
+						}
+					}
+				}
+				uint8_t* texel = &result.rgba[(static_cast<size_t>(y) * result.width + x) * 4];
+				for (int c = 0; c < 4; ++c) {
+					float value = sum[c] / 4.0f;
+					if (srgb && c < 3) {
+						value = linearToSrgb(value);
+					}
+					texel[c] = static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+				}
+			}
+		}
+		return result;
+	}
+
+	void compressLevel(const Image& image, uint32_t vkFormat, std::vector<uint8_t>& output) {
+		uint32_t blockBytes = Ktx2::blockSize(vkFormat);
+		uint32_t blocksX = (image.width + 3) / 4;
+		uint32_t blocksY = (image.height + 3) / 4;
+		uint8_t texels[16 * 4];
+		uint8_t block[16];
+		for (uint32_t by = 0; by < blocksY; ++by) {
+			for (uint32_t bx = 0; bx < blocksX; ++bx) {
+				// blocks past the edge repeat the last row and column
+				for (uint32_t y = 0; y < 4; ++y) {
+					for (uint32_t x = 0; x < 4; ++x) {
+						uint32_t sx = std::min(bx * 4 + x, image.width - 1);
+						uint32_t sy = std::min(by * 4 + y, image.height - 1);
+						std::memcpy(&texels[(y * 4 + x) * 4], &image.rgba[(static_cast<size_t>(sy) * image.width + sx) * 4], 4);
+					}
+				}
+				switch (vkFormat) {
+					case Ktx2::FORMAT_BC1_RGB_SRGB:
+					case Ktx2::FORMAT_BC1_RGB_UNORM:
+						BcEncoder::encodeBC1(texels, block);
+						break;
+					case Ktx2::FORMAT_BC5_UNORM:
+						BcEncoder::encodeBC5(texels, block);
+						break;
+					default:
+						BcEncoder::encodeBC7(texels, block);
+						break;
+				}
+				output.insert(output.end(), block, block + blockBytes);
+			}
+		}
+	}
+
+	// albedo keeps its alpha only when it has one, normal and material data are two linear channels
+	uint32_t chooseFormat(const std::string& role, const Image& image) {
+		if (role == "normal" || role == "material") {
+			return Ktx2::FORMAT_BC5_UNORM;
+		}
+		for (size_t i = 3; i < image.rgba.size(); i += 4) {
+			if (image.rgba[i] != 255) {
+				return Ktx2::FORMAT_BC7_SRGB;
+			}
+		}
+		return Ktx2::FORMAT_BC1_RGB_SRGB;
+	}
+}
+
+bool cookTexture(const std::string& role, const uint8_t* bytes, size_t size, const std::string& outputPath, std::string& message) {
+	int width, height, channels;
+	stbi_uc* pixels = stbi_load_from_memory(bytes, static_cast<int>(size), &width, &height, &channels, STBI_rgb_alpha);
+	if (!pixels) {
+		message = "failed to decode the image";
+		return false;
+	}
+	Image level;
+	level.width = static_cast<uint32_t>(width);
+	level.height = static_cast<uint32_t>(height);
+	level.rgba.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+	stbi_image_free(pixels);
+
+	Ktx2::Texture texture;
+	texture.vkFormat = chooseFormat(role, level);
+	texture.width = level.width;
+	texture.height = level.height;
+	bool srgb = texture.vkFormat != Ktx2::FORMAT_BC5_UNORM;
+
+	// same chain length as the runtime blit path: down to 1x1
+	uint32_t levelCount = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+	for (uint32_t i = 0; i < levelCount; ++i) {
+		if (i > 0) {
+			level = downsample(level, srgb);
+		}
+		Ktx2::Level entry;
+		entry.offset = texture.data.size();
+		compressLevel(level, texture.vkFormat, texture.data);
+		entry.size = texture.data.size() - entry.offset;
+		texture.levels.push_back(entry);
+	}
+
+	if (!Ktx2::write(outputPath, texture)) {
+		message = "failed to write " + outputPath;
+		return false;
+	}
+	message = "format " + std::to_string(texture.vkFormat) + ", " + std::to_string(levelCount) + " levels";
+	return true;
+}
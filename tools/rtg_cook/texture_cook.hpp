@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// block compresses an encoded image into a KTX2 file with a full mip chain (albedo: BC1, or BC7 when
+// it has alpha, normal and material maps: BC5). message describes the output or the failure
+bool cookTexture(const std::string& role, const uint8_t* bytes, size_t size, const std::string& outputPath, std::string& message);
@@ -0,0 +1,60 @@
+#include <nlohmann/json.hpp>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "scene_file.hpp"
+
+namespace {
+	bool compileManifest(const std::filesystem::path& manifestPath, nlohmann::json& json) {
+		std::ifstream file(manifestPath);
+		if (!file.is_open()) {
+			std::cerr << "failed to open " << manifestPath.string() << std::endl;
+			return false;
+		}
+		std::vector<uint8_t> bytes;
+		try {
+			json = nlohmann::json::parse(file);
+			bytes = SceneFile::compile(json);
+		} catch (const std::exception& e) {
+			std::cerr << "failed to compile " << manifestPath.string() << ": " << e.what() << std::endl;
+			return false;
+		}
+		std::string outputPath = SceneFile::compiledPath(manifestPath.string());
+		if (!SceneFile::write(outputPath, bytes)) {
+			std::cerr << "failed to write " << outputPath << std::endl;
+			return false;
+		}
+		std::cout << manifestPath.string() << " -> " << outputPath << " (" << bytes.size() << " bytes)" << std::endl;
+		return true;
+	}
+
+	// compiles assets.json and the manifests of its world cells next to each of them
+	bool compileScene(const std::string& assetsPath) {
+		nlohmann::json assets;
+		if (!compileManifest(assetsPath, assets)) {
+			return false;
+		}
+		bool succeeded = true;
+		if (assets.contains("world")) {
+			std::filesystem::path sceneDir = std::filesystem::path(assetsPath).parent_path();
+			for (const auto& cell : assets["world"]["cells"]) {
+				nlohmann::json manifest;
+				succeeded &= compileManifest(sceneDir / cell["manifest"].get<std::string>(), manifest);
+			}
+		}
+		return succeeded;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	if (argc == 2) {
+		return compileScene(argv[1]) ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	std::cerr << "usage: SceneCompiler <assets.json>" << std::endl;
+	return EXIT_FAILURE;
+}